@@ -0,0 +1,252 @@
+#include "accessor_view.h"
+
+#include <logger.h>
+#include <tiny_gltf.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WVK_ACCESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace wvk {
+
+AccessorView::AccessorView(const tinygltf::Model &model, int accessorIndex) {
+    if (accessorIndex < 0 || accessorIndex >= static_cast<int>(model.accessors.size())) {
+        logger::fatal_error("glTF accessor index out of range");
+    }
+    const tinygltf::Accessor &accessor = model.accessors[accessorIndex];
+    if (accessor.sparse.isSparse) {
+        logger::fatal_error("Sparse glTF accessors are not supported");
+    }
+
+    int components = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+    uint32_t componentCount = components > 0 ? static_cast<uint32_t>(components) : 0;
+
+    // The spec reads accessors without a buffer view as zeros
+    if (accessor.bufferView < 0) {
+        *this = AccessorView{nullptr, 0, 0, 0, accessor.count, accessor.componentType, componentCount,
+                             accessor.normalized};
+        return;
+    }
+
+    if (accessor.bufferView >= static_cast<int>(model.bufferViews.size())) {
+        logger::fatal_error("glTF accessor buffer view out of range");
+    }
+    const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+    if (bufferView.buffer < 0 || bufferView.buffer >= static_cast<int>(model.buffers.size())) {
+        logger::fatal_error("glTF buffer view buffer out of range");
+    }
+    const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+    if (bufferView.byteOffset > buffer.data.size() || bufferView.byteLength > buffer.data.size() - bufferView.byteOffset) {
+        logger::fatal_error("glTF buffer view reads past the end of its buffer");
+    }
+
+    *this = AccessorView{buffer.data.data() + bufferView.byteOffset, bufferView.byteLength, bufferView.byteStride,
+                         accessor.byteOffset, accessor.count, accessor.componentType, componentCount,
+                         accessor.normalized};
+}
+
+AccessorView::AccessorView(const uint8_t *view, size_t viewLength, size_t byteStride, size_t byteOffset, size_t count,
+                           int componentType, uint32_t componentCount, bool normalized)
+    : count(count), componentType(componentType), componentCount(componentCount), normalized(normalized) {
+    int size = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(componentType));
+    if (componentCount == 0 || componentCount > 4 || size <= 0) {
+        logger::fatal_error("Unsupported glTF accessor type");
+    }
+    componentSize = static_cast<uint32_t>(size);
+
+    if (view == nullptr) return;
+
+    size_t elementSize = componentSize * componentCount;
+    stride = byteStride != 0 ? byteStride : elementSize;
+    if (stride % componentSize != 0 || stride < elementSize) {
+        logger::fatal_error("Invalid glTF buffer view stride");
+    }
+
+    if (byteOffset > viewLength ||
+        (count > 0 && (viewLength - byteOffset < elementSize || (count - 1) > (viewLength - byteOffset - elementSize) / stride))) {
+        logger::fatal_error("glTF accessor reads past the end of its buffer view");
+    }
+
+    data = view + byteOffset;
+}
+
+/* Conversion */
+
+template <typename Component>
+static float normalizedFloat(Component value) {
+    // Signed values use the symmetric range, the most negative value clamps to -1
+    float result = static_cast<float>(value) / static_cast<float>(std::numeric_limits<Component>::max());
+    return std::max(result, -1.0f);
+}
+
+template <typename Component>
+static void convertFloats(const uint8_t *data, size_t count, size_t stride, uint32_t componentCount, bool normalized,
+                          float *out, uint32_t components) {
+    uint32_t stored = std::min(componentCount, components);
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *element = data + i * stride;
+        float *result = out + i * components;
+
+        for (uint32_t c = 0; c < stored; c++) {
+            Component value;
+            memcpy(&value, element + c * sizeof(Component), sizeof(Component));
+            result[c] = normalized ? normalizedFloat(value) : static_cast<float>(value);
+        }
+        for (uint32_t c = stored; c < components; c++) {
+            result[c] = 0.0f;
+        }
+    }
+}
+
+template <typename Component>
+static void convertUints(const uint8_t *data, size_t count, size_t stride, uint32_t componentCount,
+                         uint32_t *out, uint32_t components) {
+    uint32_t stored = std::min(componentCount, components);
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *element = data + i * stride;
+        uint32_t *result = out + i * components;
+
+        for (uint32_t c = 0; c < stored; c++) {
+            Component value;
+            memcpy(&value, element + c * sizeof(Component), sizeof(Component));
+            result[c] = static_cast<uint32_t>(value);
+        }
+        for (uint32_t c = stored; c < components; c++) {
+            result[c] = 0;
+        }
+    }
+}
+
+#ifdef WVK_ACCESSOR_SSE2
+
+// Zero extends the four unsigned bytes or shorts of an element to 32 bit lanes
+static __m128i widenBytes(const uint8_t *element) {
+    int32_t packed;
+    memcpy(&packed, element, sizeof(packed));
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+}
+
+static __m128i widenShorts(const uint8_t *element) {
+    __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(element));
+    return _mm_unpacklo_epi16(packed, _mm_setzero_si128());
+}
+
+// Four component unsigned bytes or shorts, by far the most common integer attributes (joints and weights)
+template <__m128i (*Widen)(const uint8_t *)>
+static void convertVec4Floats(const uint8_t *data, size_t count, size_t stride, float maximum, bool normalized,
+                              float *out) {
+    __m128 divisor = _mm_set1_ps(normalized ? maximum : 1.0f);
+    for (size_t i = 0; i < count; i++) {
+        __m128 values = _mm_cvtepi32_ps(Widen(data + i * stride));
+        _mm_storeu_ps(out + 4 * i, _mm_div_ps(values, divisor));
+    }
+}
+
+template <__m128i (*Widen)(const uint8_t *)>
+static void convertVec4Uints(const uint8_t *data, size_t count, size_t stride, uint32_t *out) {
+    for (size_t i = 0; i < count; i++) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * i), Widen(data + i * stride));
+    }
+}
+
+#endif
+
+void AccessorView::readFloats(float *out, uint32_t components) const {
+    if (data == nullptr) {
+        std::fill(out, out + count * components, 0.0f);
+        return;
+    }
+
+    switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        if (componentCount == components && stride == components * sizeof(float)) {
+            memcpy(out, data, count * stride);
+            return;
+        }
+        convertFloats<float>(data, count, stride, componentCount, false, out, components);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+#ifdef WVK_ACCESSOR_SSE2
+        if (componentCount == 4 && components == 4) {
+            convertVec4Floats<widenBytes>(data, count, stride, 255.0f, normalized, out);
+            return;
+        }
+#endif
+        convertFloats<uint8_t>(data, count, stride, componentCount, normalized, out, components);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+#ifdef WVK_ACCESSOR_SSE2
+        if (componentCount == 4 && components == 4) {
+            convertVec4Floats<widenShorts>(data, count, stride, 65535.0f, normalized, out);
+            return;
+        }
+#endif
+        convertFloats<uint16_t>(data, count, stride, componentCount, normalized, out, components);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        convertFloats<int8_t>(data, count, stride, componentCount, normalized, out, components);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+        convertFloats<int16_t>(data, count, stride, componentCount, normalized, out, components);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        convertFloats<uint32_t>(data, count, stride, componentCount, false, out, components);
+        return;
+    default:
+        logger::fatal_error("Unsupported glTF component type " + std::to_string(componentType));
+    }
+}
+
+void AccessorView::readUints(uint32_t *out, uint32_t components) const {
+    if (data == nullptr) {
+        std::fill(out, out + count * components, 0u);
+        return;
+    }
+
+    switch (componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+#ifdef WVK_ACCESSOR_SSE2
+        if (componentCount == 4 && components == 4) {
+            convertVec4Uints<widenBytes>(data, count, stride, out);
+            return;
+        }
+#endif
+        convertUints<uint8_t>(data, count, stride, componentCount, out, components);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+#ifdef WVK_ACCESSOR_SSE2
+        if (componentCount == 4 && components == 4) {
+            convertVec4Uints<widenShorts>(data, count, stride, out);
+            return;
+        }
+#endif
+        convertUints<uint16_t>(data, count, stride, componentCount, out, components);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        if (componentCount == components && stride == components * sizeof(uint32_t)) {
+            memcpy(out, data, count * stride);
+            return;
+        }
+        convertUints<uint32_t>(data, count, stride, componentCount, out, components);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        convertUints<int8_t>(data, count, stride, componentCount, out, components);
+        return;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+        convertUints<int16_t>(data, count, stride, componentCount, out, components);
+        return;
+    default:
+        logger::fatal_error("readUints :: accessor does not have an integer component type");
+    }
+}
+
+}
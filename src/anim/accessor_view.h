@@ -0,0 +1,122 @@
+#pragma once
+
+#include "../glm.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+namespace tinygltf {
+    class Model;
+};
+
+namespace wvk {
+
+// Elements of type T spaced stride bytes apart. glTF only aligns elements to their component size, so they are
+// read with memcpy rather than through a T pointer.
+template <typename T>
+class StridedRange {
+  public:
+    class Iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = T;
+
+        Iterator(const uint8_t *element, size_t stride) : element(element), stride(stride) {}
+
+        T operator*() const {
+            T value;
+            memcpy(&value, element, sizeof(T));
+            return value;
+        }
+        Iterator &operator++() {
+            element += stride;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            element += stride;
+            return previous;
+        }
+        bool operator==(const Iterator &other) const { return element == other.element; }
+        bool operator!=(const Iterator &other) const { return element != other.element; }
+
+      private:
+        const uint8_t *element;
+        size_t stride;
+    };
+
+    StridedRange(const uint8_t *data, size_t count, size_t stride) : data(data), count(count), stride(stride) {}
+
+    size_t size() const { return count; }
+    T operator[](size_t index) const { return *Iterator{data + index * stride, stride}; }
+
+    Iterator begin() const { return {data, stride}; }
+    Iterator end() const { return {data + count * stride, stride}; }
+
+  private:
+    const uint8_t *data;
+    size_t count;
+    size_t stride;
+};
+
+/*
+ * Typed view of a glTF accessor. The buffer, offset and byte stride are resolved once when the view is created, so
+ * a whole attribute can be iterated or converted in one pass instead of looking the accessor up for every element.
+ * Sparse accessors and matrix types are not supported.
+ */
+class AccessorView {
+  public:
+    AccessorView() = default;
+    // Fatal error if the accessor is unsupported or its data doesn't fit in its buffer view
+    AccessorView(const tinygltf::Model &model, int accessorIndex);
+    // Accessor into the bytes of a buffer view, described by its glTF JSON fields. A null view reads as zeros and
+    // byteStride 0 means tightly packed elements. Fatal error as above.
+    AccessorView(const uint8_t *view, size_t viewLength, size_t byteStride, size_t byteOffset, size_t count,
+                 int componentType, uint32_t componentCount, bool normalized);
+
+    size_t size() const { return count; }
+    int getComponentType() const { return componentType; }
+    uint32_t getComponentCount() const { return componentCount; }
+    bool isNormalized() const { return normalized; }
+
+    // Elements as they are stored, T has to match the layout (e.g. glm::vec3 for float VEC3). Accessors without a
+    // buffer view have no stored elements, only the read functions below handle them.
+    template <typename T>
+    StridedRange<T> as() const {
+        return {data, data != nullptr ? count : 0, stride};
+    }
+
+    // Converts every element to components floats, written one element after the other. Normalized integers map to
+    // [0, 1] or [-1, 1] as the glTF spec describes, other integers convert as they are and missing components are 0.
+    // out must have room for size() * components floats.
+    void readFloats(float *out, uint32_t components) const;
+
+    // Widens integer components (joints, indices) to 32 bits, with the same layout as readFloats. Fatal error for
+    // float accessors.
+    void readUints(uint32_t *out, uint32_t components) const;
+
+    // Whole attribute converted to a glm vector type
+    template <typename Vec>
+    std::vector<Vec> readVectors() const {
+        std::vector<Vec> result(count);
+        readFloats(reinterpret_cast<float *>(result.data()), static_cast<uint32_t>(Vec::length()));
+        return result;
+    }
+
+  private:
+    const uint8_t *data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    int componentType = 0;
+    uint32_t componentCount = 0;
+    uint32_t componentSize = 0;
+    bool normalized = false;
+};
+
+}
@@ -4,28 +4,162 @@
 
 #include <logger.h>
 
-#include "../resource_path.h"
+#include "accessor_view.h"
+#include "../asset/asset_file_system.h"
+#include "../mesh/glb_file.h"
+#include "../mesh/mesh_optimizer.h"
+#include "../mesh/simplifier.h"
+#include "../mesh/vertex_welder.h"
+#include "../cpu_profiler.h"
+#include "../derived_data_cache.h"
+#include "../mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace wvk {
 
-Skeleton::Skeleton(std::string filename) {
-    std::string path = resourcePath() + filename;
+/* Derived data cache */
+
+// Bump whenever RiggedMeshVertex, the layout below or the cooking in finishSkeleton() changes
+static const uint32_t COOKED_SKELETON_MAGIC = 0x4c4b5357; // "WSKL"
+static const uint32_t COOKED_SKELETON_VERSION = 1;
+
+// A .wskel file is this header, the vertices, the full detail indices, one CookedSkeletonLod per LOD and the LOD
+// indices one after the other. Joints aren't read from the source yet, so only the mesh is stored.
+struct CookedSkeletonHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t contentHash;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    uint32_t padding;
+};
+
+struct CookedSkeletonLod {
+    uint32_t indexCount;
+    float error;
+};
+
+std::vector<uint8_t> Skeleton::serializeCooked(uint64_t contentHash) const {
+    CookedSkeletonHeader header{};
+    header.magic = COOKED_SKELETON_MAGIC;
+    header.version = COOKED_SKELETON_VERSION;
+    header.contentHash = contentHash;
+    header.vertexCount = static_cast<uint32_t>(skeletonData.vertices.size());
+    header.indexCount = static_cast<uint32_t>(skeletonData.indices.size());
+    header.lodCount = static_cast<uint32_t>(skeletonData.lods.size());
+
+    std::vector<uint8_t> bytes;
+    auto append = [&](const void *data, size_t size) {
+        const uint8_t *begin = static_cast<const uint8_t *>(data);
+        bytes.insert(bytes.end(), begin, begin + size);
+    };
+    append(&header, sizeof(header));
+    append(skeletonData.vertices.data(), skeletonData.vertices.size() * sizeof(RiggedMeshVertex));
+    append(skeletonData.indices.data(), skeletonData.indices.size() * sizeof(uint32_t));
+    for (const MeshLod &lod : skeletonData.lods) {
+        CookedSkeletonLod range{static_cast<uint32_t>(lod.indices.size()), lod.error};
+        append(&range, sizeof(range));
+    }
+    for (const MeshLod &lod : skeletonData.lods) {
+        append(lod.indices.data(), lod.indices.size() * sizeof(uint32_t));
+    }
+    return bytes;
+}
 
-    tinygltf::TinyGLTF loader{};
-    tinygltf::Model model{};
-    std::string error;
-    std::string warn;
+bool Skeleton::parseCooked(const uint8_t *data, size_t size, uint64_t contentHash) {
+    CookedSkeletonHeader header{};
+    if (data == nullptr || size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != COOKED_SKELETON_MAGIC || header.version != COOKED_SKELETON_VERSION) return false;
+    if (header.contentHash != contentHash) return false;
+
+    size_t offset = sizeof(header);
+    auto read = [&](void *destination, uint64_t bytes) {
+        if (bytes > size - offset) return false;
+        if (bytes > 0) memcpy(destination, data + offset, bytes);
+        offset += bytes;
+        return true;
+    };
+    // Indices are drawn as they are, so every one must address an existing vertex
+    auto inRange = [&](const std::vector<uint32_t> &indices) {
+        return std::all_of(indices.begin(), indices.end(), [&](uint32_t index) { return index < header.vertexCount; });
+    };
+
+    // Counts are checked against the file size before anything is allocated for them
+    uint64_t fixedSize = uint64_t{header.vertexCount} * sizeof(RiggedMeshVertex) +
+                         uint64_t{header.indexCount} * sizeof(uint32_t) +
+                         uint64_t{header.lodCount} * sizeof(CookedSkeletonLod);
+    if (fixedSize > size - offset) return false;
+
+    SkeletonData cooked{};
+    cooked.vertices.resize(header.vertexCount);
+    cooked.indices.resize(header.indexCount);
+    std::vector<CookedSkeletonLod> ranges(header.lodCount);
+    read(cooked.vertices.data(), cooked.vertices.size() * sizeof(RiggedMeshVertex));
+    read(cooked.indices.data(), cooked.indices.size() * sizeof(uint32_t));
+    read(ranges.data(), ranges.size() * sizeof(CookedSkeletonLod));
+    if (!inRange(cooked.indices)) return false;
+
+    for (const CookedSkeletonLod &range : ranges) {
+        if (uint64_t{range.indexCount} * sizeof(uint32_t) > size - offset) return false;
+        MeshLod lod{};
+        lod.indices.resize(range.indexCount);
+        lod.error = range.error;
+        read(lod.indices.data(), lod.indices.size() * sizeof(uint32_t));
+        if (!inRange(lod.indices)) return false;
+        cooked.lods.push_back(std::move(lod));
+    }
+    if (offset != size) return false;
 
-    if (!loader.LoadBinaryFromFile(&model, &error, &warn, path.c_str())) {
-        logger::error(warn);
-        logger::error(error);
-        logger::fatal_error("Failed to load .glb file");
+    skeletonData = std::move(cooked);
+    return true;
+}
+
+Skeleton::Skeleton(AssetId id) {
+    WVK_PROFILE_ZONE("load skeleton");
+
+    // The optimized mesh and its LODs are cooked on first load and loaded from the derived data cache until the
+    // source's contents change
+    AssetFileSystem &assets = assetFileSystem();
+    std::string filename = assets.getName(id);
+    DerivedDataCache &cache = derivedDataCache();
+    uint64_t contentHash = 0;
+    if (!assets.contentHash(id, contentHash)) {
+        logger::fatal_error("Failed to load .glb file " + filename);
     }
+    uint64_t key = derivedDataKey("cooked skeleton", COOKED_SKELETON_VERSION, contentHash);
 
-    if (!warn.empty()) {
-        logger::debug(warn);
+    MappedFile cookedFile;
+    if (cache.open(key, "wskel", cookedFile) && parseCooked(cookedFile.getData(), cookedFile.getSize(), contentHash)) {
+        logger::debug("Loaded cooked skeleton of " + filename);
+        return;
     }
 
+    AssetData data;
+    GlbFile file;
+    if (!assets.open(id, data) || !file.parse(data.getData(), data.getSize())) {
+        logger::fatal_error("Failed to load .glb file " + filename);
+    }
+
+    createSkeleton(file);
+
+    std::vector<uint8_t> bytes = serializeCooked(contentHash);
+    if (cache.write(key, "wskel", bytes.data(), bytes.size())) {
+        logger::debug("Cooked " + filename);
+    } else {
+        logger::error("Failed to cache the cooked skeleton of " + filename);
+    }
+}
+
+Skeleton::Skeleton(const GlbFile &file) {
+    createSkeleton(file);
+}
+
+Skeleton::Skeleton(const tinygltf::Model &model) {
     createSkeleton(model);
 }
 
@@ -42,61 +176,84 @@ std::vector<const tinygltf::Node *> Skeleton::getRiggedMeshes(const tinygltf::Mo
     return nodes;
 }
 
-void Skeleton::readMeshData(const tinygltf::Model &model, const tinygltf::Mesh &mesh) {
-    tinygltf::Primitive primitive = mesh.primitives[0];
-    if (mesh.primitives.size() > 1) {
-        logger::fatal_error("More than one primitive detected for GLTF file, only one supported.");
-    }
+void Skeleton::readMeshData(const SkinnedPrimitive &primitive) {
+    // Each attribute is converted in one pass, then the vertices are assembled from the arrays
+    size_t vertexCount = primitive.positions.size();
+
+    std::vector<glm::vec3> positions = primitive.positions.readVectors<glm::vec3>();
+    std::vector<glm::vec3> normals = primitive.normals.readVectors<glm::vec3>();
+    std::vector<glm::vec2> texCoords = primitive.texCoords.readVectors<glm::vec2>();
+    std::vector<glm::vec4> weights = primitive.weights.readVectors<glm::vec4>();
 
-    // Read the vertices
-    int vertexCount = model.accessors[primitive.attributes["POSITION"]].count;
+    std::vector<uint32_t> joints(primitive.joints.size() * 4);
+    primitive.joints.readUints(joints.data(), 4);
 
+    if (normals.size() != vertexCount || texCoords.size() != vertexCount || weights.size() != vertexCount ||
+        primitive.joints.size() != vertexCount) {
+        logger::fatal_error("GLTF mesh attributes have different vertex counts");
+    }
+
+    // Exporters often write identical vertices more than once
     size_t verticesOffset = skeletonData.vertices.size();
-    skeletonData.vertices.resize(skeletonData.vertices.size() + vertexCount);
+    VertexWelder<RiggedMeshVertex> welder{vertexCount};
+    std::vector<uint32_t> remap(vertexCount);
 
     for (size_t vertexIndex = 0; vertexIndex < vertexCount; vertexIndex++) {
         RiggedMeshVertex vertex{};
 
-        vertex.position = readVec3f(model, primitive.attributes["POSITION"], vertexIndex);
-        vertex.normal = readVec3f(model, primitive.attributes["NORMAL"], vertexIndex);
-        vertex.tex_coord = readVec2f(model, primitive.attributes["TEXCOORD_0"], vertexIndex);
+        vertex.position = positions[vertexIndex];
+        vertex.normal = normals[vertexIndex];
+        vertex.tex_coord = texCoords[vertexIndex];
         vertex.texture_index = 0; // TODO: Read this value properly
 
-        auto joints = readVec4b(model, primitive.attributes["JOINTS_0"], vertexIndex);
-        vertex.joint1 = joints[0];
-        vertex.joint2 = joints[1];
-
-        glm::vec4 weights = readVec4f(model, primitive.attributes["WEIGHTS_0"], vertexIndex);
-        vertex.weight1 = weights[0];
-        vertex.weight2 = weights[1];
+        // Vertices store joint indices in a byte, a larger one would silently bind the vertex to another joint
+        uint32_t joint1 = joints[4 * vertexIndex + 0], joint2 = joints[4 * vertexIndex + 1];
+        if (joint1 > std::numeric_limits<uint8_t>::max() || joint2 > std::numeric_limits<uint8_t>::max()) {
+            logger::fatal_error("GLTF mesh joint index " + std::to_string(std::max(joint1, joint2)) +
+                                " is out of range, at most " + std::to_string(std::numeric_limits<uint8_t>::max()) +
+                                " joints are supported");
+        }
+        vertex.joint1 = static_cast<uint8_t>(joint1);
+        vertex.joint2 = static_cast<uint8_t>(joint2);
 
-        skeletonData.vertices[verticesOffset + vertexIndex] = vertex;
-        logger::debug(vertexIndex);
-    }
-    logger::debug("Finished reading vertex data. count: " + std::to_string(vertexCount));
+        vertex.weight1 = weights[vertexIndex][0];
+        vertex.weight2 = weights[vertexIndex][1];
 
-    // Read the indices
-    int indices = primitive.indices; // The accessor index containing indice data
-    if ( !(indices >= 0 && primitive.mode == TINYGLTF_MODE_TRIANGLES) ) {
-        logger::fatal_error("GLTF mesh encoding must be triangles w/ indices");
+        remap[vertexIndex] = welder.weld(vertex);
     }
 
-    int indexCount = model.accessors[indices].count;
+    std::vector<RiggedMeshVertex> welded = welder.takeVertices();
+    skeletonData.vertices.insert(skeletonData.vertices.end(), welded.begin(), welded.end());
+    logger::debug("Finished reading vertex data. count: " + std::to_string(vertexCount) +
+                  ", distinct: " + std::to_string(welded.size()));
 
+    // Read the indices
     size_t indicesOffset = skeletonData.indices.size();
-    skeletonData.indices.resize(skeletonData.indices.size() + indexCount);
+    skeletonData.indices.resize(indicesOffset + primitive.indices.size());
+    uint32_t *meshIndices = skeletonData.indices.data() + indicesOffset;
+    primitive.indices.readUints(meshIndices, 1);
 
-    for (size_t indiceIndex = 0; indiceIndex < indexCount; indiceIndex++) {
-        int indice = readUint16(model, indices, indiceIndex);
+    for (size_t indiceIndex = 0; indiceIndex < primitive.indices.size(); indiceIndex++) {
+        if (meshIndices[indiceIndex] >= vertexCount) {
+            logger::fatal_error("GLTF mesh index out of range");
+        }
+        meshIndices[indiceIndex] = static_cast<uint32_t>(verticesOffset) + remap[meshIndices[indiceIndex]];
+    }
+}
 
-        skeletonData.indices[indicesOffset + indiceIndex] = verticesOffset + indice;
+void Skeleton::readJointData(const std::vector<std::string> &jointNames) {
+    for (const std::string &name : jointNames) {
+        logger::debug("Joint: " + name);
     }
 }
 
-void Skeleton::readJointData(const tinygltf::Model &model, const tinygltf::Skin &skin) {
-    for (int joint : skin.joints) {
-        logger::debug("Joint: " + model.nodes[joint].name);
+static AccessorView skinnedAttribute(const tinygltf::Model &model, const tinygltf::Primitive &primitive,
+                                     const char *name) {
+    auto found = primitive.attributes.find(name);
+    if (found == primitive.attributes.end()) {
+        logger::fatal_error(std::string("GLTF mesh is missing the ") + name + " attribute");
     }
+    return AccessorView{model, found->second};
 }
 
 void Skeleton::createSkeleton(const tinygltf::Model &model) {
@@ -110,11 +267,80 @@ void Skeleton::createSkeleton(const tinygltf::Model &model) {
         logger::debug("Skin: " + skin.name);
         logger::debug("Mesh: " + mesh.name);
 
-        readMeshData(model, mesh);
-        readJointData(model, skin);
+        for (const tinygltf::Primitive &primitive : mesh.primitives) {
+            if ( !(primitive.indices >= 0 && primitive.mode == TINYGLTF_MODE_TRIANGLES) ) {
+                logger::fatal_error("GLTF mesh encoding must be triangles w/ indices");
+            }
+
+            readMeshData({skinnedAttribute(model, primitive, "POSITION"), skinnedAttribute(model, primitive, "NORMAL"),
+                          skinnedAttribute(model, primitive, "TEXCOORD_0"), skinnedAttribute(model, primitive, "JOINTS_0"),
+                          skinnedAttribute(model, primitive, "WEIGHTS_0"), AccessorView{model, primitive.indices}});
+        }
+
+        std::vector<std::string> jointNames;
+        for (int joint : skin.joints) {
+            jointNames.push_back(model.nodes[joint].name);
+        }
+        readJointData(jointNames);
         //readAnimationData();
     }
-    
+
+    finishSkeleton();
+}
+
+void Skeleton::createSkeleton(const GlbFile &file) {
+    logger::debug("Creating skeleton");
+
+    const std::vector<GlbNode> &nodes = file.getNodes();
+    for (const GlbNode &node : nodes) {
+        if (node.skin < 0 || node.mesh < 0) continue;
+        if (node.skin >= static_cast<int>(file.getSkins().size()) || node.mesh >= static_cast<int>(file.getMeshes().size())) {
+            logger::fatal_error("GLTF node refers to a missing skin or mesh");
+        }
+        const GlbSkin &skin = file.getSkins()[node.skin];
+        const GlbMesh &mesh = file.getMeshes()[node.mesh];
+
+        logger::debug("Node: " + node.name);
+        logger::debug("Skin: " + skin.name);
+        logger::debug("Mesh: " + mesh.name);
+
+        for (const GlbPrimitive &primitive : mesh.primitives) {
+            if ( !(primitive.indices >= 0 && primitive.mode == TINYGLTF_MODE_TRIANGLES) ) {
+                logger::fatal_error("GLTF mesh encoding must be triangles w/ indices");
+            }
+
+            auto attribute = [&](const char *name) {
+                int accessor = file.attribute(primitive, name);
+                if (accessor < 0) {
+                    logger::fatal_error(std::string("GLTF mesh is missing the ") + name + " attribute");
+                }
+                return file.accessor(accessor);
+            };
+            readMeshData({attribute("POSITION"), attribute("NORMAL"), attribute("TEXCOORD_0"), attribute("JOINTS_0"),
+                          attribute("WEIGHTS_0"), file.accessor(primitive.indices)});
+        }
+
+        std::vector<std::string> jointNames;
+        for (int joint : skin.joints) {
+            if (joint >= 0 && joint < static_cast<int>(nodes.size())) jointNames.push_back(nodes[joint].name);
+        }
+        readJointData(jointNames);
+    }
+
+    finishSkeleton();
+}
+
+void Skeleton::finishSkeleton() {
+    MeshOptimizationStats stats = optimizeMesh(skeletonData.vertices, skeletonData.indices);
+    logger::debug("Optimized skeleton mesh: " + toString(stats));
+
+    std::vector<glm::vec3> positions(skeletonData.vertices.size());
+    for (size_t i = 0; i < skeletonData.vertices.size(); i++) {
+        positions[i] = skeletonData.vertices[i].position;
+    }
+    skeletonData.lods = generateLods(skeletonData.indices, positions);
+    logger::debug("Generated " + std::to_string(skeletonData.lods.size()) + " skeleton mesh LODs");
+
     logger::debug("Finished reading skeletal data");
 }
 
@@ -4,6 +4,9 @@
 #include "../wvk_buffer.h"
 
 #include "../wvk_vertex_attributes.h"
+#include "../mesh/simplifier.h"
+#include "../asset/asset_id.h"
+#include "accessor_view.h"
 
 #include <string>
 #include <vector>
@@ -14,11 +17,24 @@ namespace tinygltf {
     class Node;
     struct Accessor;
     struct Mesh;
+    struct Primitive;
     struct Skin;
 };
 
 namespace wvk {
 
+class GlbFile;
+
+// Accessors of one skinned triangle primitive
+struct SkinnedPrimitive {
+    AccessorView positions;
+    AccessorView normals;
+    AccessorView texCoords;
+    AccessorView joints;
+    AccessorView weights;
+    AccessorView indices;
+};
+
 struct SkeletonJoint {
     // translation, rotation, orientation
     glm::mat4 model;
@@ -27,33 +43,40 @@ struct SkeletonJoint {
 struct SkeletonData {
     std::vector<RiggedMeshVertex> vertices;
     std::vector<uint32_t> indices;
+    std::vector<MeshLod> lods;   // simplified indices of the same vertices, so the joint weights stay valid
     std::vector<SkeletonJoint> joints;
 };
 
 class Skeleton {
 public:
-    Skeleton(std::string filename);
+    // Loads a .glb asset, reading it in place through GlbFile. The cooked mesh is stored in the derived data cache
+    // and loaded from there until the asset's contents change.
+    explicit Skeleton(AssetId id);
+    Skeleton(const GlbFile &file);
+    // Builds the skeleton from an already parsed glTF model
+    Skeleton(const tinygltf::Model &model);
     ~Skeleton();
 
     const std::vector<RiggedMeshVertex> &getVertices() { return skeletonData.vertices; }
     const std::vector<uint32_t> &getIndices() { return skeletonData.indices; }
+    const std::vector<MeshLod> &getLods() { return skeletonData.lods; }
 
 private:
     void createSkeleton(const tinygltf::Model &model);
+    void createSkeleton(const GlbFile &file);
+    void finishSkeleton();
+    std::vector<uint8_t> serializeCooked(uint64_t contentHash) const;
+    // Returns false, leaving the skeleton unchanged, if data isn't a cooked skeleton of the given source contents
+    bool parseCooked(const uint8_t *data, size_t size, uint64_t contentHash);
     std::vector<const tinygltf::Node *> getRiggedMeshes(const tinygltf::Model &model);
 
-    void readMeshData(const tinygltf::Model &model, const tinygltf::Mesh &mesh);
-    void readJointData(const tinygltf::Model &model, const tinygltf::Skin &skin);
+    // Appends the primitive's welded vertices and its indices to the skeleton mesh
+    void readMeshData(const SkinnedPrimitive &primitive);
+    void readJointData(const std::vector<std::string> &jointNames);
 
     SkeletonData skeletonData{};
 
     // Animation data, other resources
 };
 
-uint16_t readUint16(const tinygltf::Model &model, int attributeIndex, int index);
-glm::vec2 readVec2f(const tinygltf::Model &model, int attributeIndex, int index);
-glm::vec3 readVec3f(const tinygltf::Model &model, int attributeIndex, int index);
-glm::vec4 readVec4f(const tinygltf::Model &model, int attributeIndex, int index);
-std::array<unsigned char, 4> readVec4b(const tinygltf::Model &model, int attributeIndex, int index);
-
 }
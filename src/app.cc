@@ -1,15 +1,25 @@
 #include "app.h"
 
 #include "wvk_helper.h"
+#include "cpu_profiler.h"
 #include "glm.h"
 
-#include "game/controller.h"
-
+#include <algorithm>
 #include <thread>
 #include <chrono>
+#include <cstdlib>
 
 namespace wvk {
 
+// SPIR-V of the shaders in resources/shaders, see compile_shaders.py
+static constexpr AssetId SHADOW_VERTEX_SHADER = assetId("shadow.vert.spv");
+static constexpr AssetId RIGGED_SHADOW_VERTEX_SHADER = assetId("rigged_shadow.vert.spv");
+static constexpr AssetId MESH_VERTEX_SHADER = assetId("mesh.vert.spv");
+static constexpr AssetId RIGGED_MESH_VERTEX_SHADER = assetId("rigged_mesh.vert.spv");
+static constexpr AssetId DEPTH_VERTEX_SHADER = assetId("depth.vert.spv");
+static constexpr AssetId RIGGED_DEPTH_VERTEX_SHADER = assetId("rigged_depth.vert.spv");
+static constexpr AssetId BASIC_FRAGMENT_SHADER = assetId("basic.frag.spv");
+
 WvkApplication::WvkApplication() {
     createPipelineResources();
     logger::debug("Created pipeline resources");
@@ -19,6 +29,12 @@ WvkApplication::WvkApplication() {
 
     createCommandBuffers();
     logger::debug("Created command buffers");
+
+    gpuProfiler = std::make_unique<WvkGpuProfiler>(device, swapChain.getImageCount(),
+                                                   device.getEnabledFeatures().pipelineStatisticsQuery);
+
+    overlay = std::make_unique<WvkOverlay>(device, swapChain);
+    logger::debug("Created performance overlay");
 }
 
 WvkApplication::~WvkApplication() {
@@ -26,15 +42,19 @@ WvkApplication::~WvkApplication() {
     vkQueueWaitIdle(device.getPresentQueue());
     freeCommandBuffers();
 
-    for (auto &image : textureImages) {
-        image.cleanup();
-    }
+    // Waits for its uploads, before the textures they write to are destroyed
+    assetStreamer.reset();
+    textureStreamer.reset();
+
+    overlay.reset();
+    gpuProfiler.reset();
+    shadowMap.reset();
 
     for (auto &buffer : cameraTransformBuffers) {
         buffer.cleanup();
     }
 
-    for (auto &buffer : lightTransformBuffers) {
+    for (auto &buffer : shadowDataBuffers) {
         buffer.cleanup();
     }
 
@@ -42,6 +62,10 @@ WvkApplication::~WvkApplication() {
         buffer.cleanup();
     }
 
+    for (auto &buffer : indirectBuffers) {
+        buffer.cleanup();
+    }
+
     textureSampler.cleanup();
     depthSampler.cleanup();
 
@@ -56,17 +80,11 @@ WvkApplication::~WvkApplication() {
     logger::debug("Application shutting down");
 }
 
-void checkVkResult(VkResult err) {
-    if (err != VK_SUCCESS) {
-        logger::fatal_error("Imgui_ImplVulkan_Init call failed with error code: " + std::to_string(err));
-    }
-}
-
 std::chrono::time_point<std::chrono::high_resolution_clock> getTime() {
     return std::chrono::high_resolution_clock::now();
 }
 
-void WvkApplication::run() {
+void WvkApplication::run(AppController &controller) {
     using namespace std::chrono_literals;
     using namespace std::chrono;
 
@@ -75,43 +93,114 @@ void WvkApplication::run() {
 
     bool forceQuit = false;
 
-    wayward::DebugController controller{this};
+    WVK_PROFILE_THREAD("main");
+
+#ifdef WVK_ENABLE_PROFILER
+    // WVK_PROFILE_FRAMES=<first>:<count> captures a fixed frame range, e.g. for automated runs
+    if (const char *range = std::getenv("WVK_PROFILE_FRAMES")) {
+        char *separator;
+        uint64_t firstFrame = std::strtoull(range, &separator, 10);
+        uint32_t frameCount = *separator == ':' ? std::strtoul(separator + 1, nullptr, 10) : 0;
+        WVK_PROFILE_SCHEDULE_CAPTURE(firstFrame, frameCount);
+    }
+#endif
+
+    while (!forceQuit && !controller.finished() && !glfwWindowShouldClose(window.getGlfwWindow())) {
+        WVK_PROFILE_FRAME(frame);
 
-    while (!forceQuit && !glfwWindowShouldClose(window.getGlfwWindow())) {
         auto start = getTime();
 
-        glfwPollEvents();
+        {
+            WVK_PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
+
+        assetStreamer->update(camera != nullptr ? camera->transform.position : glm::vec3{0.f});
+        streamTextures();
 
         int imageIndex = swapChain.acquireNextImage();
 
-        recordCommandBuffer(imageIndex);
+        {
+            WVK_PROFILE_ZONE("overlay.update");
+            overlay->update(lastFrameTime, frameStats, settings, *gpuProfiler);
+        }
+
+        {
+            WVK_PROFILE_ZONE("recordCommandBuffer");
+            recordCommandBuffer(imageIndex);
+        }
 
         swapChain.submitCommands(commandBuffers[imageIndex], imageIndex);
 
         auto end = getTime();
         timeCount += duration_cast<microseconds>(end - start).count();
+        lastFrameTime = duration_cast<microseconds>(end - start).count() / 1000.f;
 
         updateKeys();
-        controller.update();
+        {
+            WVK_PROFILE_ZONE("controller.update");
+            controller.update();
+        }
 
         if (++frame % FRAME_INTERVAL == 0) {
             int avg = timeCount / FRAME_INTERVAL;
             logger::debug("average frame time: " + std::to_string(avg) + " microseconds");
             timeCount = 0;
+
+            logGpuTimings();
         }
 
         if (isKeyPressed(GLFW_KEY_ESCAPE)) {
             forceQuit = true;
         }
 
-        std::this_thread::sleep_for(16.6ms - duration_cast<milliseconds>(end-start));
+        if (isKeyPressed(GLFW_KEY_F1)) {
+            settings.showOverlay = !settings.showOverlay;
+        }
+
+        if (isKeyPressed(GLFW_KEY_F2)) {
+            WVK_PROFILE_CAPTURE(FRAME_INTERVAL);
+        }
+
+        if (settings.limitFrameRate) {
+            std::this_thread::sleep_for(16.6ms - duration_cast<milliseconds>(end-start));
+        }
+    }
+}
+
+void WvkApplication::logGpuTimings() {
+    if (!gpuProfiler->timestampsSupported()) return;
+
+    std::string message = "average GPU frame time: " + std::to_string(gpuProfiler->getFrameHistory().average()) + " ms";
+    for (const std::string &name : gpuProfiler->getScopeNames()) {
+        const GpuScopeHistory *history = gpuProfiler->getScopeHistory(name);
+        message += ", " + name + ": " + std::to_string(history->average()) + " ms";
+    }
+    logger::debug(message);
+
+    if (!gpuProfiler->pipelineStatisticsSupported()) return;
+
+    for (const std::string &name : gpuProfiler->getScopeNames()) {
+        const GpuPipelineStatistics &stats = gpuProfiler->getScopeHistory(name)->statistics;
+        if (stats.vertexInvocations == 0 && stats.fragmentInvocations == 0) continue;
+
+        logger::debug(name + " statistics: " +
+                      std::to_string(stats.inputAssemblyPrimitives) + " primitives, " +
+                      std::to_string(stats.vertexInvocations) + " vertex invocations, " +
+                      std::to_string(stats.clippingPrimitives) + " clipped primitives, " +
+                      std::to_string(stats.fragmentInvocations) + " fragment invocations");
     }
 }
 
 void WvkApplication::createPipelineResources() {
-    // Allocate texture images
-    for (size_t i = 0; i < images.size(); i++) {
-        textureImages.push_back(Image{device, images[i]});
+    shadowMap = std::make_unique<WvkShadowMap>(device, swapChain, CascadeConfig{});
+
+    assetStreamer = std::make_unique<WvkAssetStreamer>(device);
+
+    // Request the coarse levels of the textures, finer ones are streamed in as they're seen up close
+    textureStreamer = std::make_unique<WvkTextureStreamer>(device, *assetStreamer, swapChain.getImageCount());
+    for (AssetId image : IMAGES) {
+        textureStreamer->addTexture(image);
     }
 
     // Allocate uniform buffers (one per swapchain image)
@@ -127,62 +216,112 @@ void WvkApplication::createPipelineResources() {
                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                             cameraTransformBuffers[i]);
 
-        lightTransformBuffers.emplace_back();
-        device.createBuffer(transformBufferSize,
+        shadowDataBuffers.emplace_back();
+        device.createBuffer(sizeof(ShadowData),
                             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                            lightTransformBuffers[i]);
+                            shadowDataBuffers[i]);
 
         objectDataBuffers.emplace_back();
-        device.createBuffer(sizeof(ObjectData) * MAX_OBJECTS,
+        device.createBuffer(sizeof(ObjectData),
                             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                             objectDataBuffers[i]);
     }
 
-    for (size_t i = 0; i < MAX_OBJECTS; i++) {
-        objectData[i].transform = glm::mat4(1.f);
-        for (size_t j = 0; j < ObjectData::MAX_JOINTS; j++) {
-            objectData[i].joints[j] = glm::mat4(1.f);
-        }
+    // Indirect draws are created on first use and grow with the number of visible meshlets
+    indirectBuffers.resize(swapChain.getImageCount());
+
+    for (size_t i = 0; i < ObjectData::MAX_OBJECTS; i++) {
+        objectData.transforms[i] = glm::mat4(1.f);
+    }
+    for (size_t i = 0; i < ObjectData::MAX_OBJECTS * ObjectData::MAX_JOINTS; i++) {
+        objectData.joints[i] = glm::mat4(1.f);
     }
 }
 
 void WvkApplication::createPipelines() {
-    VertexDescriptionInfo meshVertexDescription = {MeshVertex::getBindingDescription(), MeshVertex::getAttributeDescriptions()};
-    VertexDescriptionInfo riggedVertexDescription = {RiggedMeshVertex::getBindingDescription(), RiggedMeshVertex::getAttributeDescriptions()};
+    VertexDescriptionInfo meshVertexDescription = {{PackedVertex::getBindingDescription(), InstanceData::getBindingDescription()},
+                                                   PackedVertex::getAttributeDescriptions()};
+    std::vector<VkVertexInputAttributeDescription> instanceAttributes = InstanceData::getAttributeDescriptions(meshVertexDescription.attributes.size());
+    meshVertexDescription.attributes.insert(meshVertexDescription.attributes.end(), instanceAttributes.begin(), instanceAttributes.end());
 
-    PushConstantInfo emptyPushInfo{};
-    
-    PushConstantInfo objectPushInfo{};
-    objectPushInfo.pushConstants.resize(1);
-    objectPushInfo.pushConstants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    objectPushInfo.pushConstants[0].offset = 0;
-    objectPushInfo.pushConstants[0].size = sizeof(ObjectPushConstant);
+    VertexDescriptionInfo riggedVertexDescription = {{PackedRiggedVertex::getBindingDescription()}, PackedRiggedVertex::getAttributeDescriptions()};
+
+    // Depth only passes read just the position streams
+    VertexDescriptionInfo positionVertexDescription = {{PositionVertex::getBindingDescription(), InstanceData::getBindingDescription()},
+                                                       PositionVertex::getAttributeDescriptions()};
+    instanceAttributes = InstanceData::getAttributeDescriptions(positionVertexDescription.attributes.size());
+    positionVertexDescription.attributes.insert(positionVertexDescription.attributes.end(), instanceAttributes.begin(), instanceAttributes.end());
+
+    VertexDescriptionInfo riggedPositionVertexDescription = {{RiggedPositionVertex::getBindingDescription()},
+                                                             RiggedPositionVertex::getAttributeDescriptions()};
+
+    PushConstantInfo drawPushInfo{};
+    drawPushInfo.pushConstants.resize(1);
+    drawPushInfo.pushConstants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    drawPushInfo.pushConstants[0].offset = 0;
+    drawPushInfo.pushConstants[0].size = sizeof(DrawPushConstant);
 
     /* Shadow mapping pipeline */
 
+    PushConstantInfo shadowPushInfo{};
+    shadowPushInfo.pushConstants.resize(1);
+    shadowPushInfo.pushConstants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    shadowPushInfo.pushConstants[0].offset = 0;
+    shadowPushInfo.pushConstants[0].size = sizeof(ShadowPushConstant);
+
     DescriptorSetInfo shadowDescriptor{};
     auto &shadowLayout = shadowDescriptor.layoutBindings;
 
     shadowLayout.resize(1);
 
+    /* Cascade projections */
     shadowLayout[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     shadowLayout[0].count = 1;
     shadowLayout[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     shadowLayout[0].unique = true;
     for (size_t i = 0; i < swapChain.getImageCount(); i++) {
-        shadowLayout[0].data[i][0].buffer = lightTransformBuffers[i].buffer;
-        shadowLayout[0].data[i][0].size = lightTransformBuffers[i].size;
+        shadowLayout[0].data[i][0].buffer = shadowDataBuffers[i].buffer;
+        shadowLayout[0].data[i][0].size = shadowDataBuffers[i].size;
     }
 
+    // Slope scaled bias keeps surfaces at grazing angles to the light from shadowing themselves
+    PipelineConfigInfo shadowConfig = WvkPipeline::defaultPipelineConfigInfo(VK_SAMPLE_COUNT_1_BIT);
+    shadowConfig.rasterizationInfo.depthBiasEnable = VK_TRUE;
+    shadowConfig.rasterizationInfo.depthBiasConstantFactor = 1.25f;
+    shadowConfig.rasterizationInfo.depthBiasSlopeFactor = 1.75f;
+
     shadowPipeline = std::make_unique<WvkPipeline>(device, swapChain,
-                                                   swapChain.getShadowRenderPass(),
-                                                   "shadow.vert.spv", "",
-                                                   emptyPushInfo,
+                                                   shadowMap->getRenderPass(),
+                                                   SHADOW_VERTEX_SHADER, NO_ASSET,
+                                                   shadowPushInfo,
                                                    shadowDescriptor,
-                                                   meshVertexDescription,
-                                                   WvkPipeline::defaultPipelineConfigInfo(VK_SAMPLE_COUNT_1_BIT));
+                                                   positionVertexDescription,
+                                                   shadowConfig);
+
+    DescriptorSetInfo shadowRiggedDescriptor = shadowDescriptor;
+    auto &shadowRiggedLayout = shadowRiggedDescriptor.layoutBindings;
+
+    shadowRiggedLayout.resize(2);
+
+    /* Uniform buffer containing object data (i.e. position, joints) */
+    shadowRiggedLayout[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    shadowRiggedLayout[1].count = 1;
+    shadowRiggedLayout[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    shadowRiggedLayout[1].unique = true;
+    for (size_t i = 0; i < swapChain.getImageCount(); i++) {
+        shadowRiggedLayout[1].data[i][0].buffer = objectDataBuffers[i].buffer;
+        shadowRiggedLayout[1].data[i][0].size = objectDataBuffers[i].size;
+    }
+
+    shadowRiggedPipeline = std::make_unique<WvkPipeline>(device, swapChain,
+                                                         shadowMap->getRenderPass(),
+                                                         RIGGED_SHADOW_VERTEX_SHADER, NO_ASSET,
+                                                         shadowPushInfo,
+                                                         shadowRiggedDescriptor,
+                                                         riggedPositionVertexDescription,
+                                                         shadowConfig);
 
 
     /* Main render pass pipeline */
@@ -204,11 +343,11 @@ void WvkApplication::createPipelines() {
 
     /* Array of textures */
     mainLayout[1].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-    mainLayout[1].count = textureImages.size();
+    mainLayout[1].count = textureStreamer->getTextureCount();
     mainLayout[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     mainLayout[1].unique = false;
-    for (size_t i = 0; i < textureImages.size(); i++) {
-        mainLayout[1].data[0][i].imageView = textureImages[i].imageView;
+    for (size_t i = 0; i < textureStreamer->getTextureCount(); i++) {
+        mainLayout[1].data[0][i].imageView = assetStreamer->getPlaceholderImage().imageView;
         mainLayout[1].data[0][i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     }
 
@@ -219,32 +358,35 @@ void WvkApplication::createPipelines() {
     mainLayout[2].unique = false;
     mainLayout[2].data[0][0].sampler = textureSampler.sampler;
 
-    /* Light depth image */
+    /* Shadow cascades */
     mainLayout[3].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     mainLayout[3].count = 1;
     mainLayout[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     mainLayout[3].unique = false;
-    mainLayout[3].data[0][0].imageView = swapChain.getShadowDepthImageView();
+    mainLayout[3].data[0][0].imageView = shadowMap->getArrayView();
     mainLayout[3].data[0][0].sampler = depthSampler.sampler;
     mainLayout[3].data[0][0].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
-    /* Light space projection */
+    /* Cascade projections and splits */
     mainLayout[4].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     mainLayout[4].count = 1;
-    mainLayout[4].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    mainLayout[4].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     mainLayout[4].unique = true;
     for (size_t i = 0; i < swapChain.getImageCount(); i++) {
-        mainLayout[4].data[i][0].buffer = lightTransformBuffers[i].buffer;
-        mainLayout[4].data[i][0].size = lightTransformBuffers[i].size;
+        mainLayout[4].data[i][0].buffer = shadowDataBuffers[i].buffer;
+        mainLayout[4].data[i][0].size = shadowDataBuffers[i].size;
     }
 
+    PipelineConfigInfo meshConfig = WvkPipeline::defaultPipelineConfigInfo(VK_SAMPLE_COUNT_4_BIT);
+    meshBackFacesCulled = (meshConfig.rasterizationInfo.cullMode & VK_CULL_MODE_BACK_BIT) != 0;
+
     pipeline = std::make_unique<WvkPipeline>(device, swapChain,
                                              swapChain.getRenderPass(),
-                                             "mesh.vert.spv", "basic.frag.spv",
-                                             emptyPushInfo,
+                                             MESH_VERTEX_SHADER, BASIC_FRAGMENT_SHADER,
+                                             drawPushInfo,
                                              mainDescriptor,
                                              meshVertexDescription,
-                                             WvkPipeline::defaultPipelineConfigInfo(VK_SAMPLE_COUNT_4_BIT));
+                                             meshConfig);
 
 
     DescriptorSetInfo mainRiggedDescriptor{};
@@ -268,11 +410,60 @@ void WvkApplication::createPipelines() {
 
     riggedPipeline = std::make_unique<WvkPipeline>(device, swapChain,
                                                    swapChain.getRenderPass(),
-                                                   "rigged_mesh.vert.spv", "basic.frag.spv",
-                                                   objectPushInfo,
+                                                   RIGGED_MESH_VERTEX_SHADER, BASIC_FRAGMENT_SHADER,
+                                                   drawPushInfo,
                                                    mainRiggedDescriptor,
                                                    riggedVertexDescription,
                                                    WvkPipeline::defaultPipelineConfigInfo(VK_SAMPLE_COUNT_4_BIT));
+
+
+    /* Depth prepass pipelines */
+
+    DescriptorSetInfo depthDescriptor{};
+    auto &depthLayout = depthDescriptor.layoutBindings;
+
+    depthLayout.resize(1);
+    depthLayout[0] = mainLayout[0];
+
+    depthPipeline = std::make_unique<WvkPipeline>(device, swapChain,
+                                                  swapChain.getDepthPrepassRenderPass(),
+                                                  DEPTH_VERTEX_SHADER, NO_ASSET,
+                                                  drawPushInfo,
+                                                  depthDescriptor,
+                                                  positionVertexDescription,
+                                                  meshConfig);
+
+    DescriptorSetInfo depthRiggedDescriptor = depthDescriptor;
+    depthRiggedDescriptor.layoutBindings.push_back(mainRiggedLayout[5]);
+
+    depthRiggedPipeline = std::make_unique<WvkPipeline>(device, swapChain,
+                                                        swapChain.getDepthPrepassRenderPass(),
+                                                        RIGGED_DEPTH_VERTEX_SHADER, NO_ASSET,
+                                                        drawPushInfo,
+                                                        depthRiggedDescriptor,
+                                                        riggedPositionVertexDescription,
+                                                        WvkPipeline::defaultPipelineConfigInfo(VK_SAMPLE_COUNT_4_BIT));
+
+    // After the prepass only the closest fragment passes the depth test, so nothing is shaded twice
+    PipelineConfigInfo depthEqualConfig = meshConfig;
+    depthEqualConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    depthEqualConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+    depthEqualPipeline = std::make_unique<WvkPipeline>(device, swapChain,
+                                                       swapChain.getDepthLoadRenderPass(),
+                                                       MESH_VERTEX_SHADER, BASIC_FRAGMENT_SHADER,
+                                                       drawPushInfo,
+                                                       mainDescriptor,
+                                                       meshVertexDescription,
+                                                       depthEqualConfig);
+
+    depthEqualRiggedPipeline = std::make_unique<WvkPipeline>(device, swapChain,
+                                                             swapChain.getDepthLoadRenderPass(),
+                                                             RIGGED_MESH_VERTEX_SHADER, BASIC_FRAGMENT_SHADER,
+                                                             drawPushInfo,
+                                                             mainRiggedDescriptor,
+                                                             riggedVertexDescription,
+                                                             depthEqualConfig);
 }
 
 void WvkApplication::createCommandBuffers() {
@@ -303,27 +494,69 @@ void WvkApplication::writeToBuffer(VkDeviceMemory memory, uint32_t size, const v
     vkUnmapMemory(device.getDevice(), memory);
 }
 
-void WvkApplication::recordShadowRenderPass(int imageIndex) {
-    VkCommandBuffer commandBuffer = commandBuffers[imageIndex];
+void WvkApplication::updateUniformBuffers(int imageIndex) {
+    if (camera != nullptr) {
+        VkExtent2D extent = swapChain.getExtent();
+        float aspectRatio = (float) extent.width / (float) extent.height;
+        TransformMatrices matrices = camera->transform.perspectiveProjection(aspectRatio);
 
-    // Begin the main render pass
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = swapChain.getShadowRenderPass();
-    renderPassInfo.framebuffer = swapChain.getShadowFramebuffer();
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = swapChain.getExtent();
+        writeToBuffer(cameraTransformBuffers[imageIndex].memory, sizeof(matrices), &matrices);
+    }
 
-    VkClearValue clearValue{};
-    clearValue.depthStencil = {1.f, 0};
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearValue;
+    uint32_t skeletonCount = std::min<size_t>(skeletons.size(), ObjectData::MAX_OBJECTS);
+    for (uint32_t i = 0; i < skeletonCount; i++) {
+        objectData.transforms[i] = skeletons[i]->getTransform();
+    }
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    writeToBuffer(objectDataBuffers[imageIndex].memory, sizeof(objectData), &objectData);
+}
 
+void WvkApplication::streamTextures() {
+    WVK_PROFILE_ZONE("stream textures");
+
+    if (camera != nullptr) {
+        VkExtent2D extent = swapChain.getExtent();
+        float aspectRatio = (float) extent.width / (float) extent.height;
+        TransformMatrices matrices = camera->transform.perspectiveProjection(aspectRatio);
+        ClusterView view = clusterView(matrices.view, matrices.projection, extent.height);
+
+        for (WvkModel *model : models) {
+            if (!model->isResident()) continue;
+            uint32_t texture = model->getMaterialId();
+            uint32_t textureSize = textureStreamer->getTextureSize(texture);
+            for (const InstanceData &instance : model->getInstances()) {
+                if (!instanceVisible(model->getLocalBounds(), instance.transform, view)) continue;
+                textureStreamer->requestLod(texture, textureLod(model->getUvDensity(), textureSize,
+                                                                model->getLocalBounds(), instance.transform, view));
+            }
+        }
+        for (WvkSkeleton *skeleton : skeletons) {
+            if (!skeleton->isResident() || !instanceVisible(skeleton->getLocalBounds(), skeleton->getTransform(), view)) {
+                continue;
+            }
+            uint32_t texture = skeleton->getMaterialId();
+            uint32_t textureSize = textureStreamer->getTextureSize(texture);
+            textureStreamer->requestLod(texture, textureLod(skeleton->getUvDensity(), textureSize,
+                                                            skeleton->getLocalBounds(), skeleton->getTransform(), view));
+        }
+    }
+
+    textureStreamer->update(static_cast<VkDeviceSize>(settings.textureBudgetMB) * 1024 * 1024);
+}
+
+void WvkApplication::updateTextureDescriptors(int imageIndex) {
+    // The previous frame recorded for this image has finished, so its descriptor sets aren't in use
+    textureStreamer->updateDescriptors(imageIndex, [this, imageIndex](uint32_t texture, VkImageView view) {
+        for (WvkPipeline *texturedPipeline : {pipeline.get(), riggedPipeline.get(), depthEqualPipeline.get(),
+                                              depthEqualRiggedPipeline.get()}) {
+            texturedPipeline->updateImage(imageIndex, 1, texture, view);
+        }
+    });
+}
+
+void WvkApplication::setViewport(VkCommandBuffer commandBuffer) {
     VkExtent2D extent = swapChain.getExtent();
 
-    // Set dynamic state for pipeline
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -331,25 +564,265 @@ void WvkApplication::recordShadowRenderPass(int imageIndex) {
     viewport.height = static_cast<float>(extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    VkRect2D scissor{{0, 0}, swapChain.getExtent()};
+    VkRect2D scissor{{0, 0}, extent};
     vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void WvkApplication::pushDrawConstants(VkCommandBuffer commandBuffer, WvkPipeline &pipeline, const Quantization &quantization,
+                                       uint32_t materialId, uint32_t objectId) {
+    DrawPushConstant push = {quantization.offset, materialId, quantization.scale, objectId};
+    vkCmdPushConstants(commandBuffer, pipeline.getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPushConstant), &push);
+}
 
-    shadowPipeline->bind(commandBuffer, imageIndex);
+void WvkApplication::cullClusters(int imageIndex) {
+    WVK_PROFILE_ZONE("cull clusters");
 
+    static_assert(sizeof(DrawIndexedCommand) == sizeof(VkDrawIndexedIndirectCommand),
+                  "DrawIndexedCommand must match VkDrawIndexedIndirectCommand");
+
+    clusterDraws.clear();
+    clusterDrawRanges.clear();
+    if (camera == nullptr) return;
+
+    VkExtent2D extent = swapChain.getExtent();
+    float aspectRatio = (float) extent.width / (float) extent.height;
+    TransformMatrices matrices = camera->transform.perspectiveProjection(aspectRatio);
+    ClusterView view = clusterView(matrices.view, matrices.projection, extent.height);
+    view.cullBackFacing = meshBackFacesCulled;
+
+    // Skeletons are drawn directly, only their LOD is selected here
+    for (WvkSkeleton *skeleton : skeletons) {
+        uint32_t lod = 0;
+        if (settings.lodSelection) {
+            lod = selectLod(skeleton->getLods(), skeleton->getLod(), skeleton->getLocalBounds(), skeleton->getTransform(), view);
+        }
+        skeleton->setLod(lod);
+    }
+
+    if (!settings.clusterCulling && !settings.lodSelection) return;
+
+    ClusterCullStats stats{};
     for (WvkModel *model : models) {
-        model->bind(commandBuffer);
+        uint32_t first = static_cast<uint32_t>(clusterDraws.size());
+        const std::vector<InstanceData> &instances = model->getInstances();
+        const std::vector<LodRange> &lods = model->getLods();
+        std::vector<uint8_t> &instanceLods = model->getInstanceLods();
+
+        for (uint32_t instance = 0; instance < instances.size(); instance++) {
+            const glm::mat4 &transform = instances[instance].transform;
+            if (settings.clusterCulling && !instanceVisible(model->getLocalBounds(), transform, view)) {
+                stats.culledInstances++;
+                stats.culledMeshlets += model->getMeshlets().size();
+                continue;
+            }
+            stats.visibleInstances++;
+
+            uint32_t lod = 0;
+            if (settings.lodSelection) {
+                lod = selectLod(lods, instanceLods[instance], model->getLocalBounds(), transform, view);
+                instanceLods[instance] = static_cast<uint8_t>(lod);
+            }
+
+            // LODs have no meshlets, they are small enough to draw whole
+            if (lod > 0) {
+                appendInstanceDraw(clusterDraws, lods[lod - 1].indexCount, lods[lod - 1].firstIndex, 0, instance);
+                frameStats.simplifiedInstances++;
+            } else if (settings.clusterCulling) {
+                cullMeshlets(model->getMeshlets(), transform, instance, view, clusterDraws, stats);
+            } else {
+                for (const SubMesh &subMesh : model->getSubMeshes()) {
+                    appendInstanceDraw(clusterDraws, subMesh.indexCount, subMesh.firstIndex, subMesh.vertexOffset, instance);
+                }
+            }
+        }
+        clusterDrawRanges.push_back({first, static_cast<uint32_t>(clusterDraws.size()) - first});
+    }
+
+    frameStats.visibleMeshlets = stats.visibleMeshlets;
+    frameStats.culledMeshlets = stats.culledMeshlets;
+    if (clusterDraws.empty()) return;
+
+    // The buffer of this image is no longer read, the previous frame using it has finished
+    Buffer &buffer = indirectBuffers[imageIndex];
+    VkDeviceSize size = sizeof(DrawIndexedCommand) * clusterDraws.size();
+    if (buffer.device == VK_NULL_HANDLE || buffer.size < size) {
+        VkDeviceSize capacity = buffer.device == VK_NULL_HANDLE ? size : std::max<VkDeviceSize>(size, 2 * buffer.size);
+        buffer.cleanup();
+        device.createBuffer(capacity,
+                            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                            buffer);
+    }
+    writeToBuffer(buffer.memory, size, clusterDraws.data());
+}
+
+void WvkApplication::drawModel(VkCommandBuffer commandBuffer, int imageIndex, size_t modelIndex) {
+    WvkModel *model = models[modelIndex];
+    if (clusterDrawRanges.empty()) {
         model->draw(commandBuffer);
+        frameStats.recordDraw(model->getIndexCount(), model->getInstanceCount());
+        return;
     }
 
-    /* TODO:
-    shadowRiggedPipeline->bind(commandBuffer, imageIndex);
+    auto [first, count] = clusterDrawRanges[modelIndex];
+    if (count == 0) return;
+
+    // Meshlet draws select their instance with firstInstance, indirect draws can only do that with the feature
+    const VkPhysicalDeviceFeatures &features = device.getEnabledFeatures();
+    VkBuffer buffer = indirectBuffers[imageIndex].buffer;
+    VkDeviceSize offset = sizeof(DrawIndexedCommand) * first;
+    if (!features.drawIndirectFirstInstance) {
+        for (uint32_t i = first; i < first + count; i++) {
+            const DrawIndexedCommand &draw = clusterDraws[i];
+            vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+        }
+    } else if (features.multiDrawIndirect) {
+        vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, count, sizeof(DrawIndexedCommand));
+    } else {
+        for (uint32_t i = 0; i < count; i++) {
+            vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset + i * sizeof(DrawIndexedCommand), 1, sizeof(DrawIndexedCommand));
+        }
+    }
 
-    for (WvkSkeleton *skeleton : skeletons) {
-        skeleton->bind(commandBuffer);
-        skeleton->draw(commandBuffer);
+    for (uint32_t i = first; i < first + count; i++) {
+        frameStats.recordDraw(clusterDraws[i].indexCount, clusterDraws[i].instanceCount);
+    }
+}
+
+void WvkApplication::recordShadowRenderPass(int imageIndex) {
+    VkCommandBuffer commandBuffer = commandBuffers[imageIndex];
+
+    // Fit the cascades to the camera, they only need to reach as far as the scene
+    ShadowData shadowData{};
+    if (camera != nullptr && settings.renderShadows) {
+        Bounds sceneBounds{};
+        for (WvkModel *model : models) {
+            sceneBounds.extend(model->getBounds());
+        }
+
+        VkExtent2D extent = swapChain.getExtent();
+        float aspectRatio = (float) extent.width / (float) extent.height;
+        TransformMatrices cameraMatrices = camera->transform.perspectiveProjection(aspectRatio);
+
+        shadowData = shadowMap->update(cameraMatrices, Transform::PERSPECTIVE_NEAR, Transform::PERSPECTIVE_FAR,
+                                       lightDirection, sceneBounds);
+    }
+
+    writeToBuffer(shadowDataBuffers[imageIndex].memory, sizeof(shadowData), &shadowData);
+
+    // With shadows disabled the passes only run once, so the shadow map is cleared and in the right layout
+    if (shadowData.cascadeCount == 0) {
+        shadowMap->invalidate();
+        if (shadowMap->isInitialized()) return;
+    }
+
+    // Turning the light or moving the camera across a cascade tile redraws the caches, as does a change to this
+    // version when static models are added, removed or moved
+    uint64_t version = models.size();
+    std::vector<Bounds> dynamicBounds;
+    for (WvkModel *model : models) {
+        if (model->isDynamic()) {
+            dynamicBounds.push_back(model->getBounds());
+        } else {
+            version = version * 31 + model->getVersion();
+        }
+        version = version * 2 + model->isDynamic();
+    }
+
+    // Skinned meshes are always dynamic casters
+    uint32_t skeletonCount = std::min<size_t>(skeletons.size(), ObjectData::MAX_OBJECTS);
+    for (uint32_t i = 0; i < skeletonCount; i++) {
+        if (skeletons[i]->isResident()) dynamicBounds.push_back(skeletons[i]->getBounds());
+    }
+
+    shadowMap->record(commandBuffer, version, dynamicBounds, [&](uint32_t cascade, ShadowCasters casters) {
+        if (shadowData.cascadeCount == 0) return;
+
+        shadowPipeline->bind(commandBuffer, imageIndex);
+
+        const ShadowCascade &shadowCascade = shadowMap->getCascade(cascade);
+        for (WvkModel *model : models) {
+            if (casters == SHADOW_CASTERS_STATIC && model->isDynamic()) continue;
+            if (casters == SHADOW_CASTERS_DYNAMIC && !model->isDynamic()) continue;
+
+            if (!intersectsCascade(shadowCascade, model->getBounds())) {
+                frameStats.culledObjects++;
+                continue;
+            }
+
+            const Quantization &quantization = model->getQuantization();
+            ShadowPushConstant push = {quantization.offset, cascade, quantization.scale, 0};
+            vkCmdPushConstants(commandBuffer, shadowPipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowPushConstant), &push);
+
+            model->bindPositions(commandBuffer);
+            model->draw(commandBuffer);
+            frameStats.recordDraw(model->getIndexCount(), model->getInstanceCount());
+        }
+
+        if (casters == SHADOW_CASTERS_STATIC || skeletonCount == 0) return;
+
+        shadowRiggedPipeline->bind(commandBuffer, imageIndex);
+
+        for (uint32_t i = 0; i < skeletonCount; i++) {
+            WvkSkeleton *skeleton = skeletons[i];
+            if (!skeleton->isResident()) continue;
+            if (!intersectsCascade(shadowCascade, skeleton->getBounds())) {
+                frameStats.culledObjects++;
+                continue;
+            }
+
+            const Quantization &quantization = skeleton->getQuantization();
+            ShadowPushConstant push = {quantization.offset, cascade, quantization.scale, i};
+            vkCmdPushConstants(commandBuffer, shadowRiggedPipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowPushConstant), &push);
+
+            skeleton->bindPositions(commandBuffer);
+            skeleton->draw(commandBuffer);
+            frameStats.recordDraw(skeleton->getIndexCount(), 1);
+        }
+    }, frameStats);
+}
+
+void WvkApplication::recordDepthPrepass(int imageIndex) {
+    VkCommandBuffer commandBuffer = commandBuffers[imageIndex];
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = swapChain.getDepthPrepassRenderPass();
+    renderPassInfo.framebuffer = swapChain.getDepthPrepassFramebuffer(imageIndex);
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = swapChain.getExtent();
+
+    VkClearValue clearValue{};
+    clearValue.depthStencil = {1.f, 0};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    setViewport(commandBuffer);
+
+    depthPipeline->bind(commandBuffer, imageIndex);
+
+    for (size_t i = 0; i < models.size(); i++) {
+        WvkModel *model = models[i];
+        pushDrawConstants(commandBuffer, *depthPipeline, model->getQuantization(), model->getMaterialId(), 0);
+
+        model->bindPositions(commandBuffer);
+        drawModel(commandBuffer, imageIndex, i);
+    }
+
+    depthRiggedPipeline->bind(commandBuffer, imageIndex);
+
+    uint32_t skeletonCount = std::min<size_t>(skeletons.size(), ObjectData::MAX_OBJECTS);
+    for (uint32_t i = 0; i < skeletonCount; i++) {
+        WvkSkeleton *skeleton = skeletons[i];
+        if (!skeleton->isResident()) continue;
+        pushDrawConstants(commandBuffer, *depthRiggedPipeline, skeleton->getQuantization(), skeleton->getMaterialId(), i);
+
+        skeleton->bindPositions(commandBuffer);
+        skeleton->draw(commandBuffer, skeleton->getLod());
+        frameStats.recordDraw(skeleton->getIndexCount(skeleton->getLod()), 1);
     }
-    */
 
     vkCmdEndRenderPass(commandBuffer);
 }
@@ -357,6 +830,10 @@ void WvkApplication::recordShadowRenderPass(int imageIndex) {
 void WvkApplication::recordMainRenderPass(int imageIndex) {
     VkCommandBuffer commandBuffer = commandBuffers[imageIndex];
 
+    // After a depth prepass the main pass keeps its depth and only shades the visible fragments
+    WvkPipeline *meshPipeline = pipeline.get();
+    WvkPipeline *skeletonPipeline = riggedPipeline.get();
+
     // Begin the main render pass
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -365,6 +842,14 @@ void WvkApplication::recordMainRenderPass(int imageIndex) {
     renderPassInfo.renderArea.offset = {0, 0};
     renderPassInfo.renderArea.extent = swapChain.getExtent();
 
+    if (settings.depthPrepass) {
+        meshPipeline = depthEqualPipeline.get();
+        skeletonPipeline = depthEqualRiggedPipeline.get();
+
+        renderPassInfo.renderPass = swapChain.getDepthLoadRenderPass();
+        renderPassInfo.framebuffer = swapChain.getDepthLoadFramebuffer(imageIndex);
+    }
+
     std::array<VkClearValue, 2> clearValues{};
     clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
     clearValues[1].depthStencil = {1.f, 0};
@@ -373,48 +858,34 @@ void WvkApplication::recordMainRenderPass(int imageIndex) {
 
     vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-    VkExtent2D extent = swapChain.getExtent();
-
     // Set dynamic state for pipeline
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(extent.width);
-    viewport.height = static_cast<float>(extent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    VkRect2D scissor{{0, 0}, swapChain.getExtent()};
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-    if (camera != nullptr) {
-        float aspectRatio = (float) extent.width / (float) extent.height;
-        TransformMatrices matrices = camera->transform.perspectiveProjection(aspectRatio);
+    setViewport(commandBuffer);
 
-        writeToBuffer(cameraTransformBuffers[imageIndex].memory, sizeof(matrices), &matrices);
-    }
+    meshPipeline->bind(commandBuffer, imageIndex);
 
-    pipeline->bind(commandBuffer, imageIndex);
+    for (size_t i = 0; i < models.size(); i++) {
+        WvkModel *model = models[i];
+        pushDrawConstants(commandBuffer, *meshPipeline, model->getQuantization(), model->getMaterialId(), 0);
 
-    for (WvkModel *model : models) {
         model->bind(commandBuffer);
-        model->draw(commandBuffer);
+        drawModel(commandBuffer, imageIndex, i);
     }
 
-    riggedPipeline->bind(commandBuffer, imageIndex);
-    
-    writeToBuffer(objectDataBuffers[imageIndex].memory, sizeof(objectData), objectData);
+    skeletonPipeline->bind(commandBuffer, imageIndex);
 
-    for (WvkSkeleton *skeleton : skeletons) {
-        ObjectPushConstant push = {0};
-
-        void *pData = static_cast<void *>(&push);
-        vkCmdPushConstants(commandBuffer, riggedPipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ObjectPushConstant), pData);
+    uint32_t skeletonCount = std::min<size_t>(skeletons.size(), ObjectData::MAX_OBJECTS);
+    for (uint32_t i = 0; i < skeletonCount; i++) {
+        WvkSkeleton *skeleton = skeletons[i];
+        if (!skeleton->isResident()) continue;
+        pushDrawConstants(commandBuffer, *skeletonPipeline, skeleton->getQuantization(), skeleton->getMaterialId(), i);
 
         skeleton->bind(commandBuffer);
-        skeleton->draw(commandBuffer);
+        skeleton->draw(commandBuffer, skeleton->getLod());
+        frameStats.recordDraw(skeleton->getIndexCount(skeleton->getLod()), 1);
     }
 
+    frameStats.visibleObjects = models.size() + skeletonCount;
+
     vkCmdEndRenderPass(commandBuffer);
 }
 
@@ -427,8 +898,33 @@ void WvkApplication::recordCommandBuffer(int imageIndex) {
 
     checkVulkanError(vkBeginCommandBuffer(commandBuffer, &beginInfo), "failed to begin command buffer");
 
-    recordShadowRenderPass(imageIndex);
-    recordMainRenderPass(imageIndex);
+    gpuProfiler->beginFrame(commandBuffer, imageIndex);
+    frameStats = FrameStats{};
+    frameStats.uploadQueueDepth = assetStreamer->getQueueDepth();
+    frameStats.residentTextureBytes = textureStreamer->getResidentSize();
+    frameStats.streamingTextures = textureStreamer->getStreamingCount();
+
+    updateTextureDescriptors(imageIndex);
+
+    updateUniformBuffers(imageIndex);
+    cullClusters(imageIndex);
+
+    {
+        GpuProfileScope scope{*gpuProfiler, commandBuffer, "shadow pass"};
+        recordShadowRenderPass(imageIndex);
+    }
+    if (settings.depthPrepass) {
+        GpuProfileScope scope{*gpuProfiler, commandBuffer, "depth prepass"};
+        recordDepthPrepass(imageIndex);
+    }
+    {
+        GpuProfileScope scope{*gpuProfiler, commandBuffer, "main pass"};
+        recordMainRenderPass(imageIndex);
+    }
+    {
+        GpuProfileScope scope{*gpuProfiler, commandBuffer, "overlay"};
+        overlay->record(commandBuffer, imageIndex);
+    }
 
     checkVulkanError(vkEndCommandBuffer(commandBuffer), "failed to record command buffer");
 }
@@ -485,12 +981,14 @@ glm::vec2 WvkApplication::getCursorPos() {
     return glm::vec2(cx, cy);
 }
 
-void WvkApplication::setLight(int light, TransformMatrices *transform) {
+void WvkApplication::setLight(int light, glm::vec3 direction) {
     // TODO: param light index is currently unused
 
-    for (size_t i = 0; i < lightTransformBuffers.size(); i++) {
-        writeToBuffer(lightTransformBuffers[i].memory, sizeof(TransformMatrices), transform);
+    if (glm::length(direction) < 0.0001f) {
+        logger::error("Light direction must not be zero");
+        return;
     }
+    lightDirection = glm::normalize(direction);
 }
 
 }
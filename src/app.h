@@ -6,6 +6,13 @@
 #include "wvk_model.h"
 #include "wvk_skeleton.h"
 #include "wvk_sampler.h"
+#include "wvk_shadow_map.h"
+#include "wvk_gpu_profiler.h"
+#include "wvk_overlay.h"
+#include "wvk_asset_streamer.h"
+#include "wvk_texture_streamer.h"
+#include "render_settings.h"
+#include "cluster_culling.h"
 #include "game/game_structs.h"
 #include "glm.h"
 
@@ -25,15 +32,39 @@ enum CursorState {
     CURSOR_DISABLED
 };
 
-struct ObjectPushConstant {
-    uint32_t objectId;
+// Per draw data of the mesh and depth pipelines
+struct DrawPushConstant {
+    glm::vec3 positionOffset; // dequantizes the packed positions
+    uint32_t materialId;
+    glm::vec3 positionScale;
+    uint32_t objectId;        // only read by the rigged pipelines
 };
 
+struct ShadowPushConstant {
+    glm::vec3 positionOffset;
+    uint32_t cascade;
+    glm::vec3 positionScale;
+    uint32_t objectId;        // only read by the rigged shadow pipeline
+};
+
+/* Matches the ObjectData uniform block of rigged_mesh.vert and rigged_shadow.vert */
 struct ObjectData {
+    static const int MAX_OBJECTS = 8;
     static const int MAX_JOINTS = 16;
 
-    glm::mat4 transform;
-    glm::mat4 joints[MAX_JOINTS];
+    glm::mat4 transforms[MAX_OBJECTS];
+    glm::mat4 joints[MAX_OBJECTS * MAX_JOINTS];
+};
+
+// Game logic driven by WvkApplication::run, updated once per frame after the frame is submitted
+class AppController {
+  public:
+    virtual ~AppController() {}
+
+    virtual void update() = 0;
+
+    // The application exits once this returns true
+    virtual bool finished() { return false; }
 };
 
 class WvkApplication {
@@ -47,7 +78,7 @@ class WvkApplication {
     WvkApplication(const WvkApplication &) = delete;
     WvkApplication &operator=(const WvkApplication &) = delete;
 
-    void run();
+    void run(AppController &controller);
 
     bool isKeyPressed(int);
     bool isKeyHeld(int);
@@ -58,13 +89,26 @@ class WvkApplication {
     void enableCursor(bool enable) { window.enableCursor(enable); }
 
     void setCamera(Camera *camera) { this->camera = camera; }
-    void setLight(int light, TransformMatrices *transform);
+    // Sets the direction the light shines in, shadows are fitted to the camera every frame
+    void setLight(int light, glm::vec3 direction);
     void addModel(WvkModel *model) { models.push_back(model); }
-    void addSkeleton(WvkSkeleton *skeleton) { skeletons.push_back(skeleton); }
+    void addSkeleton(WvkSkeleton *skeleton) {
+        if (skeletons.size() >= ObjectData::MAX_OBJECTS) {
+            logger::error("Too many skeletons, only the first " + std::to_string(ObjectData::MAX_OBJECTS) + " are drawn");
+        }
+        skeletons.push_back(skeleton);
+    }
 
     uint64_t getFrame() { return frame; }
+    // CPU time spent on the last frame in milliseconds, excluding the frame limiter
+    float getLastFrameTime() { return lastFrameTime; }
 
     WvkDevice &getDevice() { return device; }
+    WvkAssetStreamer &getAssetStreamer() { return *assetStreamer; }
+    WvkGpuProfiler &getGpuProfiler() { return *gpuProfiler; }
+    WvkShadowMap &getShadowMap() { return *shadowMap; }
+    RenderSettings &getRenderSettings() { return settings; }
+    const FrameStats &getFrameStats() { return frameStats; }
 
   private:
     void createPipelineResources();
@@ -74,45 +118,86 @@ class WvkApplication {
     void freeCommandBuffers();
     void recordCommandBuffer(int imageIndex);
 
+    void updateUniformBuffers(int imageIndex);
+    // Requests the mip levels the visible instances sample and streams them within the texture budget
+    void streamTextures();
+    // Points the texture descriptors of this image at the textures whose resident levels changed since it was last
+    // recorded
+    void updateTextureDescriptors(int imageIndex);
+    void setViewport(VkCommandBuffer commandBuffer);
+    void pushDrawConstants(VkCommandBuffer commandBuffer, WvkPipeline &pipeline, const Quantization &quantization,
+                           uint32_t materialId, uint32_t objectId);
+    // Selects the LODs of the camera passes and culls the meshlets of full detail instances
+    void cullClusters(int imageIndex);
+    // Draws a model with the bound pipeline, through the culled meshlet draws when cluster culling ran this frame
+    void drawModel(VkCommandBuffer commandBuffer, int imageIndex, size_t modelIndex);
     void recordShadowRenderPass(int imageIndex);
+    void recordDepthPrepass(int imageIndex);
     void recordMainRenderPass(int imageIndex);
 
     void writeToBuffer(VkDeviceMemory memory, uint32_t size, const void *data);
 
     void updateKeys();
+    void logGpuTimings();
 
     std::vector<WvkModel*> models;
     std::vector<WvkSkeleton*> skeletons;
 
     uint64_t frame = 0;
+    float lastFrameTime = 0.f;
 
     WvkWindow window{WIDTH, HEIGHT, "Hello Vulkan!"};
     WvkDevice device{window};
     WvkSwapchain swapChain{device, window.getExtent()};
 
     Camera *camera = nullptr;
+    glm::vec3 lightDirection{-1.f, -1.f, -1.f};
+
+    std::unique_ptr<WvkAssetStreamer> assetStreamer;
+    std::unique_ptr<WvkTextureStreamer> textureStreamer;
+
+    std::unique_ptr<WvkShadowMap> shadowMap;
 
     std::unique_ptr<WvkPipeline> shadowPipeline;
+    std::unique_ptr<WvkPipeline> shadowRiggedPipeline;
     std::unique_ptr<WvkPipeline> riggedPipeline;
     std::unique_ptr<WvkPipeline> pipeline;
+    bool meshBackFacesCulled = false; // by the camera pass pipelines, which allows culling back-facing meshlets
+
+    // Depth prepass, and main pass pipelines that only shade fragments matching its depth
+    std::unique_ptr<WvkPipeline> depthPipeline;
+    std::unique_ptr<WvkPipeline> depthRiggedPipeline;
+    std::unique_ptr<WvkPipeline> depthEqualPipeline;
+    std::unique_ptr<WvkPipeline> depthEqualRiggedPipeline;
 
-    /* TODO: Read this MAX_OBJECTS using spirv-reflect from shader */
-    constexpr static int MAX_OBJECTS = 8;
-    ObjectData objectData[MAX_OBJECTS];
+    std::unique_ptr<WvkGpuProfiler> gpuProfiler;
+    std::unique_ptr<WvkOverlay> overlay;
+
+    RenderSettings settings;
+    FrameStats frameStats;
+
+    /* TODO: Read ObjectData::MAX_OBJECTS using spirv-reflect from shader */
+    ObjectData objectData;
 
     std::vector<VkCommandBuffer> commandBuffers;
 
     /* Pipeline descriptor set resources */
-    Sampler textureSampler{device, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER};
+    Sampler textureSampler{device, SamplerConfig{}};   // trilinear and anisotropic, textures tile
     Sampler depthSampler{device, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER};
 
-    const std::vector<std::string> images = {"hazel.png", "viking_room.png"};
-    std::vector<Image> textureImages;
+    // Streamed in the background, the descriptors point at the placeholder image until each texture is resident
+    static constexpr AssetId IMAGES[] = {assetId("hazel.png"), assetId("viking_room.png")};
 
     std::vector<Buffer> cameraTransformBuffers;
-    std::vector<Buffer> lightTransformBuffers;
+    std::vector<Buffer> shadowDataBuffers;
     std::vector<Buffer> objectDataBuffers;
 
+    // Meshlet and LOD draws of the camera passes, written by cullClusters. clusterDrawRanges holds the first draw and
+    // the number of draws of each model, and is empty when the models are drawn whole.
+    std::vector<Buffer> indirectBuffers;
+    std::vector<DrawIndexedCommand> clusterDraws;
+    std::vector<std::pair<uint32_t, uint32_t>> clusterDrawRanges;
+
     std::unordered_map<uint16_t, KeyState> keyStates;
 };
 
@@ -0,0 +1,176 @@
+#include "asset_archive.h"
+
+#include "lz4_block.h"
+#include "../cpu_profiler.h"
+#include "../derived_data_cache.h"
+
+#include <logger.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace wvk {
+
+// Compressed entries have to save at least this fraction of their size, the rest are read in place
+static const size_t MIN_SAVING_DIVISOR = 8;
+
+static uint64_t alignEntry(uint64_t offset) {
+    return (offset + ARCHIVE_ALIGNMENT - 1) & ~(ARCHIVE_ALIGNMENT - 1);
+}
+
+static bool hasExtension(const std::string &name, const char *extension) {
+    size_t length = strlen(extension);
+    return name.size() >= length && name.compare(name.size() - length, length, extension) == 0;
+}
+
+// Formats with compression of their own, LZ4 only costs time on them
+static bool isCompressedFormat(const std::string &name) {
+    return hasExtension(name, ".png") || hasExtension(name, ".jpg") || hasExtension(name, ".jpeg") ||
+           hasExtension(name, ".ktx2");
+}
+
+bool serializeArchive(const std::vector<ArchiveFile> &files, std::vector<uint8_t> &archive, std::string &error) {
+    WVK_PROFILE_ZONE("serialize archive");
+
+    std::vector<const ArchiveFile *> sorted;
+    for (const ArchiveFile &file : files) {
+        sorted.push_back(&file);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const ArchiveFile *a, const ArchiveFile *b) {
+        return assetId(a->name) < assetId(b->name);
+    });
+    for (size_t i = 1; i < sorted.size(); i++) {
+        if (assetId(sorted[i - 1]->name) == assetId(sorted[i]->name)) {
+            error = "asset ids of " + sorted[i - 1]->name + " and " + sorted[i]->name + " collide";
+            return false;
+        }
+    }
+
+    std::string names;
+    std::vector<ArchiveEntry> entries(sorted.size());
+    std::vector<std::vector<uint8_t>> compressed(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const ArchiveFile &file = *sorted[i];
+        ArchiveEntry &entry = entries[i];
+        entry.id = assetId(file.name);
+        entry.contentHash = hashBytes(file.contents.data(), file.contents.size());
+        entry.size = file.contents.size();
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        names += file.name;
+        names += '\0';
+
+        entry.compression = ARCHIVE_STORED;
+        entry.storedSize = entry.size;
+        if (!isCompressedFormat(file.name) && !file.contents.empty()) {
+            compressed[i] = lz4Compress(file.contents.data(), file.contents.size());
+            if (compressed[i].size() <= entry.size - entry.size / MIN_SAVING_DIVISOR) {
+                entry.compression = ARCHIVE_LZ4;
+                entry.storedSize = compressed[i].size();
+            } else {
+                compressed[i].clear();
+            }
+        }
+    }
+
+    ArchiveHeader header{};
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.namesSize = static_cast<uint32_t>(names.size());
+
+    uint64_t offset = sizeof(ArchiveHeader) + sizeof(ArchiveEntry) * entries.size() + names.size();
+    for (ArchiveEntry &entry : entries) {
+        offset = alignEntry(offset);
+        entry.offset = offset;
+        offset += entry.storedSize;
+    }
+
+    archive.assign(offset, 0);
+    memcpy(archive.data(), &header, sizeof(header));
+    memcpy(archive.data() + sizeof(header), entries.data(), sizeof(ArchiveEntry) * entries.size());
+    memcpy(archive.data() + sizeof(header) + sizeof(ArchiveEntry) * entries.size(), names.data(), names.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        const std::vector<uint8_t> &contents = entries[i].compression == ARCHIVE_LZ4 ? compressed[i] : sorted[i]->contents;
+        if (!contents.empty()) {
+            memcpy(archive.data() + entries[i].offset, contents.data(), contents.size());
+        }
+    }
+    return true;
+}
+
+bool AssetArchive::open(const std::string &path) {
+    if (!file.open(path)) {
+        logger::error("Failed to map asset archive " + path);
+        return false;
+    }
+    if (!parse(file.getData(), file.getSize())) {
+        logger::error("Invalid asset archive " + path);
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+bool AssetArchive::parse(const uint8_t *archiveData, size_t archiveSize) {
+    entries.clear();
+    data = archiveData;
+    size = archiveSize;
+
+    ArchiveHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION) return false;
+
+    uint64_t indexSize = sizeof(ArchiveEntry) * static_cast<uint64_t>(header.entryCount);
+    if (indexSize + header.namesSize > size - sizeof(header)) return false;
+    if (header.namesSize > 0 && data[sizeof(header) + indexSize + header.namesSize - 1] != '\0') return false;
+
+    entries.resize(header.entryCount);
+    memcpy(entries.data(), data + sizeof(header), indexSize);
+    names = reinterpret_cast<const char *>(data + sizeof(header) + indexSize);
+    namesSize = header.namesSize;
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const ArchiveEntry &entry = entries[i];
+        bool valid = entry.offset <= size && entry.storedSize <= size - entry.offset && entry.nameOffset < namesSize &&
+                     (i == 0 || entries[i - 1].id < entry.id);
+        if (entry.compression == ARCHIVE_STORED) {
+            valid = valid && entry.storedSize == entry.size;
+        } else {
+            valid = valid && entry.compression == ARCHIVE_LZ4;
+        }
+        if (!valid) {
+            entries.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+const ArchiveEntry *AssetArchive::find(AssetId id) const {
+    auto entry = std::lower_bound(entries.begin(), entries.end(), id, [](const ArchiveEntry &entry, AssetId id) {
+        return entry.id < id;
+    });
+    return entry != entries.end() && entry->id == id ? &*entry : nullptr;
+}
+
+std::string AssetArchive::getName(const ArchiveEntry &entry) const {
+    return names + entry.nameOffset;
+}
+
+bool AssetArchive::read(const ArchiveEntry &entry, const uint8_t *&entryData, std::vector<uint8_t> &buffer) const {
+    if (entry.compression == ARCHIVE_STORED) {
+        entryData = data + entry.offset;
+        return true;
+    }
+
+    WVK_PROFILE_ZONE("decompress asset");
+    buffer.resize(entry.size);
+    if (!lz4Decompress(data + entry.offset, entry.storedSize, buffer.data(), buffer.size())) {
+        return false;
+    }
+    entryData = buffer.data();
+    return true;
+}
+
+}
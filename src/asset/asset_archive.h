@@ -0,0 +1,93 @@
+#pragma once
+
+#include "asset_id.h"
+#include "../mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wvk {
+
+/*
+ * Packed asset archive (.wpak): every resource in one file that is memory mapped once, so shipping builds open a
+ * single file instead of one per asset. Layout:
+ *
+ *   ArchiveHeader
+ *   ArchiveEntry[entryCount]   sorted by id for binary search
+ *   names                      zero terminated file names, for tools and error messages
+ *   entry data                 each entry starts on an ARCHIVE_ALIGNMENT boundary
+ *
+ * Entries are stored as they are or LZ4 compressed. Stored entries are read in place from the mapping and copied
+ * straight into staging memory, aligned for any vertex or texel type; formats that are already compressed, like PNG
+ * and KTX2, are always stored. Each entry carries the hash of its contents, which the derived data cache keys cooked
+ * assets with, so nothing in the archive is hashed at load time.
+ */
+
+static const uint32_t ARCHIVE_MAGIC = 0x4b415057;   // "WPAK"
+static const uint32_t ARCHIVE_VERSION = 1;
+static const uint64_t ARCHIVE_ALIGNMENT = 64;
+
+enum ArchiveCompression : uint32_t {
+    ARCHIVE_STORED,
+    ARCHIVE_LZ4,
+};
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t namesSize;
+};
+
+struct ArchiveEntry {
+    AssetId id;
+    uint64_t contentHash;    // hashBytes of the uncompressed contents
+    uint64_t offset;         // from the start of the archive
+    uint64_t storedSize;
+    uint64_t size;           // uncompressed
+    uint32_t compression;    // ArchiveCompression
+    uint32_t nameOffset;     // into the names
+};
+
+struct ArchiveFile {
+    std::string name;        // file name without directories, hashed with assetId()
+    std::vector<uint8_t> contents;
+};
+
+// Packs files into an archive. Returns false and sets error if two names hash to the same id.
+bool serializeArchive(const std::vector<ArchiveFile> &files, std::vector<uint8_t> &archive, std::string &error);
+
+class AssetArchive {
+  public:
+    AssetArchive() = default;
+
+    AssetArchive(const AssetArchive &) = delete;
+    AssetArchive &operator=(const AssetArchive &) = delete;
+
+    // Maps an archive and validates its index. Logs the problem and returns false if it can't be read or is malformed.
+    bool open(const std::string &path);
+    // Same as above for archive bytes in memory, which have to outlive the archive
+    bool parse(const uint8_t *data, size_t size);
+
+    // nullptr if the archive has no entry with the id
+    const ArchiveEntry *find(AssetId id) const;
+    const std::vector<ArchiveEntry> &getEntries() const { return entries; }
+    std::string getName(const ArchiveEntry &entry) const;
+
+    // Points data at a stored entry's bytes in the archive, or decompresses it into buffer and points data there.
+    // Returns false if the entry doesn't decompress.
+    bool read(const ArchiveEntry &entry, const uint8_t *&data, std::vector<uint8_t> &buffer) const;
+
+  private:
+    MappedFile file;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    std::vector<ArchiveEntry> entries;
+    const char *names = nullptr;
+    uint32_t namesSize = 0;
+};
+
+}
@@ -0,0 +1,132 @@
+#include "asset_file_system.h"
+
+#include "../cpu_profiler.h"
+#include "../derived_data_cache.h"
+#include "../resource_path.h"
+
+#include <logger.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+
+namespace wvk {
+
+void AssetData::close() {
+    file.close();
+    buffer.clear();
+    data = nullptr;
+    size = 0;
+    open = false;
+}
+
+AssetFileSystem::AssetFileSystem(const std::string &directory) {
+    WVK_PROFILE_ZONE("mount assets");
+
+    std::string archivePath = directory + ASSET_ARCHIVE_FILENAME;
+    std::error_code error;
+    if (std::filesystem::exists(archivePath, error) && archive.open(archivePath)) {
+        logger::debug("Mounted " + std::to_string(archive.getEntries().size()) + " assets from " + archivePath);
+    }
+    indexLooseFiles(directory);
+}
+
+std::vector<std::string> findAssetFiles(const std::string &directory) {
+    std::vector<std::string> paths;
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator file{directory, error};
+    for (; !error && file != std::filesystem::recursive_directory_iterator{}; file.increment(error)) {
+        // The derived data cache lives in the resource directory, its entries aren't assets
+        if (file->is_directory(error) && file->path().filename() == "derived") {
+            file.disable_recursion_pending();
+            continue;
+        }
+        if (!file->is_regular_file(error)) continue;
+
+        // Hidden files are left by the OS and editors
+        std::string name = file->path().filename().string();
+        std::string extension = file->path().extension().string();
+        if (name[0] == '.' || extension == ".wpak" || extension == ".tmp") continue;
+        paths.push_back(file->path().string());
+    }
+    if (error) {
+        logger::error("Failed to list resource directory " + directory + ": " + error.message());
+    }
+    return paths;
+}
+
+void AssetFileSystem::indexLooseFiles(const std::string &directory) {
+    for (const std::string &path : findAssetFiles(directory)) {
+        std::string name = std::filesystem::path(path).filename().string();
+        auto inserted = looseFiles.emplace(assetId(name), path);
+        if (!inserted.second) {
+            logger::error("Asset " + name + " exists twice, using " + inserted.first->second);
+        }
+    }
+}
+
+bool AssetFileSystem::exists(AssetId id) const {
+    return archive.find(id) != nullptr || looseFiles.count(id) > 0;
+}
+
+bool AssetFileSystem::open(AssetId id, AssetData &data) const {
+    data.close();
+
+    if (const ArchiveEntry *entry = archive.find(id)) {
+        if (!archive.read(*entry, data.data, data.buffer)) {
+            logger::error("Failed to decompress asset " + archive.getName(*entry));
+            return false;
+        }
+        data.size = entry->size;
+        data.open = true;
+        return true;
+    }
+
+    auto looseFile = looseFiles.find(id);
+    if (looseFile == looseFiles.end()) return false;
+
+    // Empty files can't be mapped, they open as no data
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(looseFile->second, error);
+    if (error) return false;
+    if (size > 0) {
+        if (!data.file.open(looseFile->second)) return false;
+        data.data = data.file.getData();
+        data.size = data.file.getSize();
+    }
+    data.open = true;
+    return true;
+}
+
+bool AssetFileSystem::contentHash(AssetId id, uint64_t &hash) const {
+    if (const ArchiveEntry *entry = archive.find(id)) {
+        hash = entry->contentHash;
+        return true;
+    }
+
+    auto looseFile = looseFiles.find(id);
+    if (looseFile == looseFiles.end()) return false;
+    return derivedDataCache().sourceHash(looseFile->second, hash);
+}
+
+std::string AssetFileSystem::getName(AssetId id) const {
+    if (const ArchiveEntry *entry = archive.find(id)) {
+        return archive.getName(*entry);
+    }
+
+    auto looseFile = looseFiles.find(id);
+    if (looseFile != looseFiles.end()) {
+        return std::filesystem::path(looseFile->second).filename().string();
+    }
+
+    char name[17];
+    snprintf(name, sizeof(name), "%016" PRIx64, id);
+    return name;
+}
+
+AssetFileSystem &assetFileSystem() {
+    static AssetFileSystem fileSystem{resourcePath()};
+    return fileSystem;
+}
+
+}
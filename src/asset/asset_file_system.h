@@ -0,0 +1,82 @@
+#pragma once
+
+#include "asset_archive.h"
+#include "asset_id.h"
+#include "../mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wvk {
+
+// Archive mounted from the resource directory when it exists, see WaywardPack in tools/pack_assets.cc
+static const char *const ASSET_ARCHIVE_FILENAME = "resources.wpak";
+
+// Contents of an asset, mapped from a loose file, pointing into the archive mapping or decompressed from it
+class AssetData {
+  public:
+    AssetData() = default;
+
+    AssetData(const AssetData &) = delete;
+    AssetData &operator=(const AssetData &) = delete;
+
+    void close();
+
+    bool isOpen() const { return open; }
+    const uint8_t *getData() const { return data; }
+    size_t getSize() const { return size; }
+
+  private:
+    friend class AssetFileSystem;
+
+    MappedFile file;
+    std::vector<uint8_t> buffer;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    bool open = false;
+};
+
+/*
+ * Resolves asset ids to their contents. Assets in the archive of the resource directory are read from it, the others
+ * from loose files anywhere below the directory, which is how the source tree keeps them. Both are indexed once on
+ * construction, so opening an asset is a lookup and a map; nothing is mutated afterwards and any thread may read.
+ */
+class AssetFileSystem {
+  public:
+    explicit AssetFileSystem(const std::string &directory);
+
+    AssetFileSystem(const AssetFileSystem &) = delete;
+    AssetFileSystem &operator=(const AssetFileSystem &) = delete;
+
+    bool exists(AssetId id) const;
+    // Returns false if the asset doesn't exist or can't be read
+    bool open(AssetId id, AssetData &data) const;
+    // Hash of the asset's contents, from the archive index or the derived data cache's source hashes
+    bool contentHash(AssetId id, uint64_t &hash) const;
+
+    bool exists(const std::string &name) const { return exists(assetId(name)); }
+    bool open(const std::string &name, AssetData &data) const { return open(assetId(name), data); }
+    bool contentHash(const std::string &name, uint64_t &hash) const { return contentHash(assetId(name), hash); }
+
+    // File name of an asset, for messages and telling formats apart. The id in hex if the asset doesn't exist.
+    std::string getName(AssetId id) const;
+
+    bool hasArchive() const { return !archive.getEntries().empty(); }
+
+  private:
+    void indexLooseFiles(const std::string &directory);
+
+    AssetArchive archive;
+    std::unordered_map<AssetId, std::string> looseFiles;   // paths by id
+};
+
+// Paths of the asset files anywhere below directory, without hidden files, the derived data cache and archives
+std::vector<std::string> findAssetFiles(const std::string &directory);
+
+// The file system of the resource path, shared by every loader
+AssetFileSystem &assetFileSystem();
+
+}
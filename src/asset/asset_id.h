@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace wvk {
+
+/*
+ * Assets are identified by the 64 bit FNV-1a hash of their file name, so names written in code hash at compile time:
+ *
+ *   constexpr AssetId VIKING_ROOM = assetId("viking_room.obj.model");
+ *
+ * Names are file names without directories, like the installed resource directory, which is flat. The packer
+ * rejects archives whose names collide.
+ */
+
+using AssetId = uint64_t;
+
+// Stands for no asset where one is optional, like the fragment shader of a depth only pipeline
+constexpr AssetId NO_ASSET = 0;
+
+constexpr AssetId assetId(std::string_view name) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+}
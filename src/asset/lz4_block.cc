@@ -0,0 +1,203 @@
+#include "lz4_block.h"
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace wvk {
+
+static const size_t MIN_MATCH = 4;
+static const size_t MAX_OFFSET = 65535;
+// The format ends every block with literals: the last match starts at least 12 bytes before the end and the last 5
+// bytes are always literals
+static const size_t MATCH_START_LIMIT = 12;
+static const size_t LAST_LITERALS = 5;
+
+static const int HASH_BITS = 16;
+static const size_t WILD_COPY = 16;
+
+static uint32_t read32(const uint8_t *data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint64_t read64(const uint8_t *data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static int countTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+static uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 and more continue in bytes of 255 until one is smaller
+static void writeLength(std::vector<uint8_t> &block, size_t length) {
+    for (; length >= 255; length -= 255) {
+        block.push_back(255);
+    }
+    block.push_back(static_cast<uint8_t>(length));
+}
+
+static void writeSequence(std::vector<uint8_t> &block, const uint8_t *literals, size_t literalCount,
+                          size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength - MIN_MATCH;
+    uint8_t token = static_cast<uint8_t>((literalCount < 15 ? literalCount : 15) << 4);
+    if (matchLength > 0) {
+        token |= static_cast<uint8_t>(matchCode < 15 ? matchCode : 15);
+    }
+    block.push_back(token);
+    if (literalCount >= 15) writeLength(block, literalCount - 15);
+    block.insert(block.end(), literals, literals + literalCount);
+
+    // The last sequence has literals only
+    if (matchLength == 0) return;
+    block.push_back(static_cast<uint8_t>(offset & 0xff));
+    block.push_back(static_cast<uint8_t>(offset >> 8));
+    if (matchCode >= 15) writeLength(block, matchCode - 15);
+}
+
+size_t lz4CompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+std::vector<uint8_t> lz4Compress(const uint8_t *data, size_t size) {
+    std::vector<uint8_t> block;
+    block.reserve(lz4CompressBound(size));
+
+    // Last position each 4 byte sequence was seen at, plus one so 0 means never
+    std::vector<uint32_t> table(size_t{1} << HASH_BITS, 0);
+
+    size_t literalStart = 0;
+    size_t position = 0;
+    size_t matchLimit = size > LAST_LITERALS ? size - LAST_LITERALS : 0;
+    while (position + MATCH_START_LIMIT < size) {
+        uint32_t sequence = read32(data + position);
+        uint32_t &entry = table[hashSequence(sequence)];
+        size_t candidate = entry;
+        entry = static_cast<uint32_t>(position + 1);
+
+        if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || read32(data + candidate - 1) != sequence) {
+            position++;
+            continue;
+        }
+        size_t matchStart = candidate - 1;
+
+        // Compared 8 bytes at a time, the first differing bit of the little endian words is the first differing byte
+        size_t length = MIN_MATCH;
+        while (position + length + 8 <= matchLimit) {
+            uint64_t difference = read64(data + matchStart + length) ^ read64(data + position + length);
+            if (difference != 0) {
+                length += countTrailingZeros(difference) / 8;
+                break;
+            }
+            length += 8;
+        }
+        if (position + length + 8 > matchLimit) {
+            while (position + length < matchLimit && data[matchStart + length] == data[position + length]) {
+                length++;
+            }
+        }
+        // Matches also extend back over the literals before them
+        while (position > literalStart && matchStart > 0 && data[matchStart - 1] == data[position - 1]) {
+            position--;
+            matchStart--;
+            length++;
+        }
+
+        writeSequence(block, data + literalStart, position - literalStart, position - matchStart, length);
+        position += length;
+        literalStart = position;
+
+        // The position two bytes back is hashed too, so runs right after a match are found
+        if (position >= 2 && position + MATCH_START_LIMIT < size) {
+            table[hashSequence(read32(data + position - 2))] = static_cast<uint32_t>(position - 2 + 1);
+        }
+    }
+
+    writeSequence(block, data + literalStart, size - literalStart, 0, 0);
+    return block;
+}
+
+// Reads a length continued in bytes of 255, returns false if the block ends first
+static bool readLength(const uint8_t *&in, const uint8_t *end, size_t &length) {
+    uint8_t byte;
+    do {
+        if (in == end) return false;
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool lz4Decompress(const uint8_t *block, size_t blockSize, uint8_t *out, size_t size) {
+    const uint8_t *in = block;
+    const uint8_t *inEnd = block + blockSize;
+    uint8_t *output = out;
+    uint8_t *outEnd = out + size;
+
+    while (in < inEnd) {
+        uint8_t token = *in++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !readLength(in, inEnd, literalCount)) return false;
+        if (literalCount > static_cast<size_t>(inEnd - in) || literalCount > static_cast<size_t>(outEnd - output)) {
+            return false;
+        }
+        // Short copies are done as one fixed size copy when both buffers have room for it, the excess is overwritten
+        if (literalCount <= WILD_COPY && static_cast<size_t>(inEnd - in) >= WILD_COPY &&
+            static_cast<size_t>(outEnd - output) >= WILD_COPY) {
+            memcpy(output, in, WILD_COPY);
+        } else {
+            memcpy(output, in, literalCount);
+        }
+        in += literalCount;
+        output += literalCount;
+
+        // The last sequence ends after its literals
+        if (in == inEnd) break;
+
+        if (inEnd - in < 2) return false;
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > static_cast<size_t>(output - out)) return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(in, inEnd, matchLength)) return false;
+        matchLength += MIN_MATCH;
+        if (matchLength > static_cast<size_t>(outEnd - output)) return false;
+
+        // Matches closer than their length repeat the bytes they're writing, those are copied in steps no larger than
+        // the offset, so every step reads bytes that were already written
+        const uint8_t *match = output - offset;
+        if (offset >= WILD_COPY && static_cast<size_t>(outEnd - output) >= matchLength + WILD_COPY) {
+            for (size_t i = 0; i < matchLength; i += WILD_COPY) {
+                memcpy(output + i, match + i, WILD_COPY);
+            }
+            output += matchLength;
+        } else if (offset >= matchLength) {
+            memcpy(output, match, matchLength);
+            output += matchLength;
+        } else {
+            for (size_t i = 0; i < matchLength; i++) {
+                *output++ = *match++;
+            }
+        }
+    }
+    return output == outEnd;
+}
+
+}
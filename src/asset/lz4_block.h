@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wvk {
+
+/*
+ * LZ4 block format: sequences of a token, literals and a match copied from up to 64 KB back. Decompression is a loop
+ * of copies, fast enough that reading compressed archive entries costs less than reading the bytes they save.
+ * Blocks don't store their decompressed size, the caller has to keep it.
+ */
+
+// Largest block lz4Compress can return for size bytes
+size_t lz4CompressBound(size_t size);
+
+// Greedy single pass compression, about as fast as the reference's fast mode and compatible with its decoder
+std::vector<uint8_t> lz4Compress(const uint8_t *data, size_t size);
+
+// Decompresses a block into exactly size bytes of out. Returns false if the block is malformed, would write past out
+// or decompresses to a different size.
+bool lz4Decompress(const uint8_t *block, size_t blockSize, uint8_t *out, size_t size);
+
+}
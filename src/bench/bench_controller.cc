@@ -0,0 +1,221 @@
+#include "bench_controller.h"
+#include "bench_report.h"
+
+#include "../wvk_model.h"
+#include "../wvk_skeleton.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace bench {
+
+// Deterministic pseudo-random value in [0, 1) for an index
+static float hashToUnit(uint32_t i) {
+    i ^= i >> 16;
+    i *= 0x7feb352d;
+    i ^= i >> 15;
+    i *= 0x846ca68b;
+    i ^= i >> 16;
+    return (i & 0xffffff) / float(0x1000000);
+}
+
+// Axis aligned box centered at center, each face wound counter clockwise when viewed from outside
+static void createBox(glm::vec3 center, float size,
+                      std::vector<wvk::MeshVertex> &vertices, std::vector<uint32_t> &indices) {
+    struct Face { glm::vec3 normal, u, v; };
+    static const Face FACES[6] = {
+        {{ 1, 0, 0}, {0, 1, 0}, {0, 0, 1}},
+        {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+        {{ 0, 1, 0}, {0, 0, 1}, {1, 0, 0}},
+        {{ 0,-1, 0}, {1, 0, 0}, {0, 0, 1}},
+        {{ 0, 0, 1}, {1, 0, 0}, {0, 1, 0}},
+        {{ 0, 0,-1}, {0, 1, 0}, {1, 0, 0}},
+    };
+    static const glm::vec2 CORNERS[4] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+
+    float half = size / 2.f;
+    for (const Face &face : FACES) {
+        uint32_t first = static_cast<uint32_t>(vertices.size());
+        for (const glm::vec2 &corner : CORNERS) {
+            glm::vec3 position = center + half * (face.normal + corner.x * face.u + corner.y * face.v);
+            vertices.push_back({position, face.normal, (corner + 1.f) / 2.f, 0});
+        }
+
+        for (uint32_t index : {0, 1, 2, 2, 3, 0}) {
+            indices.push_back(first + index);
+        }
+    }
+}
+
+static uint32_t gridSide(uint32_t count) {
+    return static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+}
+
+BenchController::BenchController(wvk::WvkApplication *app, const BenchConfig &config) : app{app}, config{config} {
+    app->setCamera(&camera);
+
+    // The benchmark measures rendering, not the frame limiter or the overlay
+    wvk::RenderSettings &settings = app->getRenderSettings();
+    settings.limitFrameRate = false;
+    settings.showOverlay = false;
+    settings.depthPrepass = config.depthPrepass;
+
+    createScene();
+
+    cpuFrameTimes.reserve(config.frames);
+    gpuFrameTimes.reserve(config.frames);
+}
+
+void BenchController::createScene() {
+    wvk::WvkDevice &device = app->getDevice();
+
+    const float PROP_SPACING = 3.f;
+    const float BOX_SPACING = 1.5f;
+
+    uint32_t propSide = gridSide(config.instancedProps);
+    uint32_t boxSide = gridSide(config.staticMeshes);
+    sceneRadius = std::max({propSide * PROP_SPACING, boxSide * BOX_SPACING, 4.f}) / 2.f;
+
+    /* Floor */
+    float floorSize = sceneRadius * 1.5f;
+    std::vector<wvk::MeshVertex> floorVertices = {
+        {{-floorSize, -floorSize, -1.5f}, {0.f, 0.f, 1.f}, {0.f, 0.f}, 0},
+        {{-floorSize, floorSize, -1.5f}, {0.f, 0.f, 1.f}, {0.f, 1.f}, 0},
+        {{floorSize, floorSize, -1.5f}, {0.f, 0.f, 1.f}, {1.f, 1.f}, 0},
+        {{floorSize, -floorSize, -1.5f}, {0.f, 0.f, 1.f}, {1.f, 0.f}, 0}
+    };
+    app->addModel(new wvk::WvkModel(device, floorVertices, {2, 1, 0, 0, 3, 2}));
+
+    /* Static meshes, each a separate model and draw call */
+    for (uint32_t i = 0; i < config.staticMeshes; i++) {
+        glm::vec3 center{(i % boxSide + 0.5f - boxSide / 2.f) * BOX_SPACING,
+                         (i / boxSide + 0.5f - boxSide / 2.f) * BOX_SPACING,
+                         -1.f + hashToUnit(i)};
+        float size = 0.3f + 0.5f * hashToUnit(i + 7919);
+
+        std::vector<wvk::MeshVertex> vertices;
+        std::vector<uint32_t> indices;
+        createBox(center, size, vertices, indices);
+
+        app->addModel(new wvk::WvkModel(device, vertices, indices));
+    }
+
+    /* Instanced props */
+    if (config.instancedProps > 0) {
+        std::vector<glm::mat4> transforms;
+        for (uint32_t i = 0; i < config.instancedProps; i++) {
+            glm::vec3 position{(i % propSide - propSide / 2.f) * PROP_SPACING,
+                               (i / propSide - propSide / 2.f) * PROP_SPACING,
+                               0.f};
+
+            glm::mat4 transform = glm::translate(glm::mat4(1.f), position);
+            transform = glm::rotate(transform, 2.f * glm::pi<float>() * hashToUnit(i + 104729), VECTOR_UP);
+            transforms.push_back(transform);
+        }
+
+        wvk::WvkModel *prop = new wvk::WvkModel(device, wvk::assetId(config.propModel), 1);
+        prop->setInstances(transforms);
+        app->addModel(prop);
+    }
+
+    /* Skinned characters */
+    uint32_t characters = std::min<uint32_t>(config.skinnedCharacters, wvk::ObjectData::MAX_OBJECTS);
+    for (uint32_t i = 0; i < characters; i++) {
+        wvk::WvkSkeleton *skeleton = new wvk::WvkSkeleton(device, wvk::assetId(config.characterModel));
+
+        glm::vec3 position{(i - (characters - 1) / 2.f) * 1.5f, 0.f, -1.5f};
+        skeleton->setTransform(glm::translate(glm::mat4(1.f), position));
+        app->addSkeleton(skeleton);
+    }
+
+    /* Light, the shadow cascades follow the camera */
+    app->setLight(0, glm::vec3(-1.f, -1.f, -1.f));
+}
+
+void BenchController::updateCamera(float time) {
+    float angle = 0.3f * time;
+    float distance = sceneRadius * (1.1f + 0.3f * std::sin(0.2f * time));
+    float height = sceneRadius * (0.4f + 0.2f * std::sin(0.5f * time));
+
+    camera.transform.position = glm::vec3(distance * std::cos(angle), distance * std::sin(angle), height);
+    camera.transform.lookingTowards(glm::vec3(0.f, 0.f, -1.f));
+}
+
+void BenchController::collectSamples() {
+    const wvk::GpuScopeHistory &gpuHistory = app->getGpuProfiler().getFrameHistory();
+    uint64_t newGpuSamples = gpuHistory.total - gpuSamplesSeen;
+    gpuSamplesSeen = gpuHistory.total;
+
+    if (frame < config.warmupFrames) return;
+    if (frame == config.warmupFrames) {
+        // Called after the frame was recorded, which is the first measured one
+        firstMeasuredGpuFrame = app->getGpuProfiler().getRecordedFrameCount() - 1;
+    }
+
+    cpuFrameTimes.push_back(app->getLastFrameTime());
+
+    // GPU results arrive a few frames late, read every sample added since the last frame
+    uint64_t available = std::min<uint64_t>(newGpuSamples, gpuHistory.count);
+    for (uint64_t i = available; i > 0; i--) {
+        int index = (gpuHistory.head + wvk::GpuScopeHistory::LENGTH - static_cast<int>(i)) % wvk::GpuScopeHistory::LENGTH;
+        if (gpuHistory.frames[index] < firstMeasuredGpuFrame) continue;
+        gpuFrameTimes.push_back(gpuHistory.milliseconds[index]);
+    }
+
+    const wvk::FrameStats &stats = app->getFrameStats();
+    maxFrameStats.drawCalls = std::max(maxFrameStats.drawCalls, stats.drawCalls);
+    maxFrameStats.triangles = std::max(maxFrameStats.triangles, stats.triangles);
+    maxFrameStats.instances = std::max(maxFrameStats.instances, stats.instances);
+
+    const wvk::GpuScopeHistory *mainPass = app->getGpuProfiler().getScopeHistory("main pass");
+    if (mainPass != nullptr && mainPass->count > 0 && mainPass->latestFrame() >= firstMeasuredGpuFrame) {
+        maxMainPassFragments = std::max(maxMainPassFragments, mainPass->statistics.fragmentInvocations);
+    }
+}
+
+void BenchController::update() {
+    collectSamples();
+
+    frame++;
+    updateCamera(frame * FIXED_TIMESTEP);
+}
+
+nlohmann::json BenchController::createReport() {
+    nlohmann::json report;
+
+    report["device"] = app->getDevice().getPhysicalDeviceProperties().vk.deviceName;
+
+    report["config"]["static_meshes"] = config.staticMeshes;
+    report["config"]["instanced_props"] = config.instancedProps;
+    report["config"]["skinned_characters"] = config.skinnedCharacters;
+    report["config"]["prop_model"] = config.propModel;
+    report["config"]["character_model"] = config.characterModel;
+    report["config"]["depth_prepass"] = config.depthPrepass;
+    report["config"]["warmup_frames"] = config.warmupFrames;
+    report["config"]["frames"] = config.frames;
+
+    report["cpu_ms"] = toJson(summarize(cpuFrameTimes));
+    if (!gpuFrameTimes.empty()) {
+        report["gpu_ms"] = toJson(summarize(gpuFrameTimes));
+    }
+
+    report["draws"]["draw_calls"] = maxFrameStats.drawCalls;
+    report["draws"]["triangles"] = maxFrameStats.triangles;
+    report["draws"]["instances"] = maxFrameStats.instances;
+    if (app->getGpuProfiler().pipelineStatisticsSupported()) {
+        report["draws"]["main_pass_fragments"] = maxMainPassFragments;
+    }
+
+    wvk::MemoryTracker &memory = app->getDevice().getMemoryTracker();
+    VkDeviceSize totalMemory = 0;
+    for (int i = 0; i < wvk::MEMORY_CATEGORY_COUNT; i++) {
+        wvk::MemoryCategory category = static_cast<wvk::MemoryCategory>(i);
+        report["memory_bytes"][wvk::memoryCategoryName(category)] = memory.getAllocated(category);
+        totalMemory += memory.getAllocated(category);
+    }
+    report["memory_bytes"]["total"] = totalMemory;
+
+    return report;
+}
+
+}
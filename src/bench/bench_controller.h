@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../app.h"
+#include "../game/game_structs.h"
+
+#include <json.h>
+
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct BenchConfig {
+    uint32_t staticMeshes = 64;       // procedural boxes, one draw call each
+    uint32_t instancedProps = 256;    // instances of propModel, drawn with a single draw call
+    uint32_t skinnedCharacters = 4;   // copies of characterModel, at most ObjectData::MAX_OBJECTS
+
+    bool depthPrepass = false;
+
+    std::string propModel = "viking_room.obj.model";
+    std::string characterModel = "astronaut.glb";
+
+    uint32_t warmupFrames = 120;
+    uint32_t frames = 1200;
+};
+
+// Builds a scene from a BenchConfig and flies the camera along a scripted path with a fixed timestep,
+// so every run renders exactly the same frames
+class BenchController : public wvk::AppController {
+  public:
+    static constexpr float FIXED_TIMESTEP = 1.f / 60.f;
+
+    BenchController(wvk::WvkApplication *app, const BenchConfig &config);
+
+    BenchController(const BenchController &) = delete;
+    BenchController &operator=(const BenchController &) = delete;
+
+    void update() override;
+    bool finished() override { return frame >= config.warmupFrames + config.frames; }
+
+    nlohmann::json createReport();
+
+  private:
+    void createScene();
+    void updateCamera(float time);
+    void collectSamples();
+
+    wvk::WvkApplication *app;
+    BenchConfig config;
+
+    uint32_t frame = 0;
+    float sceneRadius = 1.f;
+
+    Camera camera;
+
+    std::vector<float> cpuFrameTimes;
+    std::vector<float> gpuFrameTimes;
+    uint64_t gpuSamplesSeen = 0;
+    uint64_t firstMeasuredGpuFrame = 0;   // GPU results of earlier frames belong to the warmup
+
+    wvk::FrameStats maxFrameStats;
+    uint64_t maxMainPassFragments = 0;
+};
+
+}
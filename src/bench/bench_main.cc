@@ -0,0 +1,121 @@
+#include "bench_controller.h"
+#include "bench_report.h"
+
+#include "../app.h"
+#include "../resource_path.h"
+
+#include <logger.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static void printUsage() {
+    logger::print("usage: WaywardBench [options]\n"
+                  "  --static <n>          procedural static meshes (default 64)\n"
+                  "  --instanced <n>       instanced props (default 256)\n"
+                  "  --skinned <n>         skinned characters (default 4, max 8)\n"
+                  "  --prop <file>         prop model in resources/models (default viking_room.obj.model)\n"
+                  "  --character <file>    skinned model in resources/models (default astronaut.glb)\n"
+                  "  --depth-prepass       render a depth prepass before the main pass\n"
+                  "  --warmup <n>          frames rendered before measuring (default 120)\n"
+                  "  --frames <n>          measured frames (default 1200)\n"
+                  "  --output <file>       report path (default bench_report.json)\n"
+                  "  --baseline <file>     baseline report to compare against\n"
+                  "  --threshold <value>   allowed relative slowdown vs the baseline (default 0.1)\n"
+                  "  --resources <dir>     resource directory");
+}
+
+int main(int argc, char **argv) {
+    bench::BenchConfig config{};
+    std::string outputPath = "bench_report.json";
+    std::string baselinePath;
+    double threshold = 0.1;
+
+#if defined(__APPLE__)
+    std::string appPath(argv[0]);
+    const std::string contents = "Contents/";
+    size_t index = appPath.rfind(contents);
+    std::string resources = appPath.substr(0, index + contents.size()) + "resources/";
+#else
+    std::string resources = "resources/";
+#endif
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help") {
+            printUsage();
+            return 0;
+        }
+        if (arg == "--depth-prepass") {
+            config.depthPrepass = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            logger::error("missing value for " + arg);
+            printUsage();
+            return 1;
+        }
+        const char *value = argv[++i];
+
+        if (arg == "--static") config.staticMeshes = std::strtoul(value, nullptr, 10);
+        else if (arg == "--instanced") config.instancedProps = std::strtoul(value, nullptr, 10);
+        else if (arg == "--skinned") config.skinnedCharacters = std::strtoul(value, nullptr, 10);
+        else if (arg == "--prop") config.propModel = value;
+        else if (arg == "--character") config.characterModel = value;
+        else if (arg == "--warmup") config.warmupFrames = std::strtoul(value, nullptr, 10);
+        else if (arg == "--frames") config.frames = std::strtoul(value, nullptr, 10);
+        else if (arg == "--output") outputPath = value;
+        else if (arg == "--baseline") baselinePath = value;
+        else if (arg == "--threshold") threshold = std::strtod(value, nullptr);
+        else if (arg == "--resources") resources = value;
+        else {
+            logger::error("unknown option " + arg);
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (!resources.empty() && resources.back() != '/') resources += '/';
+    setResourcePath(resources.c_str());
+
+    nlohmann::json report;
+    {
+        wvk::WvkApplication app;
+        bench::BenchController controller{&app, config};
+
+        app.run(controller);
+
+        if (!controller.finished()) {
+            logger::error("benchmark was interrupted, no report written");
+            return 1;
+        }
+
+        report = controller.createReport();
+    }
+
+    if (!bench::writeJson(outputPath, report)) {
+        logger::error("failed to write report to " + outputPath);
+        return 1;
+    }
+    logger::print("Wrote benchmark report to " + outputPath);
+    logger::print(report.dump(4));
+
+    if (baselinePath.empty()) return 0;
+
+    nlohmann::json baseline;
+    if (!bench::readJson(baselinePath, baseline)) {
+        logger::error("failed to read baseline " + baselinePath);
+        return 1;
+    }
+
+    int regressions = bench::compareToBaseline(report, baseline, threshold);
+    if (regressions > 0) {
+        logger::error(std::to_string(regressions) + " metrics regressed by more than " +
+                      std::to_string(threshold * 100.0) + "%");
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "bench_report.h"
+
+#include <logger.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace bench {
+
+static double percentile(const std::vector<float> &sorted, double p) {
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    if (rank > 0) rank--;
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+TimingSummary summarize(std::vector<float> samples) {
+    TimingSummary summary{};
+    if (samples.empty()) return summary;
+
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0.0;
+    for (float sample : samples) {
+        total += sample;
+    }
+
+    summary.samples = samples.size();
+    summary.average = total / samples.size();
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.p50 = percentile(samples, 0.50);
+    summary.p95 = percentile(samples, 0.95);
+    summary.p99 = percentile(samples, 0.99);
+
+    return summary;
+}
+
+nlohmann::json toJson(const TimingSummary &summary) {
+    nlohmann::json json;
+    json["samples"] = summary.samples;
+    json["avg"] = summary.average;
+    json["min"] = summary.min;
+    json["max"] = summary.max;
+    json["p50"] = summary.p50;
+    json["p95"] = summary.p95;
+    json["p99"] = summary.p99;
+    return json;
+}
+
+int compareTimings(const std::string &label, const nlohmann::json &current, const nlohmann::json &baseline,
+                   double threshold) {
+    static const char *METRICS[] = {"avg", "p50", "p95", "p99"};
+
+    int regressions = 0;
+
+    for (const char *metric : METRICS) {
+        if (!current.count(metric) || !baseline.count(metric)) continue;
+
+        double value = current[metric].get<double>();
+        double base = baseline[metric].get<double>();
+        if (base <= 0.0) continue;
+
+        double change = (value - base) / base;
+        bool regressed = change > threshold;
+
+        char line[256];
+        snprintf(line, sizeof(line), "%s.%s: %.3f ms (baseline %.3f ms, %+.1f%%)%s",
+                 label.c_str(), metric, value, base, change * 100.0, regressed ? " REGRESSION" : "");
+        if (regressed) {
+            logger::error(line);
+            regressions++;
+        } else {
+            logger::print(line);
+        }
+    }
+
+    return regressions;
+}
+
+int compareToBaseline(const nlohmann::json &report, const nlohmann::json &baseline, double threshold) {
+    static const char *TIMINGS[] = {"cpu_ms", "gpu_ms"};
+
+    int regressions = 0;
+
+    for (const char *timing : TIMINGS) {
+        if (!report.count(timing) || !baseline.count(timing)) continue;
+
+        regressions += compareTimings(timing, report[timing], baseline[timing], threshold);
+    }
+
+    return regressions;
+}
+
+bool readJson(const std::string &path, nlohmann::json &out) {
+    std::ifstream file{path};
+    if (!file.is_open()) return false;
+
+    try {
+        file >> out;
+    } catch (const nlohmann::json::exception &e) {
+        logger::error("Failed to parse " + path + ": " + e.what());
+        return false;
+    }
+    return true;
+}
+
+bool writeJson(const std::string &path, const nlohmann::json &json) {
+    std::ofstream file{path};
+    if (!file.is_open()) return false;
+
+    file << json.dump(4) << std::endl;
+    return true;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <json.h>
+
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct TimingSummary {
+    size_t samples = 0;
+    double average = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+};
+
+// Nearest-rank percentiles of a set of frame times
+TimingSummary summarize(std::vector<float> samples);
+
+nlohmann::json toJson(const TimingSummary &summary);
+
+// Compares the avg/p50/p95/p99 of a timing summary against the baseline summary, logging one line per metric.
+// Returns the number of metrics more than threshold slower than the baseline.
+int compareTimings(const std::string &label, const nlohmann::json &current, const nlohmann::json &baseline,
+                   double threshold);
+
+// Compares the timings of a report against a baseline report. A metric regresses if it is more than
+// threshold (relative, e.g. 0.1 = 10%) slower than the baseline. Returns the number of regressed metrics.
+int compareToBaseline(const nlohmann::json &report, const nlohmann::json &baseline, double threshold);
+
+bool readJson(const std::string &path, nlohmann::json &out);
+bool writeJson(const std::string &path, const nlohmann::json &json);
+
+}
@@ -0,0 +1,60 @@
+#include "microbench.h"
+
+#include <chrono>
+#include <vector>
+
+namespace bench {
+
+static volatile float gSink = 0.f;
+
+void consume(float value) {
+    gSink = gSink + value;
+}
+
+MicroResult runMicroBenchmark(const MicroBenchmark &benchmark, double minSeconds, uint32_t minIterations) {
+    using Clock = std::chrono::steady_clock;
+
+    benchmark.run();
+
+    std::vector<float> samples;
+    double elapsed = 0.0;
+
+    while (elapsed < minSeconds || samples.size() < minIterations) {
+        auto start = Clock::now();
+        benchmark.run();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        samples.push_back(static_cast<float>(seconds * 1000.0));
+        elapsed += seconds;
+    }
+
+    MicroResult result{};
+    result.name = benchmark.name;
+    result.items = benchmark.items;
+    result.bytes = benchmark.bytes;
+    result.summary = summarize(samples);
+    return result;
+}
+
+double itemsPerSecond(const MicroResult &result) {
+    if (result.summary.p50 <= 0.0) return 0.0;
+    return result.items / (result.summary.p50 / 1000.0);
+}
+
+double megabytesPerSecond(const MicroResult &result) {
+    if (result.summary.p50 <= 0.0) return 0.0;
+    return result.bytes / (1024.0 * 1024.0) / (result.summary.p50 / 1000.0);
+}
+
+nlohmann::json toJson(const MicroResult &result) {
+    nlohmann::json json = toJson(result.summary);
+    json["items"] = result.items;
+    json["items_per_s"] = itemsPerSecond(result);
+    if (result.bytes > 0) {
+        json["bytes"] = result.bytes;
+        json["mb_per_s"] = megabytesPerSecond(result);
+    }
+    return json;
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "bench_report.h"
+
+#include <json.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace bench {
+
+struct MicroBenchmark {
+    std::string name;
+    uint64_t items = 0;    // elements processed per iteration, e.g. vertices
+    uint64_t bytes = 0;    // input bytes consumed per iteration, 0 if not meaningful
+    std::function<void()> run;
+};
+
+struct MicroResult {
+    std::string name;
+    uint64_t items = 0;
+    uint64_t bytes = 0;
+    TimingSummary summary; // milliseconds per iteration
+};
+
+// Runs the benchmark once to warm caches, then repeatedly until both minSeconds and minIterations are reached
+MicroResult runMicroBenchmark(const MicroBenchmark &benchmark, double minSeconds, uint32_t minIterations);
+
+// Throughput at the median iteration time
+double itemsPerSecond(const MicroResult &result);
+double megabytesPerSecond(const MicroResult &result);
+
+nlohmann::json toJson(const MicroResult &result);
+
+// Keeps the compiler from discarding a kernel whose result is otherwise unused
+void consume(float value);
+
+}
@@ -0,0 +1,703 @@
+#include "microbench.h"
+#include "bench_report.h"
+
+#include "../mesh/obj_loader.h"
+#include "../mesh/vertex_packing.h"
+#include "../mesh/mesh_optimizer.h"
+#include "../mesh/simplifier.h"
+#include "../mesh/cooked_mesh.h"
+#include "../mesh/glb_file.h"
+#include "../texture/block_compression.h"
+#include "../texture/texture_cooker.h"
+#include "../anim/skeleton.h"
+#include "../anim/accessor_view.h"
+#include "../game/game_structs.h"
+#include "../shadow_cascades.h"
+#include "../derived_data_cache.h"
+#include "../asset/lz4_block.h"
+
+#include <tiny_gltf.h>
+#include <stb_image.h>
+#include <logger.h>
+
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef WVK_RESOURCE_DIR
+#define WVK_RESOURCE_DIR "resources/"
+#endif
+
+// Swallows the loaders' debug output while timing, so the terminal doesn't dominate the measurement
+class NullBuffer : public std::streambuf {
+  protected:
+    int overflow(int c) override { return c; }
+};
+
+static void printUsage() {
+    logger::print("usage: WaywardMicrobench [options]\n"
+                  "  --filter <text>       only run benchmarks whose name contains text\n"
+                  "  --min-time <seconds>  minimum time spent per benchmark (default 0.5)\n"
+                  "  --grid <n>            side of the synthetic OBJ grid in quads (default 512)\n"
+                  "  --transforms <n>      transforms per projection batch and objects per culling batch (default 100000)\n"
+                  "  --prop <file>         OBJ model in resources/models (default viking_room.obj.model)\n"
+                  "  --character <file>    skinned model in resources/models (default astronaut.glb)\n"
+                  "  --texture <file>      image in resources/images (default viking_room.png)\n"
+                  "  --output <file>       report path (default microbench_report.json)\n"
+                  "  --baseline <file>     baseline report to compare against\n"
+                  "  --threshold <value>   allowed relative slowdown vs the baseline (default 0.1)\n"
+                  "  --resources <dir>     resource directory\n"
+                  "  --verbose             keep loader logging");
+}
+
+static bool readFile(const std::string &path, std::string &out) {
+    std::ifstream file{path, std::ios::binary};
+    if (!file.is_open()) return false;
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    out = contents.str();
+    return true;
+}
+
+/* Synthetic inputs */
+
+// OBJ text of a side x side grid of quads, with positions, texture coordinates and normals per corner
+static std::string createObjGrid(uint32_t side) {
+    std::string obj;
+    obj.reserve(static_cast<size_t>(side + 1) * (side + 1) * 96 + static_cast<size_t>(side) * side * 80);
+
+    char line[256]; // two face lines with 7 digit indices
+    for (uint32_t y = 0; y <= side; y++) {
+        for (uint32_t x = 0; x <= side; x++) {
+            float height = 0.1f * std::sin(0.37f * x) * std::cos(0.23f * y);
+            snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn 0 0 1\n",
+                     float(x), float(y), height, float(x) / side, float(y) / side);
+            obj += line;
+        }
+    }
+
+    for (uint32_t y = 0; y < side; y++) {
+        for (uint32_t x = 0; x < side; x++) {
+            uint32_t a = y * (side + 1) + x + 1; // OBJ indices start at 1
+            uint32_t b = a + 1;
+            uint32_t c = a + side + 2;
+            uint32_t d = a + side + 1;
+            snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\nf %u/%u/%u %u/%u/%u %u/%u/%u\n",
+                     a, a, a, b, b, b, c, c, c, a, a, a, c, c, c, d, d, d);
+            obj += line;
+        }
+    }
+
+    return obj;
+}
+
+template <typename T>
+static int addAccessor(tinygltf::Model &model, const std::vector<T> &data, int type, int componentType) {
+    tinygltf::Buffer &buffer = model.buffers[0];
+
+    tinygltf::BufferView view{};
+    view.buffer = 0;
+    view.byteOffset = buffer.data.size();
+    view.byteLength = data.size() * sizeof(T);
+
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data.data());
+    buffer.data.insert(buffer.data.end(), bytes, bytes + view.byteLength);
+    model.bufferViews.push_back(view);
+
+    tinygltf::Accessor accessor{};
+    accessor.bufferView = static_cast<int>(model.bufferViews.size()) - 1;
+    accessor.type = type;
+    accessor.componentType = componentType;
+    accessor.count = data.size() * sizeof(T) / (tinygltf::GetComponentSizeInBytes(componentType) *
+                                                 tinygltf::GetNumComponentsInType(type));
+    model.accessors.push_back(accessor);
+
+    return static_cast<int>(model.accessors.size()) - 1;
+}
+
+// Skinned glTF grid of side x side vertices, laid out like an exported character. 16 bit indices limit side to 256.
+static tinygltf::Model createGltfGrid(uint32_t side) {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec4> weights;
+    std::vector<std::array<uint8_t, 4>> joints;
+
+    for (uint32_t y = 0; y < side; y++) {
+        for (uint32_t x = 0; x < side; x++) {
+            positions.push_back({float(x), float(y), 0.f});
+            normals.push_back({0.f, 0.f, 1.f});
+            texCoords.push_back({float(x) / side, float(y) / side});
+            weights.push_back({0.75f, 0.25f, 0.f, 0.f});
+            joints.push_back({0, 1, 0, 0});
+        }
+    }
+
+    std::vector<uint16_t> indices;
+    for (uint32_t y = 0; y + 1 < side; y++) {
+        for (uint32_t x = 0; x + 1 < side; x++) {
+            uint16_t a = static_cast<uint16_t>(y * side + x);
+            uint16_t b = a + 1;
+            uint16_t c = static_cast<uint16_t>(a + side + 1);
+            uint16_t d = static_cast<uint16_t>(a + side);
+            for (uint16_t index : {a, b, c, a, c, d}) {
+                indices.push_back(index);
+            }
+        }
+    }
+
+    tinygltf::Model model{};
+    model.buffers.resize(1);
+
+    tinygltf::Primitive primitive{};
+    primitive.mode = TINYGLTF_MODE_TRIANGLES;
+    primitive.attributes["POSITION"] = addAccessor(model, positions, TINYGLTF_TYPE_VEC3, TINYGLTF_COMPONENT_TYPE_FLOAT);
+    primitive.attributes["NORMAL"] = addAccessor(model, normals, TINYGLTF_TYPE_VEC3, TINYGLTF_COMPONENT_TYPE_FLOAT);
+    primitive.attributes["TEXCOORD_0"] = addAccessor(model, texCoords, TINYGLTF_TYPE_VEC2, TINYGLTF_COMPONENT_TYPE_FLOAT);
+    primitive.attributes["JOINTS_0"] = addAccessor(model, joints, TINYGLTF_TYPE_VEC4, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE);
+    primitive.attributes["WEIGHTS_0"] = addAccessor(model, weights, TINYGLTF_TYPE_VEC4, TINYGLTF_COMPONENT_TYPE_FLOAT);
+    primitive.indices = addAccessor(model, indices, TINYGLTF_TYPE_SCALAR, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+
+    tinygltf::Mesh mesh{};
+    mesh.name = "grid";
+    mesh.primitives.push_back(primitive);
+    model.meshes.push_back(mesh);
+
+    tinygltf::Node root{};
+    root.name = "root";
+    root.children = {1};
+    tinygltf::Node joint{};
+    joint.name = "joint";
+    tinygltf::Node grid{};
+    grid.name = "grid";
+    grid.mesh = 0;
+    grid.skin = 0;
+    model.nodes = {root, joint, grid};
+
+    tinygltf::Skin skin{};
+    skin.name = "grid";
+    skin.joints = {0, 1};
+    model.skins.push_back(skin);
+
+    return model;
+}
+
+/* Benchmarks */
+
+static void addObjBenchmark(std::vector<bench::MicroBenchmark> &benchmarks, const std::string &name,
+                            std::shared_ptr<const std::string> obj, bool &failed) {
+    wvk::MeshData mesh;
+    {
+        std::istringstream stream{*obj};
+        mesh = wvk::loadObjMesh(stream, 0);
+    }
+
+    benchmarks.push_back({name, mesh.indices.size(), obj->size(), [obj]() {
+        std::istringstream stream{*obj};
+        wvk::MeshData mesh = wvk::loadObjMesh(stream, 0);
+        bench::consume(static_cast<float>(mesh.vertices.size()));
+    }});
+
+    std::string meshName = name.substr(name.find('/') + 1);
+
+    // Same text parsed from memory, split over up to threadCount threads once the file is large enough. The result
+    // has to match the serial loader's exactly.
+    for (uint32_t threadCount : {1u, 2u, 4u, 8u}) {
+        std::string parallelName = "loadObjMeshParallel/" + meshName + "/" + std::to_string(threadCount);
+        wvk::MeshData parallel = wvk::loadObjMesh(obj->data(), obj->size(), 0, threadCount);
+        if (parallel.vertices != mesh.vertices || parallel.indices != mesh.indices) {
+            logger::error(parallelName + " differs from the serial loader");
+            failed = true;
+        }
+
+        benchmarks.push_back({parallelName, mesh.indices.size(), obj->size(), [obj, threadCount]() {
+            wvk::MeshData mesh = wvk::loadObjMesh(obj->data(), obj->size(), 0, threadCount);
+            bench::consume(static_cast<float>(mesh.vertices.size()));
+        }});
+    }
+
+    auto source = std::make_shared<const wvk::MeshData>(mesh);
+    benchmarks.push_back({"optimizeMesh/" + meshName, source->indices.size() / 3, 0, [source]() {
+        wvk::MeshData mesh = *source;
+        wvk::MeshOptimizationStats stats = wvk::optimizeMesh(mesh.vertices, mesh.indices);
+        bench::consume(stats.acmrAfter);
+    }});
+
+    auto positions = std::make_shared<std::vector<glm::vec3>>();
+    for (const wvk::MeshVertex &vertex : mesh.vertices) {
+        positions->push_back(vertex.position);
+    }
+    benchmarks.push_back({"generateLods/" + meshName, source->indices.size() / 3, 0, [source, positions]() {
+        std::vector<wvk::MeshLod> lods = wvk::generateLods(source->indices, *positions);
+        bench::consume(lods.empty() ? 0.f : lods.back().error);
+    }});
+
+    // The cooked file's bytes as they would be mapped, loading copies the blobs out like the staging upload does
+    wvk::CookedMeshSource cookedSource{};
+    auto cooked = std::make_shared<const std::vector<uint8_t>>(
+        wvk::serializeCookedMesh(wvk::cookMesh(mesh.vertices, mesh.indices), cookedSource));
+    benchmarks.push_back({"loadCookedMesh/" + meshName, mesh.indices.size(), cooked->size(), [cooked, cookedSource]() {
+        wvk::CookedMeshView view{};
+        if (!wvk::parseCookedMesh(cooked->data(), cooked->size(), cookedSource, view)) return;
+
+        std::vector<uint8_t> staging(cooked->size());
+        size_t offset = 0;
+        auto copy = [&](const void *data, size_t size) {
+            memcpy(staging.data() + offset, data, size);
+            offset += size;
+        };
+        copy(view.vertices, sizeof(wvk::PackedVertex) * view.vertexCount);
+        copy(view.positions, sizeof(wvk::PositionVertex) * view.vertexCount);
+        copy(view.indices, static_cast<size_t>(view.indexSize) * view.indexCount);
+        bench::consume(static_cast<float>(staging[offset / 2]));
+    }});
+
+    auto vertices = std::make_shared<const std::vector<wvk::MeshVertex>>(std::move(mesh.vertices));
+    benchmarks.push_back({"packVertices/" + meshName, vertices->size(),
+                          vertices->size() * sizeof(wvk::MeshVertex), [vertices]() {
+        wvk::Bounds bounds{};
+        for (const wvk::MeshVertex &vertex : *vertices) {
+            bounds.extend(vertex.position);
+        }
+        std::vector<wvk::PackedVertex> packed = wvk::packVertices(*vertices, wvk::positionQuantization(bounds));
+        bench::consume(static_cast<float>(packed.size()));
+    }});
+}
+
+static void addGltfBenchmarks(std::vector<bench::MicroBenchmark> &benchmarks, const std::string &name,
+                              std::shared_ptr<const tinygltf::Model> model) {
+    const tinygltf::Node *riggedNode = nullptr;
+    for (const tinygltf::Node &node : model->nodes) {
+        if (node.skin != -1 && node.mesh != -1) {
+            riggedNode = &node;
+            break;
+        }
+    }
+    if (riggedNode == nullptr) {
+        logger::error(name + " has no skinned mesh, skipping");
+        return;
+    }
+
+    const tinygltf::Primitive &primitive = model->meshes[riggedNode->mesh].primitives[0];
+    int position = primitive.attributes.at("POSITION");
+    int weights = primitive.attributes.at("WEIGHTS_0");
+    int joints = primitive.attributes.at("JOINTS_0");
+    uint64_t count = model->accessors[position].count;
+
+    benchmarks.push_back({"readFloats/position/" + name, count, count * sizeof(glm::vec3), [model, position]() {
+        std::vector<glm::vec3> positions = wvk::AccessorView{*model, position}.readVectors<glm::vec3>();
+        bench::consume(positions.back().x);
+    }});
+
+    benchmarks.push_back({"readFloats/weights/" + name, count, count * sizeof(glm::vec4), [model, weights]() {
+        std::vector<glm::vec4> values = wvk::AccessorView{*model, weights}.readVectors<glm::vec4>();
+        bench::consume(values.back().x);
+    }});
+
+    benchmarks.push_back({"readUints/joints/" + name, count, count * 4, [model, joints, count]() {
+        std::vector<uint32_t> values(count * 4);
+        wvk::AccessorView{*model, joints}.readUints(values.data(), 4);
+        bench::consume(static_cast<float>(values.back()));
+    }});
+
+    // Every attribute the skeleton reads per vertex, plus the indices
+    const tinygltf::Accessor &indices = model->accessors[primitive.indices];
+    uint64_t bytes = count * (2 * sizeof(glm::vec3) + sizeof(glm::vec2) + 4 + sizeof(glm::vec4)) +
+                     indices.count * tinygltf::GetComponentSizeInBytes(indices.componentType);
+    benchmarks.push_back({"readMeshData/" + name, count, bytes, [model]() {
+        wvk::Skeleton skeleton{*model};
+        bench::consume(static_cast<float>(skeleton.getVertices().size()));
+    }});
+}
+
+static const struct {
+    const char *name;
+    VkFormat format;
+    wvk::TextureType type;
+    int channels;   // channels the format keeps, compared by the round trip check
+} TEXTURE_FORMATS[] = {
+    {"BC1", VK_FORMAT_BC1_RGB_UNORM_BLOCK, wvk::TEXTURE_MASK, 3},
+    {"BC5", VK_FORMAT_BC5_UNORM_BLOCK, wvk::TEXTURE_NORMAL, 2},
+    {"BC7", VK_FORMAT_BC7_SRGB_BLOCK, wvk::TEXTURE_COLOR, 4},
+};
+
+static void addTextureBenchmarks(std::vector<bench::MicroBenchmark> &benchmarks, const std::string &name,
+                                 std::shared_ptr<const std::vector<uint8_t>> pixels, uint32_t width, uint32_t height) {
+    uint64_t texels = uint64_t(width) * height;
+
+    benchmarks.push_back({"generateMips/" + name, texels, pixels->size(), [pixels, width, height]() {
+        auto levels = wvk::generateMips(pixels->data(), width, height, wvk::TEXTURE_COLOR);
+        bench::consume(static_cast<float>(levels.back()[0]));
+    }});
+
+    for (const auto &format : TEXTURE_FORMATS) {
+        VkFormat vkFormat = format.format;
+        benchmarks.push_back({std::string("encode") + format.name + "/" + name, texels, pixels->size(),
+                              [pixels, width, height, vkFormat]() {
+            std::vector<uint8_t> blocks = wvk::encodeTextureLevel(vkFormat, pixels->data(), width, height);
+            bench::consume(static_cast<float>(blocks[blocks.size() / 2]));
+        }});
+
+        auto blocks = std::make_shared<const std::vector<uint8_t>>(
+            wvk::encodeTextureLevel(vkFormat, pixels->data(), width, height));
+        benchmarks.push_back({std::string("decode") + format.name + "/" + name, texels, blocks->size(),
+                              [blocks, width, height, vkFormat]() {
+            std::vector<uint8_t> decoded;
+            wvk::decodeTextureLevel(vkFormat, blocks->data(), width, height, decoded);
+            bench::consume(static_cast<float>(decoded[decoded.size() / 2]));
+        }});
+    }
+
+    // The cooked file's bytes as they would be mapped, loading copies every level like the staging upload does
+    wvk::CookedTextureSource cookedSource{};
+    auto cooked = std::make_shared<const std::vector<uint8_t>>(wvk::serializeCookedTexture(
+        wvk::cookTexture(pixels->data(), width, height, wvk::TEXTURE_COLOR), cookedSource));
+    benchmarks.push_back({"loadCookedTexture/" + name, texels, cooked->size(), [cooked, cookedSource]() {
+        wvk::TextureView view{};
+        if (!wvk::parseCookedTexture(cooked->data(), cooked->size(), cookedSource, view)) return;
+
+        std::vector<uint8_t> staging(cooked->size());
+        size_t offset = 0;
+        for (const wvk::TextureLevel &level : view.levels) {
+            memcpy(staging.data() + offset, level.data, level.size);
+            offset += level.size;
+        }
+        bench::consume(static_cast<float>(staging[offset / 2]));
+    }});
+}
+
+// Encodes and decodes every level of the image in each format and compares the result with the source on the CPU.
+// Returns the PSNR per format, or an error for formats whose round trip through a KTX2 file doesn't decode.
+static nlohmann::json checkTextureRoundTrip(const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height,
+                                            bool &failed) {
+    nlohmann::json results;
+    for (const auto &format : TEXTURE_FORMATS) {
+        wvk::CookedTexture texture = wvk::cookTexture(pixels.data(), width, height, format.type);
+        std::vector<std::vector<uint8_t>> mips = wvk::generateMips(pixels.data(), width, height, format.type);
+
+        wvk::CookedTextureSource source{};
+        source.type = format.type;
+        std::vector<uint8_t> file = wvk::serializeCookedTexture(texture, source);
+        wvk::TextureView view{};
+        bool decoded = wvk::parseCookedTexture(file.data(), file.size(), source, view) &&
+                       view.format == format.format && view.levels.size() == mips.size();
+
+        double squaredError = 0.0;
+        uint64_t samples = 0;
+        for (size_t level = 0; decoded && level < view.levels.size(); level++) {
+            const wvk::TextureLevel &textureLevel = view.levels[level];
+            std::vector<uint8_t> levelPixels;
+            decoded = wvk::decodeTextureLevel(view.format, textureLevel.data, textureLevel.width, textureLevel.height,
+                                              levelPixels);
+            for (size_t i = 0; decoded && i < levelPixels.size(); i += 4) {
+                for (int c = 0; c < format.channels; c++) {
+                    double delta = double(levelPixels[i + c]) - double(mips[level][i + c]);
+                    squaredError += delta * delta;
+                    samples++;
+                }
+            }
+        }
+
+        if (!decoded) {
+            logger::error(std::string(format.name) + " round trip failed to decode");
+            results[format.name]["error"] = "decode failed";
+            failed = true;
+            continue;
+        }
+        double meanError = squaredError / double(std::max<uint64_t>(samples, 1));
+        double psnr = meanError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanError) : 99.0;
+        results[format.name]["psnr"] = psnr;
+        results[format.name]["bytes"] = file.size();
+
+        char line[128];
+        snprintf(line, sizeof(line), "%-40s %8.2f dB PSNR  %10zu bytes", (std::string("roundTrip/") + format.name).c_str(),
+                 psnr, file.size());
+        logger::print(line);
+    }
+    return results;
+}
+
+static void addProjectionBenchmark(std::vector<bench::MicroBenchmark> &benchmarks, uint32_t count) {
+    auto transforms = std::make_shared<std::vector<Transform>>(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Transform &transform = (*transforms)[i];
+        transform.position = glm::vec3(float(i % 97), float(i % 89), float(i % 13));
+        transform.yaw = 0.01f * i;
+        transform.roll = 0.5f * std::sin(0.1f * i);
+    }
+
+    benchmarks.push_back({"perspectiveProjection", count, 0, [transforms]() {
+        float sum = 0.f;
+        for (Transform &transform : *transforms) {
+            TransformMatrices matrices = transform.perspectiveProjection(16.f / 9.f);
+            sum += matrices.view[3][0] + matrices.projection[1][1];
+        }
+        bench::consume(sum);
+    }});
+}
+
+static void addCascadeBenchmarks(std::vector<bench::MicroBenchmark> &benchmarks, uint32_t objectCount) {
+    Transform cameraTransform{};
+    cameraTransform.position = glm::vec3(10.f, 10.f, 4.f);
+    cameraTransform.lookingTowards(glm::vec3(0.f));
+    TransformMatrices camera = cameraTransform.perspectiveProjection(16.f / 9.f);
+
+    // Boxes scattered over a 200 x 200 area around the camera
+    auto objects = std::make_shared<std::vector<wvk::Bounds>>(objectCount);
+    wvk::Bounds scene{};
+    for (uint32_t i = 0; i < objectCount; i++) {
+        glm::vec3 center{float(i * 37 % 200) - 100.f, float(i * 91 % 200) - 100.f, float(i % 5)};
+        (*objects)[i].extend(center - 0.5f);
+        (*objects)[i].extend(center + 0.5f);
+        scene.extend((*objects)[i]);
+    }
+
+    const glm::vec3 lightDirection{-1.f, -0.5f, -1.f};
+    wvk::CascadeConfig config{};
+
+    benchmarks.push_back({"computeCascades", config.count, 0, [camera, scene, lightDirection, config]() {
+        wvk::ShadowCascade cascades[wvk::MAX_SHADOW_CASCADES];
+        wvk::computeCascades(camera.view, camera.projection, Transform::PERSPECTIVE_NEAR, Transform::PERSPECTIVE_FAR,
+                             lightDirection, scene, config, cascades);
+        bench::consume(cascades[0].viewProjection[0][0]);
+    }});
+
+    auto cascades = std::make_shared<std::array<wvk::ShadowCascade, wvk::MAX_SHADOW_CASCADES>>();
+    wvk::computeCascades(camera.view, camera.projection, Transform::PERSPECTIVE_NEAR, Transform::PERSPECTIVE_FAR,
+                         lightDirection, scene, config, cascades->data());
+
+    benchmarks.push_back({"intersectsCascade", uint64_t(objectCount) * config.count, 0, [objects, cascades, config]() {
+        uint32_t visible = 0;
+        for (uint32_t cascade = 0; cascade < config.count; cascade++) {
+            for (const wvk::Bounds &bounds : *objects) {
+                visible += wvk::intersectsCascade((*cascades)[cascade], bounds);
+            }
+        }
+        bench::consume(static_cast<float>(visible));
+    }});
+}
+
+int main(int argc, char **argv) {
+    std::string resources = WVK_RESOURCE_DIR;
+    std::string propModel = "viking_room.obj.model";
+    std::string characterModel = "astronaut.glb";
+    std::string textureImage = "viking_room.png";
+    std::string filter;
+    std::string outputPath = "microbench_report.json";
+    std::string baselinePath;
+    double threshold = 0.1;
+    double minSeconds = 0.5;
+    uint32_t gridSide = 512;
+    uint32_t transformCount = 100000;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help") {
+            printUsage();
+            return 0;
+        }
+        if (arg == "--verbose") {
+            verbose = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            logger::error("missing value for " + arg);
+            printUsage();
+            return 1;
+        }
+        const char *value = argv[++i];
+
+        if (arg == "--filter") filter = value;
+        else if (arg == "--min-time") minSeconds = std::strtod(value, nullptr);
+        else if (arg == "--grid") gridSide = std::strtoul(value, nullptr, 10);
+        else if (arg == "--transforms") transformCount = std::strtoul(value, nullptr, 10);
+        else if (arg == "--prop") propModel = value;
+        else if (arg == "--character") characterModel = value;
+        else if (arg == "--texture") textureImage = value;
+        else if (arg == "--output") outputPath = value;
+        else if (arg == "--baseline") baselinePath = value;
+        else if (arg == "--threshold") threshold = std::strtod(value, nullptr);
+        else if (arg == "--resources") resources = value;
+        else {
+            logger::error("unknown option " + arg);
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (!resources.empty() && resources.back() != '/') resources += '/';
+
+    NullBuffer nullBuffer;
+    std::streambuf *coutBuffer = std::cout.rdbuf();
+    if (!verbose) std::cout.rdbuf(&nullBuffer);
+
+    std::vector<bench::MicroBenchmark> benchmarks;
+
+    /* OBJ parsing and vertex deduplication */
+    bool objFailed = false;
+    auto propObj = std::make_shared<std::string>();
+    if (readFile(resources + "models/" + propModel, *propObj)) {
+        addObjBenchmark(benchmarks, "loadObjMesh/" + propModel, propObj, objFailed);
+
+        // Packing an asset into the archive and reading it back, against the bytes of the uncompressed file
+        const uint8_t *text = reinterpret_cast<const uint8_t *>(propObj->data());
+        auto block = std::make_shared<std::vector<uint8_t>>(wvk::lz4Compress(text, propObj->size()));
+        auto decompressed = std::make_shared<std::vector<uint8_t>>(propObj->size());
+        if (!wvk::lz4Decompress(block->data(), block->size(), decompressed->data(), decompressed->size()) ||
+            memcmp(decompressed->data(), text, decompressed->size()) != 0) {
+            logger::error("lz4 round trip of " + propModel + " failed");
+        }
+        benchmarks.push_back({"lz4Compress/" + propModel, 1, propObj->size(), [propObj]() {
+            const uint8_t *data = reinterpret_cast<const uint8_t *>(propObj->data());
+            bench::consume(static_cast<float>(wvk::lz4Compress(data, propObj->size()).size()));
+        }});
+        benchmarks.push_back({"lz4Decompress/" + propModel, 1, propObj->size(), [block, decompressed]() {
+            wvk::lz4Decompress(block->data(), block->size(), decompressed->data(), decompressed->size());
+            bench::consume(static_cast<float>(decompressed->back()));
+        }});
+    } else {
+        logger::error("failed to read " + resources + "models/" + propModel);
+    }
+    addObjBenchmark(benchmarks, "loadObjMesh/grid" + std::to_string(gridSide),
+                    std::make_shared<std::string>(createObjGrid(gridSide)), objFailed);
+
+    /* glTF attribute reads and skeleton mesh data */
+    std::string characterGlb;
+    if (readFile(resources + "models/" + characterModel, characterGlb)) {
+        tinygltf::TinyGLTF loader{};
+        auto model = std::make_shared<tinygltf::Model>();
+        std::string error, warn;
+        const unsigned char *data = reinterpret_cast<const unsigned char *>(characterGlb.data());
+
+        if (loader.LoadBinaryFromMemory(model.get(), &error, &warn, data, characterGlb.size())) {
+            addGltfBenchmarks(benchmarks, characterModel, model);
+        } else {
+            logger::error("failed to parse " + characterModel + ": " + error);
+        }
+
+        auto glb = std::make_shared<std::string>(std::move(characterGlb));
+        benchmarks.push_back({"LoadBinaryFromMemory/" + characterModel, 1, glb->size(), [glb]() {
+            tinygltf::TinyGLTF loader{};
+            tinygltf::Model model{};
+            std::string error, warn;
+            loader.LoadBinaryFromMemory(&model, &error, &warn,
+                                        reinterpret_cast<const unsigned char *>(glb->data()), glb->size());
+            bench::consume(static_cast<float>(model.accessors.size()));
+        }});
+
+        // What the derived data cache reads of a changed source instead of importing it
+        benchmarks.push_back({"hashBytes/" + characterModel, 1, glb->size(), [glb]() {
+            bench::consume(static_cast<float>(wvk::hashBytes(glb->data(), glb->size()) & 0xff));
+        }});
+
+        // The same file read in place, first the JSON alone and then the whole skinned mesh
+        benchmarks.push_back({"parseGlb/" + characterModel, 1, glb->size(), [glb]() {
+            wvk::GlbFile file{};
+            file.parse(reinterpret_cast<const uint8_t *>(glb->data()), glb->size());
+            bench::consume(static_cast<float>(file.getMeshes().size()));
+        }});
+        benchmarks.push_back({"loadGlbSkeleton/" + characterModel, 1, glb->size(), [glb]() {
+            wvk::GlbFile file{};
+            if (!file.parse(reinterpret_cast<const uint8_t *>(glb->data()), glb->size())) return;
+            wvk::Skeleton skeleton{file};
+            bench::consume(static_cast<float>(skeleton.getVertices().size()));
+        }});
+    } else {
+        logger::error("failed to read " + resources + "models/" + characterModel);
+    }
+    addGltfBenchmarks(benchmarks, "grid256", std::make_shared<tinygltf::Model>(createGltfGrid(256)));
+
+    /* Texture cooking */
+    nlohmann::json textureQuality;
+    bool textureFailed = false;
+    int textureWidth, textureHeight, textureChannels;
+    std::string texturePath = resources + "images/" + textureImage;
+    if (stbi_uc *image = stbi_load(texturePath.c_str(), &textureWidth, &textureHeight, &textureChannels, STBI_rgb_alpha)) {
+        auto pixels = std::make_shared<std::vector<uint8_t>>(image, image + size_t(textureWidth) * textureHeight * 4);
+        stbi_image_free(image);
+
+        uint32_t width = static_cast<uint32_t>(textureWidth), height = static_cast<uint32_t>(textureHeight);
+        addTextureBenchmarks(benchmarks, textureImage, pixels, width, height);
+        if (filter.empty() || filter.find("roundTrip") != std::string::npos) {
+            std::cout.rdbuf(coutBuffer);
+            textureQuality = checkTextureRoundTrip(*pixels, width, height, textureFailed);
+            if (!verbose) std::cout.rdbuf(&nullBuffer);
+        }
+    } else {
+        logger::error("failed to read " + texturePath);
+    }
+
+    /* Math and culling */
+    addProjectionBenchmark(benchmarks, transformCount);
+    addCascadeBenchmarks(benchmarks, transformCount);
+
+    /* Run */
+    nlohmann::json report;
+    report["config"]["min_time"] = minSeconds;
+    report["config"]["grid"] = gridSide;
+    report["config"]["transforms"] = transformCount;
+    if (!textureQuality.is_null()) report["textures"] = textureQuality;
+
+    std::vector<bench::MicroResult> results;
+    for (const bench::MicroBenchmark &benchmark : benchmarks) {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) continue;
+
+        bench::MicroResult result = bench::runMicroBenchmark(benchmark, minSeconds, 5);
+        report["kernels"][result.name] = bench::toJson(result);
+
+        std::cout.rdbuf(coutBuffer);
+        char line[256];
+        snprintf(line, sizeof(line), "%-40s %8zu iters  p50 %10.3f ms  %10.2f M items/s", result.name.c_str(),
+                 result.summary.samples, result.summary.p50, bench::itemsPerSecond(result) / 1e6);
+        std::string text = line;
+        if (result.bytes > 0) {
+            snprintf(line, sizeof(line), "  %10.1f MB/s", bench::megabytesPerSecond(result));
+            text += line;
+        }
+        logger::print(text);
+        if (!verbose) std::cout.rdbuf(&nullBuffer);
+    }
+
+    std::cout.rdbuf(coutBuffer);
+
+    if (!bench::writeJson(outputPath, report)) {
+        logger::error("failed to write report to " + outputPath);
+        return 1;
+    }
+    logger::print("Wrote microbenchmark report to " + outputPath);
+
+    if (textureFailed || objFailed) return 1;
+
+    if (baselinePath.empty()) return 0;
+
+    nlohmann::json baseline;
+    if (!bench::readJson(baselinePath, baseline)) {
+        logger::error("failed to read baseline " + baselinePath);
+        return 1;
+    }
+
+    int regressions = 0;
+    for (auto kernel = report["kernels"].begin(); kernel != report["kernels"].end(); kernel++) {
+        if (!baseline.count("kernels") || !baseline["kernels"].count(kernel.key())) continue;
+
+        regressions += bench::compareTimings(kernel.key(), kernel.value(), baseline["kernels"][kernel.key()], threshold);
+    }
+
+    if (regressions > 0) {
+        logger::error(std::to_string(regressions) + " metrics regressed by more than " +
+                      std::to_string(threshold * 100.0) + "%");
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "glm.h"
+
+#include <limits>
+
+namespace wvk {
+
+// Axis aligned bounding box, empty until a point is added
+struct Bounds {
+    glm::vec3 min{ std::numeric_limits<float>::max()};
+    glm::vec3 max{-std::numeric_limits<float>::max()};
+
+    bool valid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+    void extend(glm::vec3 point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void extend(const Bounds &other) {
+        if (!other.valid()) return;
+        extend(other.min);
+        extend(other.max);
+    }
+
+    // Bounds of this box after transforming its corners
+    Bounds transformed(const glm::mat4 &transform) const {
+        Bounds result{};
+        if (!valid()) return result;
+
+        for (int i = 0; i < 8; i++) {
+            glm::vec3 corner{i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z};
+            result.extend(glm::vec3(transform * glm::vec4(corner, 1.f)));
+        }
+        return result;
+    }
+};
+
+}
@@ -0,0 +1,142 @@
+#include "cluster_culling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace wvk {
+
+Frustum extractFrustum(const glm::mat4 &viewProjection) {
+    auto row = [&](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+
+    Frustum frustum{};
+    frustum.planes[0] = row(3) + row(0);  // left
+    frustum.planes[1] = row(3) - row(0);  // right
+    frustum.planes[2] = row(3) + row(1);  // bottom
+    frustum.planes[3] = row(3) - row(1);  // top
+    frustum.planes[4] = row(2);           // near, clip space depth starts at 0
+    frustum.planes[5] = row(3) - row(2);  // far
+
+    for (glm::vec4 &plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+bool intersectsFrustum(const Frustum &frustum, glm::vec3 center, float radius) {
+    for (const glm::vec4 &plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+    }
+    return true;
+}
+
+// Largest scale of the transform's axes, so scaled spheres stay conservative
+static float maxScale(const glm::mat4 &transform) {
+    return std::sqrt(std::max({glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+                               glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+                               glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2]))}));
+}
+
+ClusterView clusterView(const glm::mat4 &view, const glm::mat4 &projection, uint32_t viewportHeight) {
+    ClusterView clusterView{};
+    clusterView.frustum = extractFrustum(projection * view);
+    clusterView.cameraPosition = glm::vec3(glm::inverse(view)[3]);
+    clusterView.screenScale = std::abs(projection[1][1]) * viewportHeight / 2.f;
+    return clusterView;
+}
+
+bool instanceVisible(const Bounds &meshBounds, const glm::mat4 &transform, const ClusterView &view) {
+    if (!meshBounds.valid()) return false;
+
+    glm::vec3 center = (meshBounds.min + meshBounds.max) / 2.f;
+    float radius = glm::length(meshBounds.max - meshBounds.min) / 2.f;
+    return intersectsFrustum(view.frustum, glm::vec3(transform * glm::vec4(center, 1.f)), radius * maxScale(transform));
+}
+
+uint32_t selectLod(const std::vector<LodRange> &lods, uint32_t currentLod, const Bounds &meshBounds,
+                   const glm::mat4 &transform, const ClusterView &view) {
+    if (lods.empty() || !meshBounds.valid()) return 0;
+
+    float scale = maxScale(transform);
+    glm::vec3 center = glm::vec3(transform * glm::vec4((meshBounds.min + meshBounds.max) / 2.f, 1.f));
+    float radius = glm::length(meshBounds.max - meshBounds.min) / 2.f * scale;
+
+    // Distance to the closest point of the bounds, errors are never smaller on screen than there
+    float distance = std::max(glm::length(center - view.cameraPosition) - radius, 1e-4f);
+    auto pixels = [&](uint32_t lod) {
+        return lod == 0 ? 0.f : lods[lod - 1].error * scale / distance * view.screenScale;
+    };
+
+    uint32_t lod = std::min<uint32_t>(currentLod, lods.size());
+    while (lod > 0 && pixels(lod) > LOD_ERROR_PIXELS * (1.f + LOD_HYSTERESIS)) lod--;
+    while (lod < lods.size() && pixels(lod + 1) < LOD_ERROR_PIXELS * (1.f - LOD_HYSTERESIS)) lod++;
+    return lod;
+}
+
+float textureLod(float uvDensity, uint32_t textureSize, const Bounds &meshBounds, const glm::mat4 &transform,
+                 const ClusterView &view) {
+    if (!meshBounds.valid() || textureSize == 0) return 0.f;
+    // Meshes without texture coordinates sample one texel of any level
+    if (uvDensity <= 0.f) return std::numeric_limits<float>::infinity();
+
+    float scale = maxScale(transform);
+    glm::vec3 center = glm::vec3(transform * glm::vec4((meshBounds.min + meshBounds.max) / 2.f, 1.f));
+    float radius = glm::length(meshBounds.max - meshBounds.min) / 2.f * scale;
+
+    float distance = std::max(glm::length(center - view.cameraPosition) - radius, 1e-4f);
+    float texelsPerUnit = uvDensity * textureSize / scale;
+    float pixelsPerUnit = view.screenScale / distance;
+    return std::log2(texelsPerUnit / pixelsPerUnit);
+}
+
+void cullMeshlets(const std::vector<Meshlet> &meshlets, const glm::mat4 &transform, uint32_t instance,
+                  const ClusterView &view, std::vector<DrawIndexedCommand> &commands, ClusterCullStats &stats) {
+    float scale = maxScale(transform);
+    glm::mat3 rotation{transform};
+    bool merging = false;
+    for (const Meshlet &meshlet : meshlets) {
+        glm::vec3 center = glm::vec3(transform * glm::vec4(meshlet.center, 1.f));
+        float radius = meshlet.radius * scale;
+
+        bool visible = intersectsFrustum(view.frustum, center, radius);
+        if (visible && view.cullBackFacing && meshlet.coneCutoff < 1.f) {
+            glm::vec3 axis = glm::normalize(rotation * meshlet.coneAxis);
+            glm::vec3 toCenter = center - view.cameraPosition;
+            visible = glm::dot(toCenter, axis) < meshlet.coneCutoff * glm::length(toCenter) + radius;
+        }
+
+        if (!visible) {
+            stats.culledMeshlets++;
+            merging = false;
+            continue;
+        }
+        stats.visibleMeshlets++;
+
+        DrawIndexedCommand *last = commands.empty() ? nullptr : &commands.back();
+        if (merging && last->vertexOffset == meshlet.vertexOffset &&
+            last->firstIndex + last->indexCount == meshlet.firstIndex) {
+            last->indexCount += meshlet.indexCount;
+            continue;
+        }
+
+        commands.push_back({meshlet.indexCount, 1, meshlet.firstIndex, meshlet.vertexOffset, instance});
+        merging = true;
+    }
+}
+
+void appendInstanceDraw(std::vector<DrawIndexedCommand> &commands, uint32_t indexCount, uint32_t firstIndex,
+                        int32_t vertexOffset, uint32_t instance) {
+    if (!commands.empty()) {
+        DrawIndexedCommand &last = commands.back();
+        if (last.indexCount == indexCount && last.firstIndex == firstIndex && last.vertexOffset == vertexOffset &&
+            last.firstInstance + last.instanceCount == instance) {
+            last.instanceCount++;
+            return;
+        }
+    }
+    commands.push_back({indexCount, 1, firstIndex, vertexOffset, instance});
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "glm.h"
+#include "bounds.h"
+#include "mesh/meshlets.h"
+#include "mesh/simplifier.h"
+#include "wvk_vertex_attributes.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace wvk {
+
+// World space planes facing into the frustum, a point p is inside if dot(plane.xyz, p) + plane.w >= 0 for all
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// Frustum of a view projection matrix with a [0, 1] depth range
+Frustum extractFrustum(const glm::mat4 &viewProjection);
+
+bool intersectsFrustum(const Frustum &frustum, glm::vec3 center, float radius);
+
+/* Matches VkDrawIndexedIndirectCommand */
+struct DrawIndexedCommand {
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t firstInstance;
+};
+
+struct ClusterView {
+    Frustum frustum;
+    glm::vec3 cameraPosition;
+    float screenScale;   // pixels covered by one unit at a distance of one unit from the camera
+    // The pipelines drawing the meshlets cull back faces, so meshlets facing away from the camera can be skipped.
+    // Without it two sided and open meshes show their back faces.
+    bool cullBackFacing = false;
+};
+
+ClusterView clusterView(const glm::mat4 &view, const glm::mat4 &projection, uint32_t viewportHeight);
+
+struct ClusterCullStats {
+    uint32_t visibleInstances = 0;
+    uint32_t culledInstances = 0;
+    uint32_t visibleMeshlets = 0;
+    uint32_t culledMeshlets = 0;
+};
+
+// Screen space error in pixels a LOD may have, and the fraction it may drift past that before the LOD changes.
+// Without the margin an object at the threshold distance flickers between two LODs.
+constexpr float LOD_ERROR_PIXELS = 1.f;
+constexpr float LOD_HYSTERESIS = 0.25f;
+
+// Whether the bounding sphere of meshBounds is inside the frustum. Instance transforms may rotate, translate and
+// scale uniformly, so do the ones of the functions below.
+bool instanceVisible(const Bounds &meshBounds, const glm::mat4 &transform, const ClusterView &view);
+
+// LOD to draw an instance with, starting from its LOD of the previous frame. LOD 0 is the full detail mesh, LOD i is
+// drawn with lods[i - 1].
+uint32_t selectLod(const std::vector<LodRange> &lods, uint32_t currentLod, const Bounds &meshBounds,
+                   const glm::mat4 &transform, const ClusterView &view);
+
+// Finest mip level of a texture an instance samples, from the texels its closest point covers per pixel when facing
+// the camera. uvDensity is the texture coordinate length per mesh unit, see uvDensity() in mesh_data.h. Negative when
+// the texture is magnified, infinite for meshes without texture coordinates.
+float textureLod(float uvDensity, uint32_t textureSize, const Bounds &meshBounds, const glm::mat4 &transform,
+                 const ClusterView &view);
+
+// Appends a draw for the meshlets of an instance that are inside the frustum, and not facing away from the camera if
+// the view culls back faces. Consecutive visible meshlets are merged into one draw.
+void cullMeshlets(const std::vector<Meshlet> &meshlets, const glm::mat4 &transform, uint32_t instance,
+                  const ClusterView &view, std::vector<DrawIndexedCommand> &commands, ClusterCullStats &stats);
+
+// Appends a draw of an index range for one instance, merged with the previous draw if it draws the same range for
+// the instance before
+void appendInstanceDraw(std::vector<DrawIndexedCommand> &commands, uint32_t indexCount, uint32_t firstIndex,
+                        int32_t vertexOffset, uint32_t instance);
+
+}
@@ -0,0 +1,213 @@
+#include "cpu_profiler.h"
+
+#ifdef WVK_ENABLE_PROFILER
+
+#include <json.h>
+#include <logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wvk {
+namespace profiler {
+
+namespace {
+
+struct ZoneEvent {
+    const char *name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// Written only by its owning thread. The exporter reads events [0, count) of the current capture generation.
+struct ThreadBuffer {
+    static constexpr uint32_t CAPACITY = 1 << 15;
+
+    std::unique_ptr<ZoneEvent[]> events{new ZoneEvent[CAPACITY]};
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint32_t> dropped{0};
+
+    uint32_t threadId;
+    std::string threadName; // guarded by registryMutex
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers; // never shrinks, threads may exit mid capture
+
+std::atomic<bool> capturing{false};
+std::atomic<uint32_t> captureGeneration{0};
+
+const auto epoch = std::chrono::steady_clock::now();
+
+/* Capture state, only touched from the thread calling beginFrame */
+const uint64_t NO_CAPTURE = UINT64_MAX;
+uint64_t pendingFirstFrame = NO_CAPTURE;
+uint32_t pendingFrameCount = 0;
+uint64_t captureFirstFrame = 0;
+uint64_t captureEndFrame = 0;
+uint64_t currentFrame = 0;
+uint64_t frameBegin = 0;
+
+uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+ThreadBuffer *threadBuffer() {
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock{registryMutex};
+        threadBuffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = threadBuffers.back().get();
+        buffer->threadId = static_cast<uint32_t>(threadBuffers.size() - 1);
+        buffer->threadName = "thread " + std::to_string(buffer->threadId);
+    }
+    return buffer;
+}
+
+void record(const char *name, uint64_t begin, uint64_t end) {
+    ThreadBuffer *buffer = threadBuffer();
+
+    uint32_t generation = captureGeneration.load(std::memory_order_acquire);
+    if (buffer->generation.load(std::memory_order_relaxed) != generation) {
+        // First event of a new capture on this thread
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+        buffer->generation.store(generation, std::memory_order_release);
+    }
+
+    uint32_t index = buffer->count.load(std::memory_order_relaxed);
+    if (index >= ThreadBuffer::CAPACITY) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer->events[index] = {name, begin, end};
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void startCapture() {
+    captureGeneration.fetch_add(1, std::memory_order_release);
+    capturing.store(true, std::memory_order_release);
+    logger::debug("Started CPU profiler capture at frame " + std::to_string(currentFrame));
+}
+
+void stopCapture() {
+    capturing.store(false, std::memory_order_release);
+
+    using nlohmann::json;
+
+    uint32_t generation = captureGeneration.load(std::memory_order_acquire);
+    json traceEvents = json::array();
+
+    std::lock_guard<std::mutex> lock{registryMutex};
+    for (const std::unique_ptr<ThreadBuffer> &buffer : threadBuffers) {
+        if (buffer->generation.load(std::memory_order_acquire) != generation) continue;
+
+        json metadata;
+        metadata["name"] = "thread_name";
+        metadata["ph"] = "M";
+        metadata["pid"] = 0;
+        metadata["tid"] = buffer->threadId;
+        metadata["args"]["name"] = buffer->threadName;
+        traceEvents.push_back(metadata);
+
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; i++) {
+            const ZoneEvent &zone = buffer->events[i];
+
+            json event;
+            event["name"] = zone.name;
+            event["cat"] = "cpu";
+            event["ph"] = "X";
+            event["pid"] = 0;
+            event["tid"] = buffer->threadId;
+            event["ts"] = zone.begin / 1000.0;
+            event["dur"] = (zone.end - zone.begin) / 1000.0;
+            traceEvents.push_back(event);
+        }
+
+        uint32_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+        if (dropped > 0) {
+            logger::error("CPU profiler dropped " + std::to_string(dropped) + " zones on " + buffer->threadName);
+        }
+    }
+
+    json trace;
+    trace["traceEvents"] = traceEvents;
+    trace["displayTimeUnit"] = "ms";
+
+    std::string filename = "profile_" + std::to_string(captureFirstFrame) + "-" + std::to_string(currentFrame) + ".json";
+    std::ofstream file{filename};
+    if (!file.is_open()) {
+        logger::error("Failed to write CPU profile to " + filename);
+        return;
+    }
+    file << trace.dump();
+
+    logger::debug("Wrote CPU profile to " + filename);
+}
+
+}
+
+Zone::Zone(const char *name) : name{name}, begin{0}, active{capturing.load(std::memory_order_relaxed)} {
+    if (active) begin = now();
+}
+
+Zone::~Zone() {
+    if (active) record(name, begin, now());
+}
+
+void setThreadName(const char *name) {
+    ThreadBuffer *buffer = threadBuffer();
+
+    std::lock_guard<std::mutex> lock{registryMutex};
+    buffer->threadName = name;
+}
+
+void beginFrame(uint64_t frame) {
+    uint64_t time = now();
+
+    if (capturing.load(std::memory_order_relaxed)) {
+        record("frame", frameBegin, time);
+    }
+
+    currentFrame = frame;
+
+    if (capturing.load(std::memory_order_relaxed) && frame >= captureEndFrame) {
+        stopCapture();
+    }
+
+    if (!capturing.load(std::memory_order_relaxed) && pendingFirstFrame != NO_CAPTURE && frame >= pendingFirstFrame) {
+        captureFirstFrame = frame;
+        captureEndFrame = frame + pendingFrameCount;
+        pendingFirstFrame = NO_CAPTURE;
+        startCapture();
+    }
+
+    frameBegin = time;
+}
+
+void captureFrames(uint32_t frameCount) {
+    scheduleCapture(currentFrame + 1, frameCount);
+}
+
+void scheduleCapture(uint64_t firstFrame, uint32_t frameCount) {
+    if (frameCount == 0) return;
+
+    pendingFirstFrame = firstFrame;
+    pendingFrameCount = frameCount;
+}
+
+bool isCapturing() {
+    return capturing.load(std::memory_order_relaxed);
+}
+
+};
+};
+
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+/*
+ * Scoped CPU zone profiler.
+ *
+ * Zones record begin/end timestamps into a buffer owned by the calling thread, so recording never takes a lock.
+ * Nothing is recorded unless a capture is running. A capture is written out as Chrome trace_event JSON
+ * (load it in chrome://tracing or https://ui.perfetto.dev).
+ *
+ * Everything here compiles to nothing unless WVK_ENABLE_PROFILER is defined.
+ */
+
+#define WVK_PROFILE_CONCAT_IMPL(a, b) a##b
+#define WVK_PROFILE_CONCAT(a, b) WVK_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef WVK_ENABLE_PROFILER
+
+#include <cstdint>
+#include <string>
+
+namespace wvk {
+namespace profiler {
+
+// Zone names must outlive the capture (i.e. string literals), only the pointer is stored
+class Zone {
+  public:
+    explicit Zone(const char *name);
+    ~Zone();
+
+    Zone(const Zone &) = delete;
+    Zone &operator=(const Zone &) = delete;
+
+  private:
+    const char *name;
+    uint64_t begin;
+    bool active;
+};
+
+void setThreadName(const char *name);
+
+// Marks the start of a new frame, starts/stops pending captures
+void beginFrame(uint64_t frame);
+
+// Captures the next frameCount frames
+void captureFrames(uint32_t frameCount);
+
+// Captures frames [firstFrame, firstFrame + frameCount)
+void scheduleCapture(uint64_t firstFrame, uint32_t frameCount);
+
+bool isCapturing();
+
+};
+};
+
+#define WVK_PROFILE_ZONE(name) ::wvk::profiler::Zone WVK_PROFILE_CONCAT(wvkProfileZone, __LINE__){name}
+#define WVK_PROFILE_THREAD(name) ::wvk::profiler::setThreadName(name)
+#define WVK_PROFILE_FRAME(frame) ::wvk::profiler::beginFrame(frame)
+#define WVK_PROFILE_CAPTURE(frameCount) ::wvk::profiler::captureFrames(frameCount)
+#define WVK_PROFILE_SCHEDULE_CAPTURE(firstFrame, frameCount) ::wvk::profiler::scheduleCapture(firstFrame, frameCount)
+
+#else
+
+#define WVK_PROFILE_ZONE(name) ((void) 0)
+#define WVK_PROFILE_THREAD(name) ((void) 0)
+#define WVK_PROFILE_FRAME(frame) ((void) 0)
+#define WVK_PROFILE_CAPTURE(frameCount) ((void) 0)
+#define WVK_PROFILE_SCHEDULE_CAPTURE(firstFrame, frameCount) ((void) 0)
+
+#endif
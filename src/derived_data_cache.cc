@@ -0,0 +1,231 @@
+#include "derived_data_cache.h"
+
+#include "cpu_profiler.h"
+#include "resource_path.h"
+
+#include <logger.h>
+
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace wvk {
+
+static const char *INDEX_FILENAME = "sources.txt";
+static const char *INDEX_HEADER = "WvkDerivedDataSources 1";
+
+/* Hashing */
+
+static constexpr uint64_t PRIME1 = 0x9e3779b185ebca87ull;
+static constexpr uint64_t PRIME2 = 0xc2b2ae3d27d4eb4full;
+static constexpr uint64_t PRIME3 = 0x165667b19e3779f9ull;
+static constexpr uint64_t PRIME4 = 0x85ebca77c2b2ae63ull;
+static constexpr uint64_t PRIME5 = 0x27d4eb2f165667c5ull;
+
+static uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t read64(const uint8_t *data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint32_t read32(const uint8_t *data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint64_t hashRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME2;
+    return rotateLeft(accumulator, 31) * PRIME1;
+}
+
+static uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+    accumulator ^= hashRound(0, value);
+    return accumulator * PRIME1 + PRIME4;
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    const uint8_t *end = bytes + size;
+
+    // Four lanes of 8 bytes each for the bulk of the data
+    uint64_t hash;
+    if (size >= 32) {
+        uint64_t lanes[4] = {seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1};
+        for (; end - bytes >= 32; bytes += 32) {
+            for (int lane = 0; lane < 4; lane++) {
+                lanes[lane] = hashRound(lanes[lane], read64(bytes + lane * 8));
+            }
+        }
+        hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+        for (uint64_t lane : lanes) {
+            hash = mergeRound(hash, lane);
+        }
+    } else {
+        hash = seed + PRIME5;
+    }
+    hash += size;
+
+    for (; end - bytes >= 8; bytes += 8) {
+        hash ^= hashRound(0, read64(bytes));
+        hash = rotateLeft(hash, 27) * PRIME1 + PRIME4;
+    }
+    if (end - bytes >= 4) {
+        hash ^= read32(bytes) * PRIME1;
+        hash = rotateLeft(hash, 23) * PRIME2 + PRIME3;
+        bytes += 4;
+    }
+    for (; bytes < end; bytes++) {
+        hash ^= *bytes * PRIME5;
+        hash = rotateLeft(hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t derivedDataKey(const char *importer, uint32_t version, uint64_t sourceHash, const void *settings,
+                        size_t settingsSize) {
+    uint64_t key = hashBytes(importer, strlen(importer), sourceHash);
+    key = hashBytes(&version, sizeof(version), key);
+    if (settingsSize > 0) {
+        key = hashBytes(settings, settingsSize, key);
+    }
+    return key;
+}
+
+/* Cache */
+
+DerivedDataCache::DerivedDataCache(const std::string &directory) : directory{directory} {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        logger::error("Failed to create derived data cache directory " + directory + ": " + error.message());
+    }
+    loadIndex();
+}
+
+bool DerivedDataCache::sourceHash(const std::string &path, uint64_t &hash) {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error) return false;
+    int64_t modifiedTime = static_cast<int64_t>(modified.time_since_epoch().count());
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto source = sources.find(path);
+        if (source != sources.end() && source->second.size == size && source->second.modifiedTime == modifiedTime) {
+            hash = source->second.hash;
+            return true;
+        }
+    }
+
+    // Empty files can't be mapped, they hash like no data
+    MappedFile file;
+    if (size > 0 && !file.open(path)) return false;
+    {
+        WVK_PROFILE_ZONE("hash source");
+        hash = hashBytes(file.getData(), file.getSize());
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    sources[path] = SourceStamp{size, modifiedTime, hash};
+    saveIndex();
+    return true;
+}
+
+std::string DerivedDataCache::entryPath(uint64_t key, const std::string &extension) {
+    char name[17];
+    snprintf(name, sizeof(name), "%016" PRIx64, key);
+    return directory + name + "." + extension;
+}
+
+bool DerivedDataCache::open(uint64_t key, const std::string &extension, MappedFile &file) {
+    return file.open(entryPath(key, extension));
+}
+
+bool DerivedDataCache::write(uint64_t key, const std::string &extension, const void *data, size_t size) {
+    WVK_PROFILE_ZONE("write derived data");
+    return writeFile(entryPath(key, extension), data, size);
+}
+
+bool DerivedDataCache::writeFile(const std::string &path, const void *data, size_t size) {
+    // Temporary names are unique across threads and processes writing the same entry
+    static const uint64_t processNonce = (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+    static std::atomic<uint64_t> writeCount{0};
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%016" PRIx64 ".tmp", processNonce + writeCount++);
+    std::string temporaryPath = path + suffix;
+
+    std::error_code error;
+    {
+        std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+        if (file) {
+            file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        }
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+void DerivedDataCache::loadIndex() {
+    std::ifstream file{directory + INDEX_FILENAME};
+    std::string line;
+    if (!std::getline(file, line) || line != INDEX_HEADER) return;
+
+    // A hash, size and modification time per line, followed by the path which may contain spaces
+    while (std::getline(file, line)) {
+        std::istringstream fields{line};
+        SourceStamp stamp{};
+        std::string path;
+        fields >> std::hex >> stamp.hash >> std::dec >> stamp.size >> stamp.modifiedTime;
+        fields.get();
+        if (!fields || !std::getline(fields, path) || path.empty()) continue;
+        sources[path] = stamp;
+    }
+}
+
+void DerivedDataCache::saveIndex() {
+    std::ostringstream index;
+    index << INDEX_HEADER << "\n";
+    for (const auto &source : sources) {
+        index << std::hex << source.second.hash << std::dec << " " << source.second.size << " "
+              << source.second.modifiedTime << " " << source.first << "\n";
+    }
+
+    std::string contents = index.str();
+    if (!writeFile(directory + INDEX_FILENAME, contents.data(), contents.size())) {
+        logger::error("Failed to write derived data index in " + directory);
+    }
+}
+
+DerivedDataCache &derivedDataCache() {
+    static DerivedDataCache cache{resourcePath() + "derived/"};
+    return cache;
+}
+
+}
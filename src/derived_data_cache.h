@@ -0,0 +1,66 @@
+#pragma once
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace wvk {
+
+/*
+ * Derived data cache: importer outputs stored under a key made from the content hash of their source file, the
+ * importer's version and its settings. Only sources whose contents changed are imported again, touching a file or
+ * checking it out again doesn't invalidate anything. Entries are written to a temporary file that is renamed over
+ * the entry, so concurrent loaders and interrupted writes never see a partial entry.
+ *
+ * Content hashes are remembered by path, size and modification time in an index next to the entries, so startups
+ * on unchanged content don't read the sources at all.
+ */
+
+// XXH64 of size bytes
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
+
+// Key of the data an importer derives from a source with the given settings, changing any input changes the key
+uint64_t derivedDataKey(const char *importer, uint32_t version, uint64_t sourceHash, const void *settings = nullptr,
+                        size_t settingsSize = 0);
+
+class DerivedDataCache {
+  public:
+    explicit DerivedDataCache(const std::string &directory);
+
+    DerivedDataCache(const DerivedDataCache &) = delete;
+    DerivedDataCache &operator=(const DerivedDataCache &) = delete;
+
+    // Content hash of a source file. Returns false if the file can't be read.
+    bool sourceHash(const std::string &path, uint64_t &hash);
+
+    // Maps the entry of key, returns false if it isn't cached. extension names the kind of entry, like "wmesh".
+    bool open(uint64_t key, const std::string &extension, MappedFile &file);
+    // Stores size bytes of data as the entry of key, returns false if it couldn't be written
+    bool write(uint64_t key, const std::string &extension, const void *data, size_t size);
+
+  private:
+    struct SourceStamp {
+        uint64_t size;
+        int64_t modifiedTime;
+        uint64_t hash;
+    };
+
+    std::string entryPath(uint64_t key, const std::string &extension);
+    bool writeFile(const std::string &path, const void *data, size_t size);
+    void loadIndex();
+    void saveIndex();   // with the mutex held
+
+    std::string directory;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, SourceStamp> sources;   // by path
+};
+
+// The cache in the derived/ directory of the resource path, shared by every importer
+DerivedDataCache &derivedDataCache();
+
+}
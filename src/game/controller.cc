@@ -6,6 +6,8 @@
 
 namespace wayward {
 
+static constexpr wvk::AssetId VIKING_ROOM_MODEL = wvk::assetId("viking_room.obj.model");
+
 DebugController::DebugController(wvk::WvkApplication *app) : app{app} {
     /* Set up camera */
     camera.transform.position = glm::vec3(2.0, 2.0, 2.0);
@@ -15,16 +17,10 @@ DebugController::DebugController(wvk::WvkApplication *app) : app{app} {
 
 
     /* Set up lights */
-    float shadowMapWidth = 2.5;
-    float shadowMapHeight = 2.5;
-    float zNear = 0.1;
-    float zFar = 10.0;
-
-    lightTransform.position = glm::vec3(2.0, 2.0, 2.0);
-    lightTransform.lookingTowards(glm::vec3(0.0, 0.0, 0.0));
-    TransformMatrices lightTransformMatrices = lightTransform.orthoProjection(-shadowMapWidth/2, shadowMapWidth/2, -shadowMapHeight/2, shadowMapHeight/2, zNear, zFar);
+    app->setLight(0, glm::vec3(-1.0, -1.0, -1.0));
 
-    app->setLight(0, &lightTransformMatrices);
+    /* The viking room overdraws heavily, so shade each pixel only once */
+    app->getRenderSettings().depthPrepass = true;
 
     loadModels();
 }
@@ -48,10 +44,11 @@ void DebugController::loadModels() {
     wvk::WvkModel *floor = new wvk::WvkModel(device, vertices, indices);
     app->addModel(floor);
 
-    wvk::WvkModel *viking_room = new wvk::WvkModel(device, "viking_room.obj.model", 1);
+    // Streamed in the background, drawn as a placeholder until it is resident
+    wvk::WvkModel *viking_room = app->getAssetStreamer().loadModel(VIKING_ROOM_MODEL, 1);
     app->addModel(viking_room);
 
-    //wvk::WvkSkeleton *skeleton = new wvk::WvkSkeleton(device, "astronaut.glb");
+    //wvk::WvkSkeleton *skeleton = app->getAssetStreamer().loadSkeleton(wvk::assetId("astronaut.glb"));
     //app->addSkeleton(skeleton);
 }
 
@@ -10,7 +10,7 @@
 
 namespace wayward {
 
-class DebugController {
+class DebugController : public wvk::AppController {
 public:
     DebugController(wvk::WvkApplication*);
     ~DebugController();
@@ -18,7 +18,7 @@ public:
     DebugController(const DebugController&) = delete;
     DebugController& operator=(const DebugController&) = delete;
 
-    void update();
+    void update() override;
 
 private:
     void loadModels();
@@ -29,7 +29,6 @@ private:
     std::vector<wvk::WvkModel> models;
 
     Camera camera;
-    Transform lightTransform;
 };
 
 };
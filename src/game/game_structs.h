@@ -13,6 +13,10 @@ struct TransformMatrices {
 };
 
 struct Transform {
+    // Depth range of perspectiveProjection
+    static constexpr float PERSPECTIVE_NEAR = 0.1f;
+    static constexpr float PERSPECTIVE_FAR = 100.f;
+
     glm::vec3 position; // position in worldspace
     float yaw;
     float roll;
@@ -65,12 +69,10 @@ struct Transform {
 
     TransformMatrices perspectiveProjection(float aspectRatio) {
         static float fov = glm::radians(60.0);
-        static float zNear = 0.1;
-        static float zFar = 100.0;
 
         TransformMatrices matrices{};
         matrices.view = glm::lookAt(position, position + direction(), VECTOR_UP);
-        matrices.projection = glm::perspective(fov, aspectRatio, zNear, zFar);
+        matrices.projection = glm::perspective(fov, aspectRatio, PERSPECTIVE_NEAR, PERSPECTIVE_FAR);
         matrices.projection[1][1] *= -1;
 
         return matrices;
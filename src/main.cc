@@ -1,8 +1,14 @@
 #include "app.h"
+#include "game/controller.h"
 
 #include "resource_path.h"
 #include <logger.h>
 
+#include <filesystem>
+
+#ifndef WVK_RESOURCE_DIR
+#define WVK_RESOURCE_DIR "resources/"
+#endif
 
 int main(int argc, char** argv) {
 #if defined(__APPLE__)
@@ -14,10 +20,17 @@ int main(int argc, char** argv) {
 
     setResourcePath(fullPath.c_str());
 #else
-    setResourcePath("C:/Users/Jack/Documents/GitHub/wayward-vulkan-engine/src/out/build/x64-Debug/resources/");
+    // Resources are copied next to the executable on build, runs from elsewhere fall back to the source tree, whose
+    // subdirectories the asset file system indexes alike
+    std::filesystem::path resources = std::filesystem::path(argv[0]).parent_path() / "resources";
+    std::error_code error;
+    std::string fullPath = std::filesystem::is_directory(resources, error) ? resources.string() + "/" : WVK_RESOURCE_DIR;
+
+    setResourcePath(fullPath.c_str());
 #endif
 
     wvk::WvkApplication app;
+    wayward::DebugController controller{&app};
 
-    app.run();
+    app.run(controller);
 }
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace wvk {
+
+// Read only view of a whole file mapped into memory. Pages are read by the OS on first access, so opening a file
+// costs no I/O until its contents are used.
+class MappedFile {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Returns false if the file doesn't exist or can't be mapped, empty files can't be mapped
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    const uint8_t *getData() const { return data; }
+    size_t getSize() const { return size; }
+
+  private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+#if defined(_WIN32)
+    void *file = nullptr;
+    void *mapping = nullptr;
+#endif
+};
+
+}
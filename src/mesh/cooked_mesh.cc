@@ -0,0 +1,289 @@
+#include "cooked_mesh.h"
+
+#include "obj_loader.h"
+#include "glb_file.h"
+#include "glb_loader.h"
+#include "mesh_optimizer.h"
+#include "../cpu_profiler.h"
+#include "../derived_data_cache.h"
+
+#include <logger.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace wvk {
+
+static_assert(std::is_trivially_copyable<PackedVertex>::value && std::is_trivially_copyable<PositionVertex>::value &&
+              std::is_trivially_copyable<SubMesh>::value && std::is_trivially_copyable<Meshlet>::value &&
+              std::is_trivially_copyable<LodRange>::value, "cooked mesh blobs are copied as raw bytes");
+
+/* File layout */
+
+enum CookedBlob {
+    BLOB_VERTICES,
+    BLOB_POSITIONS,
+    BLOB_INDICES,
+    BLOB_SUB_MESHES,
+    BLOB_MESHLETS,
+    BLOB_LODS,
+    BLOB_COUNT,
+};
+
+struct BlobRange {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct CookedMeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    CookedMeshSource source;
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 quantizationOffset;
+    glm::vec3 quantizationScale;
+    uint32_t materialId;
+    uint32_t indexSize;
+    float uvDensity;
+
+    BlobRange blobs[BLOB_COUNT];
+};
+
+// Blobs start on 16 byte boundaries, so every struct in them is aligned in the mapped file
+static const uint64_t BLOB_ALIGNMENT = 16;
+
+static uint64_t alignBlob(uint64_t offset) {
+    return (offset + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+}
+
+/* Cooking */
+
+uint64_t cookedMeshKey(const CookedMeshSource &source) {
+    return derivedDataKey("cooked mesh", COOKED_MESH_VERSION, source.contentHash, &source.textureId,
+                          sizeof(source.textureId));
+}
+
+CookedMesh cookMesh(const std::vector<MeshVertex> &vertices, const std::vector<uint32_t> &indices,
+                    const std::vector<MeshLod> &lods) {
+    WVK_PROFILE_ZONE("cook mesh");
+
+    CookedMesh mesh{};
+    for (const MeshVertex &vertex : vertices) {
+        mesh.bounds.extend(vertex.position);
+    }
+    mesh.quantization = positionQuantization(mesh.bounds);
+    mesh.uvDensity = uvDensity(vertices, indices);
+
+    // The texture index is drawn per model, loaders give all vertices of a model the same one
+    mesh.materialId = vertices.empty() ? 0 : vertices[0].texture_index;
+    for (const MeshVertex &vertex : vertices) {
+        if (vertex.texture_index != mesh.materialId) {
+            logger::error("Mesh vertices use different textures, only texture " + std::to_string(mesh.materialId) + " is used");
+            break;
+        }
+    }
+
+    // Splitting for 16 bit indices may duplicate vertices, so this happens before the vertices are packed
+    std::vector<MeshVertex> split = vertices;
+    mesh.indexData = buildIndexData(split, indices, sizeof(PackedVertex) + sizeof(PositionVertex));
+
+    std::vector<glm::vec3> positions(split.size());
+    for (size_t i = 0; i < split.size(); i++) {
+        positions[i] = split[i].position;
+    }
+    mesh.meshlets = buildMeshlets(mesh.indexData, positions);
+
+    // Meshlets only cover the full detail mesh, the LODs are drawn whole after it
+    mesh.lods = appendLods(mesh.indexData, lods);
+    if (mesh.lods.size() != lods.size()) {
+        logger::debug("Mesh is split into sub meshes, its LODs are not used");
+    }
+
+    mesh.vertices = packVertices(split, mesh.quantization);
+    mesh.positions.resize(split.size());
+    for (size_t i = 0; i < split.size(); i++) {
+        quantizePosition(split[i].position, mesh.quantization, mesh.positions[i].position);
+    }
+
+    return mesh;
+}
+
+static CookedMesh cookImportedMesh(MeshData &mesh, const std::string &name) {
+    MeshOptimizationStats stats = optimizeMesh(mesh.vertices, mesh.indices);
+    logger::debug("Optimized " + name + ": " + toString(stats));
+
+    std::vector<glm::vec3> positions(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        positions[i] = mesh.vertices[i].position;
+    }
+    std::vector<MeshLod> lods = generateLods(mesh.indices, positions);
+    logger::debug("Generated " + std::to_string(lods.size()) + " LODs for " + name);
+
+    return cookMesh(mesh.vertices, mesh.indices, lods);
+}
+
+CookedMesh cookObjMesh(const uint8_t *data, size_t size, const std::string &name, int textureId) {
+    WVK_PROFILE_ZONE("cook obj mesh");
+
+    MeshData mesh = loadObjMesh(reinterpret_cast<const char *>(data), size, textureId);
+    return cookImportedMesh(mesh, name);
+}
+
+CookedMesh cookGlbMesh(const uint8_t *data, size_t size, const std::string &name, int textureId) {
+    WVK_PROFILE_ZONE("cook glb mesh");
+
+    GlbFile file;
+    if (!file.parse(data, size)) {
+        throw std::runtime_error("failed to parse .glb file. name: " + name);
+    }
+    MeshData mesh = loadGlbMesh(file, textureId);
+    return cookImportedMesh(mesh, name);
+}
+
+CookedMeshView viewCookedMesh(const CookedMesh &mesh) {
+    CookedMeshView view{};
+    view.bounds = mesh.bounds;
+    view.quantization = mesh.quantization;
+    view.materialId = mesh.materialId;
+    view.uvDensity = mesh.uvDensity;
+
+    view.vertices = mesh.vertices.data();
+    view.positions = mesh.positions.data();
+    view.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+
+    view.indices = mesh.indexData.data();
+    view.indexCount = mesh.indexData.indexCount();
+    view.indexSize = mesh.indexData.indexSize();
+
+    view.subMeshes = mesh.indexData.subMeshes.data();
+    view.subMeshCount = static_cast<uint32_t>(mesh.indexData.subMeshes.size());
+    view.meshlets = mesh.meshlets.data();
+    view.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+    view.lods = mesh.lods.data();
+    view.lodCount = static_cast<uint32_t>(mesh.lods.size());
+    return view;
+}
+
+/* Serialization */
+
+std::vector<uint8_t> serializeCookedMesh(const CookedMesh &mesh, const CookedMeshSource &source) {
+    CookedMeshHeader header{};
+    header.magic = COOKED_MESH_MAGIC;
+    header.version = COOKED_MESH_VERSION;
+    header.source = source;
+    header.boundsMin = mesh.bounds.min;
+    header.boundsMax = mesh.bounds.max;
+    header.quantizationOffset = mesh.quantization.offset;
+    header.quantizationScale = mesh.quantization.scale;
+    header.materialId = mesh.materialId;
+    header.indexSize = mesh.indexData.indexSize();
+    header.uvDensity = mesh.uvDensity;
+
+    const void *blobData[BLOB_COUNT] = {mesh.vertices.data(), mesh.positions.data(), mesh.indexData.data(),
+                                        mesh.indexData.subMeshes.data(), mesh.meshlets.data(), mesh.lods.data()};
+    uint64_t blobSizes[BLOB_COUNT] = {mesh.vertices.size() * sizeof(PackedVertex),
+                                      mesh.positions.size() * sizeof(PositionVertex),
+                                      mesh.indexData.byteSize(),
+                                      mesh.indexData.subMeshes.size() * sizeof(SubMesh),
+                                      mesh.meshlets.size() * sizeof(Meshlet),
+                                      mesh.lods.size() * sizeof(LodRange)};
+
+    uint64_t offset = alignBlob(sizeof(CookedMeshHeader));
+    for (int blob = 0; blob < BLOB_COUNT; blob++) {
+        header.blobs[blob] = {offset, blobSizes[blob]};
+        offset = alignBlob(offset + blobSizes[blob]);
+    }
+
+    std::vector<uint8_t> bytes(offset, 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    for (int blob = 0; blob < BLOB_COUNT; blob++) {
+        if (blobSizes[blob] > 0) {
+            memcpy(bytes.data() + header.blobs[blob].offset, blobData[blob], blobSizes[blob]);
+        }
+    }
+    return bytes;
+}
+
+bool parseCookedMesh(const uint8_t *data, size_t size, const CookedMeshSource &source, CookedMeshView &view) {
+    if (data == nullptr || size < sizeof(CookedMeshHeader)) return false;
+
+    CookedMeshHeader header{};
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != COOKED_MESH_MAGIC || header.version != COOKED_MESH_VERSION) return false;
+    if (header.source.contentHash != source.contentHash || header.source.textureId != source.textureId) return false;
+    if (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t)) return false;
+
+    uint64_t elementSizes[BLOB_COUNT] = {sizeof(PackedVertex), sizeof(PositionVertex), header.indexSize,
+                                         sizeof(SubMesh), sizeof(Meshlet), sizeof(LodRange)};
+    uint32_t counts[BLOB_COUNT];
+    for (int blob = 0; blob < BLOB_COUNT; blob++) {
+        const BlobRange &range = header.blobs[blob];
+        if (range.offset % BLOB_ALIGNMENT != 0 || range.offset > size || range.size > size - range.offset) return false;
+        if (range.size % elementSizes[blob] != 0 || range.size / elementSizes[blob] > UINT32_MAX) return false;
+        counts[blob] = static_cast<uint32_t>(range.size / elementSizes[blob]);
+    }
+    if (counts[BLOB_POSITIONS] != counts[BLOB_VERTICES]) return false;
+
+    view = CookedMeshView{};
+    view.bounds.min = header.boundsMin;
+    view.bounds.max = header.boundsMax;
+    view.quantization.offset = header.quantizationOffset;
+    view.quantization.scale = header.quantizationScale;
+    view.materialId = header.materialId;
+    view.uvDensity = header.uvDensity;
+
+    view.vertices = reinterpret_cast<const PackedVertex *>(data + header.blobs[BLOB_VERTICES].offset);
+    view.positions = reinterpret_cast<const PositionVertex *>(data + header.blobs[BLOB_POSITIONS].offset);
+    view.vertexCount = counts[BLOB_VERTICES];
+
+    view.indices = data + header.blobs[BLOB_INDICES].offset;
+    view.indexCount = counts[BLOB_INDICES];
+    view.indexSize = header.indexSize;
+
+    view.subMeshes = reinterpret_cast<const SubMesh *>(data + header.blobs[BLOB_SUB_MESHES].offset);
+    view.subMeshCount = counts[BLOB_SUB_MESHES];
+    view.meshlets = reinterpret_cast<const Meshlet *>(data + header.blobs[BLOB_MESHLETS].offset);
+    view.meshletCount = counts[BLOB_MESHLETS];
+    view.lods = reinterpret_cast<const LodRange *>(data + header.blobs[BLOB_LODS].offset);
+    view.lodCount = counts[BLOB_LODS];
+
+    // The ranges are drawn as they are, so each must stay inside the index buffer and, with its vertex offset added,
+    // only address existing vertices
+    auto maxIndex = [&](uint32_t first, uint32_t count) {
+        uint32_t result = 0;
+        if (view.indexSize == sizeof(uint16_t)) {
+            const uint16_t *indices = reinterpret_cast<const uint16_t *>(view.indices) + first;
+            for (uint32_t i = 0; i < count; i++) result = std::max<uint32_t>(result, indices[i]);
+        } else {
+            const uint32_t *indices = reinterpret_cast<const uint32_t *>(view.indices) + first;
+            for (uint32_t i = 0; i < count; i++) result = std::max(result, indices[i]);
+        }
+        return result;
+    };
+    auto validRange = [&](uint32_t first, uint32_t count, int32_t vertexOffset) {
+        if (first > view.indexCount || count > view.indexCount - first) return false;
+        if (count == 0) return true;
+        if (vertexOffset < 0 || static_cast<uint32_t>(vertexOffset) >= view.vertexCount) return false;
+        return maxIndex(first, count) < view.vertexCount - static_cast<uint32_t>(vertexOffset);
+    };
+    for (uint32_t i = 0; i < view.subMeshCount; i++) {
+        const SubMesh &subMesh = view.subMeshes[i];
+        if (!validRange(subMesh.firstIndex, subMesh.indexCount, subMesh.vertexOffset)) return false;
+    }
+    for (uint32_t i = 0; i < view.meshletCount; i++) {
+        const Meshlet &meshlet = view.meshlets[i];
+        if (!validRange(meshlet.firstIndex, meshlet.indexCount, meshlet.vertexOffset)) return false;
+    }
+    // LODs index the full detail mesh's vertices without an offset, see appendLods
+    for (uint32_t i = 0; i < view.lodCount; i++) {
+        if (!validRange(view.lods[i].firstIndex, view.lods[i].indexCount, 0)) return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "mesh_data.h"
+#include "vertex_packing.h"
+#include "index_data.h"
+#include "meshlets.h"
+#include "simplifier.h"
+#include "../bounds.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wvk {
+
+/*
+ * Cooked meshes hold everything WvkModel uploads in its final GPU layout: packed vertices, the position stream,
+ * 16 or 32 bit indices with the LODs appended, sub meshes, meshlets and LOD ranges. A .wmesh file is a header
+ * followed by those arrays as raw blobs in native byte order, so loading one is a memory map and a few memcpys.
+ * They are stored in the derived data cache under cookedMeshKey(). COOKED_MESH_VERSION must be bumped whenever the
+ * layout of any of the stored structs, or the cooking itself, changes.
+ */
+
+constexpr uint32_t COOKED_MESH_MAGIC = 0x48534d57; // "WMSH"
+constexpr uint32_t COOKED_MESH_VERSION = 3;
+
+// Identifies the source contents and import settings a mesh was cooked from, it is cooked again when these change
+struct CookedMeshSource {
+    uint64_t contentHash = 0;   // of the source file, see DerivedDataCache::sourceHash()
+    uint32_t textureId = 0;
+    uint32_t padding = 0;
+};
+
+// Derived data cache key of the mesh cooked from source
+uint64_t cookedMeshKey(const CookedMeshSource &source);
+
+struct CookedMesh {
+    Bounds bounds;
+    Quantization quantization;
+    uint32_t materialId = 0;
+    float uvDensity = 0.f;
+
+    std::vector<PackedVertex> vertices;
+    std::vector<PositionVertex> positions;
+    IndexData indexData;   // the LODs follow the sub meshes
+    std::vector<Meshlet> meshlets;
+    std::vector<LodRange> lods;
+};
+
+// Non owning view of a cooked mesh, in memory or in a mapped file
+struct CookedMeshView {
+    Bounds bounds;
+    Quantization quantization;
+    uint32_t materialId = 0;
+    float uvDensity = 0.f;
+
+    const PackedVertex *vertices = nullptr;
+    const PositionVertex *positions = nullptr;
+    uint32_t vertexCount = 0;
+
+    const void *indices = nullptr;
+    uint32_t indexCount = 0;
+    uint32_t indexSize = 0;
+
+    const SubMesh *subMeshes = nullptr;
+    uint32_t subMeshCount = 0;
+    const Meshlet *meshlets = nullptr;
+    uint32_t meshletCount = 0;
+    const LodRange *lods = nullptr;
+    uint32_t lodCount = 0;
+};
+
+// Packs a mesh for upload. LODs must index the same vertices as indices.
+CookedMesh cookMesh(const std::vector<MeshVertex> &vertices, const std::vector<uint32_t> &indices,
+                    const std::vector<MeshLod> &lods = {});
+
+// Imports the contents of an OBJ file, optimizes it and generates its LODs before cooking it, name is used in messages.
+// Throws std::runtime_error if the file can't be parsed.
+CookedMesh cookObjMesh(const uint8_t *data, size_t size, const std::string &name, int textureId);
+// Same as above for the meshes of a .glb file, see loadGlbMesh
+CookedMesh cookGlbMesh(const uint8_t *data, size_t size, const std::string &name, int textureId);
+
+CookedMeshView viewCookedMesh(const CookedMesh &mesh);
+
+std::vector<uint8_t> serializeCookedMesh(const CookedMesh &mesh, const CookedMeshSource &source);
+
+// Points view into the contents of a .wmesh file. Returns false if the file is malformed, from another version, or
+// was cooked from a different source than the given one.
+bool parseCookedMesh(const uint8_t *data, size_t size, const CookedMeshSource &source, CookedMeshView &view);
+
+}
@@ -0,0 +1,280 @@
+#include "glb_file.h"
+
+#include <json.h>
+#include <logger.h>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+
+namespace wvk {
+
+static const uint32_t GLB_MAGIC = 0x46546c67;       // "glTF"
+static const uint32_t GLB_VERSION = 2;
+static const uint32_t GLB_CHUNK_JSON = 0x4e4f534a;  // "JSON"
+static const uint32_t GLB_CHUNK_BIN = 0x004e4942;   // "BIN\0"
+
+static uint32_t readUint32(const uint8_t *data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+bool GlbFile::open(const std::string &path) {
+    if (!file.open(path)) {
+        logger::error("Failed to open " + path);
+        return false;
+    }
+    if (!parse(file.getData(), file.getSize())) {
+        logger::error("Failed to parse " + path);
+        return false;
+    }
+    return true;
+}
+
+bool GlbFile::parse(const uint8_t *data, size_t size) {
+    // 12 byte header, then chunks of a 4 byte length, a 4 byte type and the padded data
+    if (size < 20 || readUint32(data) != GLB_MAGIC) {
+        logger::error("Not a binary glTF file");
+        return false;
+    }
+    if (readUint32(data + 4) != GLB_VERSION) {
+        logger::error("Unsupported binary glTF version " + std::to_string(readUint32(data + 4)));
+        return false;
+    }
+    size_t length = readUint32(data + 8);
+    if (length > size) {
+        logger::error("Binary glTF file is truncated");
+        return false;
+    }
+
+    const char *json = nullptr;
+    size_t jsonSize = 0;
+    binary = nullptr;
+    binarySize = 0;
+
+    size_t offset = 12;
+    while (length - offset >= 8) {
+        size_t chunkSize = readUint32(data + offset);
+        uint32_t chunkType = readUint32(data + offset + 4);
+        offset += 8;
+        if (chunkSize > length - offset) {
+            logger::error("Binary glTF chunk is truncated");
+            return false;
+        }
+
+        // The first chunk is the JSON, a BIN chunk may follow it and unknown chunks are skipped
+        if (json == nullptr) {
+            if (chunkType != GLB_CHUNK_JSON) {
+                logger::error("Binary glTF file doesn't start with a JSON chunk");
+                return false;
+            }
+            json = reinterpret_cast<const char *>(data + offset);
+            jsonSize = chunkSize;
+        } else if (chunkType == GLB_CHUNK_BIN && binary == nullptr) {
+            binary = data + offset;
+            binarySize = chunkSize;
+        }
+
+        offset += (chunkSize + 3) & ~size_t(3);
+        if (offset > length) break;
+    }
+
+    if (json == nullptr) {
+        logger::error("Binary glTF file has no JSON chunk");
+        return false;
+    }
+    return parseJson(json, jsonSize);
+}
+
+static glm::mat4 nodeTransform(const nlohmann::json &node) {
+    if (node.count("matrix") != 0 && node["matrix"].size() == 16) {
+        float values[16];
+        for (size_t i = 0; i < 16; i++) {
+            values[i] = node["matrix"][i].get<float>();
+        }
+        return glm::make_mat4(values);
+    }
+
+    glm::vec3 translation{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 scale{1.0f};
+    if (node.count("translation") != 0 && node["translation"].size() == 3) {
+        const nlohmann::json &t = node["translation"];
+        translation = {t[0].get<float>(), t[1].get<float>(), t[2].get<float>()};
+    }
+    if (node.count("rotation") != 0 && node["rotation"].size() == 4) {
+        // glTF stores x, y, z, w
+        const nlohmann::json &r = node["rotation"];
+        rotation = glm::quat{r[3].get<float>(), r[0].get<float>(), r[1].get<float>(), r[2].get<float>()};
+    }
+    if (node.count("scale") != 0 && node["scale"].size() == 3) {
+        const nlohmann::json &s = node["scale"];
+        scale = {s[0].get<float>(), s[1].get<float>(), s[2].get<float>()};
+    }
+
+    return glm::translate(glm::mat4{1.0f}, translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4{1.0f}, scale);
+}
+
+static uint32_t accessorComponentCount(const std::string &type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+bool GlbFile::parseJson(const char *json, size_t size) {
+    nlohmann::json document = nlohmann::json::parse(json, json + size, nullptr, false);
+    if (document.is_discarded() || !document.is_object()) {
+        logger::error("Binary glTF file has invalid JSON");
+        return false;
+    }
+
+    // Everything is read with defaults, invalid indices are caught when they are used
+    try {
+        buffers.clear();
+        bufferSizes.clear();
+        for (const nlohmann::json &buffer : document.value("buffers", nlohmann::json::array())) {
+            bool embedded = buffer.count("uri") == 0 && buffers.empty() && binary != nullptr;
+            size_t byteLength = buffer.value("byteLength", size_t(0));
+            if (embedded && byteLength > binarySize) {
+                logger::error("Binary glTF buffer is larger than the BIN chunk");
+                return false;
+            }
+            buffers.push_back(embedded ? binary : nullptr);
+            bufferSizes.push_back(embedded ? byteLength : 0);
+        }
+
+        bufferViews.clear();
+        for (const nlohmann::json &view : document.value("bufferViews", nlohmann::json::array())) {
+            BufferView bufferView{};
+            bufferView.buffer = view.value("buffer", -1);
+            bufferView.byteOffset = view.value("byteOffset", size_t(0));
+            bufferView.byteLength = view.value("byteLength", size_t(0));
+            bufferView.byteStride = view.value("byteStride", size_t(0));
+            bufferViews.push_back(bufferView);
+        }
+
+        accessors.clear();
+        for (const nlohmann::json &accessor : document.value("accessors", nlohmann::json::array())) {
+            Accessor parsed{};
+            parsed.bufferView = accessor.value("bufferView", -1);
+            parsed.byteOffset = accessor.value("byteOffset", size_t(0));
+            parsed.count = accessor.value("count", size_t(0));
+            parsed.componentType = accessor.value("componentType", 0);
+            parsed.componentCount = accessorComponentCount(accessor.value("type", std::string{}));
+            parsed.normalized = accessor.value("normalized", false);
+            parsed.sparse = accessor.count("sparse") != 0;
+            accessors.push_back(parsed);
+        }
+
+        meshes.clear();
+        for (const nlohmann::json &mesh : document.value("meshes", nlohmann::json::array())) {
+            GlbMesh parsed{};
+            parsed.name = mesh.value("name", std::string{});
+            for (const nlohmann::json &primitive : mesh.value("primitives", nlohmann::json::array())) {
+                GlbPrimitive parsedPrimitive{};
+                nlohmann::json attributes = primitive.value("attributes", nlohmann::json::object());
+                for (auto &attribute : attributes.items()) {
+                    parsedPrimitive.attributes[attribute.key()] = attribute.value().get<int>();
+                }
+                parsedPrimitive.indices = primitive.value("indices", -1);
+                parsedPrimitive.mode = primitive.value("mode", 4);
+                parsed.primitives.push_back(std::move(parsedPrimitive));
+            }
+            meshes.push_back(std::move(parsed));
+        }
+
+        nodes.clear();
+        for (const nlohmann::json &node : document.value("nodes", nlohmann::json::array())) {
+            GlbNode parsed{};
+            parsed.name = node.value("name", std::string{});
+            parsed.mesh = node.value("mesh", -1);
+            parsed.skin = node.value("skin", -1);
+            parsed.children = node.value("children", std::vector<int>{});
+            parsed.transform = nodeTransform(node);
+            nodes.push_back(std::move(parsed));
+        }
+
+        skins.clear();
+        for (const nlohmann::json &skin : document.value("skins", nlohmann::json::array())) {
+            GlbSkin parsed{};
+            parsed.name = skin.value("name", std::string{});
+            parsed.joints = skin.value("joints", std::vector<int>{});
+            skins.push_back(std::move(parsed));
+        }
+    } catch (const nlohmann::json::exception &exception) {
+        logger::error(std::string("Unexpected binary glTF JSON: ") + exception.what());
+        return false;
+    }
+
+    return true;
+}
+
+AccessorView GlbFile::accessor(int index) const {
+    if (index < 0 || index >= static_cast<int>(accessors.size())) {
+        logger::fatal_error("glTF accessor index out of range");
+    }
+    const Accessor &accessor = accessors[index];
+    if (accessor.sparse) {
+        logger::fatal_error("Sparse glTF accessors are not supported");
+    }
+
+    // The spec reads accessors without a buffer view as zeros
+    if (accessor.bufferView < 0) {
+        return AccessorView{nullptr, 0, 0, 0, accessor.count, accessor.componentType, accessor.componentCount,
+                            accessor.normalized};
+    }
+
+    if (accessor.bufferView >= static_cast<int>(bufferViews.size())) {
+        logger::fatal_error("glTF accessor buffer view out of range");
+    }
+    const BufferView &view = bufferViews[accessor.bufferView];
+    if (view.buffer < 0 || view.buffer >= static_cast<int>(buffers.size()) || buffers[view.buffer] == nullptr) {
+        logger::fatal_error("glTF buffer view doesn't refer to the embedded buffer");
+    }
+    if (view.byteOffset > bufferSizes[view.buffer] || view.byteLength > bufferSizes[view.buffer] - view.byteOffset) {
+        logger::fatal_error("glTF buffer view reads past the end of its buffer");
+    }
+
+    return AccessorView{buffers[view.buffer] + view.byteOffset, view.byteLength, view.byteStride, accessor.byteOffset,
+                        accessor.count, accessor.componentType, accessor.componentCount, accessor.normalized};
+}
+
+int GlbFile::attribute(const GlbPrimitive &primitive, const char *semantic) const {
+    auto found = primitive.attributes.find(semantic);
+    return found != primitive.attributes.end() ? found->second : -1;
+}
+
+std::vector<glm::mat4> GlbFile::worldTransforms() const {
+    std::vector<int> parents(nodes.size(), -1);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        for (int child : nodes[i].children) {
+            if (child >= 0 && child < static_cast<int>(nodes.size())) parents[child] = static_cast<int>(i);
+        }
+    }
+
+    // Parents are resolved before their children, a cycle (invalid glTF) is cut where it is found
+    std::vector<glm::mat4> transforms(nodes.size());
+    std::vector<uint8_t> state(nodes.size(), 0);   // 0 unvisited, 1 in progress, 2 done
+    std::vector<int> stack;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        for (int node = static_cast<int>(i); node >= 0 && state[node] == 0; node = parents[node]) {
+            state[node] = 1;
+            stack.push_back(node);
+        }
+        while (!stack.empty()) {
+            int node = stack.back();
+            stack.pop_back();
+            int parent = parents[node];
+            transforms[node] = parent >= 0 && state[parent] == 2 ? transforms[parent] * nodes[node].transform
+                                                                 : nodes[node].transform;
+            state[node] = 2;
+        }
+    }
+    return transforms;
+}
+
+}
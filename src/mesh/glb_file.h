@@ -0,0 +1,102 @@
+#pragma once
+
+#include "../glm.h"
+#include "../mapped_file.h"
+#include "../anim/accessor_view.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace wvk {
+
+/*
+ * Binary glTF (.glb) file read in place. The file is memory mapped, the JSON chunk is parsed into the few arrays the
+ * importers need and accessors point straight into the BIN chunk, so vertex data is never copied out of the mapping
+ * before it is converted. Only the embedded BIN buffer is supported, buffers with a uri are not loaded.
+ */
+
+struct GlbPrimitive {
+    std::map<std::string, int> attributes;   // semantic (e.g. "POSITION") to accessor index
+    int indices = -1;
+    int mode = 4;                             // glTF primitive mode, 4 is triangles
+};
+
+struct GlbMesh {
+    std::string name;
+    std::vector<GlbPrimitive> primitives;
+};
+
+struct GlbNode {
+    std::string name;
+    int mesh = -1;
+    int skin = -1;
+    std::vector<int> children;
+    glm::mat4 transform{1.0f};   // relative to the parent node
+};
+
+struct GlbSkin {
+    std::string name;
+    std::vector<int> joints;
+};
+
+class GlbFile {
+  public:
+    GlbFile() = default;
+
+    GlbFile(const GlbFile &) = delete;
+    GlbFile &operator=(const GlbFile &) = delete;
+
+    // Maps the file and parses it. Logs the problem and returns false if it can't be read or isn't a valid GLB file.
+    bool open(const std::string &path);
+    // Same as above for GLB bytes in memory, which have to outlive the file
+    bool parse(const uint8_t *data, size_t size);
+
+    const std::vector<GlbMesh> &getMeshes() const { return meshes; }
+    const std::vector<GlbNode> &getNodes() const { return nodes; }
+    const std::vector<GlbSkin> &getSkins() const { return skins; }
+
+    // View of the accessor's elements in the BIN chunk. Fatal error for invalid, sparse or matrix accessors.
+    AccessorView accessor(int index) const;
+    // Accessor of a primitive attribute, or an invalid index if the primitive doesn't have it
+    int attribute(const GlbPrimitive &primitive, const char *semantic) const;
+
+    // Model space transform of every node, combining the transforms of its parents
+    std::vector<glm::mat4> worldTransforms() const;
+
+  private:
+    struct BufferView {
+        int buffer = -1;
+        size_t byteOffset = 0;
+        size_t byteLength = 0;
+        size_t byteStride = 0;
+    };
+
+    struct Accessor {
+        int bufferView = -1;
+        size_t byteOffset = 0;
+        size_t count = 0;
+        int componentType = 0;
+        uint32_t componentCount = 0;   // 0 for matrices
+        bool normalized = false;
+        bool sparse = false;
+    };
+
+    bool parseJson(const char *json, size_t size);
+
+    MappedFile file;
+    const uint8_t *binary = nullptr;
+    size_t binarySize = 0;
+
+    std::vector<const uint8_t *> buffers;   // null for buffers outside the file
+    std::vector<size_t> bufferSizes;
+    std::vector<BufferView> bufferViews;
+    std::vector<Accessor> accessors;
+    std::vector<GlbMesh> meshes;
+    std::vector<GlbNode> nodes;
+    std::vector<GlbSkin> skins;
+};
+
+}
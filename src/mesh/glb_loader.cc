@@ -0,0 +1,124 @@
+#include "glb_loader.h"
+
+#include "vertex_welder.h"
+#include "../cpu_profiler.h"
+
+#include <logger.h>
+
+#include <stdexcept>
+
+namespace wvk {
+
+static const int GLB_MODE_TRIANGLES = 4;
+
+static void addPrimitive(const GlbFile &file, const GlbPrimitive &primitive, const glm::mat4 &transform, int textureId,
+                         VertexWelder<MeshVertex> &welder, std::vector<uint32_t> &indices) {
+    int positionAccessor = file.attribute(primitive, "POSITION");
+    if (primitive.mode != GLB_MODE_TRIANGLES || positionAccessor < 0) {
+        logger::error("Skipping glTF primitive that isn't made of triangles");
+        return;
+    }
+
+    // Each attribute is converted in one pass straight from the mapped file
+    std::vector<glm::vec3> positions = file.accessor(positionAccessor).readVectors<glm::vec3>();
+    size_t vertexCount = positions.size();
+
+    std::vector<glm::vec3> normals(vertexCount, glm::vec3{0.0f});
+    int normalAccessor = file.attribute(primitive, "NORMAL");
+    if (normalAccessor >= 0) normals = file.accessor(normalAccessor).readVectors<glm::vec3>();
+
+    std::vector<glm::vec2> texCoords(vertexCount, glm::vec2{0.0f});
+    int texCoordAccessor = file.attribute(primitive, "TEXCOORD_0");
+    if (texCoordAccessor >= 0) texCoords = file.accessor(texCoordAccessor).readVectors<glm::vec2>();
+
+    if (normals.size() != vertexCount || texCoords.size() != vertexCount) {
+        throw std::runtime_error("glTF primitive attributes have different vertex counts");
+    }
+
+    std::vector<uint32_t> primitiveIndices;
+    if (primitive.indices >= 0) {
+        AccessorView indexView = file.accessor(primitive.indices);
+        primitiveIndices.resize(indexView.size());
+        indexView.readUints(primitiveIndices.data(), 1);
+    } else {
+        primitiveIndices.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            primitiveIndices[i] = static_cast<uint32_t>(i);
+        }
+    }
+
+    glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3{transform}));
+    for (size_t i = 0; i + 2 < primitiveIndices.size(); i += 3) {
+        for (size_t corner = 0; corner < 3; corner++) {
+            uint32_t index = primitiveIndices[i + corner];
+            if (index >= vertexCount) {
+                throw std::runtime_error("glTF primitive index out of range");
+            }
+
+            MeshVertex vertex{};
+            vertex.position = glm::vec3{transform * glm::vec4{positions[index], 1.0f}};
+            vertex.normal = normalAccessor >= 0 ? glm::normalize(normalTransform * normals[index]) : normals[index];
+            vertex.tex_coord = texCoords[index];
+            vertex.texture_index = textureId;
+            indices.push_back(welder.weld(vertex));
+        }
+    }
+}
+
+MeshData loadGlbMesh(const GlbFile &file, int textureId) {
+    WVK_PROFILE_ZONE("import glb mesh");
+
+    const std::vector<GlbNode> &nodes = file.getNodes();
+    const std::vector<GlbMesh> &meshes = file.getMeshes();
+    std::vector<glm::mat4> transforms = file.worldTransforms();
+
+    size_t indexEstimate = 0;
+    for (const GlbMesh &mesh : meshes) {
+        for (const GlbPrimitive &primitive : mesh.primitives) {
+            int accessor = primitive.indices >= 0 ? primitive.indices : file.attribute(primitive, "POSITION");
+            if (accessor >= 0) indexEstimate += file.accessor(accessor).size();
+        }
+    }
+
+    MeshData result{};
+    result.indices.reserve(indexEstimate);
+    VertexWelder<MeshVertex> welder{indexEstimate};
+
+    bool foundNode = false;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].mesh < 0 || nodes[i].mesh >= static_cast<int>(meshes.size())) continue;
+        foundNode = true;
+
+        // Skinned meshes ignore their node's transform, the joints place them
+        glm::mat4 transform = nodes[i].skin >= 0 ? glm::mat4{1.0f} : transforms[i];
+        for (const GlbPrimitive &primitive : meshes[nodes[i].mesh].primitives) {
+            addPrimitive(file, primitive, transform, textureId, welder, result.indices);
+        }
+    }
+
+    // Files without a node hierarchy still get their meshes loaded
+    if (!foundNode) {
+        for (const GlbMesh &mesh : meshes) {
+            for (const GlbPrimitive &primitive : mesh.primitives) {
+                addPrimitive(file, primitive, glm::mat4{1.0f}, textureId, welder, result.indices);
+            }
+        }
+    }
+
+    if (result.indices.empty()) {
+        throw std::runtime_error("glTF file has no triangle meshes");
+    }
+
+    result.vertices = welder.takeVertices();
+    return result;
+}
+
+MeshData loadGlbMesh(const std::string &path, int textureId) {
+    GlbFile file;
+    if (!file.open(path)) {
+        throw std::runtime_error("Failed to load " + path);
+    }
+    return loadGlbMesh(file, textureId);
+}
+
+}
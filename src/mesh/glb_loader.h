@@ -0,0 +1,18 @@
+#pragma once
+
+#include "mesh_data.h"
+#include "glb_file.h"
+
+#include <string>
+
+namespace wvk {
+
+// Merges the triangle primitives of every mesh node into one mesh, in model space, and merges identical vertices.
+// Skinned meshes are read in their bind pose. Throws std::runtime_error if the file has no triangles or its indices
+// are out of range.
+MeshData loadGlbMesh(const GlbFile &file, int textureId);
+
+// Same as above, mapping the file first. Throws std::runtime_error if it can't be parsed.
+MeshData loadGlbMesh(const std::string &path, int textureId);
+
+}
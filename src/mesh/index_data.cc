@@ -0,0 +1,84 @@
+#include "index_data.h"
+
+#include <limits>
+
+namespace wvk {
+
+static const uint32_t NOT_IN_SUB_MESH = std::numeric_limits<uint32_t>::max();
+
+// Cuts the triangle list into consecutive runs that each use at most MAX_SHORT_INDEX_VERTICES vertices.
+// Vertex fetch optimized meshes use their vertices roughly in order, so few vertices end up in two runs.
+static IndexData splitMesh(const std::vector<uint32_t> &indices, size_t vertexCount,
+                           std::vector<uint32_t> &vertexSources) {
+    IndexData data{};
+    data.shortIndices.reserve(indices.size());
+
+    std::vector<uint32_t> localIndices(vertexCount, NOT_IN_SUB_MESH);
+    std::vector<uint32_t> subMeshVertices;
+
+    auto finishSubMesh = [&]() {
+        SubMesh &subMesh = data.subMeshes.back();
+        subMesh.indexCount = static_cast<uint32_t>(data.shortIndices.size()) - subMesh.firstIndex;
+
+        for (uint32_t vertex : subMeshVertices) {
+            localIndices[vertex] = NOT_IN_SUB_MESH;
+        }
+        vertexSources.insert(vertexSources.end(), subMeshVertices.begin(), subMeshVertices.end());
+        subMeshVertices.clear();
+    };
+
+    data.subMeshes.push_back({0, 0, 0});
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        size_t newVertices = 0;
+        for (int k = 0; k < 3; k++) {
+            if (localIndices[indices[i + k]] == NOT_IN_SUB_MESH) newVertices++;
+        }
+
+        if (subMeshVertices.size() + newVertices > MAX_SHORT_INDEX_VERTICES) {
+            finishSubMesh();
+            data.subMeshes.push_back({static_cast<uint32_t>(data.shortIndices.size()), 0,
+                                      static_cast<int32_t>(vertexSources.size())});
+        }
+
+        for (int k = 0; k < 3; k++) {
+            uint32_t vertex = indices[i + k];
+            if (localIndices[vertex] == NOT_IN_SUB_MESH) {
+                localIndices[vertex] = static_cast<uint32_t>(subMeshVertices.size());
+                subMeshVertices.push_back(vertex);
+            }
+            data.shortIndices.push_back(static_cast<uint16_t>(localIndices[vertex]));
+        }
+    }
+    finishSubMesh();
+
+    return data;
+}
+
+IndexData buildIndexData(const std::vector<uint32_t> &indices, size_t vertexCount, size_t vertexBytes,
+                         std::vector<uint32_t> &vertexSources) {
+    vertexSources.clear();
+
+    IndexData data{};
+    if (vertexCount <= MAX_SHORT_INDEX_VERTICES) {
+        data.shortIndices.assign(indices.begin(), indices.end());
+        data.subMeshes.push_back({0, static_cast<uint32_t>(indices.size()), 0});
+        return data;
+    }
+
+    std::vector<uint32_t> splitSources;
+    IndexData split = splitMesh(indices, vertexCount, splitSources);
+
+    size_t duplicated = splitSources.size() > vertexCount ? splitSources.size() - vertexCount : 0;
+    size_t duplicatedBytes = duplicated * vertexBytes;
+    size_t savedBytes = indices.size() * (sizeof(uint32_t) - sizeof(uint16_t));
+    if (duplicatedBytes < savedBytes) {
+        vertexSources = std::move(splitSources);
+        return split;
+    }
+
+    data.indices = indices;
+    data.subMeshes.push_back({0, static_cast<uint32_t>(indices.size()), 0});
+    return data;
+}
+
+}
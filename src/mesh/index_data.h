@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wvk {
+
+// Vertices a sub mesh can address with 16 bit indices, primitive restart is disabled so 0xffff is a valid index
+constexpr size_t MAX_SHORT_INDEX_VERTICES = 65536;
+
+// Range of the index buffer drawn with one vkCmdDrawIndexed, indices are relative to vertexOffset
+struct SubMesh {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+};
+
+// Index buffer contents of a mesh, 16 bit whenever every sub mesh addresses at most MAX_SHORT_INDEX_VERTICES
+struct IndexData {
+    std::vector<uint16_t> shortIndices;
+    std::vector<uint32_t> indices;   // only used when the indices are 32 bit
+    std::vector<SubMesh> subMeshes;
+
+    bool isShort() const { return indices.empty(); }
+    uint32_t indexSize() const { return isShort() ? sizeof(uint16_t) : sizeof(uint32_t); }
+    uint32_t indexCount() const { return static_cast<uint32_t>(isShort() ? shortIndices.size() : indices.size()); }
+
+    uint32_t at(size_t i) const { return isShort() ? shortIndices[i] : indices[i]; }
+
+    const void *data() const { return isShort() ? static_cast<const void *>(shortIndices.data()) : indices.data(); }
+    size_t byteSize() const { return static_cast<size_t>(indexCount()) * indexSize(); }
+};
+
+// Chooses the index width of a triangle list. Meshes with more vertices than 16 bit indices can address are split
+// into sub meshes, duplicating the vertices shared between them, if the duplicated vertices (vertexBytes each on the
+// GPU) cost less memory than the halved indices save.
+// vertexSources is empty if the vertices are used as they are, otherwise it lists the source vertex of every vertex
+// of the split mesh.
+IndexData buildIndexData(const std::vector<uint32_t> &indices, size_t vertexCount, size_t vertexBytes,
+                         std::vector<uint32_t> &vertexSources);
+
+// Same as above, rearranging the vertices for the split mesh
+template <typename Vertex>
+IndexData buildIndexData(std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, size_t vertexBytes) {
+    std::vector<uint32_t> vertexSources;
+    IndexData data = buildIndexData(indices, vertices.size(), vertexBytes, vertexSources);
+
+    if (!vertexSources.empty()) {
+        std::vector<Vertex> split(vertexSources.size());
+        for (size_t i = 0; i < vertexSources.size(); i++) {
+            split[i] = vertices[vertexSources[i]];
+        }
+        vertices = std::move(split);
+    }
+
+    return data;
+}
+
+}
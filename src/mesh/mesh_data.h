@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../wvk_vertex_attributes.h"
+
+#include <cmath>
+#include <vector>
+
+namespace wvk {
+
+// CPU side mesh, as produced by the loaders and uploaded by WvkModel
+struct MeshData {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Texture coordinate units per unit of distance on the mesh's surface, as the square root of the UV area over the
+// surface area of its triangles. Texture mip selection multiplies it by the texture's size to get texels per unit.
+template <typename Vertex>
+float uvDensity(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+    double surfaceArea = 0.0, uvArea = 0.0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const Vertex &a = vertices[indices[i]], &b = vertices[indices[i + 1]], &c = vertices[indices[i + 2]];
+        surfaceArea += glm::length(glm::cross(b.position - a.position, c.position - a.position));
+        glm::vec2 uvB = b.tex_coord - a.tex_coord, uvC = c.tex_coord - a.tex_coord;
+        uvArea += std::abs(uvB.x * uvC.y - uvB.y * uvC.x);
+    }
+    return surfaceArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / surfaceArea)) : 0.f;
+}
+
+}
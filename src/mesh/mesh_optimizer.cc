@@ -0,0 +1,362 @@
+#include "mesh_optimizer.h"
+
+#include "../cpu_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace wvk {
+
+std::string toString(const MeshOptimizationStats &stats) {
+    char text[64];
+    snprintf(text, sizeof(text), "ACMR %.3f -> %.3f", stats.acmrBefore, stats.acmrAfter);
+    return text;
+}
+
+/* FIFO cache simulation */
+
+// A vertex is in the cache if fewer than cacheSize misses happened since it was last transformed.
+// Advancing the timestamp by more than the cache size empties the cache.
+class FifoCache {
+  public:
+    FifoCache(size_t vertexCount, uint32_t cacheSize) : cacheSize{cacheSize}, timestamps(vertexCount, 0) {}
+
+    uint32_t access(uint32_t vertex) {
+        if (timestamp - timestamps[vertex] > cacheSize) {
+            timestamps[vertex] = timestamp++;
+            return 1;
+        }
+        return 0;
+    }
+
+    uint32_t accessTriangle(const uint32_t *triangle) {
+        return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+    }
+
+    void reset() { timestamp += cacheSize + 1; }
+
+  private:
+    uint32_t cacheSize;
+    uint32_t timestamp = cacheSize + 1;
+    std::vector<uint32_t> timestamps;
+};
+
+float computeAcmr(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return 0.f;
+
+    FifoCache cache{vertexCount, cacheSize};
+    size_t misses = 0;
+    for (size_t i = 0; i < triangleCount * 3; i += 3) {
+        misses += cache.accessTriangle(&indices[i]);
+    }
+    return static_cast<float>(misses) / triangleCount;
+}
+
+/* Vertex cache optimization */
+
+// Forsyth's scoring, an LRU cache larger than the hardware cache so vertices that just left it still score
+static const int FORSYTH_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static const uint32_t MAX_TABLED_VALENCE = 32;
+
+// The scores only depend on small integers, so they are computed once instead of calling pow per vertex
+struct ScoreTables {
+    float cache[FORSYTH_CACHE_SIZE];
+    float valence[MAX_TABLED_VALENCE];
+
+    ScoreTables() {
+        for (int i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+            if (i < 3) {
+                // The last triangle's vertices get a fixed score so it isn't simply drawn again
+                cache[i] = LAST_TRIANGLE_SCORE;
+            } else {
+                float scaler = 1.f / (FORSYTH_CACHE_SIZE - 3);
+                cache[i] = std::pow(1.f - (i - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        valence[0] = 0.f;
+        for (uint32_t i = 1; i < MAX_TABLED_VALENCE; i++) {
+            valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+        }
+    }
+};
+
+static float vertexScore(const ScoreTables &tables, int cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) return -1.f;
+
+    float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.f;
+
+    // Prefer vertices with few triangles left, finishing them before they leave the cache
+    score += remainingTriangles < MAX_TABLED_VALENCE
+        ? tables.valence[remainingTriangles]
+        : VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+    return score;
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+    WVK_PROFILE_ZONE("optimize vertex cache");
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    // Triangles using each vertex, the first remainingTriangles[v] entries of a vertex are not drawn yet
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        remainingTriangles[indices[i]]++;
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+    }
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    static const ScoreTables tables{};
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScores[v] = vertexScore(tables, -1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] +
+                            vertexScores[indices[t * 3 + 2]];
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t scanCursor = 0;
+    uint32_t bestTriangle = 0;
+    float bestScore = triangleScores[0];
+    for (size_t t = 1; t < triangleCount; t++) {
+        if (triangleScores[t] > bestScore) {
+            bestScore = triangleScores[t];
+            bestTriangle = static_cast<uint32_t>(t);
+        }
+    }
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        // No cached vertex has triangles left, continue with the first triangle not drawn yet
+        if (bestScore < 0.f) {
+            while (emitted[scanCursor]) scanCursor++;
+            bestTriangle = static_cast<uint32_t>(scanCursor);
+        }
+
+        const uint32_t *triangle = &indices[bestTriangle * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        // Remove the triangle from the adjacency of its vertices
+        for (int k = 0; k < 3; k++) {
+            uint32_t vertex = triangle[k];
+            uint32_t *begin = &adjacency[adjacencyOffsets[vertex]];
+            uint32_t *end = begin + remainingTriangles[vertex];
+            uint32_t *found = std::find(begin, end, bestTriangle);
+            if (found != end) {
+                std::swap(*found, *(end - 1));
+                remainingTriangles[vertex]--;
+            }
+        }
+
+        // The triangle's vertices move to the front of the cache
+        nextCache.assign(triangle, triangle + 3);
+        for (uint32_t vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                nextCache.push_back(vertex);
+            }
+        }
+        std::swap(cache, nextCache);
+
+        for (size_t i = 0; i < cache.size(); i++) {
+            uint32_t vertex = cache[i];
+            cachePositions[vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScores[vertex] = vertexScore(tables, cachePositions[vertex], remainingTriangles[vertex]);
+        }
+
+        // Rescore the triangles around the cache and pick the best one, ties go to the lowest triangle index
+        bestScore = -1.f;
+        for (uint32_t vertex : cache) {
+            uint32_t offset = adjacencyOffsets[vertex];
+            for (uint32_t i = 0; i < remainingTriangles[vertex]; i++) {
+                uint32_t t = adjacency[offset + i];
+                float score = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] +
+                              vertexScores[indices[t * 3 + 2]];
+                triangleScores[t] = score;
+
+                if (score > bestScore || (score == bestScore && t < bestTriangle)) {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if (cache.size() > FORSYTH_CACHE_SIZE) cache.resize(FORSYTH_CACHE_SIZE);
+    }
+
+    indices = std::move(result);
+}
+
+/* Overdraw optimization */
+
+// Splits the triangle list where the cache restarts, those are the points where reordering costs nothing
+static std::vector<uint32_t> hardBoundaries(const std::vector<uint32_t> &indices, size_t vertexCount) {
+    std::vector<uint32_t> boundaries;
+
+    FifoCache cache{vertexCount, VERTEX_CACHE_SIZE};
+    size_t triangleCount = indices.size() / 3;
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (cache.accessTriangle(&indices[t * 3]) == 3) {
+            boundaries.push_back(static_cast<uint32_t>(t));
+        }
+    }
+    if (boundaries.empty() || boundaries[0] != 0) boundaries.insert(boundaries.begin(), 0);
+
+    return boundaries;
+}
+
+// Splits the hard clusters further wherever the cluster so far has a low enough ACMR on a cold cache
+static std::vector<uint32_t> softBoundaries(const std::vector<uint32_t> &indices, size_t vertexCount,
+                                            const std::vector<uint32_t> &hard, float threshold) {
+    std::vector<uint32_t> boundaries;
+
+    FifoCache cache{vertexCount, VERTEX_CACHE_SIZE};
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    for (size_t c = 0; c < hard.size(); c++) {
+        uint32_t start = hard[c];
+        uint32_t end = c + 1 < hard.size() ? hard[c + 1] : triangleCount;
+
+        cache.reset();
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = start; t < end; t++) {
+            clusterMisses += cache.accessTriangle(&indices[t * 3]);
+        }
+        float clusterThreshold = threshold * clusterMisses / (end - start);
+
+        boundaries.push_back(start);
+
+        cache.reset();
+        uint32_t misses = 0;
+        uint32_t size = 0;
+        for (uint32_t t = start; t < end; t++) {
+            misses += cache.accessTriangle(&indices[t * 3]);
+            size++;
+
+            if (t + 1 < end && static_cast<float>(misses) / size <= clusterThreshold) {
+                boundaries.push_back(t + 1);
+                cache.reset();
+                misses = 0;
+                size = 0;
+            }
+        }
+    }
+
+    return boundaries;
+}
+
+void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions, float threshold) {
+    WVK_PROFILE_ZONE("optimize overdraw");
+
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0) return;
+
+    std::vector<uint32_t> clusters = softBoundaries(indices, positions.size(),
+                                                    hardBoundaries(indices, positions.size()), threshold);
+
+    // Area weighted mesh centroid
+    glm::vec3 meshCentroid{0.f};
+    float meshArea = 0.f;
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        glm::vec3 a = positions[indices[t * 3 + 0]];
+        glm::vec3 b = positions[indices[t * 3 + 1]];
+        glm::vec3 c = positions[indices[t * 3 + 2]];
+        float area = glm::length(glm::cross(b - a, c - a));
+
+        meshCentroid += area * (a + b + c) / 3.f;
+        meshArea += area;
+    }
+    if (meshArea > 0.f) meshCentroid /= meshArea;
+
+    // Clusters facing away from the centroid are likely in front of the others, and are drawn first
+    std::vector<float> sortKeys(clusters.size());
+    for (size_t c = 0; c < clusters.size(); c++) {
+        uint32_t start = clusters[c];
+        uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid{0.f};
+        glm::vec3 normal{0.f};
+        float area = 0.f;
+        for (uint32_t t = start; t < end; t++) {
+            glm::vec3 a = positions[indices[t * 3 + 0]];
+            glm::vec3 b = positions[indices[t * 3 + 1]];
+            glm::vec3 c = positions[indices[t * 3 + 2]];
+            glm::vec3 cross = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(cross);
+
+            centroid += triangleArea * (a + b + c) / 3.f;
+            normal += cross;
+            area += triangleArea;
+        }
+
+        if (area > 0.f) centroid /= area;
+        float normalLength = glm::length(normal);
+        if (normalLength > 0.f) normal /= normalLength;
+
+        sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t cluster : order) {
+        uint32_t start = clusters[cluster];
+        uint32_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+
+    indices = std::move(result);
+}
+
+/* Vertex fetch optimization */
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertexCount) {
+    std::vector<uint32_t> remap(vertexCount, UNUSED_VERTEX);
+
+    uint32_t next = 0;
+    for (uint32_t &index : indices) {
+        if (remap[index] == UNUSED_VERTEX) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    return remap;
+}
+
+}
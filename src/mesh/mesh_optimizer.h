@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../glm.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace wvk {
+
+// Size of the FIFO post-transform cache the ACMR is measured against, a common size for current GPUs
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+// Marks vertices that no triangle references in a remap table
+constexpr uint32_t UNUSED_VERTEX = std::numeric_limits<uint32_t>::max();
+
+struct MeshOptimizationStats {
+    float acmrBefore = 0.f;   // average cache miss ratio, transformed vertices per triangle
+    float acmrAfter = 0.f;
+};
+
+// "ACMR 1.49 -> 0.71" style summary for the load log
+std::string toString(const MeshOptimizationStats &stats);
+
+// Average cache miss ratio of a triangle list for a FIFO cache with cacheSize entries
+float computeAcmr(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders triangles for post-transform cache locality using Forsyth's linear-speed algorithm
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+// Reorders clusters of a cache optimized triangle list so outward facing clusters are drawn first, keeping the
+// ACMR within threshold times the ACMR of the input
+void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions, float threshold = 1.05f);
+
+// Renumbers vertices in the order the triangles first use them. Returns the table from old to new vertex index,
+// with UNUSED_VERTEX for vertices no triangle references.
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertexCount);
+
+template <typename Vertex>
+void remapVertices(std::vector<Vertex> &vertices, const std::vector<uint32_t> &remap) {
+    size_t used = 0;
+    for (uint32_t index : remap) {
+        if (index != UNUSED_VERTEX) used++;
+    }
+
+    std::vector<Vertex> remapped(used);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        if (remap[i] != UNUSED_VERTEX) remapped[remap[i]] = vertices[i];
+    }
+    vertices = std::move(remapped);
+}
+
+// Runs the vertex cache, overdraw and vertex fetch optimizations on an indexed triangle list.
+// The result only depends on the input, so optimizing the same mesh always produces the same buffers.
+template <typename Vertex>
+MeshOptimizationStats optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+    MeshOptimizationStats stats{};
+    stats.acmrBefore = computeAcmr(indices, vertices.size());
+
+    optimizeVertexCache(indices, vertices.size());
+
+    std::vector<glm::vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].position;
+    }
+    optimizeOverdraw(indices, positions);
+
+    remapVertices(vertices, optimizeVertexFetch(indices, vertices.size()));
+
+    stats.acmrAfter = computeAcmr(indices, vertices.size());
+    return stats;
+}
+
+}
@@ -0,0 +1,243 @@
+#include "meshlets.h"
+
+#include "../cpu_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace wvk {
+
+// Cones wider than this (minimum normal dot product with the axis) can't be culled in practice
+static const float MIN_CONE_DOT = 0.1f;
+
+static void computeBounds(Meshlet &meshlet, const IndexData &indexData, const std::vector<glm::vec3> &positions) {
+    auto vertex = [&](uint32_t i) {
+        return positions[meshlet.vertexOffset + indexData.at(meshlet.firstIndex + i)];
+    };
+
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{-std::numeric_limits<float>::max()};
+    for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+        min = glm::min(min, vertex(i));
+        max = glm::max(max, vertex(i));
+    }
+
+    meshlet.center = (min + max) / 2.f;
+    meshlet.radius = 0.f;
+    for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(vertex(i) - meshlet.center));
+    }
+
+    glm::vec3 normalSum{0.f};
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.indexCount / 3);
+    for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+        glm::vec3 a = vertex(i), b = vertex(i + 1), c = vertex(i + 2);
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        if (length == 0.f) continue;
+
+        normals.push_back(normal / length);
+        normalSum += normal / length;
+    }
+
+    meshlet.coneCutoff = 1.f;
+    float sumLength = glm::length(normalSum);
+    if (normals.empty() || sumLength == 0.f) return;
+
+    meshlet.coneAxis = normalSum / sumLength;
+
+    float minDot = 1.f;
+    for (const glm::vec3 &normal : normals) {
+        minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+    }
+    if (minDot <= MIN_CONE_DOT) return;
+
+    // Sine of the cone's half angle, so the test is against the cone widened by 90 degrees
+    meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+}
+
+// Triangles with a normal this far from the meshlet's average count as much as one additional vertex
+static const float CONE_WEIGHT = 0.5f;
+
+// Triangles searched for a meshlet that ran out of adjacent triangles, and how closely they have to face its way
+static const size_t SEARCH_WINDOW = 128;
+static const float MIN_SEARCH_DOT = 0.7f;
+
+static glm::vec3 triangleNormal(const uint32_t *triangle, const std::vector<glm::vec3> &positions, int32_t vertexOffset) {
+    glm::vec3 a = positions[vertexOffset + triangle[0]];
+    glm::vec3 b = positions[vertexOffset + triangle[1]];
+    glm::vec3 c = positions[vertexOffset + triangle[2]];
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    float length = glm::length(normal);
+    return length > 0.f ? normal / length : glm::vec3(0.f);
+}
+
+// Grows meshlets over the triangles of a sub mesh. Each meshlet starts at the first triangle not used yet, so the
+// vertex cache order is roughly kept, and grows with the adjacent triangle that adds the fewest vertices and
+// deviates least from the meshlet's normals, or a nearby triangle in cache order when none is adjacent.
+// Returns the triangles in meshlet order.
+static std::vector<uint32_t> growMeshlets(const std::vector<uint32_t> &triangles, size_t vertexCount,
+                                          const std::vector<glm::vec3> &positions, int32_t vertexOffset,
+                                          std::vector<uint32_t> &meshletSizes) {
+    size_t triangleCount = triangles.size() / 3;
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t vertex : triangles) {
+        adjacencyOffsets[vertex + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<uint32_t> adjacency(triangles.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangles.size(); i++) {
+            adjacency[fill[triangles[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<glm::vec3> normals(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        normals[t] = triangleNormal(&triangles[t * 3], positions, vertexOffset);
+    }
+
+    std::vector<bool> used(triangleCount, false);
+    std::vector<uint32_t> stamps(vertexCount, 0);
+    uint32_t stamp = 0;
+
+    std::vector<uint32_t> result;
+    result.reserve(triangles.size());
+    std::vector<uint32_t> candidates;
+
+    size_t seedCursor = 0;
+    while (true) {
+        while (seedCursor < triangleCount && used[seedCursor]) seedCursor++;
+        if (seedCursor == triangleCount) break;
+
+        stamp++;
+        uint32_t vertices = 0;
+        uint32_t meshletTriangles = 0;
+        glm::vec3 normalSum{0.f};
+        candidates.clear();
+
+        uint32_t next = static_cast<uint32_t>(seedCursor);
+        while (true) {
+            const uint32_t *triangle = &triangles[next * 3];
+            result.insert(result.end(), triangle, triangle + 3);
+            used[next] = true;
+            meshletTriangles++;
+            normalSum += normals[next];
+
+            for (int k = 0; k < 3; k++) {
+                if (stamps[triangle[k]] == stamp) continue;
+                stamps[triangle[k]] = stamp;
+                vertices++;
+                for (uint32_t i = adjacencyOffsets[triangle[k]]; i < adjacencyOffsets[triangle[k] + 1]; i++) {
+                    if (!used[adjacency[i]]) candidates.push_back(adjacency[i]);
+                }
+            }
+
+            if (meshletTriangles >= MAX_MESHLET_TRIANGLES) break;
+
+            float sumLength = glm::length(normalSum);
+            glm::vec3 axis = sumLength > 0.f ? normalSum / sumLength : glm::vec3(0.f);
+
+            // Pick the best candidate, ties go to the lowest triangle index so the result is deterministic
+            float bestScore = std::numeric_limits<float>::max();
+            uint32_t best = 0;
+            size_t kept = 0;
+            for (uint32_t candidate : candidates) {
+                if (used[candidate]) continue;
+                candidates[kept++] = candidate;
+
+                uint32_t newVertices = 0;
+                for (int k = 0; k < 3; k++) {
+                    if (stamps[triangles[candidate * 3 + k]] != stamp) newVertices++;
+                }
+                if (vertices + newVertices > MAX_MESHLET_VERTICES) continue;
+
+                float score = newVertices + CONE_WEIGHT * (1.f - glm::dot(normals[candidate], axis));
+                if (score < bestScore || (score == bestScore && candidate < best)) {
+                    bestScore = score;
+                    best = candidate;
+                }
+            }
+            candidates.resize(kept);
+
+            if (bestScore != std::numeric_limits<float>::max()) {
+                next = best;
+                continue;
+            }
+
+            // Nothing adjacent fits. Look a little further along the vertex cache order for a triangle facing the
+            // same way, so disconnected pieces like texture seams don't each start a small meshlet.
+            bool found = false;
+            size_t searched = 0;
+            for (size_t t = seedCursor; t < triangleCount && searched < SEARCH_WINDOW; t++) {
+                if (used[t]) continue;
+                searched++;
+
+                uint32_t newVertices = 0;
+                for (int k = 0; k < 3; k++) {
+                    if (stamps[triangles[t * 3 + k]] != stamp) newVertices++;
+                }
+                if (vertices + newVertices > MAX_MESHLET_VERTICES) continue;
+                if (glm::dot(normals[t], axis) < MIN_SEARCH_DOT) continue;
+
+                next = static_cast<uint32_t>(t);
+                found = true;
+                break;
+            }
+            if (!found) break;
+        }
+
+        meshletSizes.push_back(meshletTriangles * 3);
+    }
+
+    return result;
+}
+
+std::vector<Meshlet> buildMeshlets(IndexData &indexData, const std::vector<glm::vec3> &positions) {
+    WVK_PROFILE_ZONE("build meshlets");
+
+    std::vector<Meshlet> meshlets;
+
+    for (const SubMesh &subMesh : indexData.subMeshes) {
+        std::vector<uint32_t> triangles(subMesh.indexCount);
+        uint32_t vertexCount = 0;
+        for (uint32_t i = 0; i < subMesh.indexCount; i++) {
+            triangles[i] = indexData.at(subMesh.firstIndex + i);
+            vertexCount = std::max(vertexCount, triangles[i] + 1);
+        }
+
+        std::vector<uint32_t> meshletSizes;
+        triangles = growMeshlets(triangles, vertexCount, positions, subMesh.vertexOffset, meshletSizes);
+
+        // The triangles only move within the sub mesh, so its range and index width stay the same
+        for (uint32_t i = 0; i < subMesh.indexCount; i++) {
+            if (indexData.isShort()) {
+                indexData.shortIndices[subMesh.firstIndex + i] = static_cast<uint16_t>(triangles[i]);
+            } else {
+                indexData.indices[subMesh.firstIndex + i] = triangles[i];
+            }
+        }
+
+        uint32_t firstIndex = subMesh.firstIndex;
+        for (uint32_t size : meshletSizes) {
+            Meshlet meshlet{};
+            meshlet.firstIndex = firstIndex;
+            meshlet.indexCount = size;
+            meshlet.vertexOffset = subMesh.vertexOffset;
+            computeBounds(meshlet, indexData, positions);
+            meshlets.push_back(meshlet);
+
+            firstIndex += size;
+        }
+    }
+
+    return meshlets;
+}
+
+}
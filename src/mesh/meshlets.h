@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../glm.h"
+#include "index_data.h"
+
+#include <vector>
+
+namespace wvk {
+
+constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+// Consecutive triangles of a sub mesh, with bounds in the mesh's space for culling
+struct Meshlet {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+
+    glm::vec3 center{0.f};
+    float radius = 0.f;
+
+    // Normal cone. Every triangle faces away from a viewer at position p if
+    // dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius
+    glm::vec3 coneAxis{0.f, 0.f, 1.f};
+    float coneCutoff = 1.f;   // 1 if the triangles face too many directions to ever be culled
+};
+
+// Groups the triangles of each sub mesh into meshlets of at most MAX_MESHLET_VERTICES vertices and
+// MAX_MESHLET_TRIANGLES triangles, reordering the triangles within the sub mesh so every meshlet is a consecutive
+// range of the index buffer. Meshlets are grown over adjacent triangles facing similar directions, so their
+// normal cones are narrow enough to cull back-facing meshlets.
+std::vector<Meshlet> buildMeshlets(IndexData &indexData, const std::vector<glm::vec3> &positions);
+
+}
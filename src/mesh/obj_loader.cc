@@ -0,0 +1,508 @@
+#include "obj_loader.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <logger.h>
+
+#include "vertex_welder.h"
+#include "../mapped_file.h"
+#include "../cpu_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace wvk {
+
+static MeshVertex objVertex(const tinyobj::attrib_t &attrib, const tinyobj::index_t &index, int textureId) {
+    MeshVertex vertex{};
+
+    vertex.position = {
+        attrib.vertices[3 * index.vertex_index + 0],
+        attrib.vertices[3 * index.vertex_index + 1],
+        attrib.vertices[3 * index.vertex_index + 2]
+    };
+
+    vertex.tex_coord = {
+        attrib.texcoords[2 * index.texcoord_index + 0],
+        1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+    };
+
+    vertex.texture_index = textureId;
+
+    vertex.normal = {
+        attrib.normals[3 * index.normal_index + 0],
+        attrib.normals[3 * index.normal_index + 1],
+        attrib.normals[3 * index.normal_index + 2]
+    };
+
+    return vertex;
+}
+
+static MeshData buildMesh(const tinyobj::attrib_t &attrib, const std::vector<tinyobj::shape_t> &shapes, int textureId) {
+    WVK_PROFILE_ZONE("deduplicate vertices");
+
+    size_t indexCount = 0;
+    for (const auto& shape : shapes) {
+        indexCount += shape.mesh.indices.size();
+    }
+
+    MeshData mesh{};
+    mesh.indices.reserve(indexCount);
+    VertexWelder<MeshVertex> welder{indexCount};
+
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            mesh.indices.push_back(welder.weld(objVertex(attrib, index, textureId)));
+        }
+    }
+
+    mesh.vertices = welder.takeVertices();
+    return mesh;
+}
+
+/* Parallel parsing */
+
+// Smaller pieces of a file aren't worth starting a thread for
+static const size_t MIN_OBJ_CHUNK_SIZE = 1 << 20;
+
+enum ObjAttribute {
+    OBJ_POSITION,
+    OBJ_TEX_COORD,
+    OBJ_NORMAL,
+    OBJ_ATTRIBUTE_COUNT,
+};
+
+static const size_t OBJ_ATTRIBUTE_SIZES[OBJ_ATTRIBUTE_COUNT] = {3, 2, 3};
+
+struct ObjFace {
+    uint32_t firstCorner;
+    uint32_t cornerCount;
+    uint32_t attributeCounts[OBJ_ATTRIBUTE_COUNT];   // attributes of its chunk defined before the face
+};
+
+// A line aligned piece of an OBJ file. Face indices are kept as written until the attribute counts of the chunks
+// before it are known, relative indices may point into any of them.
+struct ObjChunk {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    bool supported = true;
+
+    std::vector<tinyobj::real_t> attributes[OBJ_ATTRIBUTE_COUNT];
+    std::vector<int> corners;   // v, vt and vn index of every face corner
+    std::vector<ObjFace> faces;
+    size_t attributeOffsets[OBJ_ATTRIBUTE_COUNT] = {};
+
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;   // into the chunk's vertices until they are merged
+    size_t indexOffset = 0;
+
+    // Merging the chunks' vertices
+    size_t vertexOffset = 0;                        // of the chunk's vertices among all chunks' vertices
+    std::vector<std::vector<uint32_t>> shards;      // the chunk's vertices by hash shard
+    size_t firstCount = 0;                          // vertices that aren't in an earlier chunk
+    size_t firstOffset = 0;
+};
+
+// Calls work(i) for every i below count, each on its own thread and the first one on the calling thread
+template <typename Work>
+static void forEachObjTask(size_t count, Work work) {
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for (size_t i = 1; i < count; i++) {
+        threads.emplace_back([&work, i]() { work(i); });
+    }
+    work(0);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+// Calls work(chunk) for every chunk, each on its own thread and the first one on the calling thread
+template <typename Work>
+static void forEachObjChunk(std::vector<ObjChunk> &chunks, Work work) {
+    forEachObjTask(chunks.size(), [&](size_t i) { work(chunks[i]); });
+}
+
+static bool isObjLineEnd(char c) {
+    return c == '\n' || c == '\r';
+}
+
+// Reads a face corner the way tinyobj::parseTriple does, but keeps the indices as written. Missing ones are 0.
+static void parseObjCorner(const char **token, int *corner) {
+    corner[0] = atoi(*token);
+    corner[1] = 0;
+    corner[2] = 0;
+
+    (*token) += strcspn(*token, "/ \t\r");
+    if ((*token)[0] != '/') return;
+    (*token)++;
+
+    // i/j or i/j/k, i//k skips the texture coordinate
+    if ((*token)[0] != '/') {
+        corner[1] = atoi(*token);
+        (*token) += strcspn(*token, "/ \t\r");
+        if ((*token)[0] != '/') return;
+    }
+    (*token)++;
+
+    corner[2] = atoi(*token);
+    (*token) += strcspn(*token, "/ \t\r");
+}
+
+// Parses the attributes and faces of a chunk with tinyobj's own number parsing, so every float comes out the same.
+// Lines the mesh doesn't use are skipped, lines that could make tinyobj fail mark the chunk as unsupported.
+static void parseObjChunk(ObjChunk &chunk) {
+    // tinyobj parses one NUL terminated line at a time, its parsing functions rely on that
+    std::string text(chunk.begin, chunk.end);
+    char *textEnd = &text[0] + text.size();
+
+    for (char *line = &text[0], *lineEnd = line; line < textEnd; line = lineEnd + 1) {
+        lineEnd = std::find_if(line, textEnd, isObjLineEnd);
+        if (lineEnd != textEnd) *lineEnd = '\0';
+
+        const char *token = line;
+        token += strspn(token, " \t");
+        if (token[0] == '\0' || token[0] == '#') continue;
+
+        if (token[0] == 'v' && IS_SPACE(token[1])) {
+            token += 2;
+            tinyobj::real_t x, y, z;
+            tinyobj::parseReal3(&x, &y, &z, &token);
+            chunk.attributes[OBJ_POSITION].insert(chunk.attributes[OBJ_POSITION].end(), {x, y, z});
+            continue;
+        }
+
+        if (token[0] == 'v' && token[1] == 't' && IS_SPACE(token[2])) {
+            token += 3;
+            tinyobj::real_t x, y;
+            tinyobj::parseReal2(&x, &y, &token);
+            chunk.attributes[OBJ_TEX_COORD].insert(chunk.attributes[OBJ_TEX_COORD].end(), {x, y});
+            continue;
+        }
+
+        if (token[0] == 'v' && token[1] == 'n' && IS_SPACE(token[2])) {
+            token += 3;
+            tinyobj::real_t x, y, z;
+            tinyobj::parseReal3(&x, &y, &z, &token);
+            chunk.attributes[OBJ_NORMAL].insert(chunk.attributes[OBJ_NORMAL].end(), {x, y, z});
+            continue;
+        }
+
+        // Skin weights, lines and points fail the whole file on bad indices, leave them to tinyobj
+        if ((token[0] == 'v' && token[1] == 'w' && IS_SPACE(token[2])) ||
+            ((token[0] == 'l' || token[0] == 'p') && IS_SPACE(token[1]))) {
+            chunk.supported = false;
+            return;
+        }
+
+        if (token[0] == 'f' && IS_SPACE(token[1])) {
+            token += 2;
+            token += strspn(token, " \t");
+
+            ObjFace face{};
+            face.firstCorner = static_cast<uint32_t>(chunk.corners.size() / 3);
+            for (int attribute = 0; attribute < OBJ_ATTRIBUTE_COUNT; attribute++) {
+                face.attributeCounts[attribute] =
+                    static_cast<uint32_t>(chunk.attributes[attribute].size() / OBJ_ATTRIBUTE_SIZES[attribute]);
+            }
+
+            while (!IS_NEW_LINE(token[0])) {
+                int corner[3];
+                parseObjCorner(&token, corner);
+
+                // Index 0 is an error, and tinyobj leaves missing attributes at -1 which buildMesh can't read
+                if (corner[0] == 0 || corner[1] == 0 || corner[2] == 0) {
+                    chunk.supported = false;
+                    return;
+                }
+
+                chunk.corners.insert(chunk.corners.end(), corner, corner + 3);
+                face.cornerCount++;
+                token += strspn(token, " \t\r");
+            }
+
+            chunk.faces.push_back(face);
+        }
+    }
+}
+
+// Resolves the face indices of a parsed chunk, triangulates its faces and merges identical vertices within it.
+// Returns false if a face refers to an attribute that isn't defined before it.
+static bool buildObjChunk(ObjChunk &chunk, const tinyobj::attrib_t &attrib, int textureId) {
+    VertexWelder<MeshVertex> welder{chunk.corners.size() / 3};
+    chunk.indices.reserve(chunk.corners.size() / 3);
+
+    auto addCorner = [&](const tinyobj::index_t &index) {
+        chunk.indices.push_back(welder.weld(objVertex(attrib, index, textureId)));
+    };
+
+    // Faces with more than three corners go through tinyobj's triangulation to split them the same way
+    tinyobj::PrimGroup polygons;
+    auto addPolygons = [&]() {
+        if (polygons.IsEmpty()) return;
+
+        tinyobj::shape_t shape;
+        tinyobj::exportGroupsToShape(&shape, polygons, {}, -1, "", true, attrib.vertices, nullptr);
+        for (const tinyobj::index_t &index : shape.mesh.indices) {
+            addCorner(index);
+        }
+        polygons.clear();
+    };
+
+    std::vector<tinyobj::vertex_index_t> corners;
+    for (const ObjFace &face : chunk.faces) {
+        // tinyobj skips these while triangulating
+        if (face.cornerCount < 3) continue;
+
+        corners.resize(face.cornerCount);
+        for (uint32_t i = 0; i < face.cornerCount; i++) {
+            const int *corner = &chunk.corners[3 * (face.firstCorner + i)];
+
+            int resolved[OBJ_ATTRIBUTE_COUNT];
+            for (int attribute = 0; attribute < OBJ_ATTRIBUTE_COUNT; attribute++) {
+                int64_t defined = static_cast<int64_t>(chunk.attributeOffsets[attribute] + face.attributeCounts[attribute]);
+                int64_t index = corner[attribute] > 0 ? corner[attribute] - 1 : defined + corner[attribute];
+                if (index < 0 || index >= defined) return false;
+                resolved[attribute] = static_cast<int>(index);
+            }
+            corners[i] = {resolved[OBJ_POSITION], resolved[OBJ_TEX_COORD], resolved[OBJ_NORMAL]};
+        }
+
+        if (face.cornerCount > 3) {
+            polygons.faceGroup.emplace_back();
+            polygons.faceGroup.back().vertex_indices = corners;
+            continue;
+        }
+
+        addPolygons();
+        for (const tinyobj::vertex_index_t &corner : corners) {
+            tinyobj::index_t index;
+            index.vertex_index = corner.v_idx;
+            index.texcoord_index = corner.vt_idx;
+            index.normal_index = corner.vn_idx;
+            addCorner(index);
+        }
+    }
+    addPolygons();
+
+    chunk.vertices = welder.takeVertices();
+    return true;
+}
+
+// Welds the chunks' vertices into the mesh, with indices in the same first use order as welding every corner in turn.
+// Each thread welds the vertices of one hash shard in file order, which finds the first occurrence of every vertex.
+// The first occurrences are then numbered in file order from a prefix sum over the chunks.
+static void mergeObjChunks(std::vector<ObjChunk> &chunks, MeshData &mesh) {
+    WVK_PROFILE_ZONE("merge chunks");
+
+    if (chunks.size() == 1) {
+        mesh.vertices = std::move(chunks[0].vertices);
+        mesh.indices = std::move(chunks[0].indices);
+        return;
+    }
+
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    for (ObjChunk &chunk : chunks) {
+        chunk.vertexOffset = vertexCount;
+        chunk.indexOffset = indexCount;
+        vertexCount += chunk.vertices.size();
+        indexCount += chunk.indices.size();
+    }
+
+    // The high bits of the hash, the welders' tables are indexed by the low ones
+    size_t shardCount = chunks.size();
+    forEachObjChunk(chunks, [&](ObjChunk &chunk) {
+        chunk.shards.resize(shardCount);
+        for (uint32_t vertex = 0; vertex < chunk.vertices.size(); vertex++) {
+            uint64_t hash = std::hash<MeshVertex>{}(chunk.vertices[vertex]);
+            chunk.shards[(hash >> 32) % shardCount].push_back(vertex);
+        }
+    });
+
+    // Position among all chunks' vertices of the first occurrence of each vertex
+    std::vector<uint32_t> firstOccurrences(vertexCount);
+    forEachObjTask(shardCount, [&](size_t shard) {
+        size_t shardVertexCount = 0;
+        for (const ObjChunk &chunk : chunks) {
+            shardVertexCount += chunk.shards[shard].size();
+        }
+
+        VertexWelder<MeshVertex> welder{shardVertexCount};
+        std::vector<uint32_t> firsts;
+        for (const ObjChunk &chunk : chunks) {
+            for (uint32_t vertex : chunk.shards[shard]) {
+                uint32_t position = static_cast<uint32_t>(chunk.vertexOffset + vertex);
+                uint32_t welded = welder.weld(chunk.vertices[vertex]);
+                if (welded == firsts.size()) firsts.push_back(position);
+                firstOccurrences[position] = firsts[welded];
+            }
+        }
+    });
+
+    forEachObjChunk(chunks, [&](ObjChunk &chunk) {
+        for (size_t vertex = 0; vertex < chunk.vertices.size(); vertex++) {
+            chunk.firstCount += firstOccurrences[chunk.vertexOffset + vertex] == chunk.vertexOffset + vertex;
+        }
+    });
+    size_t firstCount = 0;
+    for (ObjChunk &chunk : chunks) {
+        chunk.firstOffset = firstCount;
+        firstCount += chunk.firstCount;
+    }
+
+    // Mesh index of each first occurrence
+    std::vector<uint32_t> meshIndices(vertexCount);
+    mesh.vertices.resize(firstCount);
+    forEachObjChunk(chunks, [&](ObjChunk &chunk) {
+        size_t first = chunk.firstOffset;
+        for (size_t vertex = 0; vertex < chunk.vertices.size(); vertex++) {
+            size_t position = chunk.vertexOffset + vertex;
+            if (firstOccurrences[position] != position) continue;
+
+            meshIndices[position] = static_cast<uint32_t>(first);
+            mesh.vertices[first++] = chunk.vertices[vertex];
+        }
+    });
+
+    mesh.indices.resize(indexCount);
+    forEachObjChunk(chunks, [&](ObjChunk &chunk) {
+        for (size_t i = 0; i < chunk.indices.size(); i++) {
+            mesh.indices[chunk.indexOffset + i] = meshIndices[firstOccurrences[chunk.vertexOffset + chunk.indices[i]]];
+        }
+    });
+}
+
+// Splits the text into line aligned chunks and parses them on worker threads. Vertices are welded per chunk first,
+// then the chunks' distinct vertices are welded across chunks, see mergeObjChunks. Returns false for files using
+// anything the serial loader has to handle.
+static bool loadObjMeshParallel(const char *text, size_t size, int textureId, MeshData &mesh,
+                                uint32_t threadCount = 0) {
+    WVK_PROFILE_ZONE("parse obj parallel");
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / MIN_OBJ_CHUNK_SIZE));
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char *end = text + size;
+    const char *chunkBegin = text;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char *chunkEnd = i + 1 == chunkCount ? end : text + size * (i + 1) / chunkCount;
+        chunkEnd = std::max(chunkEnd, chunkBegin);
+        chunkEnd = std::find_if(chunkEnd, end, isObjLineEnd);
+        if (chunkEnd != end) chunkEnd++;
+
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    {
+        WVK_PROFILE_ZONE("parse chunks");
+        forEachObjChunk(chunks, parseObjChunk);
+    }
+
+    size_t attributeCounts[OBJ_ATTRIBUTE_COUNT] = {};
+    for (ObjChunk &chunk : chunks) {
+        if (!chunk.supported) return false;
+
+        for (int attribute = 0; attribute < OBJ_ATTRIBUTE_COUNT; attribute++) {
+            chunk.attributeOffsets[attribute] = attributeCounts[attribute];
+            attributeCounts[attribute] += chunk.attributes[attribute].size() / OBJ_ATTRIBUTE_SIZES[attribute];
+        }
+    }
+    if (attributeCounts[OBJ_POSITION] > INT32_MAX || attributeCounts[OBJ_TEX_COORD] > INT32_MAX ||
+        attributeCounts[OBJ_NORMAL] > INT32_MAX) {
+        return false;
+    }
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::real_t> *merged[OBJ_ATTRIBUTE_COUNT] = {&attrib.vertices, &attrib.texcoords, &attrib.normals};
+    for (int attribute = 0; attribute < OBJ_ATTRIBUTE_COUNT; attribute++) {
+        merged[attribute]->resize(attributeCounts[attribute] * OBJ_ATTRIBUTE_SIZES[attribute]);
+    }
+
+    std::atomic<bool> supported{true};
+    {
+        WVK_PROFILE_ZONE("build chunks");
+
+        forEachObjChunk(chunks, [&](ObjChunk &chunk) {
+            for (int attribute = 0; attribute < OBJ_ATTRIBUTE_COUNT; attribute++) {
+                std::copy(chunk.attributes[attribute].begin(), chunk.attributes[attribute].end(),
+                          merged[attribute]->begin() + chunk.attributeOffsets[attribute] * OBJ_ATTRIBUTE_SIZES[attribute]);
+            }
+        });
+
+        forEachObjChunk(chunks, [&](ObjChunk &chunk) {
+            if (!buildObjChunk(chunk, attrib, textureId)) supported = false;
+        });
+    }
+    if (!supported) return false;
+
+    mergeObjChunks(chunks, mesh);
+    return true;
+}
+
+MeshData loadObjMesh(const std::string &path, int textureId) {
+    MappedFile file;
+    if (file.open(path)) {
+        MeshData mesh{};
+        if (loadObjMeshParallel(reinterpret_cast<const char *>(file.getData()), file.getSize(), textureId, mesh)) {
+            return mesh;
+        }
+    }
+
+    WVK_PROFILE_ZONE("parse obj");
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str())) {
+        throw std::runtime_error(warn + "\n" + err);
+    }
+
+    if (warn.size() > 0) {
+        logger::debug(warn);
+    }
+
+    return buildMesh(attrib, shapes, textureId);
+}
+
+MeshData loadObjMesh(std::istream &stream, int textureId) {
+    WVK_PROFILE_ZONE("parse obj");
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream)) {
+        throw std::runtime_error(warn + "\n" + err);
+    }
+
+    if (warn.size() > 0) {
+        logger::debug(warn);
+    }
+
+    return buildMesh(attrib, shapes, textureId);
+}
+
+MeshData loadObjMesh(const char *text, size_t size, int textureId, uint32_t threadCount) {
+    MeshData mesh{};
+    if (loadObjMeshParallel(text, size, textureId, mesh, threadCount)) {
+        return mesh;
+    }
+
+    std::istringstream stream{std::string(text, size)};
+    return loadObjMesh(stream, textureId);
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "mesh_data.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+
+namespace wvk {
+
+// Parses an OBJ file and merges identical vertices. Throws std::runtime_error if the file can't be parsed.
+// Large files are parsed on worker threads, see below.
+MeshData loadObjMesh(const std::string &path, int textureId);
+
+// Same as above, reading OBJ text from a stream. Material libraries are not resolved.
+MeshData loadObjMesh(std::istream &stream, int textureId);
+
+// Same as above, reading OBJ text from memory. The text is split into line aligned chunks of at least 1 MB that are
+// parsed on up to threadCount threads, 0 uses every hardware thread. The result is identical to the stream loader's.
+// Files with lines, points, skin weights, invalid indices, or faces missing texture coordinates or normals are
+// parsed serially.
+MeshData loadObjMesh(const char *text, size_t size, int textureId, uint32_t threadCount = 0);
+
+}
@@ -0,0 +1,374 @@
+#include "simplifier.h"
+
+#include "mesh_optimizer.h"
+#include "../cpu_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace wvk {
+
+// Open border edges keep their shape through a plane perpendicular to the surface, weighted above the surface planes
+static const double BORDER_WEIGHT = 10.0;
+
+// Stop a LOD chain when a level removes less than this fraction of the previous level's triangles
+static const float MIN_LOD_REDUCTION = 0.2f;
+static const size_t MIN_LOD_TRIANGLES = 16;
+// LODs that move the surface further than this fraction of the mesh's size look too different to be useful
+static const float MAX_LOD_ERROR = 0.05f;
+
+/* Quadrics */
+
+// Sum of squared distances to a set of weighted planes, stored as the upper half of a symmetric 4x4 matrix
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+    double weight = 0;
+
+    static Quadric fromPlane(glm::dvec3 normal, double distance, double weight) {
+        Quadric q{};
+        q.a00 = weight * normal.x * normal.x;
+        q.a01 = weight * normal.x * normal.y;
+        q.a02 = weight * normal.x * normal.z;
+        q.a03 = weight * normal.x * distance;
+        q.a11 = weight * normal.y * normal.y;
+        q.a12 = weight * normal.y * normal.z;
+        q.a13 = weight * normal.y * distance;
+        q.a22 = weight * normal.z * normal.z;
+        q.a23 = weight * normal.z * distance;
+        q.a33 = weight * distance * distance;
+        q.weight = weight;
+        return q;
+    }
+
+    Quadric &operator+=(const Quadric &o) {
+        a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+        a11 += o.a11; a12 += o.a12; a13 += o.a13;
+        a22 += o.a22; a23 += o.a23;
+        a33 += o.a33;
+        weight += o.weight;
+        return *this;
+    }
+
+    // Weighted average squared distance of p to the planes
+    double error(glm::dvec3 p) const {
+        double e = a00 * p.x * p.x + 2 * a01 * p.x * p.y + 2 * a02 * p.x * p.z + 2 * a03 * p.x
+                 + a11 * p.y * p.y + 2 * a12 * p.y * p.z + 2 * a13 * p.y
+                 + a22 * p.z * p.z + 2 * a23 * p.z
+                 + a33;
+        return weight > 0 ? std::fabs(e) / weight : 0;
+    }
+};
+
+/* Vertex classification */
+
+enum VertexKind : uint8_t {
+    VERTEX_MANIFOLD,  // interior vertex, collapses onto any neighbour
+    VERTEX_BORDER,    // on an open edge, only collapses along it
+    VERTEX_LOCKED,    // shares its position with other vertices (a seam), never moves
+};
+
+static uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+// Vertices with identical positions map to the lowest of them
+static std::vector<uint32_t> positionRemap(const std::vector<glm::vec3> &positions) {
+    std::vector<uint32_t> order(positions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&positions](uint32_t a, uint32_t b) {
+        const glm::vec3 &pa = positions[a], &pb = positions[b];
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        if (pa.z != pb.z) return pa.z < pb.z;
+        return a < b;
+    });
+
+    std::vector<uint32_t> remap(positions.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        bool same = i > 0 && positions[order[i]] == positions[order[i - 1]];
+        remap[order[i]] = same ? remap[order[i - 1]] : order[i];
+    }
+    return remap;
+}
+
+// Sorted directed edges of a triangle list, between position groups
+static std::vector<uint64_t> directedEdges(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &remap) {
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            edges.push_back(edgeKey(remap[indices[i + k]], remap[indices[i + (k + 1) % 3]]));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    return edges;
+}
+
+static bool hasEdge(const std::vector<uint64_t> &edges, uint32_t a, uint32_t b) {
+    return std::binary_search(edges.begin(), edges.end(), edgeKey(a, b));
+}
+
+/* Simplification */
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+static const double NO_COLLAPSE = std::numeric_limits<double>::max();
+
+// True if moving from onto to turns any triangle around from upside down
+static bool flipsTriangle(uint32_t from, uint32_t to, const std::vector<uint32_t> &indices,
+                          const std::vector<uint32_t> &triangles, const std::vector<glm::vec3> &positions) {
+    for (uint32_t t : triangles) {
+        const uint32_t *triangle = &indices[t * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) continue;
+
+        glm::vec3 corners[3] = {positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]};
+        glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+        for (int k = 0; k < 3; k++) {
+            if (triangle[k] == from) corners[k] = positions[to];
+        }
+        glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+        if (glm::dot(before, after) <= 0.f) return true;
+    }
+    return false;
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions,
+                                   size_t targetIndexCount, float maxError, float &error) {
+    WVK_PROFILE_ZONE("simplify mesh");
+
+    std::vector<uint32_t> result = indices;
+    error = 0.f;
+
+    size_t vertexCount = positions.size();
+    std::vector<uint32_t> remap = positionRemap(positions);
+
+    std::vector<uint32_t> groupSizes(vertexCount, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        groupSizes[remap[v]]++;
+    }
+
+    // Borders are edges without a twin going the other way
+    std::vector<uint64_t> edges = directedEdges(result, remap);
+    std::vector<VertexKind> kinds(vertexCount, VERTEX_MANIFOLD);
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (size_t i = 0; i < result.size(); i += 3) {
+        glm::dvec3 p0 = positions[result[i]], p1 = positions[result[i + 1]], p2 = positions[result[i + 2]];
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double area = glm::length(normal);
+        if (area == 0) continue;
+        normal /= area;
+
+        Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), area);
+        for (int k = 0; k < 3; k++) {
+            quadrics[result[i + k]] += plane;
+        }
+
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+            if (hasEdge(edges, remap[b], remap[a])) continue;
+
+            glm::dvec3 pa = positions[a], pb = positions[b];
+            glm::dvec3 edge = pb - pa;
+            double length = glm::length(edge);
+            if (length == 0) continue;
+
+            glm::dvec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+            Quadric border = Quadric::fromPlane(borderNormal, -glm::dot(borderNormal, pa), length * length * BORDER_WEIGHT);
+            quadrics[a] += border;
+            quadrics[b] += border;
+            if (kinds[a] == VERTEX_MANIFOLD) kinds[a] = VERTEX_BORDER;
+            if (kinds[b] == VERTEX_MANIFOLD) kinds[b] = VERTEX_BORDER;
+        }
+    }
+
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (groupSizes[remap[v]] > 1) kinds[v] = VERTEX_LOCKED;
+    }
+
+    double maxSquaredError = static_cast<double>(maxError) * maxError;
+    std::vector<uint32_t> collapsedTo(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<Collapse> collapses;
+    std::vector<Collapse> bestCollapses(vertexCount);
+
+    while (result.size() > targetIndexCount) {
+        size_t triangleCount = result.size() / 3;
+
+        // Triangles around each vertex
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t v : result) adjacencyOffsets[v + 1]++;
+        for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        std::vector<uint32_t> adjacency(result.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        edges = directedEdges(result, remap);
+
+        // The cheapest collapse of each vertex, ties go to the lower target
+        std::fill(bestCollapses.begin(), bestCollapses.end(), Collapse{0, 0, NO_COLLAPSE});
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+                for (int direction = 0; direction < 2; direction++) {
+                    uint32_t from = direction == 0 ? a : b;
+                    uint32_t to = direction == 0 ? b : a;
+
+                    if (kinds[from] == VERTEX_LOCKED) continue;
+                    if (kinds[from] == VERTEX_BORDER) {
+                        // Only along the border, which is an edge without a twin
+                        bool forward = hasEdge(edges, remap[from], remap[to]);
+                        bool backward = hasEdge(edges, remap[to], remap[from]);
+                        if (forward == backward || kinds[to] == VERTEX_MANIFOLD) continue;
+                    }
+
+                    Quadric combined = quadrics[from];
+                    combined += quadrics[to];
+                    double error = combined.error(positions[to]);
+
+                    Collapse &best = bestCollapses[from];
+                    if (error < best.error || (error == best.error && to < best.to)) {
+                        best = {from, to, error};
+                    }
+                }
+            }
+        }
+
+        collapses.clear();
+        for (const Collapse &collapse : bestCollapses) {
+            if (collapse.error != NO_COLLAPSE) collapses.push_back(collapse);
+        }
+
+        // Cheapest collapses first, ties broken by the vertices so the result is deterministic
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            if (a.error != b.error) return a.error < b.error;
+            if (a.from != b.from) return a.from < b.from;
+            return a.to < b.to;
+        });
+
+        std::iota(collapsedTo.begin(), collapsedTo.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+
+        // Each collapse removes about two triangles, stop once the target is reached
+        size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+        size_t removed = 0;
+        double passError = 0;
+
+        for (const Collapse &collapse : collapses) {
+            if (removed >= trianglesToRemove) break;
+            if (collapse.error > maxSquaredError) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            uint32_t begin = adjacencyOffsets[collapse.from], end = adjacencyOffsets[collapse.from + 1];
+            std::vector<uint32_t> around(adjacency.begin() + begin, adjacency.begin() + end);
+            if (flipsTriangle(collapse.from, collapse.to, result, around, positions)) continue;
+
+            collapsedTo[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            passError = std::max(passError, collapse.error);
+
+            // Neither vertex moves again this pass. Neighbours may, which can leave a flip test slightly stale,
+            // but locking the whole ring would need many more passes.
+            touched[collapse.from] = true;
+            touched[collapse.to] = true;
+            for (uint32_t t : around) {
+                if (result[t * 3 + 0] == collapse.to || result[t * 3 + 1] == collapse.to ||
+                    result[t * 3 + 2] == collapse.to) {
+                    removed++;
+                }
+            }
+        }
+
+        if (removed == 0) break;
+        error = std::max(error, static_cast<float>(std::sqrt(passError)));
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = collapsedTo[result[i]], b = collapsedTo[result[i + 1]], c = collapsedTo[result[i + 2]];
+            if (a == b || b == c || a == c) continue;
+
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    return result;
+}
+
+std::vector<MeshLod> generateLods(const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions) {
+    WVK_PROFILE_ZONE("generate lods");
+
+    std::vector<MeshLod> lods;
+    lods.reserve(MAX_MESH_LODS);
+
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+    for (uint32_t index : indices) {
+        min = glm::min(min, positions[index]);
+        max = glm::max(max, positions[index]);
+    }
+    float maxError = indices.empty() ? 0.f : MAX_LOD_ERROR * glm::length(max - min);
+
+    const std::vector<uint32_t> *previous = &indices;
+    float previousError = 0.f;
+    for (uint32_t level = 1; level < MAX_MESH_LODS; level++) {
+        size_t previousTriangles = previous->size() / 3;
+        if (previousTriangles < MIN_LOD_TRIANGLES || previousError >= maxError) break;
+
+        // Each level simplifies the one before it, so errors add up along the chain
+        MeshLod lod{};
+        float error = 0.f;
+        lod.indices = simplifyMesh(*previous, positions, (previousTriangles / 2) * 3,
+                                   maxError - previousError, error);
+        lod.error = previousError + error;
+
+        size_t triangles = lod.indices.size() / 3;
+        if (triangles > previousTriangles * (1.f - MIN_LOD_REDUCTION)) break;
+
+        optimizeVertexCache(lod.indices, positions.size());
+
+        lods.push_back(std::move(lod));
+        previous = &lods.back().indices;
+        previousError = lods.back().error;
+    }
+
+    return lods;
+}
+
+std::vector<LodRange> appendLods(IndexData &indexData, const std::vector<MeshLod> &lods) {
+    std::vector<LodRange> ranges;
+    if (lods.empty()) return ranges;
+    if (indexData.subMeshes.size() != 1 || indexData.subMeshes[0].vertexOffset != 0) return ranges;
+
+    for (const MeshLod &lod : lods) {
+        LodRange range{};
+        range.firstIndex = indexData.indexCount();
+        range.indexCount = static_cast<uint32_t>(lod.indices.size());
+        range.error = lod.error;
+
+        if (indexData.isShort()) {
+            indexData.shortIndices.insert(indexData.shortIndices.end(), lod.indices.begin(), lod.indices.end());
+        } else {
+            indexData.indices.insert(indexData.indices.end(), lod.indices.begin(), lod.indices.end());
+        }
+        ranges.push_back(range);
+    }
+
+    return ranges;
+}
+
+}
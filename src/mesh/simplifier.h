@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../glm.h"
+#include "index_data.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace wvk {
+
+constexpr uint32_t MAX_MESH_LODS = 5; // including the full detail mesh
+
+// A simplified version of a mesh, indexing the same vertices as the full mesh
+struct MeshLod {
+    std::vector<uint32_t> indices;
+    // Summed over the chain up to this LOD, the square root of the largest quadric error of a collapse: the root
+    // mean square distance of the moved vertex to the planes of its original triangles, in the mesh's units. It
+    // estimates how far the surface moved, it doesn't bound the distance to the full detail surface.
+    float error = 0.f;
+};
+
+// Simplifies a triangle list with quadric error metrics until it has at most targetIndexCount indices or no edge
+// can be collapsed with an error of at most maxError. Edges are collapsed onto one of their vertices,
+// so the result only references existing vertices and their attributes (skin weights included) stay valid.
+// Vertices on texture or normal seams don't move and open borders only move along themselves, so no cracks open.
+// error is set to the square root of the largest quadric error of a collapse, see MeshLod::error, and maxError is
+// compared in the same units.
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions,
+                                   size_t targetIndexCount, float maxError, float &error);
+
+// Chain of LODs, each with about half the triangles of the previous one. The chain ends early once a mesh doesn't
+// simplify further. The full detail mesh is not included.
+std::vector<MeshLod> generateLods(const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions);
+
+// Range of an index buffer drawing one LOD with the full detail mesh's vertices
+struct LodRange {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.f;   // MeshLod::error, what selectLod projects to pixels
+};
+
+// Appends the LODs after the full detail mesh and returns their ranges, in order. LODs index the vertices of the
+// mesh they were generated from, so they are only appended to meshes drawn as one sub mesh without a vertex offset,
+// otherwise no ranges are returned.
+std::vector<LodRange> appendLods(IndexData &indexData, const std::vector<MeshLod> &lods);
+
+}
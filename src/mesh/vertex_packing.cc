@@ -0,0 +1,98 @@
+#include "vertex_packing.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+
+namespace wvk {
+
+Quantization positionQuantization(const Bounds &bounds) {
+    Quantization quantization{};
+    if (!bounds.valid()) return quantization;
+
+    // Flat axes still need a non-zero scale
+    quantization.offset = bounds.min;
+    quantization.scale = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+    return quantization;
+}
+
+void quantizePosition(glm::vec3 position, const Quantization &quantization, uint16_t out[4]) {
+    glm::vec3 normalized = glm::clamp((position - quantization.offset) / quantization.scale, 0.f, 1.f);
+    for (int i = 0; i < 3; i++) {
+        out[i] = glm::packUnorm1x16(normalized[i]);
+    }
+    out[3] = 0;
+}
+
+glm::vec3 dequantizePosition(const uint16_t position[4], const Quantization &quantization) {
+    glm::vec3 normalized{glm::unpackUnorm1x16(position[0]), glm::unpackUnorm1x16(position[1]), glm::unpackUnorm1x16(position[2])};
+    return quantization.offset + quantization.scale * normalized;
+}
+
+void encodeOctahedral(glm::vec3 normal, int16_t out[2]) {
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length == 0.f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    // Project onto the octahedron, then fold the lower half over the diagonals
+    glm::vec2 p = glm::vec2(normal) / length;
+    if (normal.z < 0.f) {
+        glm::vec2 sign{p.x >= 0.f ? 1.f : -1.f, p.y >= 0.f ? 1.f : -1.f};
+        p = (1.f - glm::abs(glm::vec2(p.y, p.x))) * sign;
+    }
+
+    out[0] = static_cast<int16_t>(glm::packSnorm1x16(p.x));
+    out[1] = static_cast<int16_t>(glm::packSnorm1x16(p.y));
+}
+
+glm::vec3 decodeOctahedral(const int16_t encoded[2]) {
+    glm::vec2 p{glm::unpackSnorm1x16(static_cast<uint16_t>(encoded[0])), glm::unpackSnorm1x16(static_cast<uint16_t>(encoded[1]))};
+
+    glm::vec3 normal{p, 1.f - std::abs(p.x) - std::abs(p.y)};
+    float t = std::max(-normal.z, 0.f);
+    normal.x += normal.x >= 0.f ? -t : t;
+    normal.y += normal.y >= 0.f ? -t : t;
+    return glm::normalize(normal);
+}
+
+PackedVertex packVertex(const MeshVertex &vertex, const Quantization &quantization) {
+    PackedVertex packed{};
+    quantizePosition(vertex.position, quantization, packed.position);
+    encodeOctahedral(vertex.normal, packed.normal);
+    packed.texCoord[0] = glm::packHalf1x16(vertex.tex_coord.x);
+    packed.texCoord[1] = glm::packHalf1x16(vertex.tex_coord.y);
+    return packed;
+}
+
+PackedRiggedVertex packVertex(const RiggedMeshVertex &vertex, const Quantization &quantization) {
+    PackedRiggedVertex packed{};
+    quantizePosition(vertex.position, quantization, packed.position);
+    encodeOctahedral(vertex.normal, packed.normal);
+    packed.texCoord[0] = glm::packHalf1x16(vertex.tex_coord.x);
+    packed.texCoord[1] = glm::packHalf1x16(vertex.tex_coord.y);
+    packed.joints[0] = vertex.joint1;
+    packed.joints[1] = vertex.joint2;
+    packed.weights[0] = glm::packUnorm1x16(vertex.weight1);
+    packed.weights[1] = glm::packUnorm1x16(vertex.weight2);
+    return packed;
+}
+
+std::vector<PackedVertex> packVertices(const std::vector<MeshVertex> &vertices, const Quantization &quantization) {
+    std::vector<PackedVertex> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        packed[i] = packVertex(vertices[i], quantization);
+    }
+    return packed;
+}
+
+std::vector<PackedRiggedVertex> packVertices(const std::vector<RiggedMeshVertex> &vertices, const Quantization &quantization) {
+    std::vector<PackedRiggedVertex> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        packed[i] = packVertex(vertices[i], quantization);
+    }
+    return packed;
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../wvk_vertex_attributes.h"
+#include "../bounds.h"
+
+#include <vector>
+
+namespace wvk {
+
+// Maps 16 bit normalized positions back to the mesh's space: position = offset + scale * normalized
+struct Quantization {
+    glm::vec3 offset{0.f};
+    glm::vec3 scale{1.f};
+};
+
+// Quantization covering the bounds, with the full 16 bit range on each axis
+Quantization positionQuantization(const Bounds &bounds);
+
+void quantizePosition(glm::vec3 position, const Quantization &quantization, uint16_t out[4]);
+glm::vec3 dequantizePosition(const uint16_t position[4], const Quantization &quantization);
+
+// Octahedral encoding, the normal doesn't need to be normalized
+void encodeOctahedral(glm::vec3 normal, int16_t out[2]);
+glm::vec3 decodeOctahedral(const int16_t encoded[2]);
+
+PackedVertex packVertex(const MeshVertex &vertex, const Quantization &quantization);
+PackedRiggedVertex packVertex(const RiggedMeshVertex &vertex, const Quantization &quantization);
+
+std::vector<PackedVertex> packVertices(const std::vector<MeshVertex> &vertices, const Quantization &quantization);
+std::vector<PackedRiggedVertex> packVertices(const std::vector<RiggedMeshVertex> &vertices, const Quantization &quantization);
+
+}
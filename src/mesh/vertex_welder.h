@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace wvk {
+
+// Merges identical vertices while a mesh is imported, handing out the index of each distinct vertex.
+// Vertices are found through an open addressing table of (hash, index) slots with linear probing, so a lookup
+// usually touches one cache line and only compares whole vertices when the hashes match. Vertex needs operator==
+// and a std::hash specialization covering every attribute compared by it.
+template <typename Vertex>
+class VertexWelder {
+  public:
+    // maxVertices is an estimate of the distinct vertices, the index count is a safe upper bound
+    explicit VertexWelder(size_t maxVertices) {
+        vertices.reserve(maxVertices);
+        resize(maxVertices);
+    }
+
+    // Index of the vertex, added to the vertices if no identical one was added before
+    uint32_t weld(const Vertex &vertex) {
+        size_t hash = std::hash<Vertex>{}(vertex);
+        uint32_t tag = tagOf(hash);
+
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            Slot &entry = slots[slot];
+            if (entry.index == EMPTY) {
+                if ((vertices.size() + 1) * 2 > slots.size()) {
+                    // Doubles the table to keep it at most half full, which invalidates the slot found above
+                    resize(slots.size());
+                    return weld(vertex);
+                }
+
+                entry = {tag, static_cast<uint32_t>(vertices.size())};
+                vertices.push_back(vertex);
+                return entry.index;
+            }
+            if (entry.tag == tag && vertices[entry.index] == vertex) {
+                return entry.index;
+            }
+        }
+    }
+
+    size_t getVertexCount() const { return vertices.size(); }
+
+    // The distinct vertices in the order they were first welded, the welder is empty afterwards
+    std::vector<Vertex> takeVertices() {
+        std::vector<Vertex> result = std::move(vertices);
+        vertices.clear();
+        std::fill(slots.begin(), slots.end(), Slot{0, EMPTY});
+        return result;
+    }
+
+  private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    struct Slot {
+        uint32_t tag;
+        uint32_t index;
+    };
+
+    // Compared before the vertices, the slot already matches the low bits of the hash
+    static uint32_t tagOf(size_t hash) {
+        uint64_t wide = hash;
+        return static_cast<uint32_t>(wide >> 32) ^ static_cast<uint32_t>(wide);
+    }
+
+    // Sizes the table to the smallest power of two of at least twice vertexCount slots, and reinserts the vertices
+    void resize(size_t vertexCount) {
+        size_t capacity = 16;
+        while (capacity < vertexCount * 2) capacity *= 2;
+
+        slots.assign(capacity, Slot{0, EMPTY});
+        mask = capacity - 1;
+
+        for (uint32_t index = 0; index < vertices.size(); index++) {
+            size_t hash = std::hash<Vertex>{}(vertices[index]);
+            uint32_t tag = tagOf(hash);
+
+            size_t slot = hash & mask;
+            while (slots[slot].index != EMPTY) slot = (slot + 1) & mask;
+            slots[slot] = {tag, index};
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    std::vector<Vertex> vertices;
+};
+
+}
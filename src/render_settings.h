@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+namespace wvk {
+
+// Performance settings that can be changed while the application is running
+struct RenderSettings {
+    bool showOverlay = true;
+    bool limitFrameRate = true; // sleep to ~60fps after each frame
+    bool renderShadows = true;
+    bool depthPrepass = false;  // lay down depth first, so the main pass shades each pixel once
+    bool clusterCulling = true; // cull off-screen meshlets of the camera passes on the CPU, and back-facing ones if
+                                // the mesh pipelines cull back faces
+    bool lodSelection = true;   // draw distant objects with simplified LODs in the camera passes
+    bool gpuProfiling = true;
+    int textureBudgetMB = 256;  // device memory for streamed texture mip levels, the coarse levels may exceed it
+};
+
+// Counters accumulated while recording a frame
+struct FrameStats {
+    uint32_t drawCalls = 0;
+    uint64_t triangles = 0;
+    uint32_t instances = 0;
+
+    uint32_t culledObjects = 0;
+    uint32_t visibleObjects = 0;
+
+    uint32_t visibleMeshlets = 0;
+    uint32_t culledMeshlets = 0;
+    uint32_t simplifiedInstances = 0; // instances drawn with a LOD other than the full detail mesh
+
+    uint32_t uploadQueueDepth = 0;
+    uint64_t residentTextureBytes = 0;
+    uint32_t streamingTextures = 0;    // textures with mip levels being streamed in or out
+
+    uint32_t shadowCascadesRedrawn = 0;    // cascades whose static caster cache was redrawn
+    uint32_t shadowCascadesComposited = 0; // cascades that copied the cache and redrew dynamic casters
+
+    void recordDraw(uint32_t indexCount, uint32_t instanceCount) {
+        drawCalls++;
+        triangles += static_cast<uint64_t>(indexCount / 3) * instanceCount;
+        instances += instanceCount;
+    }
+};
+
+}
@@ -1,16 +1,24 @@
 #version 450
 
 #define MAX_TEXTURES 2
+#define MAX_CASCADES 4
 
 layout(location = 0) in vec2 texCoord;
 layout(location = 1) flat in uint textureIndex;
-layout(location = 2) in vec4 lightPosition;
+layout(location = 2) in float viewDepth;
 layout(location = 3) in vec3 vertNormal;
 layout(location = 4) in vec3 worldPosition;
 
 layout(binding = 1) uniform texture2D textures[MAX_TEXTURES];
 layout(binding = 2) uniform sampler texSampler;
-layout(binding = 3) uniform sampler2D depthSampler;
+layout(binding = 3) uniform sampler2DArray depthSampler;
+
+layout(binding = 4) uniform ShadowData {
+    mat4 viewProjection[MAX_CASCADES];
+    vec4 splits;       // far view space depth of each cascade
+    vec4 uvScale;      // fraction of the layer each cascade renders to
+    uint cascadeCount;
+} shadowData;
 
 layout(location = 0) out vec4 outColor;
 
@@ -25,20 +33,29 @@ void main() {
 
     float shadow = 0.0;
 
-    vec3 projCoords = lightPosition.xyz / lightPosition.w;
-    vec2 depthTexCoords = projCoords.xy * 0.5 + 0.5;
-    if ( (depthTexCoords.x >= 0.0 && depthTexCoords.x <= 1.0) && (depthTexCoords.y >= 0.0 && depthTexCoords.y <= 1.0) )  {
-        vec4 depthColor = texture(depthSampler, depthTexCoords);
-        float lightDepth = depthColor.r;
-        float fragDepth = projCoords.z;
+    // Pick the first cascade that reaches this fragment, beyond the last one nothing is shadowed
+    uint cascade = shadowData.cascadeCount;
+    for (uint i = 0; i < shadowData.cascadeCount; i++) {
+        if (viewDepth < shadowData.splits[i]) {
+            cascade = i;
+            break;
+        }
+    }
+
+    if (cascade < shadowData.cascadeCount) {
+        vec4 lightPosition = shadowData.viewProjection[cascade] * vec4(worldPosition, 1.0);
+        vec3 projCoords = lightPosition.xyz / lightPosition.w;
+        vec2 depthTexCoords = projCoords.xy * 0.5 + 0.5;
+
+        if ( (depthTexCoords.x >= 0.0 && depthTexCoords.x <= 1.0) && (depthTexCoords.y >= 0.0 && depthTexCoords.y <= 1.0) )  {
+            float lightDepth = texture(depthSampler, vec3(depthTexCoords * shadowData.uvScale[cascade], cascade)).r;
+            float fragDepth = projCoords.z;
 
-        if (fragDepth - 0.01 > lightDepth) {
-            // We are in shadow
-            shadow = 1.0;
+            if (fragDepth - 0.002 > lightDepth) {
+                // We are in shadow
+                shadow = 1.0;
+            }
         }
-    } else {
-        // Tex coordinates are outside outside of depth map. Assume we are not in shadow
-        shadow = 0.0;
     }
 
     /* === LIGHTING CALCULATIONS === */
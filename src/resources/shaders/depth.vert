@@ -0,0 +1,28 @@
+#version 450
+
+layout(binding = 0) uniform CameraTransform {
+    mat4 view;
+    mat4 proj;
+} camera;
+
+// Per draw data, the packed positions are dequantized with positionOffset + positionScale * position
+layout(push_constant) uniform constants {
+    vec3 positionOffset;
+    uint materialId;
+    vec3 positionScale;
+    uint objectId;
+} push;
+
+// Only the position stream is bound
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in mat4 inInstanceTransform;
+
+// Same computation as mesh.vert, so the main pass can test for equal depth
+invariant gl_Position;
+
+void main() {
+    vec3 position = push.positionOffset + push.positionScale * inPosition.xyz;
+    vec4 modelPosition = inInstanceTransform * vec4(position, 1.0);
+    vec4 viewPosition = camera.view * modelPosition;
+    gl_Position = camera.proj * viewPosition;
+}
@@ -1,37 +1,50 @@
 #version 450
 
-#define MAX_OBJECTS 32
-
 layout(binding = 0) uniform CameraTransform {
     mat4 view;
     mat4 proj;
 } camera;
 
-layout(binding = 4) uniform LightTransform {
-    mat4 view;
-    mat4 proj;
-} light;
+// Per draw data, the packed positions are dequantized with positionOffset + positionScale * position
+layout(push_constant) uniform constants {
+    vec3 positionOffset;
+    uint materialId;
+    vec3 positionScale;
+    uint objectId;
+} push;
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
 layout(location = 2) in vec2 inTexCoord;
-layout(location = 3) in uint inTextureIndex;
+layout(location = 3) in mat4 inInstanceTransform;
 
 layout(location = 0) out vec2 fragTexCoord;
 layout(location = 1) flat out uint fragTextureIndex;
-layout(location = 2) out vec4 lightPosition;
+layout(location = 2) out float fragViewDepth;
 layout(location = 3) out vec3 fragNormal;
 layout(location = 4) out vec3 fragWorldPosition;
 
+// Must match depth.vert exactly for the depth equal test after the prepass
+invariant gl_Position;
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+    return normalize(normal);
+}
+
 void main() {
-    vec3 position = inPosition;
-    gl_Position = camera.proj * camera.view * vec4(position, 1.0);
+    vec3 position = push.positionOffset + push.positionScale * inPosition.xyz;
+    vec4 modelPosition = inInstanceTransform * vec4(position, 1.0);
+    vec4 viewPosition = camera.view * modelPosition;
+    gl_Position = camera.proj * viewPosition;
 
     fragTexCoord = inTexCoord;
-    fragTextureIndex = inTextureIndex;
-    fragNormal = inNormal;
-    lightPosition = light.proj * light.view * vec4(position, 1.0);
+    fragTextureIndex = push.materialId;
+    fragNormal = mat3(inInstanceTransform) * decodeOctahedral(inNormal);
+    fragViewDepth = viewPosition.z;
 
-    vec4 modelPosition = vec4(position, 1.0);
     fragWorldPosition = vec3(modelPosition) / modelPosition.w;
 }
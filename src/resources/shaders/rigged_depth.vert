@@ -0,0 +1,48 @@
+#version 450
+
+layout(binding = 0) uniform CameraTransform {
+    mat4 View;
+    mat4 Proj;
+} Camera;
+
+/* TODO : Read the size of this object using spirv-reflect during runtime */
+#define MAX_OBJECTS  8
+#define MAX_JOINTS  16
+layout(binding = 1) uniform ObjectData {
+    mat4 Models[MAX_OBJECTS];
+    mat4 Joints[MAX_OBJECTS * MAX_JOINTS];
+} Objects;
+
+// Per draw data, the packed positions are dequantized with positionOffset + positionScale * position
+layout(push_constant) uniform constants {
+    vec3 positionOffset;
+    uint materialId;
+    vec3 positionScale;
+    uint objectId;
+} push;
+
+// Only the position stream is bound
+layout(location = 0) in vec4 VertexPosition;
+layout(location = 1) in uvec2 Joints;
+layout(location = 2) in vec2 Weights;
+
+// Same computation as rigged_mesh.vert, so the main pass can test for equal depth
+invariant gl_Position;
+
+mat4 getModel() {
+    return Objects.Models[push.objectId];
+}
+
+mat4 getJoint(uint jointId) {
+    return Objects.Joints[push.objectId * MAX_JOINTS + jointId];
+}
+
+void main() {
+    vec3 vertexPosition = push.positionOffset + push.positionScale * VertexPosition.xyz;
+    vec4 position = getModel() * vec4(vertexPosition, 1.0);
+    vec4 riggedPosition = Weights.x * getJoint(Joints.x) * position
+                        + Weights.y * getJoint(Joints.y) * position;
+
+    vec4 viewPosition = Camera.View * riggedPosition;
+    gl_Position = Camera.Proj * viewPosition;
+}
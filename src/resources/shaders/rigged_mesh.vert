@@ -5,11 +5,6 @@ layout(binding = 0) uniform CameraTransform {
     mat4 Proj;
 } Camera;
 
-layout(binding = 4) uniform LightTransform {
-    mat4 View;
-    mat4 Proj;
-} Light;
-
 /* TODO : Read the size of this object using spirv-reflect during runtime */
 #define MAX_OBJECTS  8
 #define MAX_JOINTS  16
@@ -18,45 +13,57 @@ layout(binding = 5) uniform ObjectData {
     mat4 Joints[MAX_OBJECTS * MAX_JOINTS];
 } Objects;
 
-//push constants block
-layout(push_constant) uniform constants
-{
-    uint ObjectId;
-} PushConstants;
+// Per draw data, the packed positions are dequantized with positionOffset + positionScale * position
+layout(push_constant) uniform constants {
+    vec3 positionOffset;
+    uint materialId;
+    vec3 positionScale;
+    uint objectId;
+} push;
 
-layout(location = 0) in vec3 VertexPosition;
-layout(location = 1) in vec3 Normal;
+layout(location = 0) in vec4 VertexPosition;
+layout(location = 1) in vec2 Normal;
 layout(location = 2) in vec2 TexCoord;
-layout(location = 3) in uint TextureIndex;
-layout(location = 4) in uint Joint1;
-layout(location = 5) in uint Joint2;
-layout(location = 6) in float Weight1;
-layout(location = 7) in float Weight2;
+layout(location = 3) in uvec2 Joints;
+layout(location = 4) in vec2 Weights;
 
 layout(location = 0) out vec2 FragTexCoord;
 layout(location = 1) flat out uint FragTextureIndex;
-layout(location = 2) out vec4 FragLightPosition;
+layout(location = 2) out float FragViewDepth;
 layout(location = 3) out vec3 FragNormal;
 layout(location = 4) out vec3 FragWorldPosition;
 
+// Must match rigged_depth.vert exactly for the depth equal test after the prepass
+invariant gl_Position;
+
 mat4 getModel() {
-    return Objects.Models[PushConstants.ObjectId];
+    return Objects.Models[push.objectId];
 }
 
 mat4 getJoint(uint jointId) {
-    return Objects.Joints[PushConstants.ObjectId * MAX_JOINTS + jointId];
+    return Objects.Joints[push.objectId * MAX_JOINTS + jointId];
+}
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+    return normalize(normal);
 }
 
 void main() {
-    vec4 position = getModel() * vec4(VertexPosition, 1.0);
-    vec4 riggedPosition = Weight1 * getJoint(Joint1) * position
-                        + Weight2 * getJoint(Joint2) * position;
+    vec3 vertexPosition = push.positionOffset + push.positionScale * VertexPosition.xyz;
+    vec4 position = getModel() * vec4(vertexPosition, 1.0);
+    vec4 riggedPosition = Weights.x * getJoint(Joints.x) * position
+                        + Weights.y * getJoint(Joints.y) * position;
 
-    gl_Position = Camera.Proj * Camera.View * riggedPosition;
+    vec4 viewPosition = Camera.View * riggedPosition;
+    gl_Position = Camera.Proj * viewPosition;
 
     FragTexCoord = TexCoord;
-    FragTextureIndex = TextureIndex;
-    FragNormal = Normal;
-    FragLightPosition = Light.Proj * Light.View * riggedPosition;
+    FragTextureIndex = push.materialId;
+    FragNormal = decodeOctahedral(Normal);
+    FragViewDepth = viewPosition.z;
     FragWorldPosition = riggedPosition.xyz / riggedPosition.w;
 }
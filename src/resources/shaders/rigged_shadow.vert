@@ -0,0 +1,44 @@
+#version 450
+
+#define MAX_CASCADES 4
+
+layout(binding = 0) uniform ShadowData {
+    mat4 viewProjection[MAX_CASCADES];
+    vec4 splits;
+    vec4 uvScale;
+    uint cascadeCount;
+} shadow;
+
+/* TODO : Read the size of this object using spirv-reflect during runtime */
+#define MAX_OBJECTS  8
+#define MAX_JOINTS  16
+layout(binding = 1) uniform ObjectData {
+    mat4 Models[MAX_OBJECTS];
+    mat4 Joints[MAX_OBJECTS * MAX_JOINTS];
+} Objects;
+
+// The packed positions are dequantized with positionOffset + positionScale * position
+layout(push_constant) uniform constants {
+    vec3 positionOffset;
+    uint cascade;
+    vec3 positionScale;
+    uint objectId;
+} push;
+
+// Only the position stream is bound
+layout(location = 0) in vec4 VertexPosition;
+layout(location = 1) in uvec2 Joints;
+layout(location = 2) in vec2 Weights;
+
+mat4 getJoint(uint jointId) {
+    return Objects.Joints[push.objectId * MAX_JOINTS + jointId];
+}
+
+void main() {
+    vec3 vertexPosition = push.positionOffset + push.positionScale * VertexPosition.xyz;
+    vec4 position = Objects.Models[push.objectId] * vec4(vertexPosition, 1.0);
+    vec4 riggedPosition = Weights.x * getJoint(Joints.x) * position
+                        + Weights.y * getJoint(Joints.y) * position;
+
+    gl_Position = shadow.viewProjection[push.cascade] * riggedPosition;
+}
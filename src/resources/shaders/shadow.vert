@@ -1,16 +1,27 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 view;
-    mat4 proj;
-} ubo;
+#define MAX_CASCADES 4
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec2 inTexCoord;
-layout(location = 3) in uint inTextureIndex;
+layout(binding = 0) uniform ShadowData {
+    mat4 viewProjection[MAX_CASCADES];
+    vec4 splits;
+    vec4 uvScale;
+    uint cascadeCount;
+} shadow;
+
+// The packed positions are dequantized with positionOffset + positionScale * position
+layout(push_constant) uniform constants {
+    vec3 positionOffset;
+    uint cascade;
+    vec3 positionScale;
+    uint objectId;
+} push;
+
+// Only the position stream is bound
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in mat4 inInstanceTransform;
 
 void main() {
-    vec3 position = inPosition;
-    gl_Position = ubo.proj * ubo.view * vec4(position, 1.0);
+    vec3 position = push.positionOffset + push.positionScale * inPosition.xyz;
+    gl_Position = shadow.viewProjection[push.cascade] * inInstanceTransform * vec4(position, 1.0);
 }
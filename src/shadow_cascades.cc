@@ -0,0 +1,131 @@
+#include "shadow_cascades.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wvk {
+
+std::array<float, MAX_SHADOW_CASCADES + 1> computeCascadeSplits(float near, float far, uint32_t count, float lambda) {
+    std::array<float, MAX_SHADOW_CASCADES + 1> splits{};
+    count = std::min<uint32_t>(count, MAX_SHADOW_CASCADES);
+
+    splits[0] = near;
+    for (uint32_t i = 1; i <= count; i++) {
+        float fraction = static_cast<float>(i) / count;
+        float logarithmic = near * std::pow(far / near, fraction);
+        float uniform = near + (far - near) * fraction;
+        splits[i] = lambda * logarithmic + (1.f - lambda) * uniform;
+    }
+    return splits;
+}
+
+uint32_t shadowLayerResolution(const CascadeConfig &config) {
+    uint32_t resolution = 1;
+    for (uint32_t i = 0; i < config.count; i++) {
+        resolution = std::max(resolution, config.resolutions[i]);
+    }
+    return resolution;
+}
+
+void computeCascades(const glm::mat4 &cameraView, const glm::mat4 &cameraProjection, float cameraNear, float cameraFar,
+                     glm::vec3 lightDirection, const Bounds &sceneBounds, const CascadeConfig &config,
+                     ShadowCascade *cascades) {
+    uint32_t count = std::min<uint32_t>(config.count, MAX_SHADOW_CASCADES);
+    float shadowFar = std::min(cameraFar, config.maxDistance);
+    auto splits = computeCascadeSplits(cameraNear, shadowFar, count, config.splitLambda);
+
+    // World space corners of the camera frustum, on the near (0-3) and far (4-7) planes
+    glm::mat4 inverseViewProjection = glm::inverse(cameraProjection * cameraView);
+    glm::vec3 frustum[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 corner = inverseViewProjection * glm::vec4(i & 1 ? 1.f : -1.f, i & 2 ? 1.f : -1.f, i & 4 ? 1.f : 0.f, 1.f);
+        frustum[i] = glm::vec3(corner) / corner.w;
+    }
+
+    // Light view is a rotation only, so snapping in light space is independent of the camera position
+    lightDirection = glm::normalize(lightDirection);
+    glm::vec3 up = std::abs(lightDirection.z) > 0.99f ? glm::vec3(0.f, 1.f, 0.f) : glm::vec3(0.f, 0.f, 1.f);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.f), lightDirection, up);
+
+    Bounds lightSceneBounds = sceneBounds.transformed(lightView);
+
+    for (uint32_t i = 0; i < count; i++) {
+        float sliceNear = (splits[i] - cameraNear) / (cameraFar - cameraNear);
+        float sliceFar = (splits[i + 1] - cameraNear) / (cameraFar - cameraNear);
+
+        glm::vec3 slice[8];
+        glm::vec3 center{0.f};
+        for (int corner = 0; corner < 4; corner++) {
+            slice[corner] = glm::mix(frustum[corner], frustum[corner + 4], sliceNear);
+            slice[corner + 4] = glm::mix(frustum[corner], frustum[corner + 4], sliceFar);
+            center += slice[corner] + slice[corner + 4];
+        }
+        center /= 8.f;
+
+        // A bounding sphere keeps the cascade size constant as the camera rotates
+        float radius = 0.f;
+        for (const glm::vec3 &corner : slice) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.f) / 16.f;
+
+        // The center is snapped down to a whole tile, so the box grows by one tile on each side to still cover the
+        // slice. A tile is a whole number of texels, which keeps the texel grid fixed in light space.
+        uint32_t resolution = config.resolutions[i];
+        uint32_t tileTexels = 1;
+        if (config.cacheStaticCasters) {
+            tileTexels = std::max<uint32_t>(1, static_cast<uint32_t>(resolution * config.cacheTileSize));
+            tileTexels = std::min<uint32_t>(tileTexels, resolution / 4);
+        }
+        float halfExtent = radius / (1.f - 2.f * tileTexels / resolution);
+        float tileSize = tileTexels * 2.f * halfExtent / resolution;
+
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.f));
+        lightCenter = glm::floor(lightCenter / tileSize) * tileSize;
+
+        // The depth range covers the whole scene, so it doesn't change as the camera moves and cached cascades
+        // stay valid. It is rounded out to whole tiles so dynamic casters moving the scene bounds don't change it
+        // every frame.
+        float zNear = lightCenter.z - halfExtent;
+        float zFar = lightCenter.z + halfExtent;
+        if (lightSceneBounds.valid()) {
+            zNear = std::floor(lightSceneBounds.min.z / tileSize) * tileSize;
+            zFar = std::max(std::ceil(lightSceneBounds.max.z / tileSize) * tileSize, zNear + tileSize);
+        }
+
+        ShadowCascade &cascade = cascades[i];
+        cascade.view = lightView;
+        cascade.lightDirection = lightDirection;
+        cascade.min = glm::vec3(lightCenter.x - halfExtent, lightCenter.y - halfExtent, zNear);
+        cascade.max = glm::vec3(lightCenter.x + halfExtent, lightCenter.y + halfExtent, zFar);
+        cascade.projection = glm::ortho(cascade.min.x, cascade.max.x, cascade.min.y, cascade.max.y, zNear, zFar);
+        cascade.projection[1][1] *= -1;
+        cascade.viewProjection = cascade.projection * cascade.view;
+        cascade.splitFar = splits[i + 1];
+    }
+}
+
+bool intersectsCascade(const ShadowCascade &cascade, const Bounds &bounds) {
+    Bounds lightBounds = bounds.transformed(cascade.view);
+    if (!lightBounds.valid()) return false;
+
+    // Anything in front of the cascade towards the light can still cast into it, so only the far side is tested
+    return lightBounds.max.x >= cascade.min.x && lightBounds.min.x <= cascade.max.x &&
+           lightBounds.max.y >= cascade.min.y && lightBounds.min.y <= cascade.max.y &&
+           lightBounds.min.z <= cascade.max.z;
+}
+
+ShadowData createShadowData(const ShadowCascade *cascades, const CascadeConfig &config) {
+    ShadowData data{};
+    data.cascadeCount = std::min<uint32_t>(config.count, MAX_SHADOW_CASCADES);
+
+    float resolution = static_cast<float>(shadowLayerResolution(config));
+    for (uint32_t i = 0; i < data.cascadeCount; i++) {
+        data.viewProjection[i] = cascades[i].viewProjection;
+        data.splits[i] = cascades[i].splitFar;
+        data.uvScale[i] = config.resolutions[i] / resolution;
+    }
+    return data;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "glm.h"
+#include "bounds.h"
+
+#include <array>
+#include <cstdint>
+
+namespace wvk {
+
+static const int MAX_SHADOW_CASCADES = 4;
+
+struct CascadeConfig {
+    uint32_t count = MAX_SHADOW_CASCADES;
+
+    // Each cascade renders to a resolution x resolution corner of its layer, the layers are as large as the largest
+    std::array<uint32_t, MAX_SHADOW_CASCADES> resolutions = {2048, 2048, 2048, 2048};
+
+    float splitLambda = 0.8f;  // 0 = uniform splits, 1 = logarithmic splits
+    float maxDistance = 40.f;  // no shadows are drawn further than this from the camera
+
+    // Static casters are drawn into a cache that is only redrawn when the cascade or the static casters change
+    bool cacheStaticCasters = true;
+    // With the cache, cascades move in tiles of this fraction of their width instead of single texels, so the cache
+    // survives camera movement within a tile. Each cascade grows by a tile on every side to keep its slice covered,
+    // which costs 2 * cacheTileSize of its resolution.
+    float cacheTileSize = 1.f / 16.f;
+};
+
+struct ShadowCascade {
+    glm::mat4 view;            // rotation only, shared by all cascades
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec3 lightDirection;  // normalized
+
+    // Light view space box covered by the cascade
+    glm::vec3 min;
+    glm::vec3 max;
+
+    float splitFar;            // view space depth where the next cascade starts
+};
+
+/* Matches the ShadowData uniform block of shadow.vert and basic.frag */
+struct ShadowData {
+    glm::mat4 viewProjection[MAX_SHADOW_CASCADES];
+    glm::vec4 splits;          // far view space depth of each cascade
+    glm::vec4 uvScale;         // fraction of the layer each cascade renders to
+    uint32_t cascadeCount;
+    uint32_t padding[3];
+};
+
+// Size of the shadow map layers, the largest cascade resolution
+uint32_t shadowLayerResolution(const CascadeConfig &config);
+
+// Split depths between near and far, blending uniform and logarithmic schemes. Returns count + 1 depths.
+std::array<float, MAX_SHADOW_CASCADES + 1> computeCascadeSplits(float near, float far, uint32_t count, float lambda);
+
+// Fits each cascade to its slice of the camera frustum. The light's depth range is the depth range of the scene
+// so casters between the light and the slice are kept. Cascade origins are snapped to whole texels so the shadows
+// don't shimmer when the camera moves, or to whole tiles when static casters are cached (see cacheTileSize).
+void computeCascades(const glm::mat4 &cameraView, const glm::mat4 &cameraProjection, float cameraNear, float cameraFar,
+                     glm::vec3 lightDirection, const Bounds &sceneBounds, const CascadeConfig &config,
+                     ShadowCascade *cascades);
+
+// True if bounds (world space) may cast a shadow into the cascade
+bool intersectsCascade(const ShadowCascade &cascade, const Bounds &bounds);
+
+ShadowData createShadowData(const ShadowCascade *cascades, const CascadeConfig &config);
+
+}
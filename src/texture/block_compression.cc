@@ -0,0 +1,572 @@
+#include "block_compression.h"
+
+#include "../cpu_profiler.h"
+
+#include <logger.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace wvk {
+
+static constexpr int BLOCK_TEXELS = 16;
+
+// Interpolation weights of the 4 bit BC7 indices, out of 64
+static constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// BC1 index to the weight of the second endpoint, in four color mode
+static constexpr float BC1_WEIGHTS[4] = {0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+
+/* Bits */
+
+// Blocks are little endian bit streams, the first field in the lowest bits of the first byte
+class BitWriter {
+  public:
+    explicit BitWriter(uint8_t *data, size_t size) : data{data} { memset(data, 0, size); }
+
+    void write(uint32_t value, uint32_t bits) {
+        for (uint32_t bit = 0; bit < bits; bit++, position++) {
+            if ((value >> bit) & 1) data[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+        }
+    }
+
+  private:
+    uint8_t *data;
+    uint32_t position = 0;
+};
+
+class BitReader {
+  public:
+    explicit BitReader(const uint8_t *data) : data{data} {}
+
+    uint32_t read(uint32_t bits) {
+        uint32_t value = 0;
+        for (uint32_t bit = 0; bit < bits; bit++, position++) {
+            value |= static_cast<uint32_t>((data[position >> 3] >> (position & 7)) & 1) << bit;
+        }
+        return value;
+    }
+
+  private:
+    const uint8_t *data;
+    uint32_t position = 0;
+};
+
+/* Endpoint fitting */
+
+// Mean and principal axis of the first channels of a block's texels. The axis is zero for blocks of a single color.
+static void fitAxis(const uint8_t *texels, int channels, float *mean, float *axis) {
+    for (int c = 0; c < channels; c++) {
+        float sum = 0.f;
+        for (int i = 0; i < BLOCK_TEXELS; i++) {
+            sum += texels[i * 4 + c];
+        }
+        mean[c] = sum / BLOCK_TEXELS;
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        float delta[4];
+        for (int c = 0; c < channels; c++) {
+            delta[c] = texels[i * 4 + c] - mean[c];
+        }
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                covariance[a][b] += delta[a] * delta[b];
+            }
+        }
+    }
+
+    // Power iteration, starting from the channel that varies most so the start isn't orthogonal to the axis
+    int widest = 0;
+    for (int c = 1; c < channels; c++) {
+        if (covariance[c][c] > covariance[widest][widest]) widest = c;
+    }
+    for (int c = 0; c < channels; c++) {
+        axis[c] = covariance[widest][c];
+    }
+
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        float largest = 0.f;
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            largest = std::max(largest, std::abs(next[a]));
+        }
+        if (largest < 1e-6f) break;
+        for (int c = 0; c < channels; c++) {
+            axis[c] = next[c] / largest;
+        }
+    }
+
+    float length = 0.f;
+    for (int c = 0; c < channels; c++) {
+        length += axis[c] * axis[c];
+    }
+    length = std::sqrt(length);
+    for (int c = 0; c < channels; c++) {
+        axis[c] = length > 1e-6f ? axis[c] / length : 0.f;
+    }
+}
+
+// Endpoints at the extent of the texels along the axis
+static void axisEndpoints(const uint8_t *texels, int channels, float *first, float *second) {
+    float mean[4], axis[4];
+    fitAxis(texels, channels, mean, axis);
+
+    float lowest = 0.f, highest = 0.f;
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        float t = 0.f;
+        for (int c = 0; c < channels; c++) {
+            t += (texels[i * 4 + c] - mean[c]) * axis[c];
+        }
+        lowest = std::min(lowest, t);
+        highest = std::max(highest, t);
+    }
+    for (int c = 0; c < channels; c++) {
+        first[c] = std::clamp(mean[c] + lowest * axis[c], 0.f, 255.f);
+        second[c] = std::clamp(mean[c] + highest * axis[c], 0.f, 255.f);
+    }
+}
+
+// Endpoints minimizing the squared error of every texel to its interpolation between them, given each texel's weight
+// of the second endpoint. Returns false if the weights don't determine both endpoints.
+static bool leastSquaresEndpoints(const uint8_t *texels, int channels, const float *weights,
+                                  float *first, float *second) {
+    float aa = 0.f, ab = 0.f, bb = 0.f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        float b = weights[i];
+        float a = 1.f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < channels; c++) {
+            ax[c] += a * texels[i * 4 + c];
+            bx[c] += b * texels[i * 4 + c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f) return false;
+
+    for (int c = 0; c < channels; c++) {
+        first[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.f, 255.f);
+        second[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.f, 255.f);
+    }
+    return true;
+}
+
+/* BC1 */
+
+static uint16_t packRgb565(const float *color) {
+    auto quantize = [](float value, int maximum) {
+        return static_cast<uint16_t>(std::clamp(static_cast<int>(std::lround(value * maximum / 255.f)), 0, maximum));
+    };
+    return static_cast<uint16_t>(quantize(color[0], 31) << 11 | quantize(color[1], 63) << 5 | quantize(color[2], 31));
+}
+
+static void bc1Palette(uint16_t color0, uint16_t color1, int palette[4][3]) {
+    for (int e = 0; e < 2; e++) {
+        uint16_t color = e == 0 ? color0 : color1;
+        int red = color >> 11, green = (color >> 5) & 63, blue = color & 31;
+        palette[e][0] = red << 3 | red >> 2;
+        palette[e][1] = green << 2 | green >> 4;
+        palette[e][2] = blue << 3 | blue >> 2;
+    }
+    for (int c = 0; c < 3; c++) {
+        if (color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            // Three color mode, index 3 is black
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+}
+
+// Picks the closest palette entry for every texel, returns the summed squared error
+static int bc1Indices(const uint8_t *texels, uint16_t color0, uint16_t color1, uint32_t &indices) {
+    int palette[4][3];
+    bc1Palette(color0, color1, palette);
+
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        int bestIndex = 0, bestError = INT_MAX;
+        for (int index = 0; index < 4; index++) {
+            int texelError = 0;
+            for (int c = 0; c < 3; c++) {
+                int delta = texels[i * 4 + c] - palette[index][c];
+                texelError += delta * delta;
+            }
+            if (texelError < bestError) {
+                bestError = texelError;
+                bestIndex = index;
+            }
+        }
+        indices |= static_cast<uint32_t>(bestIndex) << (2 * i);
+        error += bestError;
+    }
+    return error;
+}
+
+void encodeBC1Block(const uint8_t *texels, uint8_t *block) {
+    float first[4], second[4];
+    axisEndpoints(texels, 3, first, second);
+
+    uint16_t bestColors[2] = {0, 0};
+    uint32_t bestIndices = 0;
+    int bestError = INT_MAX;
+
+    for (int iteration = 0; iteration < 3; iteration++) {
+        uint16_t color0 = packRgb565(first);
+        uint16_t color1 = packRgb565(second);
+        // Four color mode needs the first color to be the larger one
+        if (color0 < color1) {
+            std::swap(color0, color1);
+            std::swap(first, second);
+        }
+
+        uint32_t indices;
+        int error = bc1Indices(texels, color0, color1, indices);
+        if (error < bestError) {
+            bestError = error;
+            bestColors[0] = color0;
+            bestColors[1] = color1;
+            bestIndices = indices;
+        }
+        if (error == 0 || color0 == color1) break;
+
+        float weights[BLOCK_TEXELS];
+        for (int i = 0; i < BLOCK_TEXELS; i++) {
+            weights[i] = BC1_WEIGHTS[(indices >> (2 * i)) & 3];
+        }
+        if (!leastSquaresEndpoints(texels, 3, weights, first, second)) break;
+    }
+
+    memcpy(block, &bestColors[0], 2);
+    memcpy(block + 2, &bestColors[1], 2);
+    memcpy(block + 4, &bestIndices, 4);
+}
+
+void decodeBC1Block(const uint8_t *block, uint8_t *texels) {
+    uint16_t color0, color1;
+    uint32_t indices;
+    memcpy(&color0, block, 2);
+    memcpy(&color1, block + 2, 2);
+    memcpy(&indices, block + 4, 4);
+
+    int palette[4][3];
+    bc1Palette(color0, color1, palette);
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        const int *color = palette[(indices >> (2 * i)) & 3];
+        for (int c = 0; c < 3; c++) {
+            texels[i * 4 + c] = static_cast<uint8_t>(color[c]);
+        }
+        texels[i * 4 + 3] = 255;
+    }
+}
+
+/* BC4 and BC5 */
+
+static void bc4Palette(int value0, int value1, int palette[8]) {
+    palette[0] = value0;
+    palette[1] = value1;
+    if (value0 > value1) {
+        for (int i = 1; i <= 6; i++) {
+            palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+        }
+    } else {
+        for (int i = 1; i <= 4; i++) {
+            palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// One channel between its extremes, the eight value mode covers the range evenly
+static void encodeBC4Block(const uint8_t *texels, int channel, uint8_t *block) {
+    int lowest = 255, highest = 0;
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        lowest = std::min(lowest, static_cast<int>(texels[i * 4 + channel]));
+        highest = std::max(highest, static_cast<int>(texels[i * 4 + channel]));
+    }
+
+    int palette[8];
+    bc4Palette(highest, lowest, palette);
+
+    uint64_t indices = 0;
+    if (highest > lowest) {
+        for (int i = 0; i < BLOCK_TEXELS; i++) {
+            int value = texels[i * 4 + channel];
+            int bestIndex = 0;
+            for (int index = 1; index < 8; index++) {
+                if (std::abs(value - palette[index]) < std::abs(value - palette[bestIndex])) bestIndex = index;
+            }
+            indices |= static_cast<uint64_t>(bestIndex) << (3 * i);
+        }
+    }
+
+    block[0] = static_cast<uint8_t>(highest);
+    block[1] = static_cast<uint8_t>(lowest);
+    for (int b = 0; b < 6; b++) {
+        block[2 + b] = static_cast<uint8_t>(indices >> (8 * b));
+    }
+}
+
+static void decodeBC4Block(const uint8_t *block, int channel, uint8_t *texels) {
+    int palette[8];
+    bc4Palette(block[0], block[1], palette);
+
+    uint64_t indices = 0;
+    for (int b = 0; b < 6; b++) {
+        indices |= static_cast<uint64_t>(block[2 + b]) << (8 * b);
+    }
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        texels[i * 4 + channel] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+    }
+}
+
+void encodeBC5Block(const uint8_t *texels, uint8_t *block) {
+    encodeBC4Block(texels, 0, block);
+    encodeBC4Block(texels, 1, block + 8);
+}
+
+void decodeBC5Block(const uint8_t *block, uint8_t *texels) {
+    decodeBC4Block(block, 0, texels);
+    decodeBC4Block(block + 8, 1, texels);
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        texels[i * 4 + 2] = 0;
+        texels[i * 4 + 3] = 255;
+    }
+}
+
+/* BC7 mode 6 */
+
+// 7 bits per channel and a p-bit shared by the channels of each endpoint
+struct Bc7Endpoints {
+    int color[2][4];
+    int pbit[2];
+};
+
+static void quantizeBC7Endpoint(const float *value, int *color, int &pbit) {
+    float bestError = INFINITY;
+    for (int p = 0; p < 2; p++) {
+        int quantized[4];
+        float error = 0.f;
+        for (int c = 0; c < 4; c++) {
+            quantized[c] = std::clamp(static_cast<int>(std::lround((value[c] - p) / 2.f)), 0, 127);
+            float delta = static_cast<float>(quantized[c] * 2 + p) - value[c];
+            error += delta * delta;
+        }
+        if (error < bestError) {
+            bestError = error;
+            pbit = p;
+            std::copy(quantized, quantized + 4, color);
+        }
+    }
+}
+
+static void bc7Palette(const Bc7Endpoints &endpoints, int palette[16][4]) {
+    for (int c = 0; c < 4; c++) {
+        int value0 = endpoints.color[0][c] << 1 | endpoints.pbit[0];
+        int value1 = endpoints.color[1][c] << 1 | endpoints.pbit[1];
+        for (int index = 0; index < 16; index++) {
+            palette[index][c] = ((64 - BC7_WEIGHTS[index]) * value0 + BC7_WEIGHTS[index] * value1 + 32) >> 6;
+        }
+    }
+}
+
+static int bc7Indices(const uint8_t *texels, const Bc7Endpoints &endpoints, uint8_t *indices) {
+    int palette[16][4];
+    bc7Palette(endpoints, palette);
+
+    int error = 0;
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        int bestError = INT_MAX;
+        for (int index = 0; index < 16; index++) {
+            int texelError = 0;
+            for (int c = 0; c < 4; c++) {
+                int delta = texels[i * 4 + c] - palette[index][c];
+                texelError += delta * delta;
+            }
+            if (texelError < bestError) {
+                bestError = texelError;
+                indices[i] = static_cast<uint8_t>(index);
+            }
+        }
+        error += bestError;
+    }
+    return error;
+}
+
+void encodeBC7Block(const uint8_t *texels, uint8_t *block) {
+    float first[4], second[4];
+    axisEndpoints(texels, 4, first, second);
+
+    Bc7Endpoints best{};
+    uint8_t bestIndices[BLOCK_TEXELS] = {};
+    int bestError = INT_MAX;
+
+    for (int iteration = 0; iteration < 3; iteration++) {
+        Bc7Endpoints endpoints{};
+        quantizeBC7Endpoint(first, endpoints.color[0], endpoints.pbit[0]);
+        quantizeBC7Endpoint(second, endpoints.color[1], endpoints.pbit[1]);
+
+        uint8_t indices[BLOCK_TEXELS];
+        int error = bc7Indices(texels, endpoints, indices);
+        if (error < bestError) {
+            bestError = error;
+            best = endpoints;
+            std::copy(indices, indices + BLOCK_TEXELS, bestIndices);
+        }
+        if (error == 0) break;
+
+        float weights[BLOCK_TEXELS];
+        for (int i = 0; i < BLOCK_TEXELS; i++) {
+            weights[i] = BC7_WEIGHTS[indices[i]] / 64.f;
+        }
+        if (!leastSquaresEndpoints(texels, 4, weights, first, second)) break;
+    }
+
+    // The first texel's index has an implicit zero top bit, swap the endpoints if it needs it
+    if (bestIndices[0] >= 8) {
+        std::swap(best.color[0], best.color[1]);
+        std::swap(best.pbit[0], best.pbit[1]);
+        for (uint8_t &index : bestIndices) {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    BitWriter writer{block, 16};
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(static_cast<uint32_t>(best.color[0][c]), 7);
+        writer.write(static_cast<uint32_t>(best.color[1][c]), 7);
+    }
+    writer.write(static_cast<uint32_t>(best.pbit[0]), 1);
+    writer.write(static_cast<uint32_t>(best.pbit[1]), 1);
+    writer.write(bestIndices[0], 3);
+    for (int i = 1; i < BLOCK_TEXELS; i++) {
+        writer.write(bestIndices[i], 4);
+    }
+}
+
+bool decodeBC7Block(const uint8_t *block, uint8_t *texels) {
+    if ((block[0] & 0x7f) != 1 << 6) {
+        memset(texels, 0, BLOCK_TEXELS * 4);
+        return false;
+    }
+
+    BitReader reader{block};
+    reader.read(7);
+
+    Bc7Endpoints endpoints{};
+    for (int c = 0; c < 4; c++) {
+        endpoints.color[0][c] = static_cast<int>(reader.read(7));
+        endpoints.color[1][c] = static_cast<int>(reader.read(7));
+    }
+    endpoints.pbit[0] = static_cast<int>(reader.read(1));
+    endpoints.pbit[1] = static_cast<int>(reader.read(1));
+
+    int palette[16][4];
+    bc7Palette(endpoints, palette);
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        uint32_t index = reader.read(i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++) {
+            texels[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+        }
+    }
+    return true;
+}
+
+/* Levels */
+
+std::vector<uint8_t> encodeTextureLevel(VkFormat format, const uint8_t *pixels, uint32_t width, uint32_t height) {
+    WVK_PROFILE_ZONE("encode texture level");
+
+    void (*encodeBlock)(const uint8_t *, uint8_t *) = nullptr;
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            encodeBlock = encodeBC1Block;
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            encodeBlock = encodeBC5Block;
+            break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            encodeBlock = encodeBC7Block;
+            break;
+        default:
+            logger::fatal_error("can't encode texture format " + std::to_string(format));
+    }
+
+    uint32_t blockSize = texelBlockSize(format);
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    std::vector<uint8_t> blocks(static_cast<size_t>(blocksWide) * blocksHigh * blockSize);
+
+    uint8_t texels[BLOCK_TEXELS * 4];
+    for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+            for (uint32_t y = 0; y < 4; y++) {
+                uint32_t row = std::min(blockY * 4 + y, height - 1);
+                for (uint32_t x = 0; x < 4; x++) {
+                    uint32_t column = std::min(blockX * 4 + x, width - 1);
+                    memcpy(&texels[(y * 4 + x) * 4], &pixels[(static_cast<size_t>(row) * width + column) * 4], 4);
+                }
+            }
+            encodeBlock(texels, &blocks[(static_cast<size_t>(blockY) * blocksWide + blockX) * blockSize]);
+        }
+    }
+    return blocks;
+}
+
+bool decodeTextureLevel(VkFormat format, const uint8_t *blocks, uint32_t width, uint32_t height,
+                        std::vector<uint8_t> &pixels) {
+    uint32_t blockSize = texelBlockSize(format);
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+
+    bool decoded = true;
+    uint8_t texels[BLOCK_TEXELS * 4];
+    for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+            const uint8_t *block = &blocks[(static_cast<size_t>(blockY) * blocksWide + blockX) * blockSize];
+            switch (format) {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                    decodeBC1Block(block, texels);
+                    break;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                    decodeBC5Block(block, texels);
+                    break;
+                case VK_FORMAT_BC7_UNORM_BLOCK:
+                case VK_FORMAT_BC7_SRGB_BLOCK:
+                    decoded &= decodeBC7Block(block, texels);
+                    break;
+                default:
+                    return false;
+            }
+
+            for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++) {
+                for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++) {
+                    size_t pixel = static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x;
+                    memcpy(&pixels[pixel * 4], &texels[(y * 4 + x) * 4], 4);
+                }
+            }
+        }
+    }
+    return decoded;
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "texture_data.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace wvk {
+
+/*
+ * CPU encoders and decoders of the BCn formats textures are cooked to. Each format stores 4x4 texel blocks in a fixed
+ * number of bytes: BC1 keeps RGB in 8 bytes, BC5 two independent channels in 16 and BC7 RGBA in 16. Blocks are read
+ * and written as 16 RGBA8 texels, row by row.
+ *
+ * The encoders fit one endpoint pair per block along the principal axis of its texels and refine it by least squares
+ * against the chosen indices. BC7 only uses mode 6 (one RGBA endpoint pair with 4 bit indices), so the BC7 decoder
+ * only decodes mode 6 blocks and returns false for the other modes.
+ */
+
+void encodeBC1Block(const uint8_t *texels, uint8_t *block);
+void decodeBC1Block(const uint8_t *block, uint8_t *texels);
+
+// Red and green channels as two BC4 blocks, blue decodes as 0
+void encodeBC5Block(const uint8_t *texels, uint8_t *block);
+void decodeBC5Block(const uint8_t *block, uint8_t *texels);
+
+void encodeBC7Block(const uint8_t *texels, uint8_t *block);
+bool decodeBC7Block(const uint8_t *block, uint8_t *texels);
+
+// Encodes width x height RGBA8 pixels into rows of blocks of a BCn format. Blocks past the right and bottom edges
+// repeat the last column and row.
+std::vector<uint8_t> encodeTextureLevel(VkFormat format, const uint8_t *pixels, uint32_t width, uint32_t height);
+// Decodes the blocks of one level back to RGBA8 pixels. Returns false if any block couldn't be decoded, those are
+// left transparent black.
+bool decodeTextureLevel(VkFormat format, const uint8_t *blocks, uint32_t width, uint32_t height,
+                        std::vector<uint8_t> &pixels);
+
+}
@@ -0,0 +1,238 @@
+#include "ktx2_file.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace wvk {
+
+static constexpr uint8_t KTX2_IDENTIFIER[12] = {0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a};
+static constexpr uint64_t LEVEL_ALIGNMENT = 16;
+
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Khronos data format descriptor values, see the Khronos Data Format Specification
+enum {
+    DF_MODEL_RGBSDA = 1,
+    DF_MODEL_BC1A = 128,
+    DF_MODEL_BC5 = 132,
+    DF_MODEL_BC7 = 134,
+    DF_PRIMARIES_BT709 = 1,
+    DF_TRANSFER_LINEAR = 1,
+    DF_TRANSFER_SRGB = 2,
+    DF_SAMPLE_LINEAR = 0x10,
+};
+
+static uint64_t align(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Basic data format descriptor block of a format, with one sample per channel or per compressed channel
+static std::vector<uint32_t> dataFormatDescriptor(VkFormat format) {
+    struct Sample {
+        uint32_t bitOffset;
+        uint32_t bitLength;
+        uint32_t channel;
+        uint32_t upper;
+    };
+
+    uint32_t model;
+    std::vector<Sample> samples;
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            model = DF_MODEL_BC1A;
+            samples = {{0, 64, 0, 0xffffffff}};
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            model = DF_MODEL_BC5;
+            samples = {{0, 64, 0, 0xffffffff}, {64, 64, 1, 0xffffffff}};
+            break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            model = DF_MODEL_BC7;
+            samples = {{0, 128, 0, 0xffffffff}};
+            break;
+        default:
+            // Alpha is never sRGB encoded
+            model = DF_MODEL_RGBSDA;
+            samples = {{0, 8, 0, 255}, {8, 8, 1, 255}, {16, 8, 2, 255},
+                       {24, 8, isSrgb(format) ? 15u | DF_SAMPLE_LINEAR : 15u, 255}};
+            break;
+    }
+
+    uint32_t blockDimension = isBlockCompressed(format) ? 3 : 0;
+    uint32_t blockSize = static_cast<uint32_t>(24 + 16 * samples.size());
+
+    std::vector<uint32_t> words;
+    words.push_back(4 + blockSize);                                         // total size
+    words.push_back(0);                                                     // Khronos vendor, basic descriptor
+    words.push_back(2 | blockSize << 16);                                   // version 2
+    words.push_back(model | DF_PRIMARIES_BT709 << 8 |
+                    (isSrgb(format) ? DF_TRANSFER_SRGB : DF_TRANSFER_LINEAR) << 16);
+    words.push_back(blockDimension | blockDimension << 8);                  // texel block dimensions minus one
+    words.push_back(texelBlockSize(format));                                // bytes of plane 0
+    words.push_back(0);
+    for (const Sample &sample : samples) {
+        words.push_back(sample.bitOffset | (sample.bitLength - 1) << 16 | sample.channel << 24);
+        words.push_back(0);                                                 // sample position
+        words.push_back(0);                                                 // lower
+        words.push_back(sample.upper);
+    }
+    return words;
+}
+
+std::vector<uint8_t> serializeKtx2(const TextureView &texture, const std::vector<Ktx2KeyValue> &keyValues) {
+    uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+
+    Ktx2Header header{};
+    memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = static_cast<uint32_t>(texture.format);
+    header.typeSize = 1;
+    header.pixelWidth = texture.width;
+    header.pixelHeight = texture.height;
+    header.faceCount = 1;
+    header.levelCount = levelCount;
+
+    std::vector<uint32_t> dfd = dataFormatDescriptor(texture.format);
+
+    // Keys are sorted, each entry is its length, the key, a terminating zero and the value, padded to 4 bytes
+    std::vector<const Ktx2KeyValue *> sorted;
+    for (const Ktx2KeyValue &keyValue : keyValues) {
+        sorted.push_back(&keyValue);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Ktx2KeyValue *a, const Ktx2KeyValue *b) { return a->key < b->key; });
+
+    std::vector<uint8_t> kvd;
+    for (const Ktx2KeyValue *keyValue : sorted) {
+        uint32_t length = static_cast<uint32_t>(keyValue->key.size() + 1 + keyValue->value.size());
+        size_t offset = kvd.size();
+        kvd.resize(align(offset + 4 + length, 4), 0);
+        memcpy(&kvd[offset], &length, 4);
+        memcpy(&kvd[offset + 4], keyValue->key.c_str(), keyValue->key.size() + 1);
+        if (!keyValue->value.empty()) {
+            memcpy(&kvd[offset + 4 + keyValue->key.size() + 1], keyValue->value.data(), keyValue->value.size());
+        }
+    }
+
+    uint64_t offset = sizeof(Ktx2Header) + sizeof(Ktx2Level) * levelCount;
+    header.dfdByteOffset = static_cast<uint32_t>(offset);
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * 4);
+    offset += header.dfdByteLength;
+    if (!kvd.empty()) {
+        header.kvdByteOffset = static_cast<uint32_t>(offset);
+        header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+        offset += kvd.size();
+    }
+
+    // Levels are stored from the smallest to the largest
+    std::vector<Ktx2Level> levels(levelCount);
+    for (uint32_t level = levelCount; level-- > 0;) {
+        offset = align(offset, LEVEL_ALIGNMENT);
+        levels[level].byteOffset = offset;
+        levels[level].byteLength = texture.levels[level].size;
+        levels[level].uncompressedByteLength = texture.levels[level].size;
+        offset += texture.levels[level].size;
+    }
+
+    std::vector<uint8_t> bytes(offset, 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + sizeof(header), levels.data(), sizeof(Ktx2Level) * levelCount);
+    memcpy(bytes.data() + header.dfdByteOffset, dfd.data(), header.dfdByteLength);
+    if (!kvd.empty()) {
+        memcpy(bytes.data() + header.kvdByteOffset, kvd.data(), kvd.size());
+    }
+    for (uint32_t level = 0; level < levelCount; level++) {
+        memcpy(bytes.data() + levels[level].byteOffset, texture.levels[level].data, texture.levels[level].size);
+    }
+    return bytes;
+}
+
+static bool parseKeyValues(const uint8_t *data, size_t size, std::vector<Ktx2KeyValue> &keyValues) {
+    size_t offset = 0;
+    while (offset + 4 <= size) {
+        uint32_t length;
+        memcpy(&length, data + offset, 4);
+        offset += 4;
+        if (length > size - offset) return false;
+
+        const char *entry = reinterpret_cast<const char *>(data + offset);
+        size_t keyLength = strnlen(entry, length);
+        if (keyLength == length) return false;
+
+        Ktx2KeyValue keyValue{};
+        keyValue.key.assign(entry, keyLength);
+        keyValue.value.assign(data + offset + keyLength + 1, data + offset + length);
+        keyValues.push_back(std::move(keyValue));
+
+        offset = align(offset + length, 4);
+    }
+    return true;
+}
+
+bool parseKtx2(const uint8_t *data, size_t size, TextureView &texture, std::vector<Ktx2KeyValue> *keyValues) {
+    if (data == nullptr || size < sizeof(Ktx2Header)) return false;
+
+    Ktx2Header header{};
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) return false;
+
+    VkFormat format = static_cast<VkFormat>(header.vkFormat);
+    if (!isTextureFormat(format) || header.supercompressionScheme != 0) return false;
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0) return false;
+    if (header.layerCount > 1 || header.faceCount != 1) return false;
+    if (header.levelCount == 0 || header.levelCount > mipLevelCount(header.pixelWidth, header.pixelHeight)) return false;
+    if ((size - sizeof(Ktx2Header)) / sizeof(Ktx2Level) < header.levelCount) return false;
+
+    texture.format = format;
+    texture.width = header.pixelWidth;
+    texture.height = header.pixelHeight;
+    texture.levels.resize(header.levelCount);
+
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        Ktx2Level range;
+        memcpy(&range, data + sizeof(Ktx2Header) + sizeof(Ktx2Level) * level, sizeof(range));
+
+        TextureLevel &textureLevel = texture.levels[level];
+        textureLevel.width = std::max(header.pixelWidth >> level, 1u);
+        textureLevel.height = std::max(header.pixelHeight >> level, 1u);
+        textureLevel.size = textureLevelSize(format, textureLevel.width, textureLevel.height);
+        if (range.byteLength != textureLevel.size || range.byteOffset > size || range.byteLength > size - range.byteOffset) {
+            return false;
+        }
+        textureLevel.data = data + range.byteOffset;
+    }
+
+    if (keyValues != nullptr) {
+        keyValues->clear();
+        if (header.kvdByteOffset > size || header.kvdByteLength > size - header.kvdByteOffset) return false;
+        if (!parseKeyValues(data + header.kvdByteOffset, header.kvdByteLength, *keyValues)) return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "texture_data.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wvk {
+
+/*
+ * KTX2 container for 2D textures with a mip chain. The header and level index are followed by the data format
+ * descriptor, the key/value data and the levels, smallest first, each aligned to 16 bytes so a level can be copied
+ * into a staging buffer as it is. Only single layer, single face textures without supercompression are read and
+ * written, in the formats isTextureFormat() accepts. Fields are little endian like the KTX2 spec requires, which is
+ * the native byte order of every platform the engine runs on.
+ */
+
+struct Ktx2KeyValue {
+    std::string key;
+    std::vector<uint8_t> value;
+};
+
+std::vector<uint8_t> serializeKtx2(const TextureView &texture, const std::vector<Ktx2KeyValue> &keyValues);
+
+// Points texture's levels into the contents of a KTX2 file. Returns false for malformed files and ones the engine
+// can't upload. keyValues, if given, receives the key/value data.
+bool parseKtx2(const uint8_t *data, size_t size, TextureView &texture, std::vector<Ktx2KeyValue> *keyValues = nullptr);
+
+}
@@ -0,0 +1,196 @@
+#include "texture_cooker.h"
+
+#include "block_compression.h"
+#include "ktx2_file.h"
+#include "../cpu_profiler.h"
+#include "../derived_data_cache.h"
+
+#include <stb_image.h>
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace wvk {
+
+static const char *SOURCE_KEY = "WvkSource";
+static const char *WRITER_KEY = "KTXwriter";
+
+/* Color spaces */
+
+static const std::array<float, 256> &srgbToLinearTable() {
+    static const std::array<float, 256> table = []() {
+        std::array<float, 256> values{};
+        for (int i = 0; i < 256; i++) {
+            float srgb = i / 255.f;
+            values[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table;
+}
+
+static uint8_t linearToSrgb(float linear) {
+    float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(std::lround(srgb * 255.f), 0l, 255l));
+}
+
+static uint8_t unorm8(float value) {
+    return static_cast<uint8_t>(std::clamp(std::lround(value * 255.f), 0l, 255l));
+}
+
+/* Cooking */
+
+uint64_t cookedTextureKey(const CookedTextureSource &source) {
+    return derivedDataKey("cooked texture", COOKED_TEXTURE_VERSION, source.contentHash, &source.type,
+                          sizeof(source.type));
+}
+
+VkFormat cookedTextureFormat(TextureType type) {
+    switch (type) {
+        case TEXTURE_NORMAL: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case TEXTURE_MASK: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        default: return VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+}
+
+std::vector<std::vector<uint8_t>> generateMips(const uint8_t *pixels, uint32_t width, uint32_t height, TextureType type) {
+    WVK_PROFILE_ZONE("generate mips");
+
+    const std::array<float, 256> &toLinear = srgbToLinearTable();
+
+    std::vector<std::vector<uint8_t>> levels;
+    levels.emplace_back(pixels, pixels + static_cast<size_t>(width) * height * 4);
+
+    while (width > 1 || height > 1) {
+        const std::vector<uint8_t> &source = levels.back();
+        uint32_t levelWidth = std::max(width / 2, 1u);
+        uint32_t levelHeight = std::max(height / 2, 1u);
+        std::vector<uint8_t> level(static_cast<size_t>(levelWidth) * levelHeight * 4);
+
+        for (uint32_t y = 0; y < levelHeight; y++) {
+            for (uint32_t x = 0; x < levelWidth; x++) {
+                // The 2x2 texels this one covers, odd sizes repeat the last row or column
+                const uint8_t *texels[4];
+                uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+                texels[0] = &source[(static_cast<size_t>(y0) * width + x0) * 4];
+                texels[1] = &source[(static_cast<size_t>(y0) * width + x1) * 4];
+                texels[2] = &source[(static_cast<size_t>(y1) * width + x0) * 4];
+                texels[3] = &source[(static_cast<size_t>(y1) * width + x1) * 4];
+
+                float sum[4] = {};
+                for (const uint8_t *texel : texels) {
+                    for (int c = 0; c < 4; c++) {
+                        if (type == TEXTURE_COLOR && c < 3) sum[c] += toLinear[texel[c]];
+                        else if (type == TEXTURE_NORMAL && c < 3) sum[c] += texel[c] / 127.5f - 1.f;
+                        else sum[c] += texel[c] / 255.f;
+                    }
+                }
+
+                uint8_t *texel = &level[(static_cast<size_t>(y) * levelWidth + x) * 4];
+                if (type == TEXTURE_COLOR) {
+                    for (int c = 0; c < 3; c++) {
+                        texel[c] = linearToSrgb(sum[c] / 4.f);
+                    }
+                } else if (type == TEXTURE_NORMAL) {
+                    float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                    for (int c = 0; c < 3; c++) {
+                        float normal = length > 1e-6f ? sum[c] / length : (c == 2 ? 1.f : 0.f);
+                        texel[c] = unorm8(normal * 0.5f + 0.5f);
+                    }
+                } else {
+                    for (int c = 0; c < 3; c++) {
+                        texel[c] = unorm8(sum[c] / 4.f);
+                    }
+                }
+                texel[3] = unorm8(sum[3] / 4.f);
+            }
+        }
+
+        levels.push_back(std::move(level));
+        width = levelWidth;
+        height = levelHeight;
+    }
+    return levels;
+}
+
+CookedTexture cookTexture(const uint8_t *pixels, uint32_t width, uint32_t height, TextureType type) {
+    WVK_PROFILE_ZONE("cook texture");
+
+    CookedTexture texture{};
+    texture.format = cookedTextureFormat(type);
+    texture.width = width;
+    texture.height = height;
+
+    std::vector<std::vector<uint8_t>> mips = generateMips(pixels, width, height, type);
+    for (uint32_t level = 0; level < mips.size(); level++) {
+        uint32_t levelWidth = std::max(width >> level, 1u);
+        uint32_t levelHeight = std::max(height >> level, 1u);
+        texture.levels.push_back(encodeTextureLevel(texture.format, mips[level].data(), levelWidth, levelHeight));
+    }
+    return texture;
+}
+
+CookedTexture cookTextureImage(const uint8_t *data, size_t size, const std::string &name, TextureType type) {
+    int width, height, channels;
+    stbi_uc *pixels;
+    {
+        WVK_PROFILE_ZONE("decode image");
+        pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, STBI_rgb_alpha);
+    }
+    if (!pixels) {
+        throw std::runtime_error("failed to decode image file. name: " + name);
+    }
+
+    CookedTexture texture = cookTexture(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), type);
+    stbi_image_free(pixels);
+    return texture;
+}
+
+TextureView viewCookedTexture(const CookedTexture &texture) {
+    TextureView view{};
+    view.format = texture.format;
+    view.width = texture.width;
+    view.height = texture.height;
+    for (uint32_t level = 0; level < texture.levels.size(); level++) {
+        TextureLevel textureLevel{};
+        textureLevel.width = std::max(texture.width >> level, 1u);
+        textureLevel.height = std::max(texture.height >> level, 1u);
+        textureLevel.data = texture.levels[level].data();
+        textureLevel.size = texture.levels[level].size();
+        view.levels.push_back(textureLevel);
+    }
+    return view;
+}
+
+/* Files */
+
+std::vector<uint8_t> serializeCookedTexture(const CookedTexture &texture, const CookedTextureSource &source) {
+    Ktx2KeyValue sourceValue{SOURCE_KEY, std::vector<uint8_t>(sizeof(source))};
+    memcpy(sourceValue.value.data(), &source, sizeof(source));
+
+    std::string writer = "WaywardVK";
+    Ktx2KeyValue writerValue{WRITER_KEY, std::vector<uint8_t>(writer.c_str(), writer.c_str() + writer.size() + 1)};
+
+    return serializeKtx2(viewCookedTexture(texture), {sourceValue, writerValue});
+}
+
+bool parseCookedTexture(const uint8_t *data, size_t size, const CookedTextureSource &source, TextureView &view) {
+    std::vector<Ktx2KeyValue> keyValues;
+    if (!parseKtx2(data, size, view, &keyValues)) return false;
+
+    for (const Ktx2KeyValue &keyValue : keyValues) {
+        if (keyValue.key != SOURCE_KEY || keyValue.value.size() != sizeof(CookedTextureSource)) continue;
+
+        CookedTextureSource cooked{};
+        memcpy(&cooked, keyValue.value.data(), sizeof(cooked));
+        if (cooked.version != COOKED_TEXTURE_VERSION || cooked.type != source.type) return false;
+        if (cooked.contentHash != source.contentHash) return false;
+        return view.format == cookedTextureFormat(static_cast<TextureType>(cooked.type));
+    }
+    return false;
+}
+
+}
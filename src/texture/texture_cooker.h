@@ -0,0 +1,68 @@
+#pragma once
+
+#include "texture_data.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wvk {
+
+/*
+ * Cooked textures are block compressed on the CPU with their full mip chain and stored as KTX2 in the derived data
+ * cache, so the device samples 4 to 8 times fewer bytes than from RGBA8 and loading a texture is a memory map. The
+ * format follows from what the texture holds:
+ *
+ *   TEXTURE_COLOR   BC7 sRGB, 1 byte per texel with alpha
+ *   TEXTURE_NORMAL  BC5, the X and Y of tangent space normals, shaders reconstruct Z
+ *   TEXTURE_MASK    BC1 linear, 0.5 byte per texel for packed single channel masks
+ *
+ * The source is recorded in the KTX2 key/value data, COOKED_TEXTURE_VERSION must be bumped whenever the encoders or
+ * the mip filters change.
+ */
+
+enum TextureType : uint32_t {
+    TEXTURE_COLOR,
+    TEXTURE_NORMAL,
+    TEXTURE_MASK,
+};
+
+constexpr uint32_t COOKED_TEXTURE_VERSION = 2;
+
+// Identifies the source contents and type a texture was cooked from, it is cooked again when these change
+struct CookedTextureSource {
+    uint32_t version = COOKED_TEXTURE_VERSION;
+    uint32_t type = 0;
+    uint64_t contentHash = 0;   // of the source file, see DerivedDataCache::sourceHash()
+};
+
+// Derived data cache key of the texture cooked from source
+uint64_t cookedTextureKey(const CookedTextureSource &source);
+
+struct CookedTexture {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint8_t>> levels;   // largest first
+};
+
+VkFormat cookedTextureFormat(TextureType type);
+
+// RGBA8 mip chain of an image down to 1x1, starting with a copy of the image. Each level is a 2x2 box filter of the
+// one above, color in linear space and normals renormalized.
+std::vector<std::vector<uint8_t>> generateMips(const uint8_t *pixels, uint32_t width, uint32_t height, TextureType type);
+
+CookedTexture cookTexture(const uint8_t *pixels, uint32_t width, uint32_t height, TextureType type);
+// Decodes the contents of an image file and cooks it, name is used in messages. Throws std::runtime_error if the image
+// can't be decoded.
+CookedTexture cookTextureImage(const uint8_t *data, size_t size, const std::string &name, TextureType type);
+
+TextureView viewCookedTexture(const CookedTexture &texture);
+
+std::vector<uint8_t> serializeCookedTexture(const CookedTexture &texture, const CookedTextureSource &source);
+
+// Points view into the contents of a cooked KTX2 file. Returns false if the file is malformed, from another version,
+// or was cooked from a different source than the given one.
+bool parseCookedTexture(const uint8_t *data, size_t size, const CookedTextureSource &source, TextureView &view);
+
+}
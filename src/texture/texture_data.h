@@ -0,0 +1,83 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wvk {
+
+// Texels of one mip level, tightly packed rows of pixels or 4x4 blocks
+struct TextureLevel {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+// Non owning view of a texture and its mip chain, largest level first
+struct TextureView {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<TextureLevel> levels;
+};
+
+inline bool isBlockCompressed(VkFormat format) {
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+inline bool isSrgb(VkFormat format) {
+    return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ||
+           format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+// Formats textures are stored and uploaded in, the BCn formats are the ones the cooker writes
+inline bool isTextureFormat(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Bytes of a pixel, or of a 4x4 block for the block compressed formats
+inline uint32_t texelBlockSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            return 8;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+inline size_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+    if (!isBlockCompressed(format)) return static_cast<size_t>(width) * height * texelBlockSize(format);
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * texelBlockSize(format);
+}
+
+// Levels of a full mip chain, down to 1x1
+inline uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while (std::max(width, height) >> levels > 0) {
+        levels++;
+    }
+    return levels;
+}
+
+}
@@ -0,0 +1,53 @@
+#include "../asset/asset_archive.h"
+#include "../asset/asset_file_system.h"
+
+#include <logger.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Packs every asset below a resource directory into an archive, which AssetFileSystem mounts when it's named
+// resources.wpak and placed in the resource directory
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        logger::print("usage: WaywardPack <resource dir> <output .wpak>");
+        return 1;
+    }
+    std::string directory = argv[1];
+    std::string outputPath = argv[2];
+
+    std::vector<wvk::ArchiveFile> files;
+    uint64_t totalSize = 0;
+    for (const std::string &path : wvk::findAssetFiles(directory)) {
+        std::ifstream input{path, std::ios::binary};
+        if (!input.is_open()) {
+            logger::error("failed to read " + path);
+            return 1;
+        }
+        wvk::ArchiveFile file{std::filesystem::path(path).filename().string(),
+                              std::vector<uint8_t>(std::istreambuf_iterator<char>(input), {})};
+        totalSize += file.contents.size();
+        files.push_back(std::move(file));
+    }
+
+    std::vector<uint8_t> archive;
+    std::string error;
+    if (!wvk::serializeArchive(files, archive, error)) {
+        logger::error(error);
+        return 1;
+    }
+
+    std::ofstream output{outputPath, std::ios::binary | std::ios::trunc};
+    output.write(reinterpret_cast<const char *>(archive.data()), static_cast<std::streamsize>(archive.size()));
+    if (!output) {
+        logger::error("failed to write " + outputPath);
+        return 1;
+    }
+
+    logger::print("Packed " + std::to_string(files.size()) + " assets, " + std::to_string(totalSize) + " bytes into " +
+                  std::to_string(archive.size()) + " bytes");
+    return 0;
+}
@@ -0,0 +1,271 @@
+#include "wvk_asset_streamer.h"
+
+#include "cpu_profiler.h"
+
+#include <logger.h>
+
+#include <algorithm>
+#include <array>
+
+namespace wvk {
+
+// Unit box drawn in place of models that aren't resident yet
+static WvkModel *createPlaceholderModel(WvkDevice &device) {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+
+    for (int axis = 0; axis < 3; axis++) {
+        for (float side : {-1.f, 1.f}) {
+            glm::vec3 normal{0.f};
+            normal[axis] = side;
+            glm::vec3 u{0.f};
+            u[(axis + 1) % 3] = 1.f;
+            glm::vec3 v{0.f};
+            v[(axis + 2) % 3] = 1.f;
+
+            uint32_t first = static_cast<uint32_t>(vertices.size());
+            for (glm::vec2 corner : {glm::vec2{0.f, 0.f}, glm::vec2{1.f, 0.f}, glm::vec2{1.f, 1.f}, glm::vec2{0.f, 1.f}}) {
+                glm::vec3 position = 0.5f * normal + (corner.x - 0.5f) * u + (corner.y - 0.5f) * v;
+                vertices.push_back({position, normal, corner, 0});
+            }
+            for (uint32_t index : {0u, 1u, 2u, 0u, 2u, 3u}) {
+                indices.push_back(first + index);
+            }
+        }
+    }
+
+    return new WvkModel(device, vertices, indices);
+}
+
+static float cameraDistance(const Bounds &bounds, const glm::vec3 &cameraPosition) {
+    if (!bounds.valid()) return 0.f;
+    return glm::length(glm::max(glm::max(bounds.min - cameraPosition, cameraPosition - bounds.max), glm::vec3{0.f}));
+}
+
+WvkAssetStreamer::WvkAssetStreamer(WvkDevice &device, uint32_t threadCount) : device{device} {
+    placeholderModel.reset(createPlaceholderModel(device));
+
+    // Grey checkerboard, shown until the real texture is resident
+    const uint32_t size = 8;
+    std::vector<uint8_t> pixels(size * size * 4);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint8_t value = (x + y) % 2 == 0 ? 96 : 160;
+            uint8_t *pixel = &pixels[(y * size + x) * 4];
+            pixel[0] = pixel[1] = pixel[2] = value;
+            pixel[3] = 255;
+        }
+    }
+    placeholderImage = Image{device, size, size, pixels.data()};
+
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (uint32_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&WvkAssetStreamer::work, this);
+    }
+    logger::debug("Started " + std::to_string(threadCount) + " asset streaming threads");
+}
+
+WvkAssetStreamer::~WvkAssetStreamer() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+        pending.clear();
+    }
+    jobAvailable.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // Destroying the batches waits for them
+    uploads.clear();
+    decoded.clear();
+
+    placeholderImage.cleanup();
+}
+
+void WvkAssetStreamer::request(std::unique_ptr<Job> job) {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        pending.push_back(std::move(job));
+        queueDepth++;
+    }
+    jobAvailable.notify_one();
+}
+
+WvkModel *WvkAssetStreamer::loadModel(AssetId id, int textureId) {
+    WvkModel *model = new WvkModel(device, *placeholderModel, textureId);
+    auto file = std::make_shared<ModelFile>();
+
+    auto job = std::make_unique<Job>();
+    job->name = assetFileSystem().getName(id);
+    job->decode = [file, id, textureId]() {
+        file->load(id, textureId);
+    };
+    job->upload = [model, file](WvkUploadBatch &batch) mutable {
+        model->upload(file->view, batch);
+        file.reset();
+    };
+    job->ready = [model]() { model->makeResident(); };
+    job->bounds = [model]() { return model->getBounds(); };
+
+    request(std::move(job));
+    return model;
+}
+
+WvkSkeleton *WvkAssetStreamer::loadSkeleton(AssetId id) {
+    WvkSkeleton *skeleton = new WvkSkeleton(device);
+    auto loaded = std::make_shared<std::unique_ptr<Skeleton>>();
+
+    auto job = std::make_unique<Job>();
+    job->name = assetFileSystem().getName(id);
+    job->decode = [loaded, id]() {
+        *loaded = std::make_unique<Skeleton>(id);
+    };
+    job->upload = [skeleton, loaded](WvkUploadBatch &batch) {
+        skeleton->upload(**loaded, batch);
+        loaded->reset();
+    };
+    job->ready = [skeleton]() { skeleton->makeResident(); };
+    job->bounds = [skeleton]() {
+        // The mesh bounds aren't known yet, only where the skeleton stands
+        Bounds bounds{};
+        bounds.extend(glm::vec3(skeleton->getTransform()[3]));
+        return bounds;
+    };
+
+    request(std::move(job));
+    return skeleton;
+}
+
+void WvkAssetStreamer::loadImage(AssetId id, Image &image, std::function<void()> onReady, TextureType type) {
+    Image *target = &image;
+    auto file = std::make_shared<TextureFile>();
+
+    auto job = std::make_unique<Job>();
+    job->name = assetFileSystem().getName(id);
+    job->decode = [file, id, type]() {
+        file->load(id, type);
+    };
+    job->upload = [target, file](WvkUploadBatch &batch) mutable {
+        batch.uploadTexture(file->view, *target);
+        file.reset();
+    };
+    job->ready = std::move(onReady);
+
+    request(std::move(job));
+}
+
+void WvkAssetStreamer::stream(const std::string &name, std::function<void()> decode,
+                              std::function<void(WvkUploadBatch &)> upload, std::function<void()> ready) {
+    auto job = std::make_unique<Job>();
+    job->name = name;
+    job->decode = std::move(decode);
+    job->upload = std::move(upload);
+    job->ready = std::move(ready);
+
+    request(std::move(job));
+}
+
+void WvkAssetStreamer::work() {
+    WVK_PROFILE_THREAD("asset streamer");
+
+    while (true) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            jobAvailable.wait(lock, [this]() { return stopping || !pending.empty(); });
+            if (stopping) return;
+
+            auto next = std::min_element(pending.begin(), pending.end(),
+                                         [](const std::unique_ptr<Job> &a, const std::unique_ptr<Job> &b) {
+                                             return a->priority < b->priority;
+                                         });
+            job = std::move(*next);
+            pending.erase(next);
+        }
+
+        bool loaded = true;
+        try {
+            WVK_PROFILE_ZONE("decode asset");
+            job->decode();
+        } catch (const std::exception &exception) {
+            // The asset keeps its placeholder
+            logger::error("Failed to stream " + job->name + ": " + exception.what());
+            loaded = false;
+        }
+        job->decode = nullptr;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        if (loaded) {
+            decoded.push_back(std::move(job));
+        } else {
+            queueDepth--;
+        }
+    }
+}
+
+void WvkAssetStreamer::update(const glm::vec3 &cameraPosition) {
+    WVK_PROFILE_ZONE("asset streamer update");
+
+    // Uploads finish in order, their staging memory is released with the batch
+    size_t finished = 0;
+    while (finished < uploads.size() && uploads[finished].batch->finished()) {
+        for (std::unique_ptr<Job> &job : uploads[finished].jobs) {
+            if (job->ready) job->ready();
+        }
+        std::lock_guard<std::mutex> lock{mutex};
+        queueDepth -= static_cast<uint32_t>(uploads[finished].jobs.size());
+        finished++;
+    }
+    uploads.erase(uploads.begin(), uploads.begin() + finished);
+
+    // Priorities are updated every frame, the camera and the instances move
+    auto updatePriority = [&](Job &job) {
+        job.priority = job.bounds ? cameraDistance(job.bounds(), cameraPosition) : -1.f;
+    };
+
+    std::vector<std::unique_ptr<Job>> ready;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (std::unique_ptr<Job> &job : pending) {
+            updatePriority(*job);
+        }
+        ready.swap(decoded);
+    }
+    if (ready.empty()) return;
+
+    for (std::unique_ptr<Job> &job : ready) {
+        updatePriority(*job);
+    }
+    std::sort(ready.begin(), ready.end(), [](const std::unique_ptr<Job> &a, const std::unique_ptr<Job> &b) {
+        return a->priority < b->priority;
+    });
+
+    UploadBatch upload{std::make_unique<WvkUploadBatch>(device), {}};
+    size_t count = 0;
+    while (count < ready.size() && upload.batch->getSize() < UPLOAD_BUDGET) {
+        ready[count]->upload(*upload.batch);
+        ready[count]->upload = nullptr;
+        upload.jobs.push_back(std::move(ready[count]));
+        count++;
+    }
+
+    if (count < ready.size()) {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (size_t i = count; i < ready.size(); i++) {
+            decoded.push_back(std::move(ready[i]));
+        }
+    }
+
+    upload.batch->submit();
+    uploads.push_back(std::move(upload));
+}
+
+uint32_t WvkAssetStreamer::getQueueDepth() {
+    std::lock_guard<std::mutex> lock{mutex};
+    return queueDepth;
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "wvk_device.h"
+#include "wvk_image.h"
+#include "wvk_model.h"
+#include "wvk_skeleton.h"
+#include "wvk_upload_batch.h"
+#include "bounds.h"
+#include "glm.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace wvk {
+
+/*
+ * Loads models, skeletons and images in the background. Requests return right away: files are read, decoded and
+ * cooked on worker threads, and update() uploads the finished ones from the main thread in one batch per frame.
+ * An asset is made resident once the fence of its batch has signaled, until then models are drawn as a placeholder
+ * box with the placeholder texture and skeletons aren't drawn.
+ *
+ * Assets closest to the camera are decoded and uploaded first. Requested assets have to stay alive until they are
+ * resident or the streamer is destroyed.
+ */
+class WvkAssetStreamer {
+  public:
+    // Bytes staged per frame, further decoded assets wait for the next frame so one frame doesn't stall on a burst
+    static constexpr VkDeviceSize UPLOAD_BUDGET = 32 * 1024 * 1024;
+
+    // threadCount 0 uses a worker for every core but the main thread's
+    WvkAssetStreamer(WvkDevice &device, uint32_t threadCount = 0);
+    // Drops the requests that haven't been uploaded and waits for the uploads in flight
+    ~WvkAssetStreamer();
+
+    WvkAssetStreamer(const WvkAssetStreamer &) = delete;
+    WvkAssetStreamer &operator=(const WvkAssetStreamer &) = delete;
+
+    // Loads an OBJ or .glb model like the WvkModel file constructor. The caller owns the returned model.
+    WvkModel *loadModel(AssetId id, int textureId);
+    // Loads a .glb skeleton like the WvkSkeleton file constructor. The caller owns the returned skeleton.
+    WvkSkeleton *loadSkeleton(AssetId id);
+    // Loads an image from the resource directory into image, cooking it to the format of its type on first load.
+    // onReady is called on the main thread once it can be sampled, images are loaded before models as they're
+    // shared by many.
+    void loadImage(AssetId id, Image &image, std::function<void()> onReady,
+                   TextureType type = TEXTURE_COLOR);
+    // Runs decode on a worker, then upload and ready on the main thread like the jobs above, at the priority of
+    // shared assets. For assets with their own residency management, like texture mip levels.
+    void stream(const std::string &name, std::function<void()> decode, std::function<void(WvkUploadBatch &)> upload,
+                std::function<void()> ready);
+
+    // Called once per frame on the main thread, before the frame is recorded. Makes finished uploads resident and
+    // uploads decoded assets, closest to the camera first.
+    void update(const glm::vec3 &cameraPosition);
+
+    // Requested assets that aren't resident yet
+    uint32_t getQueueDepth();
+
+    const WvkModel &getPlaceholderModel() { return *placeholderModel; }
+    const Image &getPlaceholderImage() { return placeholderImage; }
+
+  private:
+    struct Job {
+        std::string name;
+        std::function<void()> decode;                  // worker thread
+        std::function<void(WvkUploadBatch &)> upload;  // main thread
+        std::function<void()> ready;                   // main thread, once the upload has finished
+        std::function<Bounds()> bounds;                // world space bounds, none for shared assets
+        float priority = 0.f;                          // distance to the camera, lowest first
+    };
+
+    struct UploadBatch {
+        std::unique_ptr<WvkUploadBatch> batch;
+        std::vector<std::unique_ptr<Job>> jobs;
+    };
+
+    void request(std::unique_ptr<Job> job);
+    void work();
+
+    WvkDevice &device;
+
+    std::unique_ptr<WvkModel> placeholderModel;
+    Image placeholderImage;
+
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    bool stopping = false;
+    std::vector<std::unique_ptr<Job>> pending;   // waiting for a worker
+    std::vector<std::unique_ptr<Job>> decoded;   // waiting for an upload
+    uint32_t queueDepth = 0;
+
+    std::vector<UploadBatch> uploads;            // submitted, main thread only
+    std::vector<std::thread> workers;
+};
+
+}
@@ -3,6 +3,8 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "wvk_memory.h"
+
 namespace wvk {
 
 // A VkBuffer backed by device memory
@@ -14,9 +16,11 @@ struct Buffer {
     VkDeviceSize size;
 
     VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker *memoryTracker = nullptr;
 
     void cleanup() {
         if (device == VK_NULL_HANDLE) return;
+        if (memoryTracker != nullptr) memoryTracker->untrack(memory);
         vkDestroyBuffer(device, buffer, nullptr);
         vkFreeMemory(device, memory, nullptr);
     }
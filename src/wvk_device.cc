@@ -1,6 +1,8 @@
 #include "wvk_device.h"
 #include "wvk_helper.h"
+#include "derived_data_cache.h"
 
+#include <cstring>
 #include <string>
 #include <set>
 #include <vector>
@@ -32,6 +34,8 @@ WvkDevice::WvkDevice(WvkWindow &window) : window{window} {
     logger::debug("Created logical device");
     createCommandPool();
     logger::debug("Created command pool");
+    createPipelineCache();
+    logger::debug("Created pipeline cache");
 }
 
 WvkDevice::~WvkDevice() {
@@ -42,6 +46,8 @@ WvkDevice::~WvkDevice() {
         }
     }
 
+    savePipelineCache();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
     vkDestroyCommandPool(device, commandPool, nullptr);
     vkDestroyDevice(device, nullptr);
     vkDestroySurfaceKHR(instance, surface, nullptr);
@@ -262,6 +268,14 @@ void WvkDevice::pickPhysicalDevice() {
 
 void WvkDevice::cachePhysicalDeviceProperties() {
     vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties.vk);
+    vkGetPhysicalDeviceFeatures(physicalDevice, &physicalDeviceProperties.features);
+
+    uint32_t queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+    physicalDeviceProperties.timestampValidBits = queueFamilyProperties[queueIndices.graphicsQueue].timestampValidBits;
 
     VkSampleCountFlags counts = physicalDeviceProperties.vk.limits.framebufferColorSampleCounts &
                                 physicalDeviceProperties.vk.limits.framebufferDepthSampleCounts;
@@ -298,6 +312,12 @@ void WvkDevice::createLogicalDevice() {
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    // Optional features, only enabled when the physical device supports them
+    deviceFeatures.pipelineStatisticsQuery = physicalDeviceProperties.features.pipelineStatisticsQuery;
+    deviceFeatures.multiDrawIndirect = physicalDeviceProperties.features.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = physicalDeviceProperties.features.drawIndirectFirstInstance;
+    deviceFeatures.textureCompressionBC = physicalDeviceProperties.features.textureCompressionBC;
+
     // Create device
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -318,6 +338,8 @@ void WvkDevice::createLogicalDevice() {
     VkResult result = vkCreateDevice(physicalDevice, &createInfo, nullptr, &device);
     checkVulkanError(result, "failed to create logical device");
 
+    enabledFeatures = deviceFeatures;
+
     vkGetDeviceQueue(device, queueIndices.graphicsQueue, 0, &graphicsQueue);
     vkGetDeviceQueue(device, queueIndices.presentQueue, 0, &presentQueue);
 }
@@ -337,9 +359,16 @@ uint32_t WvkDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags pr
     logger::fatal_error("failed to find suitable memory type.");
 }
 
+bool WvkDevice::supportsFormatFeatures(VkFormat format, VkFormatFeatureFlags features) {
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    return (properties.optimalTilingFeatures & features) == features;
+}
+
 void WvkDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
                              Buffer &buffer) {
     buffer.device = device;
+    buffer.memoryTracker = &memoryTracker;
     buffer.size = size;
 
     VkBufferCreateInfo bufferInfo{};
@@ -363,13 +392,26 @@ void WvkDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemo
     checkVulkanError(result, "failed to allocate buffer device memory");
 
     vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0);
+
+    MemoryCategory category = MEMORY_OTHER;
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+        category = MEMORY_VERTEX_BUFFER;
+    } else if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+        category = MEMORY_INDEX_BUFFER;
+    } else if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+        category = MEMORY_UNIFORM_BUFFER;
+    } else if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+        category = MEMORY_STAGING_BUFFER;
+    }
+    memoryTracker.track(buffer.memory, category, memRequirements.size);
 }
 
 void WvkDevice::createImage(uint32_t width, uint32_t height,
                             VkFormat format, VkImageTiling tiling,
                             VkSampleCountFlagBits samples,
                             VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-                            VkImage &image, VkDeviceMemory &imageMemory) {
+                            VkImage &image, VkDeviceMemory &imageMemory,
+                            uint32_t arrayLayers, uint32_t mipLevels) {
     // Create VkImage
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -379,8 +421,8 @@ void WvkDevice::createImage(uint32_t width, uint32_t height,
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = arrayLayers;
     imageInfo.samples = samples;
     imageInfo.tiling = tiling;
     imageInfo.usage = usage;
@@ -407,13 +449,18 @@ void WvkDevice::createImage(uint32_t width, uint32_t height,
 
     // Bind the device memory to the image
     vkBindImageMemory(device, image, imageMemory, 0);
+
+    bool renderTarget = usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    memoryTracker.track(imageMemory, renderTarget ? MEMORY_RENDER_TARGET : MEMORY_TEXTURE, memRequirements.size);
 }
 
-VkImageView WvkDevice::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+VkImageView WvkDevice::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+                                       VkImageViewType viewType, uint32_t baseArrayLayer, uint32_t layerCount,
+                                       uint32_t levelCount) {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = image;
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.viewType = viewType;
     viewInfo.format = format;
 
     // TODO: unnecessary ?
@@ -424,9 +471,9 @@ VkImageView WvkDevice::createImageView(VkImage image, VkFormat format, VkImageAs
 
     viewInfo.subresourceRange.aspectMask = aspectFlags;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
+    viewInfo.subresourceRange.levelCount = levelCount;
+    viewInfo.subresourceRange.baseArrayLayer = baseArrayLayer;
+    viewInfo.subresourceRange.layerCount = layerCount;
 
     VkImageView imageView;
     VkResult result = vkCreateImageView(device, &viewInfo, NULL, &imageView);
@@ -445,6 +492,63 @@ void WvkDevice::createCommandPool() {
     checkVulkanError(result, "failed to create command pool");
 }
 
+/* Pipeline cache */
+
+static const uint32_t PIPELINE_CACHE_VERSION = 1;
+static const char *PIPELINE_CACHE_EXTENSION = "pipelines";
+
+uint64_t WvkDevice::pipelineCacheKey() {
+    struct {
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    } identity{};
+    const VkPhysicalDeviceProperties &properties = physicalDeviceProperties.vk;
+    identity.vendorID = properties.vendorID;
+    identity.deviceID = properties.deviceID;
+    identity.driverVersion = properties.driverVersion;
+    memcpy(identity.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    return derivedDataKey("pipeline cache", PIPELINE_CACHE_VERSION, hashBytes(&identity, sizeof(identity)));
+}
+
+void WvkDevice::createPipelineCache() {
+    MappedFile cached;
+    bool found = derivedDataCache().open(pipelineCacheKey(), PIPELINE_CACHE_EXTENSION, cached);
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = found ? cached.getSize() : 0;
+    cacheInfo.pInitialData = found ? cached.getData() : nullptr;
+
+    // Drivers ignore data they didn't write, but some fail instead, so those start over with an empty cache
+    VkResult result = vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache);
+    if (result != VK_SUCCESS && found) {
+        logger::error("Discarding the pipeline cache the driver rejected");
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache);
+    }
+    checkVulkanError(result, "failed to create pipeline cache");
+
+    if (found) {
+        logger::debug("Loaded " + std::to_string(cached.getSize()) + " bytes of cached pipelines");
+    }
+}
+
+void WvkDevice::savePipelineCache() {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) return;
+
+    std::vector<uint8_t> data(size);
+    if (vkGetPipelineCacheData(device, pipelineCache, &size, data.data()) != VK_SUCCESS) return;
+
+    if (!derivedDataCache().write(pipelineCacheKey(), PIPELINE_CACHE_EXTENSION, data.data(), size)) {
+        logger::error("Failed to save the pipeline cache");
+    }
+}
+
 VkCommandBuffer WvkDevice::beginSingleTimeCommands() {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
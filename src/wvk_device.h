@@ -2,6 +2,7 @@
 
 #include "wvk_window.h"
 #include "wvk_buffer.h"
+#include "wvk_memory.h"
 
 #include <logger.h>
 
@@ -19,8 +20,12 @@ struct QueueIndices {
 
 struct PhysicalDeviceProperties {
     VkPhysicalDeviceProperties vk;
+    VkPhysicalDeviceFeatures features;
 
     VkSampleCountFlagBits maxSampleCount;
+
+    // Valid bits of timestamps written on the graphics queue (0 if timestamps are unsupported)
+    uint32_t timestampValidBits;
 };
 
 class WvkDevice {
@@ -53,13 +58,20 @@ class WvkDevice {
     VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
     VkDevice getDevice() { return device; }
     VkCommandPool getCommandPool() { return commandPool; }
+    // Pipelines created through it reuse the code the driver compiled for them in previous runs
+    VkPipelineCache getPipelineCache() { return pipelineCache; }
     PhysicalDeviceProperties getPhysicalDeviceProperties() { return physicalDeviceProperties; }
+    const VkPhysicalDeviceFeatures &getEnabledFeatures() { return enabledFeatures; }
+    MemoryTracker &getMemoryTracker() { return memoryTracker; }
 
     QueueIndices getQueueIndices() { return queueIndices; }
     VkQueue getGraphicsQueue() { return graphicsQueue; }
     VkQueue getPresentQueue() { return presentQueue; }
 
 
+    // Whether images of format in optimal tiling support all of features
+    bool supportsFormatFeatures(VkFormat format, VkFormatFeatureFlags features);
+
     void createBuffer(VkDeviceSize size,
                       VkBufferUsageFlags usage,
                       VkMemoryPropertyFlags properties,
@@ -69,10 +81,14 @@ class WvkDevice {
                      VkFormat format,         VkImageTiling tiling,
                      VkSampleCountFlagBits samples,
                      VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-                     VkImage &image,          VkDeviceMemory &imageMemory);
+                     VkImage &image,          VkDeviceMemory &imageMemory,
+                     uint32_t arrayLayers = 1, uint32_t mipLevels = 1);
 
     VkImageView createImageView(VkImage image, VkFormat format,
-                                VkImageAspectFlags aspectFlags);
+                                VkImageAspectFlags aspectFlags,
+                                VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D,
+                                uint32_t baseArrayLayer = 0, uint32_t layerCount = 1,
+                                uint32_t levelCount = 1);
 
     void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
@@ -89,6 +105,10 @@ class WvkDevice {
     void pickPhysicalDevice();
     void createLogicalDevice();
     void createCommandPool();
+    // The pipeline cache is kept in the derived data cache, keyed by the device and driver it was built by
+    uint64_t pipelineCacheKey();
+    void createPipelineCache();
+    void savePipelineCache();
 
     void cachePhysicalDeviceProperties();
     std::vector<const char*> getRequiredInstanceExtensions();
@@ -104,6 +124,7 @@ class WvkDevice {
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
     VkCommandPool commandPool;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 
     VkDebugUtilsMessengerEXT debugMessenger;
 
@@ -112,6 +133,9 @@ class WvkDevice {
     QueueIndices queueIndices;
 
     PhysicalDeviceProperties physicalDeviceProperties;
+    VkPhysicalDeviceFeatures enabledFeatures{};
+
+    MemoryTracker memoryTracker;
 };
 
 };
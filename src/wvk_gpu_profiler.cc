@@ -0,0 +1,224 @@
+#include "wvk_gpu_profiler.h"
+
+#include "wvk_helper.h"
+
+#include <logger.h>
+
+namespace wvk {
+
+// Order of the results matches the bit order of the flags
+static const VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+static const uint32_t PIPELINE_STATISTICS_COUNT = 5;
+
+void GpuScopeHistory::push(float ms, uint64_t frame) {
+    milliseconds[head] = ms;
+    frames[head] = frame;
+    head = (head + 1) % LENGTH;
+    if (count < LENGTH) count++;
+    total++;
+}
+
+float GpuScopeHistory::average() const {
+    if (count == 0) return 0.f;
+
+    float total = 0.f;
+    for (int i = 0; i < count; i++) {
+        total += milliseconds[i];
+    }
+    return total / count;
+}
+
+WvkGpuProfiler::WvkGpuProfiler(WvkDevice &device, uint32_t frameCount, bool enablePipelineStatistics) : device{device} {
+    PhysicalDeviceProperties props = device.getPhysicalDeviceProperties();
+
+    timestampsEnabled = props.timestampValidBits > 0 && props.vk.limits.timestampPeriod > 0.f;
+    statisticsEnabled = enablePipelineStatistics && device.getEnabledFeatures().pipelineStatisticsQuery;
+    timestampPeriod = props.vk.limits.timestampPeriod;
+    timestampMask = props.timestampValidBits >= 64 ? ~0ull : (1ull << props.timestampValidBits) - 1;
+
+    if (!timestampsEnabled) {
+        logger::debug("GPU timestamps are not supported on the graphics queue, GPU profiling disabled");
+    }
+    if (enablePipelineStatistics && !statisticsEnabled) {
+        logger::debug("Pipeline statistics queries are not supported by this device");
+    }
+
+    frames.resize(frameCount);
+    for (FrameQueries &frame : frames) {
+        createQueryPools(frame);
+    }
+}
+
+WvkGpuProfiler::~WvkGpuProfiler() {
+    VkDevice dev = device.getDevice();
+    for (FrameQueries &frame : frames) {
+        if (frame.timestampPool != VK_NULL_HANDLE) vkDestroyQueryPool(dev, frame.timestampPool, nullptr);
+        if (frame.statisticsPool != VK_NULL_HANDLE) vkDestroyQueryPool(dev, frame.statisticsPool, nullptr);
+    }
+}
+
+void WvkGpuProfiler::createQueryPools(FrameQueries &frame) {
+    if (timestampsEnabled) {
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = MAX_SCOPES * 2;
+
+        VkResult result = vkCreateQueryPool(device.getDevice(), &poolInfo, nullptr, &frame.timestampPool);
+        checkVulkanError(result, "failed to create timestamp query pool");
+    }
+
+    if (statisticsEnabled) {
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount = MAX_SCOPES;
+        poolInfo.pipelineStatistics = PIPELINE_STATISTICS;
+
+        VkResult result = vkCreateQueryPool(device.getDevice(), &poolInfo, nullptr, &frame.statisticsPool);
+        checkVulkanError(result, "failed to create pipeline statistics query pool");
+    }
+}
+
+GpuScopeHistory &WvkGpuProfiler::historyFor(const std::string &name) {
+    auto it = histories.find(name);
+    if (it == histories.end()) {
+        scopeNames.push_back(name);
+        it = histories.emplace(name, GpuScopeHistory{}).first;
+    }
+    return it->second;
+}
+
+const GpuScopeHistory *WvkGpuProfiler::getScopeHistory(const std::string &name) {
+    auto it = histories.find(name);
+    return it == histories.end() ? nullptr : &it->second;
+}
+
+void WvkGpuProfiler::collectResults(FrameQueries &frame) {
+    if (frame.scopes.empty()) return;
+
+    VkDevice dev = device.getDevice();
+
+    // Never wait on the GPU here. If the results of this frame aren't available yet they are dropped.
+    std::vector<uint64_t> timestamps(frame.timestampCount);
+    if (frame.timestampCount > 0) {
+        VkResult result = vkGetQueryPoolResults(dev, frame.timestampPool, 0, frame.timestampCount,
+                                                timestamps.size() * sizeof(uint64_t), timestamps.data(),
+                                                sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) return;
+    }
+
+    std::vector<uint64_t> statistics(frame.statisticsCount * PIPELINE_STATISTICS_COUNT);
+    bool hasStatistics = false;
+    if (frame.statisticsCount > 0) {
+        VkResult result = vkGetQueryPoolResults(dev, frame.statisticsPool, 0, frame.statisticsCount,
+                                                statistics.size() * sizeof(uint64_t), statistics.data(),
+                                                PIPELINE_STATISTICS_COUNT * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        hasStatistics = result == VK_SUCCESS;
+    }
+
+    uint64_t frameBegin = ~0ull;
+    uint64_t frameEnd = 0;
+
+    for (const RecordedScope &scope : frame.scopes) {
+        uint64_t begin = timestamps[scope.beginQuery] & timestampMask;
+        uint64_t end = timestamps[scope.endQuery] & timestampMask;
+        uint64_t ticks = (end - begin) & timestampMask;
+
+        GpuScopeHistory &history = historyFor(scope.name);
+        history.push(static_cast<float>(ticks * timestampPeriod / 1000000.0), frame.frameNumber);
+
+        if (hasStatistics && scope.statisticsQuery >= 0) {
+            const uint64_t *values = &statistics[scope.statisticsQuery * PIPELINE_STATISTICS_COUNT];
+            history.statistics.inputAssemblyPrimitives = values[0];
+            history.statistics.vertexInvocations = values[1];
+            history.statistics.clippingInvocations = values[2];
+            history.statistics.clippingPrimitives = values[3];
+            history.statistics.fragmentInvocations = values[4];
+        }
+
+        if (begin < frameBegin) frameBegin = begin;
+        if (end > frameEnd) frameEnd = end;
+    }
+
+    if (frameEnd > frameBegin) {
+        frameHistory.push(static_cast<float>((frameEnd - frameBegin) * timestampPeriod / 1000000.0), frame.frameNumber);
+    }
+}
+
+void WvkGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    if (!openScopes.empty()) {
+        logger::error("GPU profiler scope was not closed before the next frame");
+        openScopes.clear();
+    }
+
+    currentFrame = enabled ? &frames[frameIndex] : nullptr;
+    if (!timestampsEnabled || !enabled) return;
+
+    // The previous submission using this frame's queries has completed (its fence was waited on by the swapchain)
+    collectResults(*currentFrame);
+
+    currentFrame->scopes.clear();
+    currentFrame->frameNumber = recordedFrames++;
+    currentFrame->timestampCount = 0;
+    currentFrame->statisticsCount = 0;
+
+    vkCmdResetQueryPool(commandBuffer, currentFrame->timestampPool, 0, MAX_SCOPES * 2);
+    if (statisticsEnabled) {
+        vkCmdResetQueryPool(commandBuffer, currentFrame->statisticsPool, 0, MAX_SCOPES);
+    }
+}
+
+void WvkGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string &name) {
+    if (!timestampsEnabled || currentFrame == nullptr) return;
+
+    if (currentFrame->scopes.size() >= MAX_SCOPES) {
+        // Keep the scope stack balanced, but don't record anything for this scope
+        openScopes.push_back(SIZE_MAX);
+        return;
+    }
+
+    RecordedScope scope{};
+    scope.name = name;
+    scope.beginQuery = currentFrame->timestampCount++;
+    scope.endQuery = currentFrame->timestampCount++;
+    scope.statisticsQuery = -1;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, currentFrame->timestampPool, scope.beginQuery);
+
+    // Pipeline statistics queries of the same type can't be nested, so only outermost scopes record them
+    if (statisticsEnabled && openScopes.empty()) {
+        scope.statisticsQuery = currentFrame->statisticsCount++;
+        vkCmdBeginQuery(commandBuffer, currentFrame->statisticsPool, scope.statisticsQuery, 0);
+    }
+
+    openScopes.push_back(currentFrame->scopes.size());
+    currentFrame->scopes.push_back(scope);
+}
+
+void WvkGpuProfiler::endScope(VkCommandBuffer commandBuffer) {
+    if (!timestampsEnabled || currentFrame == nullptr) return;
+
+    if (openScopes.empty()) {
+        logger::error("WvkGpuProfiler::endScope called without a matching beginScope");
+        return;
+    }
+
+    size_t index = openScopes.back();
+    openScopes.pop_back();
+    if (index == SIZE_MAX) return;
+
+    const RecordedScope &scope = currentFrame->scopes[index];
+    if (scope.statisticsQuery >= 0) {
+        vkCmdEndQuery(commandBuffer, currentFrame->statisticsPool, scope.statisticsQuery);
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, currentFrame->timestampPool, scope.endQuery);
+}
+
+}
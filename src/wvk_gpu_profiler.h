@@ -0,0 +1,131 @@
+#pragma once
+
+#include "wvk_device.h"
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace wvk {
+
+struct GpuPipelineStatistics {
+    uint64_t inputAssemblyPrimitives = 0;
+    uint64_t vertexInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentInvocations = 0;
+};
+
+// Ring buffer of the most recent results for one named scope
+struct GpuScopeHistory {
+    static constexpr int LENGTH = 240;
+
+    float milliseconds[LENGTH] = {};
+    uint64_t frames[LENGTH] = {};   // number of the recorded frame each sample was measured in
+    int head = 0;   // index of the next sample to be written
+    int count = 0;  // number of valid samples
+    uint64_t total = 0; // number of samples ever pushed
+
+    GpuPipelineStatistics statistics{};
+
+    float latest() const { return count == 0 ? 0.f : milliseconds[(head + LENGTH - 1) % LENGTH]; }
+    uint64_t latestFrame() const { return count == 0 ? 0 : frames[(head + LENGTH - 1) % LENGTH]; }
+    float average() const;
+    void push(float ms, uint64_t frame);
+};
+
+// Records timestamp (and optionally pipeline statistics) queries around named scopes of a frame's command buffer.
+// One query pool is kept per swapchain image. Results for an image are read back without blocking the next time
+// that image's command buffer is recorded, i.e. once its in-flight fence has been waited on.
+class WvkGpuProfiler {
+  public:
+    static constexpr uint32_t MAX_SCOPES = 32;
+
+    WvkGpuProfiler(WvkDevice &device, uint32_t frameCount, bool enablePipelineStatistics);
+    ~WvkGpuProfiler();
+
+    WvkGpuProfiler(const WvkGpuProfiler &) = delete;
+    WvkGpuProfiler &operator=(const WvkGpuProfiler &) = delete;
+
+    // Must be called right after vkBeginCommandBuffer, before any scope is recorded for this frame
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    void beginScope(VkCommandBuffer commandBuffer, const std::string &name);
+    void endScope(VkCommandBuffer commandBuffer);
+
+    // Disabled profilers record no queries, the last collected results are kept
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+    bool isEnabled() { return enabled; }
+
+    bool timestampsSupported() { return timestampsEnabled; }
+    bool pipelineStatisticsSupported() { return statisticsEnabled; }
+
+    // Total time between the first and last timestamp of the most recently resolved frame
+    const GpuScopeHistory &getFrameHistory() { return frameHistory; }
+    const GpuScopeHistory *getScopeHistory(const std::string &name);
+    const std::vector<std::string> &getScopeNames() { return scopeNames; }
+    // Frames recorded with queries so far, the next recorded frame gets this number
+    uint64_t getRecordedFrameCount() { return recordedFrames; }
+
+  private:
+    struct RecordedScope {
+        std::string name;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+        int statisticsQuery; // -1 if no pipeline statistics were recorded for this scope
+    };
+
+    struct FrameQueries {
+        VkQueryPool timestampPool = VK_NULL_HANDLE;
+        VkQueryPool statisticsPool = VK_NULL_HANDLE;
+
+        std::vector<RecordedScope> scopes;
+        uint64_t frameNumber = 0;
+        uint32_t timestampCount = 0;
+        uint32_t statisticsCount = 0;
+    };
+
+    void createQueryPools(FrameQueries &frame);
+    void collectResults(FrameQueries &frame);
+
+    GpuScopeHistory &historyFor(const std::string &name);
+
+    WvkDevice &device;
+
+    bool enabled = true;
+    bool timestampsEnabled;
+    bool statisticsEnabled;
+    double timestampPeriod; // nanoseconds per timestamp tick
+    uint64_t timestampMask;
+
+    std::vector<FrameQueries> frames;
+    FrameQueries *currentFrame = nullptr;
+    uint64_t recordedFrames = 0;
+    std::vector<size_t> openScopes; // indices into currentFrame->scopes
+
+    std::vector<std::string> scopeNames;
+    std::unordered_map<std::string, GpuScopeHistory> histories;
+    GpuScopeHistory frameHistory;
+};
+
+// Records a profiler scope for the lifetime of the object
+class GpuProfileScope {
+  public:
+    GpuProfileScope(WvkGpuProfiler &profiler, VkCommandBuffer commandBuffer, const std::string &name)
+        : profiler{profiler}, commandBuffer{commandBuffer} {
+        profiler.beginScope(commandBuffer, name);
+    }
+    ~GpuProfileScope() { profiler.endScope(commandBuffer); }
+
+    GpuProfileScope(const GpuProfileScope &) = delete;
+    GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+
+  private:
+    WvkGpuProfiler &profiler;
+    VkCommandBuffer commandBuffer;
+};
+
+}
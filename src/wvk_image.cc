@@ -1,62 +1,83 @@
 #include "wvk_image.h"
+#include "wvk_upload_batch.h"
 
 #include <logger.h>
 
-#include "stb_image.h"
+#include "texture/ktx2_file.h"
+#include "cpu_profiler.h"
+#include "derived_data_cache.h"
 
 namespace wvk {
 
-Image::Image(WvkDevice& wvkDevice, std::string filename) : device{wvkDevice.getDevice()} {
-    // Load pixel data
-    std::string imagePath = resourcePath() + filename;
-    int texWidth, texHeight, texChannels;
+void TextureFile::load(AssetId id, TextureType type) {
+    WVK_PROFILE_ZONE("load texture file");
 
-    stbi_uc* pixels = stbi_load(imagePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    if (!pixels) {
-        logger::fatal_error("failed to load image file. path: " + imagePath);
+    AssetFileSystem &assets = assetFileSystem();
+    std::string filename = assets.getName(id);
+    bool isKtx2 = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".ktx2") == 0;
+    if (isKtx2) {
+        if (!assets.open(id, sourceData) || !parseKtx2(sourceData.getData(), sourceData.getSize(), view)) {
+            logger::fatal_error("failed to load texture file. name: " + filename);
+        }
+        return;
     }
 
-    this->width = static_cast<uint32_t>(texWidth);
-    this->height = static_cast<uint32_t>(texHeight);
-    this->channels = static_cast<uint32_t>(texChannels);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-    // Create staging buffer
-    Buffer stagingBuffer;
-    wvkDevice.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           stagingBuffer);
-
-    // Copy image data into staging buffer
-    void *pData;
-    vkMapMemory(device, stagingBuffer.memory, 0, imageSize, 0, &pData);
-    memcpy(pData, pixels, static_cast<uint32_t>(imageSize));
-    vkUnmapMemory(device, stagingBuffer.memory);
-
-    // Create the image & image view
-    wvkDevice.createImage(width, height,
-                          VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-                          VK_SAMPLE_COUNT_1_BIT,
-                          VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                          image, imageMemory);
-    imageView = wvkDevice.createImageView(image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-
-    // Copy image data from staging buffer to actual VkImage
-    wvkDevice.transitionImageLayout(image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    wvkDevice.copyBufferToImage(stagingBuffer.buffer, image, width, height);
-    wvkDevice.transitionImageLayout(image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    stagingBuffer.cleanup();
+    // Images are cooked on first load and loaded from the derived data cache until the source's contents change
+    DerivedDataCache &cache = derivedDataCache();
+    CookedTextureSource source{};
+    source.type = type;
+    if (!assets.contentHash(id, source.contentHash)) {
+        logger::fatal_error("failed to read image file. name: " + filename);
+    }
+    uint64_t key = cookedTextureKey(source);
+
+    if (cache.open(key, "ktx2", cookedFile) && parseCookedTexture(cookedFile.getData(), cookedFile.getSize(), source, view)) {
+        logger::debug("Loaded cooked texture of " + filename);
+        return;
+    }
+
+    AssetData data;
+    if (!assets.open(id, data)) {
+        logger::fatal_error("failed to read image file. name: " + filename);
+    }
+    cookedTexture = cookTextureImage(data.getData(), data.getSize(), filename, type);
+    cookedFile.close();
+    std::vector<uint8_t> bytes = serializeCookedTexture(cookedTexture, source);
+    if (cache.write(key, "ktx2", bytes.data(), bytes.size())) {
+        logger::debug("Cooked " + filename);
+    } else {
+        logger::error("Failed to cache the cooked texture of " + filename);
+    }
+    view = viewCookedTexture(cookedTexture);
+}
+
+Image::Image(WvkDevice& wvkDevice, AssetId id, TextureType type) {
+    WVK_PROFILE_ZONE("load image");
+
+    TextureFile file;
+    file.load(id, type);
+
+    WvkUploadBatch batch{wvkDevice};
+    batch.uploadTexture(file.view, *this);
+    batch.submit();
+    batch.wait();
 
     logger::debug("Finished layout transitions");
 }
 
+Image::Image(WvkDevice& wvkDevice, uint32_t width, uint32_t height, const uint8_t *pixels) {
+    WvkUploadBatch batch{wvkDevice};
+    batch.uploadImage(pixels, width, height, *this);
+    batch.submit();
+    batch.wait();
+}
+
 void Image::cleanup() {
     if (device == VK_NULL_HANDLE) return;
 
     vkDestroyImageView(device, imageView, nullptr);
     vkDestroyImage(device, image, nullptr);
+    if (memoryTracker != nullptr) memoryTracker->untrack(imageMemory);
     vkFreeMemory(device, imageMemory, nullptr);
 }
 
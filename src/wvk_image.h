@@ -1,26 +1,46 @@
 #pragma once
 
 #include "wvk_device.h"
-#include "resource_path.h"
+#include "mapped_file.h"
+#include "asset/asset_file_system.h"
+#include "texture/texture_cooker.h"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <cstdint>
 #include <string>
 
 namespace wvk {
 
+// A texture loaded from its cooked KTX2 file, or cooked from the source image on first load. Loading doesn't touch the
+// device, so it can run on any thread.
+struct TextureFile {
+    AssetData sourceData;        // .ktx2 assets, which view points into
+    MappedFile cookedFile;
+    CookedTexture cookedTexture;
+    TextureView view;
+
+    // Loads an image asset. .ktx2 files are used as they are. Fatal error if it can't be read.
+    void load(AssetId id, TextureType type);
+};
+
 class Image {
 public:
     Image() {}
-    Image(WvkDevice& device, std::string filename);
+    // Loads an image from the resource directory and waits for it to be uploaded
+    Image(WvkDevice& device, AssetId id, TextureType type = TEXTURE_COLOR);
+    // Uploads width x height RGBA pixels and waits for them
+    Image(WvkDevice& device, uint32_t width, uint32_t height, const uint8_t *pixels);
     void cleanup();
 
     VkDevice device = VK_NULL_HANDLE;
+    MemoryTracker *memoryTracker = nullptr;
 
     uint32_t width;
     uint32_t height;
-    uint32_t channels;
+    VkFormat format;
+    uint32_t mipLevels = 1;
 
     VkImage image;
     VkDeviceMemory imageMemory;
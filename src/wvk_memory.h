@@ -0,0 +1,75 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+
+namespace wvk {
+
+enum MemoryCategory {
+    MEMORY_VERTEX_BUFFER,
+    MEMORY_INDEX_BUFFER,
+    MEMORY_UNIFORM_BUFFER,
+    MEMORY_STAGING_BUFFER,
+    MEMORY_TEXTURE,
+    MEMORY_RENDER_TARGET,
+    MEMORY_OTHER,
+
+    MEMORY_CATEGORY_COUNT
+};
+
+inline const char *memoryCategoryName(MemoryCategory category) {
+    switch (category) {
+    case MEMORY_VERTEX_BUFFER:  return "vertex buffers";
+    case MEMORY_INDEX_BUFFER:   return "index buffers";
+    case MEMORY_UNIFORM_BUFFER: return "uniform buffers";
+    case MEMORY_STAGING_BUFFER: return "staging buffers";
+    case MEMORY_TEXTURE:        return "textures";
+    case MEMORY_RENDER_TARGET:  return "render targets";
+    default:                    return "other";
+    }
+}
+
+// Bookkeeping of live device memory allocations, by category
+class MemoryTracker {
+  public:
+    void track(VkDeviceMemory memory, MemoryCategory category, VkDeviceSize size) {
+        std::lock_guard<std::mutex> lock{mutex};
+        allocations[memory] = {category, size};
+        allocated[category] += size;
+    }
+
+    void untrack(VkDeviceMemory memory) {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = allocations.find(memory);
+        if (it == allocations.end()) return;
+
+        allocated[it->second.category] -= it->second.size;
+        allocations.erase(it);
+    }
+
+    VkDeviceSize getAllocated(MemoryCategory category) {
+        std::lock_guard<std::mutex> lock{mutex};
+        return allocated[category];
+    }
+
+    size_t getAllocationCount() {
+        std::lock_guard<std::mutex> lock{mutex};
+        return allocations.size();
+    }
+
+  private:
+    struct Allocation {
+        MemoryCategory category;
+        VkDeviceSize size;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<VkDeviceMemory, Allocation> allocations;
+    std::array<VkDeviceSize, MEMORY_CATEGORY_COUNT> allocated{};
+};
+
+}
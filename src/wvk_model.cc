@@ -1,153 +1,182 @@
 #include "wvk_model.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-
-#include "resource_path.h"
-
-#include <unordered_map>
+#include "mesh/cooked_mesh.h"
+#include "mapped_file.h"
+#include "derived_data_cache.h"
+#include "asset/asset_file_system.h"
+#include "cpu_profiler.h"
 
 namespace wvk {
 
-WvkModel::WvkModel(WvkDevice& device, std::string modelFilename, int textureId) : device{device} {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-
-    std::string filepath = resourcePath() + modelFilename;
-
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
-        throw std::runtime_error(warn + "\n" + err);
+void ModelFile::load(AssetId id, int textureId) {
+    WVK_PROFILE_ZONE("load model file");
+
+    // Models are cooked on first load and loaded from the derived data cache until the source's contents change
+    AssetFileSystem &assets = assetFileSystem();
+    std::string modelFilename = assets.getName(id);
+    DerivedDataCache &cache = derivedDataCache();
+    CookedMeshSource source{};
+    source.textureId = static_cast<uint32_t>(textureId);
+    if (!assets.contentHash(id, source.contentHash)) {
+        logger::fatal_error("failed to read model file. name: " + modelFilename);
     }
+    uint64_t key = cookedMeshKey(source);
 
-    if (warn.size() > 0) {
-        logger::debug(warn);
+    if (cache.open(key, "wmesh", cookedFile) && parseCookedMesh(cookedFile.getData(), cookedFile.getSize(), source, view)) {
+        logger::debug("Loaded cooked mesh of " + modelFilename);
+        return;
     }
 
-    std::unordered_map<MeshVertex, uint32_t> indexMap{};
-
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            MeshVertex vertex{};
+    AssetData data;
+    if (!assets.open(id, data)) {
+        logger::fatal_error("failed to read model file. name: " + modelFilename);
+    }
+    bool isGlb = modelFilename.size() >= 4 && modelFilename.compare(modelFilename.size() - 4, 4, ".glb") == 0;
+    cookedMesh = isGlb ? cookGlbMesh(data.getData(), data.getSize(), modelFilename, textureId)
+                       : cookObjMesh(data.getData(), data.getSize(), modelFilename, textureId);
+    cookedFile.close();
+    std::vector<uint8_t> bytes = serializeCookedMesh(cookedMesh, source);
+    if (cache.write(key, "wmesh", bytes.data(), bytes.size())) {
+        logger::debug("Cooked " + modelFilename);
+    } else {
+        logger::error("Failed to cache the cooked mesh of " + modelFilename);
+    }
+    view = viewCookedMesh(cookedMesh);
+}
 
-            vertex.position = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
+WvkModel::WvkModel(WvkDevice& device, AssetId id, int textureId) : device{device} {
+    WVK_PROFILE_ZONE("load model");
 
-            vertex.tex_coord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
+    ModelFile file;
+    file.load(id, textureId);
+    initialize(file.view);
+}
 
-            vertex.texture_index = textureId;
+WvkModel::WvkModel(WvkDevice& device, std::vector<MeshVertex> vertices, std::vector<uint32_t> indices)
+                   : device{device} {
+    loadModel(std::move(vertices), std::move(indices));
+}
 
-            vertex.normal = {
-                attrib.normals[3 * index.normal_index + 0],
-                attrib.normals[3 * index.normal_index + 1],
-                attrib.normals[3 * index.normal_index + 2]
-            };
+WvkModel::WvkModel(WvkDevice& device, const WvkModel &placeholder, int textureId)
+                   : materialId{static_cast<uint32_t>(textureId)}, device{device}, placeholder{&placeholder} {
+    createInstanceBuffer();
+    updateBounds();
+}
 
-            if (indexMap.count(vertex) == 0) {
-                uint32_t index = static_cast<uint32_t>(vertices.size());
-                indexMap[vertex] = index;
-                vertices.push_back(vertex);
-            }
+void WvkModel::loadModel(std::vector<MeshVertex> vertices, std::vector<uint32_t> indices) {
+    CookedMesh mesh = cookMesh(vertices, indices);
+    initialize(viewCookedMesh(mesh));
+}
 
-            indices.push_back(indexMap[vertex]);
-        }
-    }
+void WvkModel::initialize(const CookedMeshView &mesh) {
+    WvkUploadBatch batch{device};
+    upload(mesh, batch);
+    batch.submit();
+    batch.wait();
 
-    initialize();
+    instanceLods.assign(instances.size(), 0);
+    createInstanceBuffer();
+    updateBounds();
 }
 
-WvkModel::WvkModel(WvkDevice& device, std::vector<MeshVertex> vertices, std::vector<uint32_t> indices)
-                   : device{device}, vertices{vertices}, indices{indices} {
-    initialize();
+void WvkModel::upload(const CookedMeshView &mesh, WvkUploadBatch &batch) {
+    localBounds = mesh.bounds;
+    quantization = mesh.quantization;
+    materialId = mesh.materialId;
+    uvDensity = mesh.uvDensity;
+
+    indexCount = mesh.indexCount;
+    indexType = mesh.indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    subMeshes.assign(mesh.subMeshes, mesh.subMeshes + mesh.subMeshCount);
+    meshlets.assign(mesh.meshlets, mesh.meshlets + mesh.meshletCount);
+    lods.assign(mesh.lods, mesh.lods + mesh.lodCount);
+
+    // Copied straight from the cooked mesh to staging memory
+    batch.uploadBuffer(mesh.vertices, sizeof(PackedVertex) * mesh.vertexCount,
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer);
+    batch.uploadBuffer(mesh.positions, sizeof(PositionVertex) * mesh.vertexCount,
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, positionBuffer);
+    batch.uploadBuffer(mesh.indices, static_cast<VkDeviceSize>(mesh.indexSize) * mesh.indexCount,
+                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer);
 }
 
-void WvkModel::loadModel(std::vector<MeshVertex> vertices, std::vector<uint32_t> indices) {
-    this->vertices = vertices;
-    this->indices = indices;
+void WvkModel::makeResident() {
+    placeholder = nullptr;
+    instanceLods.assign(instances.size(), 0);
 
-    initialize();
+    // The bounds change from the placeholder's, which the cached shadow casters have to notice
+    updateBounds();
+    version++;
 }
 
-void WvkModel::initialize() {
-    createVertexBuffer();
-    logger::debug("Created vertex buffer");
-    createIndexBuffer();
-    logger::debug("Created index buffer");
+void WvkModel::updateBounds() {
+    bounds = Bounds{};
+    for (const InstanceData &instance : instances) {
+        bounds.extend(mesh().localBounds.transformed(instance.transform));
+    }
 }
 
 WvkModel::~WvkModel() {
     vertexBuffer.cleanup();
-    vertexStagingBuffer.cleanup();
+    positionBuffer.cleanup();
     indexBuffer.cleanup();
-    indexStagingBuffer.cleanup();
+    instanceBuffer.cleanup();
 }
 
-void WvkModel::createVertexBuffer() {
-    // Size in bytes of buffer
-    VkDeviceSize size = sizeof(vertices[0]) * vertices.size();
-
-    // Create vertex buffer
-    device.createBuffer(size,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        vertexBuffer);
+void WvkModel::createInstanceBuffer() {
+    VkDeviceSize size = sizeof(instances[0]) * instances.size();
 
-    // Create staging buffer
+    // Instances are small and rarely change, so they are written directly to host visible memory
     device.createBuffer(size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        vertexStagingBuffer);
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        instanceBuffer);
 
-    // Copy vertices to staging buffer
     void *pData;
-    vkMapMemory(device.getDevice(), vertexStagingBuffer.memory, 0, size, 0, &pData);
-    memcpy(pData, vertices.data(), (size_t) size);
-    vkUnmapMemory(device.getDevice(), vertexStagingBuffer.memory);
-
-    device.copyBuffer(vertexStagingBuffer, vertexBuffer, size);
+    vkMapMemory(device.getDevice(), instanceBuffer.memory, 0, size, 0, &pData);
+    memcpy(pData, instances.data(), (size_t) size);
+    vkUnmapMemory(device.getDevice(), instanceBuffer.memory);
 }
 
-void WvkModel::createIndexBuffer() {
-    // Size in bytes of buffer
-    VkDeviceSize size = sizeof(indices[0]) * indices.size();
-
-    // Create index buffer
-    device.createBuffer(size,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        indexBuffer);
+void WvkModel::setInstances(const std::vector<glm::mat4> &transforms) {
+    if (transforms.empty()) {
+        logger::fatal_error("WvkModel::setInstances requires at least one instance");
+    }
 
-    // Create staging buffer
-    device.createBuffer(size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        indexStagingBuffer);
+    instances.resize(transforms.size());
+    for (size_t i = 0; i < transforms.size(); i++) {
+        instances[i].transform = transforms[i];
+    }
+    instanceLods.assign(instances.size(), 0);
 
-    // Copy indices to staging buffer
-    void *pData;
-    vkMapMemory(device.getDevice(), indexStagingBuffer.memory, 0, size, 0, &pData);
-    memcpy(pData, indices.data(), (size_t) size);
-    vkUnmapMemory(device.getDevice(), indexStagingBuffer.memory);
+    // The previous instance buffer may still be read by frames in flight
+    vkQueueWaitIdle(device.getGraphicsQueue());
 
-    device.copyBuffer(indexStagingBuffer, indexBuffer, size);
+    instanceBuffer.cleanup();
+    createInstanceBuffer();
+    updateBounds();
+    version++;
 }
 
 void WvkModel::bind(VkCommandBuffer commandBuffer) {
-    std::array<VkBuffer, 1> buffers = {vertexBuffer.buffer};
-    std::array<VkDeviceSize, 1> offsets  = {0};
+    // Placeholders are drawn with this model's instances
+    std::array<VkBuffer, 2> buffers = {mesh().vertexBuffer.buffer, instanceBuffer.buffer};
+    std::array<VkDeviceSize, 2> offsets  = {0, 0};
     vkCmdBindVertexBuffers(commandBuffer, 0, buffers.size(), buffers.data(), offsets.data());
-    vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindIndexBuffer(commandBuffer, mesh().indexBuffer.buffer, 0, mesh().indexType);
+}
+
+void WvkModel::bindPositions(VkCommandBuffer commandBuffer) {
+    std::array<VkBuffer, 2> buffers = {mesh().positionBuffer.buffer, instanceBuffer.buffer};
+    std::array<VkDeviceSize, 2> offsets  = {0, 0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, buffers.size(), buffers.data(), offsets.data());
+    vkCmdBindIndexBuffer(commandBuffer, mesh().indexBuffer.buffer, 0, mesh().indexType);
 }
 
 void WvkModel::draw(VkCommandBuffer commandBuffer) {
-    vkCmdDrawIndexed(commandBuffer, indices.size(), 1, 0, 0, 0);
+    for (const SubMesh &subMesh : mesh().subMeshes) {
+        vkCmdDrawIndexed(commandBuffer, subMesh.indexCount, instances.size(), subMesh.firstIndex, subMesh.vertexOffset, 0);
+    }
 }
 
 }
@@ -2,24 +2,49 @@
 
 #include "wvk_buffer.h"
 #include "wvk_device.h"
+#include "wvk_upload_batch.h"
 
 #include "wvk_vertex_attributes.h"
+#include "mesh/vertex_packing.h"
+#include "mesh/index_data.h"
+#include "mesh/meshlets.h"
+#include "mesh/simplifier.h"
+#include "mesh/cooked_mesh.h"
+#include "mapped_file.h"
+#include "asset/asset_id.h"
+#include "bounds.h"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 #include "glm.h"
 
+#include <string>
 #include <vector>
 #include <array>
 
 namespace wvk {
 
+// Mesh of a model file, ready to be uploaded: its cooked mesh mapped in place from the derived data cache when the
+// source is unchanged, otherwise the mesh cooked from the source file. Loading doesn't touch the device, so it can run on any thread.
+struct ModelFile {
+    MappedFile cookedFile;
+    CookedMesh cookedMesh;
+    CookedMeshView view{};
+
+    // Loads an OBJ or .glb model from the resource directory, cooking it if needed. Throws if it can't be loaded.
+    void load(AssetId id, int textureId);
+};
+
 class WvkModel {
 public:
     WvkModel(WvkDevice& device) : device{device} {}
-    WvkModel(WvkDevice& device, std::string modelFilename, int textureId);
+    // Loads an OBJ or .glb model from the resource directory, through its cooked mesh when the source is unchanged
+    WvkModel(WvkDevice& device, AssetId id, int textureId);
     WvkModel(WvkDevice& device, std::vector<MeshVertex> vertices, std::vector<uint32_t> indices);
+    // Model without a mesh yet, drawn with the placeholder's mesh and textureId until upload() has finished and
+    // makeResident() is called. Used by WvkAssetStreamer.
+    WvkModel(WvkDevice& device, const WvkModel &placeholder, int textureId);
     ~WvkModel();
 
     WvkModel(const WvkModel &) = delete;
@@ -27,28 +52,86 @@ public:
 
     void loadModel(std::vector<MeshVertex> vertices, std::vector<uint32_t> indices);
 
+    // Records the upload of the mesh's buffers, the view isn't used afterwards
+    void upload(const CookedMeshView &mesh, WvkUploadBatch &batch);
+    // Switches from the placeholder to the uploaded mesh, once the batch has finished
+    void makeResident();
+    bool isResident() { return placeholder == nullptr; }
+
+    // Replaces the instances drawn by this model. Waits for the GPU to go idle, so this shouldn't be called every frame.
+    void setInstances(const std::vector<glm::mat4> &transforms);
+
     void bind(VkCommandBuffer commandBuffer);
+    // Binds the position stream instead of the full vertices, for pipelines using PositionVertex
+    void bindPositions(VkCommandBuffer commandBuffer);
     void draw(VkCommandBuffer commandBuffer);
 
-    VkBuffer getVertexBuffer() { return vertexBuffer.buffer; }
-    VkBuffer getIndexBuffer() { return indexBuffer.buffer; }
-    const std::vector<uint32_t> &getIndices() { return indices; }
+    VkBuffer getVertexBuffer() { return mesh().vertexBuffer.buffer; }
+    VkBuffer getIndexBuffer() { return mesh().indexBuffer.buffer; }
+    // Indices of the full detail mesh
+    uint32_t getIndexCount() { return mesh().lods.empty() ? mesh().indexCount : mesh().lods[0].firstIndex; }
+    uint32_t getInstanceCount() { return instances.size(); }
+    const std::vector<InstanceData> &getInstances() { return instances; }
+    // World space bounds of all instances
+    const Bounds &getBounds() { return bounds; }
+    const Bounds &getLocalBounds() { return mesh().localBounds; }
+
+    // Ranges of the full detail mesh drawn by draw()
+    const std::vector<SubMesh> &getSubMeshes() { return mesh().subMeshes; }
+    // Ranges of the index buffer for culling parts of the mesh, drawn through indirect commands
+    const std::vector<Meshlet> &getMeshlets() { return mesh().meshlets; }
+    // Simplified versions of the full detail mesh, in the same index buffer
+    const std::vector<LodRange> &getLods() { return mesh().lods; }
+    // LOD each instance was last drawn with, kept between frames for hysteresis
+    std::vector<uint8_t> &getInstanceLods() { return instanceLods; }
+
+    // Dequantizes the packed positions, pushed with every draw
+    const Quantization &getQuantization() { return mesh().quantization; }
+    uint32_t getMaterialId() { return materialId; }
+    // Texture coordinate units per unit of the mesh's surface, for texture mip selection
+    float getUvDensity() { return mesh().uvDensity; }
+
+    // Dynamic models are redrawn into the shadow map every frame, static ones are cached
+    void setDynamic(bool dynamic) { this->dynamic = dynamic; }
+    bool isDynamic() { return dynamic; }
+    // Incremented whenever the instances change
+    uint32_t getVersion() { return version; }
 
 private:
-    void initialize();
-    void createVertexBuffer();
-    void createIndexBuffer();
+    // Copies the mesh into device local buffers and waits for them, the view isn't used afterwards
+    void initialize(const CookedMeshView &mesh);
+    void createInstanceBuffer();
+    void updateBounds();
+
+    // The model whose mesh is drawn, the placeholder until this model is resident
+    const WvkModel &mesh() const { return placeholder != nullptr ? *placeholder : *this; }
 
-    std::vector<MeshVertex> vertices;
-    std::vector<uint32_t> indices;
+    std::vector<SubMesh> subMeshes;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    std::vector<Meshlet> meshlets;
+    std::vector<LodRange> lods;
+    std::vector<InstanceData> instances{{glm::mat4(1.f)}};
+    std::vector<uint8_t> instanceLods = std::vector<uint8_t>(1, 0);
+
+    Bounds localBounds;
+    Bounds bounds;
+
+    Quantization quantization;
+    uint32_t materialId = 0;
+    float uvDensity = 0.f;
+
+    bool dynamic = false;
+    uint32_t version = 0;
 
     WvkDevice& device;
+    const WvkModel *placeholder = nullptr;
 
     Buffer vertexBuffer;
-    Buffer vertexStagingBuffer;
-
+    Buffer positionBuffer;
     Buffer indexBuffer;
-    Buffer indexStagingBuffer;
+
+    Buffer instanceBuffer;
 };
 
 }
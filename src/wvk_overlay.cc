@@ -0,0 +1,230 @@
+#include "wvk_overlay.h"
+
+#include "wvk_helper.h"
+
+#include <imgui.h>
+#include <imgui_impl_glfw.h>
+#include <imgui_impl_vulkan.h>
+
+#include <logger.h>
+
+#include <algorithm>
+#include <string>
+
+namespace wvk {
+
+static void checkVkResult(VkResult err) {
+    if (err != VK_SUCCESS) {
+        logger::fatal_error("Imgui_ImplVulkan call failed with error code: " + std::to_string(err));
+    }
+}
+
+static std::string formatBytes(VkDeviceSize bytes) {
+    char text[32];
+    if (bytes >= 1024 * 1024) {
+        snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+    } else {
+        snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+    }
+    return text;
+}
+
+WvkOverlay::WvkOverlay(WvkDevice &device, WvkSwapchain &swapChain) : device{device}, swapChain{swapChain} {
+    createDescriptorPool();
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui::StyleColorsDark();
+    ImGui::GetIO().IniFilename = nullptr;
+
+    ImGui_ImplGlfw_InitForVulkan(device.getWindow().getGlfwWindow(), true);
+
+    ImGui_ImplVulkan_InitInfo initInfo{};
+    initInfo.Instance = device.getInstance();
+    initInfo.PhysicalDevice = device.getPhysicalDevice();
+    initInfo.Device = device.getDevice();
+    initInfo.QueueFamily = device.getQueueIndices().graphicsQueue;
+    initInfo.Queue = device.getGraphicsQueue();
+    initInfo.PipelineCache = device.getPipelineCache();
+    initInfo.DescriptorPool = descriptorPool;
+    initInfo.Subpass = 0;
+    initInfo.MinImageCount = swapChain.getImageCount();
+    initInfo.ImageCount = swapChain.getImageCount();
+    initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+    initInfo.Allocator = nullptr;
+    initInfo.CheckVkResultFn = checkVkResult;
+
+    if (!ImGui_ImplVulkan_Init(&initInfo, swapChain.getOverlayRenderPass())) {
+        logger::fatal_error("failed to initialize ImGui Vulkan backend");
+    }
+
+    uploadFonts();
+}
+
+WvkOverlay::~WvkOverlay() {
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
+    vkDestroyDescriptorPool(device.getDevice(), descriptorPool, nullptr);
+}
+
+void WvkOverlay::createDescriptorPool() {
+    // ImGui only allocates descriptor sets for the textures it draws (the font atlas)
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = 16;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = 16;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    VkResult result = vkCreateDescriptorPool(device.getDevice(), &poolInfo, nullptr, &descriptorPool);
+    checkVulkanError(result, "failed to create overlay descriptor pool");
+}
+
+void WvkOverlay::uploadFonts() {
+    VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+    ImGui_ImplVulkan_CreateFontsTexture(commandBuffer);
+    device.endSingleTimeCommands(commandBuffer);
+
+    ImGui_ImplVulkan_DestroyFontUploadObjects();
+}
+
+void WvkOverlay::update(float cpuFrameTime, const FrameStats &stats, RenderSettings &settings, WvkGpuProfiler &gpuProfiler) {
+    cpuFrameTimes[historyHead] = cpuFrameTime;
+    gpuFrameTimes[historyHead] = gpuProfiler.getFrameHistory().latest();
+    historyHead = (historyHead + 1) % HISTORY_LENGTH;
+
+    visible = settings.showOverlay;
+    if (!visible) return;
+
+    ImGui_ImplVulkan_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+
+    ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.8f);
+    ImGui::Begin("Performance (F1)", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+    drawFrameTimes(gpuProfiler);
+    drawStats(stats, gpuProfiler);
+    drawMemory();
+    drawSettings(settings, gpuProfiler);
+
+    ImGui::End();
+    ImGui::Render();
+}
+
+void WvkOverlay::drawFrameTimes(WvkGpuProfiler &gpuProfiler) {
+    float cpuMax = *std::max_element(cpuFrameTimes, cpuFrameTimes + HISTORY_LENGTH);
+    float gpuMax = *std::max_element(gpuFrameTimes, gpuFrameTimes + HISTORY_LENGTH);
+    float scale = std::max({cpuMax, gpuMax, 16.6f});
+
+    // historyHead is the oldest sample, so the graphs scroll from right to left
+    int latest = (historyHead + HISTORY_LENGTH - 1) % HISTORY_LENGTH;
+
+    char label[64];
+    snprintf(label, sizeof(label), "CPU %.2f ms", cpuFrameTimes[latest]);
+    ImGui::PlotLines("##cpu", cpuFrameTimes, HISTORY_LENGTH, historyHead, label, 0.f, scale, ImVec2(320, 60));
+
+    if (!gpuProfiler.timestampsSupported()) {
+        ImGui::Text("GPU timestamps not supported");
+        return;
+    }
+
+    snprintf(label, sizeof(label), "GPU %.2f ms", gpuFrameTimes[latest]);
+    ImGui::PlotLines("##gpu", gpuFrameTimes, HISTORY_LENGTH, historyHead, label, 0.f, scale, ImVec2(320, 60));
+
+    for (const std::string &name : gpuProfiler.getScopeNames()) {
+        const GpuScopeHistory *history = gpuProfiler.getScopeHistory(name);
+        ImGui::Text("  %-16s %6.3f ms (avg %6.3f ms)", name.c_str(), history->latest(), history->average());
+    }
+}
+
+void WvkOverlay::drawStats(const FrameStats &stats, WvkGpuProfiler &gpuProfiler) {
+    if (!ImGui::CollapsingHeader("Rendering", ImGuiTreeNodeFlags_DefaultOpen)) return;
+
+    ImGui::Text("Draw calls: %u", stats.drawCalls);
+    ImGui::Text("Triangles:  %llu", static_cast<unsigned long long>(stats.triangles));
+    ImGui::Text("Instances:  %u", stats.instances);
+    ImGui::Text("Visible / culled objects: %u / %u", stats.visibleObjects, stats.culledObjects);
+    ImGui::Text("Visible / culled meshlets: %u / %u", stats.visibleMeshlets, stats.culledMeshlets);
+    ImGui::Text("Simplified LOD instances: %u", stats.simplifiedInstances);
+    ImGui::Text("Upload queue depth: %u", stats.uploadQueueDepth);
+    ImGui::Text("Resident textures: %s, %u streaming", formatBytes(stats.residentTextureBytes).c_str(),
+                stats.streamingTextures);
+    ImGui::Text("Shadow cascades redrawn / composited: %u / %u", stats.shadowCascadesRedrawn, stats.shadowCascadesComposited);
+
+    if (!gpuProfiler.pipelineStatisticsSupported()) return;
+
+    // Fragments shaded per pixel in the main pass, about 1 with a depth prepass
+    const GpuScopeHistory *mainPass = gpuProfiler.getScopeHistory("main pass");
+    const ImGuiIO &io = ImGui::GetIO();
+    float pixels = io.DisplaySize.x * io.DisplayFramebufferScale.x * io.DisplaySize.y * io.DisplayFramebufferScale.y;
+    if (mainPass != nullptr && pixels > 0.f) {
+        ImGui::Text("Main pass overdraw: %.2fx", mainPass->statistics.fragmentInvocations / pixels);
+    }
+
+    for (const std::string &name : gpuProfiler.getScopeNames()) {
+        const GpuPipelineStatistics &pipelineStats = gpuProfiler.getScopeHistory(name)->statistics;
+        if (pipelineStats.vertexInvocations == 0) continue;
+
+        ImGui::Text("%s: %llu prims, %llu VS, %llu FS", name.c_str(),
+                    static_cast<unsigned long long>(pipelineStats.clippingPrimitives),
+                    static_cast<unsigned long long>(pipelineStats.vertexInvocations),
+                    static_cast<unsigned long long>(pipelineStats.fragmentInvocations));
+    }
+}
+
+void WvkOverlay::drawMemory() {
+    if (!ImGui::CollapsingHeader("GPU memory")) return;
+
+    MemoryTracker &tracker = device.getMemoryTracker();
+
+    VkDeviceSize total = 0;
+    for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+        MemoryCategory category = static_cast<MemoryCategory>(i);
+        VkDeviceSize allocated = tracker.getAllocated(category);
+        total += allocated;
+
+        ImGui::Text("%-16s %s", memoryCategoryName(category), formatBytes(allocated).c_str());
+    }
+    ImGui::Text("%-16s %s in %zu allocations", "total", formatBytes(total).c_str(), tracker.getAllocationCount());
+}
+
+void WvkOverlay::drawSettings(RenderSettings &settings, WvkGpuProfiler &gpuProfiler) {
+    if (!ImGui::CollapsingHeader("Settings", ImGuiTreeNodeFlags_DefaultOpen)) return;
+
+    ImGui::Checkbox("Limit frame rate", &settings.limitFrameRate);
+    ImGui::Checkbox("Shadows", &settings.renderShadows);
+    ImGui::Checkbox("Depth prepass", &settings.depthPrepass);
+    ImGui::Checkbox("Cluster culling", &settings.clusterCulling);
+    ImGui::Checkbox("LOD selection", &settings.lodSelection);
+    ImGui::SliderInt("Texture budget (MB)", &settings.textureBudgetMB, 16, 2048);
+    if (ImGui::Checkbox("GPU profiling", &settings.gpuProfiling)) {
+        gpuProfiler.setEnabled(settings.gpuProfiling);
+    }
+}
+
+void WvkOverlay::record(VkCommandBuffer commandBuffer, int imageIndex) {
+    if (!visible) return;
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = swapChain.getOverlayRenderPass();
+    renderPassInfo.framebuffer = swapChain.getOverlayFramebuffer(imageIndex);
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = swapChain.getExtent();
+    renderPassInfo.clearValueCount = 0;
+    renderPassInfo.pClearValues = nullptr;
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+}
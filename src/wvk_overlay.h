@@ -0,0 +1,51 @@
+#pragma once
+
+#include "wvk_device.h"
+#include "wvk_swapchain.h"
+#include "wvk_gpu_profiler.h"
+#include "render_settings.h"
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+namespace wvk {
+
+// Dear ImGui performance overlay, drawn in its own render pass on top of the presented image
+class WvkOverlay {
+  public:
+    static constexpr int HISTORY_LENGTH = 240;
+
+    WvkOverlay(WvkDevice &device, WvkSwapchain &swapChain);
+    ~WvkOverlay();
+
+    WvkOverlay(const WvkOverlay &) = delete;
+    WvkOverlay &operator=(const WvkOverlay &) = delete;
+
+    // Builds the overlay UI from the previous frame's CPU time (excluding the frame limiter) and stats.
+    // Settings changed through the UI are written back to settings.
+    void update(float cpuFrameTime, const FrameStats &stats, RenderSettings &settings, WvkGpuProfiler &gpuProfiler);
+
+    void record(VkCommandBuffer commandBuffer, int imageIndex);
+
+  private:
+    void createDescriptorPool();
+    void uploadFonts();
+
+    void drawFrameTimes(WvkGpuProfiler &gpuProfiler);
+    void drawStats(const FrameStats &stats, WvkGpuProfiler &gpuProfiler);
+    void drawMemory();
+    void drawSettings(RenderSettings &settings, WvkGpuProfiler &gpuProfiler);
+
+    WvkDevice &device;
+    WvkSwapchain &swapChain;
+
+    VkDescriptorPool descriptorPool;
+
+    float cpuFrameTimes[HISTORY_LENGTH] = {};
+    float gpuFrameTimes[HISTORY_LENGTH] = {};
+    int historyHead = 0;
+
+    bool visible = false; // whether the last update drew anything
+};
+
+}
@@ -1,10 +1,8 @@
 #include "wvk_pipeline.h"
 
-#include "resource_path.h"
+#include "asset/asset_file_system.h"
 #include "wvk_helper.h"
 
-#include <fstream>
-
 #include "wvk_model.h"
 
 namespace wvk {
@@ -12,8 +10,8 @@ namespace wvk {
 WvkPipeline::WvkPipeline(WvkDevice& device,
                          WvkSwapchain &swapchain,
                          VkRenderPass renderPass,
-                         std::string vertShader,
-                         std::string fragShader,
+                         AssetId vertShader,
+                         AssetId fragShader,
                          const PushConstantInfo &pushInfo,
                          const DescriptorSetInfo &descriptorInfo,
                          const VertexDescriptionInfo &vertexInfo,
@@ -52,30 +50,39 @@ void WvkPipeline::bind(VkCommandBuffer commandBuffer, int imageIndex) {
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[imageIndex], 0, nullptr);
 }
 
-static std::vector<char> readFile(const std::string& filename) {
-    std::string path = resourcePath();
-    std::ifstream file(path + filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open()) {
-        logger::fatal_error("failed to open file: " + filename);
+void WvkPipeline::updateImage(int imageIndex, uint32_t binding, uint32_t element, VkImageView imageView) {
+    DescriptorLayoutInfo &layout = descriptorSetInfo.layoutBindings[binding];
+    if (layout.type != VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || element >= layout.count) {
+        logger::fatal_error("WvkPipeline::updateImage requires an element of a sampled image binding");
     }
 
-    size_t fileSize = file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageView = imageView;
+    imageInfo.imageLayout = layout.data[0][element].imageLayout;
 
-    file.close();
-    return buffer;
+    VkWriteDescriptorSet descriptor{};
+    descriptor.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor.dstSet = descriptorSets[imageIndex];
+    descriptor.dstBinding = binding;
+    descriptor.dstArrayElement = element;
+    descriptor.descriptorType = layout.type;
+    descriptor.descriptorCount = 1;
+    descriptor.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(device.getDevice(), 1, &descriptor, 0, nullptr);
 }
 
-VkShaderModule WvkPipeline::createShaderModule(const std::string& filename) {
-    std::vector<char> code = readFile(filename);
+VkShaderModule WvkPipeline::createShaderModule(AssetId id) {
+    // Mapped files, archive entries and decompressed buffers are all aligned for the 32 bit words of SPIR-V
+    AssetData code;
+    if (!assetFileSystem().open(id, code)) {
+        logger::fatal_error("failed to open file: " + assetFileSystem().getName(id));
+    }
 
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    createInfo.codeSize = code.getSize();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.getData());
 
     VkShaderModule shaderModule;
     VkResult result = vkCreateShaderModule(device.getDevice(), &createInfo, nullptr, &shaderModule);
@@ -194,7 +201,7 @@ void WvkPipeline::createPipelineLayout() {
     checkVulkanError(result, "failed to create pipeline layout.");
 }
 
-void WvkPipeline::createGraphicsPipeline(std::string vertShader, std::string fragShader, const PipelineConfigInfo& config, const VertexDescriptionInfo &vertexInfo) {
+void WvkPipeline::createGraphicsPipeline(AssetId vertShader, AssetId fragShader, const PipelineConfigInfo& config, const VertexDescriptionInfo &vertexInfo) {
     vertShaderModule = createShaderModule(vertShader);
 
     VkPipelineShaderStageCreateInfo vertStageInfo{};
@@ -205,7 +212,7 @@ void WvkPipeline::createGraphicsPipeline(std::string vertShader, std::string fra
 
     std::vector<VkPipelineShaderStageCreateInfo> shaderStages = {vertStageInfo};
 
-    if (fragShader.size() > 0) {
+    if (fragShader != NO_ASSET) {
         fragShaderModule = createShaderModule(fragShader);
 
         VkPipelineShaderStageCreateInfo fragStageInfo{};
@@ -220,8 +227,8 @@ void WvkPipeline::createGraphicsPipeline(std::string vertShader, std::string fra
     // Vertex input info
     VkPipelineVertexInputStateCreateInfo inputInfo{};
     inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    inputInfo.vertexBindingDescriptionCount = 1;
-    inputInfo.pVertexBindingDescriptions = &vertexInfo.binding;
+    inputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInfo.bindings.size());
+    inputInfo.pVertexBindingDescriptions = vertexInfo.bindings.data();
     inputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInfo.attributes.size());
     inputInfo.pVertexAttributeDescriptions = vertexInfo.attributes.data();
 
@@ -251,7 +258,7 @@ void WvkPipeline::createGraphicsPipeline(std::string vertShader, std::string fra
     pipelineInfo.layout              = pipelineLayout;
     pipelineInfo.renderPass          = renderPass;
 
-    VkResult result = vkCreateGraphicsPipelines(device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline);
+    VkResult result = vkCreateGraphicsPipelines(device.getDevice(), device.getPipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline);
     checkVulkanError(result, "failed to create pipeline.");
 }
 
@@ -5,6 +5,7 @@
 #include "wvk_buffer.h"
 #include "game/game_structs.h"
 #include "wvk_swapchain.h"
+#include "asset/asset_id.h"
 
 #include "glm.h"
 
@@ -63,7 +64,7 @@ struct DescriptorLayoutInfo {
 
 
 struct VertexDescriptionInfo {
-    VkVertexInputBindingDescription binding;
+    std::vector<VkVertexInputBindingDescription> bindings;
     std::vector<VkVertexInputAttributeDescription> attributes;
 };
 
@@ -77,8 +78,9 @@ struct PushConstantInfo {
 
 class WvkPipeline {
   public:
+    // Shaders are SPIR-V assets, fragShader is NO_ASSET for depth only pipelines
     WvkPipeline(WvkDevice& device, WvkSwapchain& swapChain, VkRenderPass renderPass,
-                std::string vertShader, std::string fragShader,
+                AssetId vertShader, AssetId fragShader,
                 const PushConstantInfo &pushInfo,
                 const DescriptorSetInfo &descriptorInfo,
                 const VertexDescriptionInfo &vertexInfo,
@@ -92,16 +94,19 @@ class WvkPipeline {
 
     void updateUniformBuffer(int imageIndex, TransformMatrices ubo);
     void bind(VkCommandBuffer commandBuffer, int imageIndex);
+    // Points one element of a sampled image binding at another view in the descriptor set of imageIndex. The set
+    // must not be in use by a frame in flight.
+    void updateImage(int imageIndex, uint32_t binding, uint32_t element, VkImageView imageView);
 
     VkPipelineLayout getPipelineLayout() { return pipelineLayout; }
 
   private:
-    void createGraphicsPipeline(std::string vertShader, std::string fragShader, const PipelineConfigInfo &config, const VertexDescriptionInfo &vertexInfo);
+    void createGraphicsPipeline(AssetId vertShader, AssetId fragShader, const PipelineConfigInfo &config, const VertexDescriptionInfo &vertexInfo);
 
     void createPipelineLayout();
     void createDescriptorPool();
     void createDescriptorSets();
-    VkShaderModule createShaderModule(const std::string &filename);
+    VkShaderModule createShaderModule(AssetId id);
 
     WvkDevice& device;
     WvkSwapchain& swapChain;
@@ -10,6 +10,7 @@ WvkRenderPass::~WvkRenderPass() {
     for (auto &image : images) {
         vkDestroyImageView(dev, image.view, nullptr);
         vkDestroyImage(dev, image.image, nullptr);
+        device.getMemoryTracker().untrack(image.memory);
         vkFreeMemory(dev, image.memory, nullptr);
     }
 
@@ -21,6 +22,11 @@ WvkRenderPass::~WvkRenderPass() {
 }
 
 std::vector<Attachment> WvkRenderPass::initRenderPass(const RenderPassInfo &passInfo) {
+    extent = passInfo.extent;
+    if (extent.width == 0 || extent.height == 0) {
+        extent = swapchain.getExtent();
+    }
+
     auto attachments = createResources(passInfo);
     createRenderPass(passInfo);
 
@@ -34,8 +40,8 @@ void WvkRenderPass::createFramebuffer(std::vector<VkImageView> attachments) {
     framebufferInfo.renderPass = renderPass;
     framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
     framebufferInfo.pAttachments = attachments.data();
-    framebufferInfo.width = swapchain.getExtent().width;
-    framebufferInfo.height = swapchain.getExtent().height;
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
     framebufferInfo.layers = 1;
 
     framebuffers.emplace_back();
@@ -44,7 +50,6 @@ void WvkRenderPass::createFramebuffer(std::vector<VkImageView> attachments) {
 }
 
 std::vector<Attachment> WvkRenderPass::createResources(const RenderPassInfo &passInfo) {
-    VkExtent2D extent = swapchain.getExtent();
     std::vector<Attachment> attachments;
 
     // Allocate & create images on device
@@ -174,6 +179,16 @@ void WvkRenderPass::createRenderPass(const RenderPassInfo &passInfo) {
     dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
     dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+    // Passes that load an attachment must also wait for the previous pass's writes to it
+    for (const ImageInfo &imageInfo : passInfo.images) {
+        if (imageInfo.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) {
+            dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            dependency.srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+            break;
+        }
+    }
+
 
     // Create render pass
     VkRenderPassCreateInfo renderInfo{};
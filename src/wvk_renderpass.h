@@ -43,6 +43,8 @@ struct RenderPassInfo {
     std::vector<ImageInfo> images{};
     SubpassInfo subpass{};
 
+    VkExtent2D extent{0, 0}; // size of the attachments and framebuffers, the swapchain extent if zero
+
     std::vector<VkImage> resolveImages{};
 };
 
@@ -61,6 +63,7 @@ public:
     WvkRenderPass &operator=(const WvkRenderPass &) = delete;
 
     VkRenderPass getRenderPass() { return renderPass; }
+    VkExtent2D getExtent() { return extent; }
 
     VkFramebuffer getFramebuffer(int index = 0) {
         if (index >= framebuffers.size()) logger::fatal_error("invalid index WvkRenderPass::getFramebuffer()");
@@ -76,7 +79,8 @@ private:
 
     std::vector<Attachment> images;
 
-    VkRenderPass renderPass;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkExtent2D extent{0, 0};
     std::vector<VkFramebuffer> framebuffers;
     Attachment colorAttachment;
     Attachment depthAttachment;
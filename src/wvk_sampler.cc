@@ -2,33 +2,53 @@
 
 #include "wvk_helper.h"
 
+#include <algorithm>
+
 namespace wvk {
 
-Sampler::Sampler(WvkDevice &wvkDevice, VkSamplerAddressMode addressMode) : device{wvkDevice.getDevice()} {
+static SamplerConfig pointSampling(VkSamplerAddressMode addressMode) {
+    SamplerConfig config{};
+    config.magFilter = VK_FILTER_NEAREST;
+    config.minFilter = VK_FILTER_NEAREST;
+    config.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    config.addressMode = addressMode;
+    config.maxLod = 0.f;
+    config.maxAnisotropy = 1.f;
+    return config;
+}
+
+Sampler::Sampler(WvkDevice &wvkDevice, const SamplerConfig &config) : device{wvkDevice.getDevice()} {
+    float maxAnisotropy = std::min(config.maxAnisotropy,
+                                   wvkDevice.getPhysicalDeviceProperties().vk.limits.maxSamplerAnisotropy);
+    bool anisotropic = wvkDevice.getEnabledFeatures().samplerAnisotropy && maxAnisotropy > 1.f;
+
     // Create the sampler
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.flags = 0;
-    samplerInfo.magFilter = VK_FILTER_NEAREST;
-    samplerInfo.minFilter = VK_FILTER_NEAREST;
-    samplerInfo.addressModeU = addressMode;
-    samplerInfo.addressModeV = addressMode;
-    samplerInfo.addressModeW = addressMode;
-    samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = wvkDevice.getPhysicalDeviceProperties().vk.limits.maxSamplerAnisotropy;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.magFilter = config.magFilter;
+    samplerInfo.minFilter = config.minFilter;
+    samplerInfo.addressModeU = config.addressMode;
+    samplerInfo.addressModeV = config.addressMode;
+    samplerInfo.addressModeW = config.addressMode;
+    samplerInfo.anisotropyEnable = anisotropic ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = anisotropic ? maxAnisotropy : 1.f;
+    samplerInfo.borderColor = config.borderColor;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
     samplerInfo.compareEnable = VK_FALSE;
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.mipLodBias = 0.0f;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    samplerInfo.mipmapMode = config.mipmapMode;
+    samplerInfo.mipLodBias = config.lodBias;
+    samplerInfo.minLod = config.minLod;
+    samplerInfo.maxLod = config.maxLod;
 
     VkResult result = vkCreateSampler(device, &samplerInfo, nullptr, &sampler);
     checkVulkanError(result, "failed to create sampler");
 }
 
+Sampler::Sampler(WvkDevice &wvkDevice, VkSamplerAddressMode addressMode)
+    : Sampler(wvkDevice, pointSampling(addressMode)) {}
+
 void Sampler::cleanup() {
     vkDestroySampler(device, sampler, nullptr);
 }
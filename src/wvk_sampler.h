@@ -7,7 +7,23 @@
 
 namespace wvk {
 
+// Filtering and addressing of a sampler. The defaults filter trilinearly and anisotropically over every mip level.
+struct SamplerConfig {
+    VkFilter magFilter = VK_FILTER_LINEAR;
+    VkFilter minFilter = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    VkBorderColor borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+    float minLod = 0.f;
+    float maxLod = VK_LOD_CLAMP_NONE;
+    float lodBias = 0.f;
+    float maxAnisotropy = 16.f;  // clamped to the device limit, 1 or less disables anisotropic filtering
+};
+
 struct Sampler {
+    Sampler(WvkDevice &device, const SamplerConfig &config);
+    // Point sampled from the first level, for render targets read texel by texel
     Sampler(WvkDevice &device, VkSamplerAddressMode addressMode);
     void cleanup();
 
@@ -0,0 +1,353 @@
+#include "wvk_shadow_map.h"
+#include "wvk_swapchain.h"
+
+#include "wvk_helper.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wvk {
+
+// Region of a cascade's texels covered by a world space box, padded by a texel for the depth bias
+static VkRect2D cascadeRect(const ShadowCascade &cascade, uint32_t size, const Bounds &bounds) {
+    Bounds ndc = bounds.transformed(cascade.viewProjection);
+    if (!ndc.valid()) return {};
+
+    float scale = size / 2.f;
+    int32_t minX = std::max(static_cast<int32_t>(std::floor((ndc.min.x + 1.f) * scale)) - 1, 0);
+    int32_t minY = std::max(static_cast<int32_t>(std::floor((ndc.min.y + 1.f) * scale)) - 1, 0);
+    int32_t maxX = std::min(static_cast<int32_t>(std::ceil((ndc.max.x + 1.f) * scale)) + 1, static_cast<int32_t>(size));
+    int32_t maxY = std::min(static_cast<int32_t>(std::ceil((ndc.max.y + 1.f) * scale)) + 1, static_cast<int32_t>(size));
+    if (minX >= maxX || minY >= maxY) return {};
+
+    return {{minX, minY}, {static_cast<uint32_t>(maxX - minX), static_cast<uint32_t>(maxY - minY)}};
+}
+
+static bool isEmpty(const VkRect2D &rect) {
+    return rect.extent.width == 0 || rect.extent.height == 0;
+}
+
+static VkRect2D unionRect(const VkRect2D &a, const VkRect2D &b) {
+    if (isEmpty(a)) return b;
+    if (isEmpty(b)) return a;
+
+    int32_t minX = std::min(a.offset.x, b.offset.x);
+    int32_t minY = std::min(a.offset.y, b.offset.y);
+    int32_t maxX = std::max(a.offset.x + static_cast<int32_t>(a.extent.width), b.offset.x + static_cast<int32_t>(b.extent.width));
+    int32_t maxY = std::max(a.offset.y + static_cast<int32_t>(a.extent.height), b.offset.y + static_cast<int32_t>(b.extent.height));
+    return {{minX, minY}, {static_cast<uint32_t>(maxX - minX), static_cast<uint32_t>(maxY - minY)}};
+}
+
+// Begins a pass on a layer, drawing to size x size texels in its top left corner and only touching renderArea
+static void beginCascadePass(VkCommandBuffer commandBuffer, WvkRenderPass &pass, uint32_t layer, uint32_t size,
+                             VkRect2D renderArea) {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = pass.getRenderPass();
+    renderPassInfo.framebuffer = pass.getFramebuffer(layer);
+    renderPassInfo.renderArea = renderArea;
+
+    VkClearValue clearValue{};
+    clearValue.depthStencil = {1.f, 0};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    // Smaller cascades render to the top left corner of their layer
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(size);
+    viewport.height = static_cast<float>(size);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &renderArea);
+}
+
+WvkShadowMap::WvkShadowMap(WvkDevice &device, WvkSwapchain &swapChain, const CascadeConfig &cascadeConfig)
+                           : device{device}, config{cascadeConfig}, format{swapChain.getDepthFormat()},
+                             renderPass{device, swapChain},
+                             cacheRenderPass{device, swapChain}, compositeRenderPass{device, swapChain} {
+    if (config.count == 0 || config.count > MAX_SHADOW_CASCADES) {
+        logger::error("Shadow cascade count must be between 1 and " + std::to_string(MAX_SHADOW_CASCADES));
+        config.count = std::min<uint32_t>(std::max<uint32_t>(config.count, 1), MAX_SHADOW_CASCADES);
+    }
+    resolution = shadowLayerResolution(config);
+
+    createImage();
+    createRenderPass();
+
+    if (config.cacheStaticCasters) {
+        createCache();
+        createCacheRenderPasses();
+    }
+
+    logger::debug("Created " + std::to_string(config.count) + " shadow cascades of " +
+                  std::to_string(resolution) + "x" + std::to_string(resolution) +
+                  (config.cacheStaticCasters ? " with a static caster cache" : ""));
+}
+
+WvkShadowMap::~WvkShadowMap() {
+    VkDevice dev = device.getDevice();
+
+    for (VkImageView view : layerViews) {
+        vkDestroyImageView(dev, view, nullptr);
+    }
+    vkDestroyImageView(dev, arrayView, nullptr);
+    vkDestroyImage(dev, image, nullptr);
+    device.getMemoryTracker().untrack(memory);
+    vkFreeMemory(dev, memory, nullptr);
+
+    if (config.cacheStaticCasters) {
+        for (VkImageView view : cacheLayerViews) {
+            vkDestroyImageView(dev, view, nullptr);
+        }
+        vkDestroyImage(dev, cacheImage, nullptr);
+        device.getMemoryTracker().untrack(cacheMemory);
+        vkFreeMemory(dev, cacheMemory, nullptr);
+    }
+}
+
+void WvkShadowMap::createImage() {
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (config.cacheStaticCasters) usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    device.createImage(resolution, resolution,
+                       format, VK_IMAGE_TILING_OPTIMAL,
+                       VK_SAMPLE_COUNT_1_BIT,
+                       usage,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       image, memory, config.count);
+
+    arrayView = device.createImageView(image, format, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, config.count);
+    for (uint32_t i = 0; i < config.count; i++) {
+        layerViews.push_back(device.createImageView(image, format, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, i, 1));
+    }
+}
+
+void WvkShadowMap::createCache() {
+    device.createImage(resolution, resolution,
+                       format, VK_IMAGE_TILING_OPTIMAL,
+                       VK_SAMPLE_COUNT_1_BIT,
+                       VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       cacheImage, cacheMemory, config.count);
+
+    for (uint32_t i = 0; i < config.count; i++) {
+        cacheLayerViews.push_back(device.createImageView(cacheImage, format, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, i, 1));
+    }
+}
+
+void WvkShadowMap::createRenderPass() {
+    ImageInfo depth{};
+    depth.type = IMAGE_DEPTH;
+    depth.createImage = false;
+    depth.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depth.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depth.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depth.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    RenderPassInfo passInfo{};
+    passInfo.images = {depth};
+    passInfo.subpass.depthIndex = 0;
+    passInfo.extent = {resolution, resolution};
+
+    renderPass.initRenderPass(passInfo);
+    for (VkImageView view : layerViews) {
+        renderPass.createFramebuffer({view});
+    }
+}
+
+void WvkShadowMap::createCacheRenderPasses() {
+    // Both passes are compatible with renderPass, so the shadow pipelines work with all three
+    ImageInfo cacheDepth{};
+    cacheDepth.type = IMAGE_DEPTH;
+    cacheDepth.createImage = false;
+    cacheDepth.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    cacheDepth.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    cacheDepth.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    cacheDepth.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    RenderPassInfo cacheInfo{};
+    cacheInfo.images = {cacheDepth};
+    cacheInfo.subpass.depthIndex = 0;
+    cacheInfo.extent = {resolution, resolution};
+
+    cacheRenderPass.initRenderPass(cacheInfo);
+    for (VkImageView view : cacheLayerViews) {
+        cacheRenderPass.createFramebuffer({view});
+    }
+
+    ImageInfo compositeDepth{};
+    compositeDepth.type = IMAGE_DEPTH;
+    compositeDepth.createImage = false;
+    compositeDepth.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    compositeDepth.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    compositeDepth.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    compositeDepth.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    RenderPassInfo compositeInfo{};
+    compositeInfo.images = {compositeDepth};
+    compositeInfo.subpass.depthIndex = 0;
+    compositeInfo.extent = {resolution, resolution};
+
+    compositeRenderPass.initRenderPass(compositeInfo);
+    for (VkImageView view : layerViews) {
+        compositeRenderPass.createFramebuffer({view});
+    }
+}
+
+ShadowData WvkShadowMap::update(const TransformMatrices &camera, float cameraNear, float cameraFar,
+                                glm::vec3 lightDirection, const Bounds &sceneBounds) {
+    computeCascades(camera.view, camera.projection, cameraNear, cameraFar, lightDirection, sceneBounds, config, cascades);
+    return createShadowData(cascades, config);
+}
+
+void WvkShadowMap::invalidate() {
+    for (CascadeCache &cache : caches) {
+        cache.valid = false;
+    }
+}
+
+void WvkShadowMap::record(VkCommandBuffer commandBuffer, uint64_t staticCasterVersion,
+                          const std::vector<Bounds> &dynamicBounds,
+                          const std::function<void(uint32_t, ShadowCasters)> &drawCascade, FrameStats &stats) {
+    // The previous frame's main pass may still be sampling the shadow map, and its copies reading the cache
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    for (uint32_t i = 0; i < config.count; i++) {
+        if (config.cacheStaticCasters) {
+            recordCachedCascade(commandBuffer, i, staticCasterVersion, dynamicBounds, drawCascade, stats);
+        } else {
+            recordCascade(commandBuffer, i, drawCascade);
+        }
+    }
+    initialized = true;
+
+    // Make the depth writes visible to the main pass
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void WvkShadowMap::recordCascade(VkCommandBuffer commandBuffer, uint32_t cascade,
+                                 const std::function<void(uint32_t, ShadowCasters)> &drawCascade) {
+    uint32_t size = config.resolutions[cascade];
+
+    beginCascadePass(commandBuffer, renderPass, cascade, size, {{0, 0}, {size, size}});
+    drawCascade(cascade, SHADOW_CASTERS_ALL);
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+void WvkShadowMap::recordCachedCascade(VkCommandBuffer commandBuffer, uint32_t cascade,
+                                       uint64_t staticCasterVersion, const std::vector<Bounds> &dynamicBounds,
+                                       const std::function<void(uint32_t, ShadowCasters)> &drawCascade,
+                                       FrameStats &stats) {
+    const ShadowCascade &shadowCascade = cascades[cascade];
+    CascadeCache &cache = caches[cascade];
+    uint32_t size = config.resolutions[cascade];
+
+    VkRect2D dynamicRect{};
+    for (const Bounds &bounds : dynamicBounds) {
+        if (!intersectsCascade(shadowCascade, bounds)) continue;
+        dynamicRect = unionRect(dynamicRect, cascadeRect(shadowCascade, size, bounds));
+    }
+
+    // The cascade matrix only changes when the camera crosses a tile, so the cache usually survives camera movement
+    bool stale = !cache.valid || cache.viewProjection != shadowCascade.viewProjection ||
+                 cache.lightDirection != shadowCascade.lightDirection || cache.staticVersion != staticCasterVersion;
+
+    // Texels that differ from the cache: everything if it was redrawn, otherwise where dynamic casters
+    // were drawn last frame or will be drawn this frame
+    VkRect2D dirtyRect;
+    if (stale) {
+        beginCascadePass(commandBuffer, cacheRenderPass, cascade, size, {{0, 0}, {size, size}});
+        drawCascade(cascade, SHADOW_CASTERS_STATIC);
+        vkCmdEndRenderPass(commandBuffer);
+
+        cache.valid = true;
+        cache.viewProjection = shadowCascade.viewProjection;
+        cache.lightDirection = shadowCascade.lightDirection;
+        cache.staticVersion = staticCasterVersion;
+        dirtyRect = {{0, 0}, {size, size}};
+        stats.shadowCascadesRedrawn++;
+    } else {
+        dirtyRect = unionRect(cache.dynamicRect, dynamicRect);
+    }
+    cache.dynamicRect = dynamicRect;
+
+    if (isEmpty(dirtyRect)) return;
+
+    copyFromCache(commandBuffer, cascade, dirtyRect);
+
+    beginCascadePass(commandBuffer, compositeRenderPass, cascade, size, dirtyRect);
+    if (!isEmpty(dynamicRect)) {
+        drawCascade(cascade, SHADOW_CASTERS_DYNAMIC);
+    }
+    vkCmdEndRenderPass(commandBuffer);
+
+    stats.shadowCascadesComposited++;
+}
+
+void WvkShadowMap::copyFromCache(VkCommandBuffer commandBuffer, uint32_t cascade, VkRect2D rect) {
+    VkImageMemoryBarrier barriers[2]{};
+
+    // Wait for the cache pass, the cache layer is already in TRANSFER_SRC_OPTIMAL
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = cacheImage;
+    barriers[0].subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, cascade, 1};
+
+    // The whole layer is overwritten the first time, so its contents can be discarded
+    barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].oldLayout = initialized ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].image = image;
+    barriers[1].subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, cascade, 1};
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 2, barriers);
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, cascade, 1};
+    region.srcOffset = {rect.offset.x, rect.offset.y, 0};
+    region.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, cascade, 1};
+    region.dstOffset = {rect.offset.x, rect.offset.y, 0};
+    region.extent = {rect.extent.width, rect.extent.height, 1};
+    vkCmdCopyImage(commandBuffer,
+                   cacheImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   1, &region);
+
+    // The composite pass loads the copied depth and draws on top of it
+    VkImageMemoryBarrier toAttachment = barriers[1];
+    toAttachment.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toAttachment.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    toAttachment.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toAttachment.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &toAttachment);
+}
+
+}
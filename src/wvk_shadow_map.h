@@ -0,0 +1,108 @@
+#pragma once
+
+#include "wvk_device.h"
+#include "wvk_renderpass.h"
+#include "shadow_cascades.h"
+#include "render_settings.h"
+#include "game/game_structs.h"
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <functional>
+#include <vector>
+
+namespace wvk {
+
+class WvkSwapchain;
+
+enum ShadowCasters {
+    SHADOW_CASTERS_ALL, SHADOW_CASTERS_STATIC, SHADOW_CASTERS_DYNAMIC
+};
+
+// Cascaded shadow map stored as a layered depth image, one layer per cascade. The resolution is independent of
+// the swapchain.
+//
+// With CascadeConfig::cacheStaticCasters the static casters are drawn into a second layered image that is kept
+// until the cascade crosses a tile (see CascadeConfig::cacheTileSize), the light turns, the static casters change
+// or invalidate() is called. Each frame the cache is copied into the shadow map where dynamic casters were or are,
+// and only the dynamic casters are drawn on top.
+class WvkShadowMap {
+  public:
+    WvkShadowMap(WvkDevice &device, WvkSwapchain &swapChain, const CascadeConfig &config);
+    ~WvkShadowMap();
+
+    WvkShadowMap(const WvkShadowMap &) = delete;
+    WvkShadowMap &operator=(const WvkShadowMap &) = delete;
+
+    VkRenderPass getRenderPass() { return renderPass.getRenderPass(); }
+    // View of all cascades, sampled as a sampler2DArray
+    VkImageView getArrayView() { return arrayView; }
+
+    const CascadeConfig &getConfig() { return config; }
+    uint32_t getCascadeCount() { return config.count; }
+    const ShadowCascade &getCascade(uint32_t cascade) { return cascades[cascade]; }
+
+    // Fits the cascades to the camera and returns the uniform data for the shaders
+    ShadowData update(const TransformMatrices &camera, float cameraNear, float cameraFar,
+                      glm::vec3 lightDirection, const Bounds &sceneBounds);
+
+    // Redraws the static casters of every cascade on the next record
+    void invalidate();
+    // Whether the shadow map has been recorded at least once and is in the layout the main pass samples it in
+    bool isInitialized() { return initialized; }
+
+    // Records the passes of every cascade, drawCascade records the draws of the given casters of a cascade.
+    // dynamicBounds are the world space bounds of the dynamic casters, used to find the texels to redraw.
+    // staticCasterVersion changes whenever a static caster is added, removed or moved, which redraws the caches.
+    void record(VkCommandBuffer commandBuffer, uint64_t staticCasterVersion, const std::vector<Bounds> &dynamicBounds,
+                const std::function<void(uint32_t cascade, ShadowCasters casters)> &drawCascade, FrameStats &stats);
+
+  private:
+    struct CascadeCache {
+        bool valid = false;
+        glm::mat4 viewProjection{0.f}; // matrix the cache was drawn with
+        glm::vec3 lightDirection{0.f}; // light direction the cache was drawn with
+        uint64_t staticVersion = 0;    // static caster version the cache was drawn with
+        VkRect2D dynamicRect{};        // texels covered by dynamic casters in the last frame
+    };
+
+    void createImage();
+    void createCache();
+    void createRenderPass();
+    void createCacheRenderPasses();
+
+    void recordCascade(VkCommandBuffer commandBuffer, uint32_t cascade,
+                       const std::function<void(uint32_t, ShadowCasters)> &drawCascade);
+    void recordCachedCascade(VkCommandBuffer commandBuffer, uint32_t cascade, uint64_t staticCasterVersion,
+                             const std::vector<Bounds> &dynamicBounds,
+                             const std::function<void(uint32_t, ShadowCasters)> &drawCascade, FrameStats &stats);
+    void copyFromCache(VkCommandBuffer commandBuffer, uint32_t cascade, VkRect2D rect);
+
+    WvkDevice &device;
+    CascadeConfig config;
+
+    VkFormat format;
+    uint32_t resolution;
+
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView arrayView;
+    std::vector<VkImageView> layerViews;
+
+    WvkRenderPass renderPass;
+
+    VkImage cacheImage = VK_NULL_HANDLE;
+    VkDeviceMemory cacheMemory = VK_NULL_HANDLE;
+    std::vector<VkImageView> cacheLayerViews;
+
+    WvkRenderPass cacheRenderPass;     // clears and draws the static casters into the cache
+    WvkRenderPass compositeRenderPass; // draws the dynamic casters on top of the copied cache
+
+    bool initialized = false;
+
+    ShadowCascade cascades[MAX_SHADOW_CASCADES];
+    CascadeCache caches[MAX_SHADOW_CASCADES];
+};
+
+}
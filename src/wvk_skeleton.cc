@@ -2,6 +2,9 @@
 
 #include <logger.h>
 
+#include <algorithm>
+#include <iterator>
+
 namespace wvk {
 
 std::vector<MeshVertex> skeletonVertexToWvkVertex(const std::vector<RiggedMeshVertex> vertices) {
@@ -13,85 +16,95 @@ std::vector<MeshVertex> skeletonVertexToWvkVertex(const std::vector<RiggedMeshVe
     return converted;
 }
 
-WvkSkeleton::WvkSkeleton(WvkDevice& device, std::string filename) :
-    device{device}, skeleton{filename} {
-
-    createIndexBuffer();
-    logger::debug("Created skeleton index buffer");
+WvkSkeleton::WvkSkeleton(WvkDevice& device, AssetId id) : device{device} {
+    Skeleton skeleton{id};
 
-    createVertexBuffer();
-    logger::debug("Created skeleton vertex buffer");
+    WvkUploadBatch batch{device};
+    upload(skeleton, batch);
+    batch.submit();
+    batch.wait();
+    resident = true;
 }
 
 WvkSkeleton::~WvkSkeleton() {
     vertexBuffer.cleanup();
-    vertexStagingBuffer.cleanup();
+    positionBuffer.cleanup();
     indexBuffer.cleanup();
-    indexStagingBuffer.cleanup();
 }
 
-void WvkSkeleton::createVertexBuffer() {
-    // Size in bytes of buffer
-    const auto &vertices = skeleton.getVertices();
-    VkDeviceSize size = sizeof(vertices[0]) * vertices.size();
-
-    // Create vertex buffer
-    device.createBuffer(size,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        vertexBuffer);
-
-    // Create staging buffer
-    device.createBuffer(size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        vertexStagingBuffer);
-
-    // Copy vertices to staging buffer
-    void *pData;
-    vkMapMemory(device.getDevice(), vertexStagingBuffer.memory, 0, size, 0, &pData);
-    memcpy(pData, vertices.data(), (size_t) size);
-    vkUnmapMemory(device.getDevice(), vertexStagingBuffer.memory);
-
-    device.copyBuffer(vertexStagingBuffer, vertexBuffer, size);
+void WvkSkeleton::upload(Skeleton &skeleton, WvkUploadBatch &batch) {
+    std::vector<RiggedMeshVertex> vertices = skeleton.getVertices();
+    for (const RiggedMeshVertex &vertex : vertices) {
+        localBounds.extend(vertex.position);
+    }
+    quantization = positionQuantization(localBounds);
+    materialId = vertices.empty() ? 0 : vertices[0].texture_index;
+    uvDensity = wvk::uvDensity(vertices, skeleton.getIndices());
+
+    indexData = buildIndexData(vertices, skeleton.getIndices(), sizeof(PackedRiggedVertex) + sizeof(RiggedPositionVertex));
+    indexType = indexData.isShort() ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+    lods = appendLods(indexData, skeleton.getLods());
+    if (lods.size() != skeleton.getLods().size()) {
+        logger::debug("Skeleton mesh is split into sub meshes, its LODs are not used");
+    }
+
+    batch.uploadBuffer(indexData.data(), indexData.byteSize(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer);
+    createVertexBuffer(vertices, batch);
+    createPositionBuffer(vertices, batch);
+}
+
+void WvkSkeleton::createVertexBuffer(const std::vector<RiggedMeshVertex> &vertices, WvkUploadBatch &batch) {
+    // Pack vertices straight into the staging buffer
+    VkDeviceSize size = sizeof(PackedRiggedVertex) * vertices.size();
+    PackedRiggedVertex *packed = static_cast<PackedRiggedVertex *>(
+        batch.stageBuffer(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer));
+    for (size_t i = 0; i < vertices.size(); i++) {
+        packed[i] = packVertex(vertices[i], quantization);
+    }
 }
 
-void WvkSkeleton::createIndexBuffer() {
-    // Size in bytes of buffer
-    const auto &indices = skeleton.getIndices();
-    VkDeviceSize size = sizeof(indices[0]) * indices.size();
-
-    // Create index buffer
-    device.createBuffer(size,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        indexBuffer);
-
-    // Create staging buffer
-    device.createBuffer(size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        indexStagingBuffer);
-
-    // Copy indices to staging buffer
-    void *pData;
-    vkMapMemory(device.getDevice(), indexStagingBuffer.memory, 0, size, 0, &pData);
-    memcpy(pData, indices.data(), (size_t) size);
-    vkUnmapMemory(device.getDevice(), indexStagingBuffer.memory);
-
-    device.copyBuffer(indexStagingBuffer, indexBuffer, size);
+void WvkSkeleton::createPositionBuffer(const std::vector<RiggedMeshVertex> &vertices, WvkUploadBatch &batch) {
+    // Pack positions straight into the staging buffer
+    VkDeviceSize size = sizeof(RiggedPositionVertex) * vertices.size();
+    RiggedPositionVertex *positions = static_cast<RiggedPositionVertex *>(
+        batch.stageBuffer(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, positionBuffer));
+    for (size_t i = 0; i < vertices.size(); i++) {
+        PackedRiggedVertex packed = packVertex(vertices[i], quantization);
+        std::copy(std::begin(packed.position), std::end(packed.position), positions[i].position);
+        std::copy(std::begin(packed.joints), std::end(packed.joints), positions[i].joints);
+        std::copy(std::begin(packed.weights), std::end(packed.weights), positions[i].weights);
+    }
 }
 
 void WvkSkeleton::bind(VkCommandBuffer commandBuffer) {
     VkDeviceSize offset = 0;
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, &offset);
 
-    vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, offset, VK_INDEX_TYPE_UINT32);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, offset, indexType);
+}
+
+void WvkSkeleton::bindPositions(VkCommandBuffer commandBuffer) {
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &positionBuffer.buffer, &offset);
+
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, offset, indexType);
 }
 
-void WvkSkeleton::draw(VkCommandBuffer commandBuffer) {
-    uint32_t numIndices = skeleton.getIndices().size();
-    vkCmdDrawIndexed(commandBuffer, numIndices, 1, 0, 0, 0);
+uint32_t WvkSkeleton::getIndexCount(uint32_t lod) {
+    if (lod > 0) return lods[lod - 1].indexCount;
+    return lods.empty() ? indexData.indexCount() : lods[0].firstIndex;
+}
+
+void WvkSkeleton::draw(VkCommandBuffer commandBuffer, uint32_t lod) {
+    if (lod > 0) {
+        vkCmdDrawIndexed(commandBuffer, lods[lod - 1].indexCount, 1, lods[lod - 1].firstIndex, 0, 0);
+        return;
+    }
+
+    for (const SubMesh &subMesh : indexData.subMeshes) {
+        vkCmdDrawIndexed(commandBuffer, subMesh.indexCount, 1, subMesh.firstIndex, subMesh.vertexOffset, 0);
+    }
 }
 
 }
@@ -1,6 +1,10 @@
+#pragma once
+
 #include "wvk_buffer.h"
 #include "wvk_device.h"
 #include "wvk_model.h"
+#include "wvk_upload_batch.h"
+#include "mesh/vertex_packing.h"
 #include "anim/skeleton.h"
 
 #define GLFW_INCLUDE_VULKAN
@@ -18,28 +22,68 @@ namespace wvk {
 
 class WvkSkeleton {
 public:
-    WvkSkeleton(WvkDevice& device, std::string modelFilename);
+    // Loads a .glb file from the resource directory and waits for it to be uploaded
+    WvkSkeleton(WvkDevice& device, AssetId id);
+    // Skeleton without a mesh yet, not drawn until upload() has finished and makeResident() is called. Used by
+    // WvkAssetStreamer.
+    WvkSkeleton(WvkDevice& device) : device{device} {}
     ~WvkSkeleton();
 
     WvkSkeleton(const WvkSkeleton &) = delete;
     WvkSkeleton &operator=(const WvkSkeleton &) = delete;
 
+    // Records the upload of the skeleton's mesh, the skeleton isn't used afterwards
+    void upload(Skeleton &skeleton, WvkUploadBatch &batch);
+    void makeResident() { resident = true; }
+    bool isResident() { return resident; }
+
     void bind(VkCommandBuffer commandBuffer);
-    void draw(VkCommandBuffer commandBuffer);
+    // Binds the position stream instead of the full vertices, for pipelines using RiggedPositionVertex
+    void bindPositions(VkCommandBuffer commandBuffer);
+    // LOD 0 is the full detail mesh, LOD i is drawn with getLods()[i - 1]
+    void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+
+    uint32_t getIndexCount(uint32_t lod = 0);
+
+    const std::vector<LodRange> &getLods() { return lods; }
+    // LOD selected for the camera passes, kept between frames for hysteresis
+    void setLod(uint32_t lod) { this->lod = lod; }
+    uint32_t getLod() { return lod; }
+
+    void setTransform(const glm::mat4 &transform) { this->transform = transform; }
+    const glm::mat4 &getTransform() { return transform; }
+
+    // World space bounds of the bind pose
+    Bounds getBounds() { return localBounds.transformed(transform); }
+    const Bounds &getLocalBounds() { return localBounds; }
+
+    // Dequantizes the packed positions, pushed with every draw
+    const Quantization &getQuantization() { return quantization; }
+    uint32_t getMaterialId() { return materialId; }
+    // Texture coordinate units per unit of the mesh's surface, for texture mip selection
+    float getUvDensity() { return uvDensity; }
 
 private:
-    void createIndexBuffer();
-    void createVertexBuffer();
+    void createVertexBuffer(const std::vector<RiggedMeshVertex> &vertices, WvkUploadBatch &batch);
+    void createPositionBuffer(const std::vector<RiggedMeshVertex> &vertices, WvkUploadBatch &batch);
 
     WvkDevice& device;
+    bool resident = false;
 
     Buffer vertexBuffer;
-    Buffer vertexStagingBuffer;
-
+    Buffer positionBuffer;
     Buffer indexBuffer;
-    Buffer indexStagingBuffer;
 
-    wvk::Skeleton skeleton;
+    IndexData indexData;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    std::vector<LodRange> lods;
+    uint32_t lod = 0;
+    Bounds localBounds;
+    Quantization quantization;
+    uint32_t materialId = 0;
+    float uvDensity = 0.f;
+
+    glm::mat4 transform{1.f};
 };
 
 }
@@ -2,6 +2,7 @@
 
 #include "wvk_device.h"
 #include "wvk_helper.h"
+#include "cpu_profiler.h"
 #include <logger.h>
 
 #include <algorithm>
@@ -10,7 +11,10 @@
 namespace wvk {
 
 WvkSwapchain::WvkSwapchain(WvkDevice &device, VkExtent2D extent) : device{device}, windowExtent{extent},
-                                                                   shadowRenderPass{device, *this}, mainRenderPass{device, *this} {
+                                                                   mainRenderPass{device, *this},
+                                                                   depthPrepassRenderPass{device, *this},
+                                                                   depthLoadRenderPass{device, *this},
+                                                                   overlayRenderPass{device, *this} {
     cacheDeviceProperties();
 
     createSwapchain();
@@ -186,26 +190,6 @@ void WvkSwapchain::createSwapchainImages() {
 }
 
 void WvkSwapchain::createRenderPasses() {
-    // Shadow render pass
-    ImageInfo shadowDepth{};
-    shadowDepth.type = IMAGE_DEPTH;
-    shadowDepth.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    shadowDepth.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    shadowDepth.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    shadowDepth.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-    shadowDepth.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
-
-    RenderPassInfo shadowPassInfo{};
-    shadowPassInfo.images = {shadowDepth};
-    shadowPassInfo.subpass.depthIndex = 0;
-
-    auto attachments = shadowRenderPass.initRenderPass(shadowPassInfo);
-    shadowRenderPass.createFramebuffer({attachments[0].view});
-
-    shadowDepthAttachment = attachments[0];
-
-    logger::debug("Created shadow render pass");
-
     // Main render pass
     ImageInfo mainColor{};
     mainColor.type = IMAGE_COLOR;
@@ -230,12 +214,66 @@ void WvkSwapchain::createRenderPasses() {
     mainPassInfo.subpass.depthIndex = 1;
     mainPassInfo.subpass.resolveIndex = 2;
 
-    attachments = mainRenderPass.initRenderPass(mainPassInfo);
+    auto attachments = mainRenderPass.initRenderPass(mainPassInfo);
     for (size_t i = 0; i < imageViews.size(); i++) {
         mainRenderPass.createFramebuffer({attachments[0].view, attachments[1].view, imageViews[i]});
     }
 
     logger::debug("Created main render pass");
+
+    // Depth prepass, writes the depth attachment of the main pass
+    ImageInfo prepassDepth = mainDepth;
+    prepassDepth.createImage = false;
+    prepassDepth.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+    RenderPassInfo prepassInfo{};
+    prepassInfo.images = {prepassDepth};
+    prepassInfo.subpass.depthIndex = 0;
+
+    depthPrepassRenderPass.initRenderPass(prepassInfo);
+    for (size_t i = 0; i < imageViews.size(); i++) {
+        depthPrepassRenderPass.createFramebuffer({attachments[1].view});
+    }
+
+    // Main render pass after the prepass, compatible with the main render pass but loads the depth
+    ImageInfo loadColor = mainColor;
+    loadColor.createImage = false;
+
+    ImageInfo loadDepth = mainDepth;
+    loadDepth.createImage = false;
+    loadDepth.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    loadDepth.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    RenderPassInfo loadPassInfo = mainPassInfo;
+    loadPassInfo.images = {loadColor, loadDepth, mainResolve};
+
+    depthLoadRenderPass.initRenderPass(loadPassInfo);
+    for (size_t i = 0; i < imageViews.size(); i++) {
+        depthLoadRenderPass.createFramebuffer({attachments[0].view, attachments[1].view, imageViews[i]});
+    }
+
+    logger::debug("Created depth prepass render passes");
+
+    // Overlay render pass, draws directly onto the presented image
+    ImageInfo overlayColor{};
+    overlayColor.type = IMAGE_COLOR;
+    overlayColor.createImage = false;
+    overlayColor.samples = VK_SAMPLE_COUNT_1_BIT;
+    overlayColor.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    overlayColor.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    overlayColor.initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    overlayColor.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    RenderPassInfo overlayPassInfo{};
+    overlayPassInfo.images = {overlayColor};
+    overlayPassInfo.subpass.colorIndex = 0;
+
+    overlayRenderPass.initRenderPass(overlayPassInfo);
+    for (size_t i = 0; i < imageViews.size(); i++) {
+        overlayRenderPass.createFramebuffer({imageViews[i]});
+    }
+
+    logger::debug("Created overlay render pass");
 }
 
 void WvkSwapchain::createSynchronizationObjects() {
@@ -265,14 +303,21 @@ uint32_t WvkSwapchain::acquireNextImage() {
     VkSemaphore imageAvailableSemaphore = imageAvailableSemaphores[currentFrame];
     VkFence inFlightFence = inFlightFences[currentFrame];
 
-    vkWaitForFences(dev, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+    {
+        WVK_PROFILE_ZONE("wait frame fence");
+        vkWaitForFences(dev, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+    }
 
     // Acquire the next image from the swap chain
     uint32_t imageIndex;
-    vkAcquireNextImageKHR(dev, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    {
+        WVK_PROFILE_ZONE("vkAcquireNextImageKHR");
+        vkAcquireNextImageKHR(dev, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    }
 
     // Check if image is currently in flight for this image
     if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+        WVK_PROFILE_ZONE("wait image fence");
         vkWaitForFences(dev, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
     }
 
@@ -282,6 +327,8 @@ uint32_t WvkSwapchain::acquireNextImage() {
 }
 
 void WvkSwapchain::submitCommands(VkCommandBuffer buffer, uint32_t imageIndex) {
+    WVK_PROFILE_ZONE("submitCommands");
+
     VkDevice dev = device.getDevice();
     VkSemaphore imageAvailableSemaphore = imageAvailableSemaphores[currentFrame];
     VkSemaphore renderFinishedSemaphore = renderFinishedSemaphores[currentFrame];
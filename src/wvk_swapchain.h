@@ -29,11 +29,14 @@ class WvkSwapchain {
     void operator=(const WvkSwapchain &) = delete;
 
     VkRenderPass getRenderPass() { return mainRenderPass.getRenderPass(); }
-    VkRenderPass getShadowRenderPass() { return shadowRenderPass.getRenderPass(); }
     VkFramebuffer getFramebuffer(size_t imageIndex) { return mainRenderPass.getFramebuffer(imageIndex); }
-    
-    VkFramebuffer getShadowFramebuffer() { return shadowRenderPass.getFramebuffer(); }
-    VkImageView getShadowDepthImageView() { return shadowDepthAttachment.view; }
+    // Depth only pass into the main depth attachment, followed by the depth load variant of the main pass
+    VkRenderPass getDepthPrepassRenderPass() { return depthPrepassRenderPass.getRenderPass(); }
+    VkFramebuffer getDepthPrepassFramebuffer(size_t imageIndex) { return depthPrepassRenderPass.getFramebuffer(imageIndex); }
+    VkRenderPass getDepthLoadRenderPass() { return depthLoadRenderPass.getRenderPass(); }
+    VkFramebuffer getDepthLoadFramebuffer(size_t imageIndex) { return depthLoadRenderPass.getFramebuffer(imageIndex); }
+    VkRenderPass getOverlayRenderPass() { return overlayRenderPass.getRenderPass(); }
+    VkFramebuffer getOverlayFramebuffer(size_t imageIndex) { return overlayRenderPass.getFramebuffer(imageIndex); }
     
     VkExtent2D getExtent() { return swapChainExtent; }
     uint32_t getImageCount() { return images.size(); }
@@ -72,9 +75,9 @@ class WvkSwapchain {
     std::vector<VkFramebuffer> framebuffers;
 
     WvkRenderPass mainRenderPass;
-    WvkRenderPass shadowRenderPass;
-
-    Attachment shadowDepthAttachment;
+    WvkRenderPass depthPrepassRenderPass;
+    WvkRenderPass depthLoadRenderPass;     // main pass that keeps the depth of the prepass
+    WvkRenderPass overlayRenderPass; // drawn on top of the resolved swapchain image
 
     WvkDevice &device;
 
@@ -0,0 +1,214 @@
+#include "wvk_texture_streamer.h"
+
+#include "cpu_profiler.h"
+
+#include <algorithm>
+
+namespace wvk {
+
+// The levels of a texture from firstLevel on, as a texture of their own
+static TextureView levelsView(const TextureView &view, uint32_t firstLevel) {
+    TextureView levels = view;
+    levels.levels.erase(levels.levels.begin(), levels.levels.begin() + firstLevel);
+    levels.width = levels.levels[0].width;
+    levels.height = levels.levels[0].height;
+    return levels;
+}
+
+WvkTextureStreamer::WvkTextureStreamer(WvkDevice &device, WvkAssetStreamer &assetStreamer, uint32_t imageCount)
+        : device{device}, assetStreamer{assetStreamer} {
+    changedTextures.resize(imageCount);
+    allImagesInUse = imageCount >= 32 ? ~0u : (1u << imageCount) - 1;
+}
+
+WvkTextureStreamer::~WvkTextureStreamer() {
+    for (std::unique_ptr<Texture> &texture : textures) {
+        texture->image.cleanup();
+        texture->streamingImage.cleanup();
+    }
+    for (RetiredImage &retired : retiredImages) {
+        retired.image.cleanup();
+    }
+}
+
+uint32_t WvkTextureStreamer::addTexture(AssetId id, TextureType type) {
+    auto texture = std::make_unique<Texture>();
+    texture->index = static_cast<uint32_t>(textures.size());
+    texture->filename = assetFileSystem().getName(id);
+    texture->type = type;
+    texture->streaming = true;
+
+    Texture *target = texture.get();
+    auto file = std::make_shared<TextureFile>();
+    assetStreamer.stream(
+        texture->filename,
+        [file, id, type]() {
+            file->load(id, type);
+        },
+        [target, file](WvkUploadBatch &batch) {
+            target->file = file;
+
+            const std::vector<TextureLevel> &levels = file->view.levels;
+            uint32_t level = 0;
+            while (level + 1 < levels.size() && std::max(levels[level].width, levels[level].height) > COARSE_SIZE) {
+                level++;
+            }
+            target->coarseLevel = level;
+            batch.uploadTexture(levelsView(file->view, level), target->streamingImage);
+        },
+        [this, target]() { makeResident(*target, target->coarseLevel); });
+
+    textures.push_back(std::move(texture));
+    return target->index;
+}
+
+uint32_t WvkTextureStreamer::getTextureSize(uint32_t texture) {
+    if (texture >= textures.size() || !textures[texture]->file) return 0;
+    const TextureView &view = textures[texture]->file->view;
+    return std::max(view.width, view.height);
+}
+
+void WvkTextureStreamer::requestLod(uint32_t texture, float lod) {
+    if (texture >= textures.size()) return;
+    textures[texture]->requestedLod = std::min(textures[texture]->requestedLod, lod);
+}
+
+VkDeviceSize WvkTextureStreamer::levelsSize(const Texture &texture, uint32_t firstLevel) {
+    const TextureView &view = texture.file->view;
+
+    // Devices without BC support get the blocks decoded to RGBA8
+    VkFormat format = view.format;
+    if (isBlockCompressed(format) && !device.getEnabledFeatures().textureCompressionBC) {
+        format = VK_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    VkDeviceSize size = 0;
+    for (uint32_t level = firstLevel; level < view.levels.size(); level++) {
+        size += textureLevelSize(format, view.levels[level].width, view.levels[level].height);
+    }
+    return size;
+}
+
+uint32_t WvkTextureStreamer::wantedLevel(const Texture &texture) {
+    if (texture.lod == NO_LOD) return texture.coarseLevel;
+
+    float lod = std::clamp(texture.lod, 0.f, texture.coarseLevel + 1.f);
+    uint32_t level = std::min(static_cast<uint32_t>(lod), texture.coarseLevel);
+    if (level > texture.residentLevel) {
+        uint32_t evictLevel = static_cast<uint32_t>(std::max(lod - LOD_HYSTERESIS, 0.f));
+        level = std::max(std::min(evictLevel, level), texture.residentLevel);
+    }
+    return level;
+}
+
+void WvkTextureStreamer::update(VkDeviceSize budget) {
+    WVK_PROFILE_ZONE("texture streamer update");
+
+    // Levels wanted by the textures that are loaded, NO_LEVEL for the ones still loading
+    std::vector<uint32_t> levels(textures.size(), NO_LEVEL);
+    uint32_t maxBias = 0;
+    for (size_t i = 0; i < textures.size(); i++) {
+        Texture &texture = *textures[i];
+        if (texture.requestedLod != NO_LOD) {
+            texture.lod = texture.requestedLod;
+            texture.idleFrames = 0;
+        } else if (texture.idleFrames++ >= IDLE_FRAMES) {
+            texture.lod = NO_LOD;
+        }
+        texture.requestedLod = NO_LOD;
+
+        if (texture.residentLevel == NO_LEVEL) continue;
+        levels[i] = wantedLevel(texture);
+        maxBias = std::max(maxBias, texture.coarseLevel - levels[i]);
+    }
+
+    // Every texture drops its finest wanted level until they fit, down to the coarse levels
+    auto wantedSize = [&](uint32_t bias) {
+        VkDeviceSize size = 0;
+        for (size_t i = 0; i < textures.size(); i++) {
+            if (levels[i] == NO_LEVEL) continue;
+            size += levelsSize(*textures[i], std::min(levels[i] + bias, textures[i]->coarseLevel));
+        }
+        return size;
+    };
+    uint32_t bias = 0;
+    while (bias < maxBias && wantedSize(bias) > budget) {
+        bias++;
+    }
+
+    for (size_t i = 0; i < textures.size(); i++) {
+        Texture &texture = *textures[i];
+        if (levels[i] == NO_LEVEL || texture.streaming) continue;
+
+        uint32_t level = std::min(levels[i] + bias, texture.coarseLevel);
+        if (level == texture.residentLevel) continue;
+        // Evictions free memory, they aren't held back by the streams in flight
+        if (level < texture.residentLevel && streamingCount >= MAX_STREAMING) continue;
+        streamLevels(texture, level);
+    }
+}
+
+void WvkTextureStreamer::streamLevels(Texture &texture, uint32_t firstLevel) {
+    texture.streaming = true;
+    streamingCount++;
+
+    Texture *target = &texture;
+    std::shared_ptr<TextureFile> file = texture.file;
+    assetStreamer.stream(
+        texture.filename + " from level " + std::to_string(firstLevel),
+        [file, firstLevel]() {
+            // Reads the levels' pages of the mapped file here, instead of on the main thread while uploading
+            const std::vector<TextureLevel> &levels = file->view.levels;
+            uint8_t sum = 0;
+            for (uint32_t level = firstLevel; level < levels.size(); level++) {
+                for (size_t offset = 0; offset < levels[level].size; offset += 4096) {
+                    sum ^= levels[level].data[offset];
+                }
+            }
+            volatile uint8_t sink = sum;
+            (void) sink;
+        },
+        [target, firstLevel](WvkUploadBatch &batch) {
+            batch.uploadTexture(levelsView(target->file->view, firstLevel), target->streamingImage);
+        },
+        [this, target, firstLevel]() { makeResident(*target, firstLevel); });
+}
+
+void WvkTextureStreamer::makeResident(Texture &texture, uint32_t firstLevel) {
+    if (texture.residentLevel != NO_LEVEL) {
+        residentSize -= levelsSize(texture, texture.residentLevel);
+        retiredImages.push_back({texture.image, allImagesInUse});
+        streamingCount--;
+    }
+
+    texture.image = texture.streamingImage;
+    texture.streamingImage = Image{};
+    texture.residentLevel = firstLevel;
+    texture.streaming = false;
+    residentSize += levelsSize(texture, firstLevel);
+
+    for (std::vector<uint32_t> &changed : changedTextures) {
+        changed.push_back(texture.index);
+    }
+}
+
+void WvkTextureStreamer::updateDescriptors(uint32_t imageIndex,
+                                           const std::function<void(uint32_t, VkImageView)> &updateView) {
+    for (uint32_t texture : changedTextures[imageIndex]) {
+        updateView(texture, textures[texture]->image.imageView);
+    }
+    changedTextures[imageIndex].clear();
+
+    // This image's previous frame has finished and its descriptors no longer point at the retired images
+    for (auto retired = retiredImages.begin(); retired != retiredImages.end();) {
+        retired->imagesInUse &= ~(1u << imageIndex);
+        if (retired->imagesInUse == 0) {
+            retired->image.cleanup();
+            retired = retiredImages.erase(retired);
+        } else {
+            retired++;
+        }
+    }
+}
+
+}
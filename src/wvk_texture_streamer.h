@@ -0,0 +1,113 @@
+#pragma once
+
+#include "wvk_asset_streamer.h"
+#include "wvk_device.h"
+#include "wvk_image.h"
+#include "texture/texture_cooker.h"
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace wvk {
+
+/*
+ * Keeps only the mip levels of textures that are sampled on screen resident. A texture is first loaded with its
+ * coarse levels, up to COARSE_SIZE texels across, which stay resident. Every frame the renderer requests the finest
+ * level each texture is sampled from, and update() streams finer levels in from the cooked file and evicts the ones
+ * no longer needed, coarsening every texture alike while the requested levels don't fit the budget.
+ *
+ * A texture's image holds its resident levels only, from the finest one down, so its view never reaches past them
+ * and the sampler clamps to the finest resident level. Changing residency uploads a new image through the asset
+ * streamer and swaps it in once it's finished; the old image is destroyed once every swapchain image's descriptors
+ * point at the new one.
+ */
+class WvkTextureStreamer {
+  public:
+    // Largest level loaded with a texture and never evicted
+    static constexpr uint32_t COARSE_SIZE = 64;
+    // Textures keep their levels for this many frames after they were last requested, so they aren't reloaded
+    // whenever the camera turns
+    static constexpr uint32_t IDLE_FRAMES = 120;
+    // Finer levels are loaded as soon as they're needed, evicted only once the lod is this far past them
+    static constexpr float LOD_HYSTERESIS = 0.25f;
+    // Residency changes in flight, further ones wait for the next update
+    static constexpr uint32_t MAX_STREAMING = 8;
+
+    WvkTextureStreamer(WvkDevice &device, WvkAssetStreamer &assetStreamer, uint32_t imageCount);
+    // Must be destroyed after the asset streamer, which may still be uploading into the images
+    ~WvkTextureStreamer();
+
+    WvkTextureStreamer(const WvkTextureStreamer &) = delete;
+    WvkTextureStreamer &operator=(const WvkTextureStreamer &) = delete;
+
+    // Loads the coarse levels of an image from the resource directory, cooking it first like TextureFile does.
+    // Returns the texture's index, which is its descriptor array index.
+    uint32_t addTexture(AssetId id, TextureType type = TEXTURE_COLOR);
+    uint32_t getTextureCount() { return textures.size(); }
+
+    // Texels across the finest level of a texture, 0 until its file is loaded
+    uint32_t getTextureSize(uint32_t texture);
+
+    // Lowers the finest level a texture is sampled from this frame to lod, see textureLod() in cluster_culling.h
+    void requestLod(uint32_t texture, float lod);
+    // Called once per frame on the main thread, after the lods of the frame were requested. Streams levels in and out
+    // so the resident levels fit into budget bytes.
+    void update(VkDeviceSize budget);
+
+    // Calls updateView with the view of every texture whose image changed since imageIndex was last updated. The
+    // previous frame recorded for imageIndex must have finished.
+    void updateDescriptors(uint32_t imageIndex, const std::function<void(uint32_t, VkImageView)> &updateView);
+
+    // Device bytes of the resident levels
+    VkDeviceSize getResidentSize() { return residentSize; }
+    // Textures with a residency change in flight
+    uint32_t getStreamingCount() { return streamingCount; }
+
+  private:
+    static constexpr uint32_t NO_LEVEL = std::numeric_limits<uint32_t>::max();
+    static constexpr float NO_LOD = std::numeric_limits<float>::infinity();
+
+    struct Texture {
+        uint32_t index;
+        std::string filename;
+        TextureType type;
+
+        std::shared_ptr<TextureFile> file;   // set once loaded, levels are uploaded from it
+        uint32_t coarseLevel = 0;            // finest level that is never evicted
+
+        Image image;                         // levels residentLevel to the last one
+        uint32_t residentLevel = NO_LEVEL;
+        Image streamingImage;                // being uploaded, replaces image once finished
+        bool streaming = false;
+
+        float requestedLod = NO_LOD;         // this frame
+        float lod = NO_LOD;                  // of the last frame the texture was requested
+        uint32_t idleFrames = 0;
+    };
+
+    struct RetiredImage {
+        Image image;
+        uint32_t imagesInUse;                // bit mask of swapchain images whose descriptors may still point at it
+    };
+
+    VkDeviceSize levelsSize(const Texture &texture, uint32_t firstLevel);
+    uint32_t wantedLevel(const Texture &texture);
+    void streamLevels(Texture &texture, uint32_t firstLevel);
+    void makeResident(Texture &texture, uint32_t firstLevel);
+
+    WvkDevice &device;
+    WvkAssetStreamer &assetStreamer;
+
+    std::vector<std::unique_ptr<Texture>> textures;
+    std::vector<std::vector<uint32_t>> changedTextures;   // per swapchain image
+    std::vector<RetiredImage> retiredImages;
+    uint32_t allImagesInUse;
+
+    VkDeviceSize residentSize = 0;
+    uint32_t streamingCount = 0;
+};
+
+}
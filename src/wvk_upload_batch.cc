@@ -0,0 +1,288 @@
+#include "wvk_upload_batch.h"
+
+#include "wvk_helper.h"
+#include "cpu_profiler.h"
+#include "texture/block_compression.h"
+
+#include <logger.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace wvk {
+
+WvkUploadBatch::WvkUploadBatch(WvkDevice &device) : device{device} {}
+
+WvkUploadBatch::~WvkUploadBatch() {
+    VkDevice dev = device.getDevice();
+
+    if (submitted) {
+        wait();
+        vkDestroyFence(dev, fence, nullptr);
+    }
+    if (commandBuffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(dev, device.getCommandPool(), 1, &commandBuffer);
+    }
+
+    for (Buffer &buffer : stagingBuffers) {
+        buffer.cleanup();
+    }
+}
+
+VkCommandBuffer WvkUploadBatch::getCommandBuffer() {
+    if (submitted) {
+        logger::fatal_error("WvkUploadBatch can't record uploads after it was submitted");
+    }
+    if (commandBuffer != VK_NULL_HANDLE) return commandBuffer;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = device.getCommandPool();
+    allocInfo.commandBufferCount = 1;
+
+    VkResult result = vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &commandBuffer);
+    checkVulkanError(result, "failed to allocate upload command buffer");
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    checkVulkanError(vkBeginCommandBuffer(commandBuffer, &beginInfo), "failed to begin upload command buffer");
+    return commandBuffer;
+}
+
+void *WvkUploadBatch::createStagingBuffer(VkDeviceSize size) {
+    stagingBuffers.emplace_back();
+    Buffer &stagingBuffer = stagingBuffers.back();
+    device.createBuffer(size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        stagingBuffer);
+    stagedSize += size;
+
+    // Staging memory stays mapped until the batch is submitted
+    void *pData;
+    VkResult result = vkMapMemory(device.getDevice(), stagingBuffer.memory, 0, size, 0, &pData);
+    checkVulkanError(result, "failed to map staging buffer");
+    return pData;
+}
+
+void *WvkUploadBatch::stageBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Buffer &buffer) {
+    VkCommandBuffer commandBuffer = getCommandBuffer();
+    void *pData = createStagingBuffer(size);
+
+    device.createBuffer(size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        buffer);
+
+    VkBufferCopy bufferCopy{};
+    bufferCopy.srcOffset = 0;
+    bufferCopy.dstOffset = 0;
+    bufferCopy.size = size;
+    vkCmdCopyBuffer(commandBuffer, stagingBuffers.back().buffer, buffer.buffer, 1, &bufferCopy);
+
+    uploadedBuffers = true;
+    return pData;
+}
+
+void WvkUploadBatch::uploadBuffer(const void *data, VkDeviceSize size, VkBufferUsageFlags usage, Buffer &buffer) {
+    void *pData = stageBuffer(size, usage, buffer);
+    memcpy(pData, data, (size_t) size);
+}
+
+void WvkUploadBatch::uploadImage(const void *pixels, uint32_t width, uint32_t height, Image &image) {
+    TextureView texture{};
+    texture.format = VK_FORMAT_R8G8B8A8_SRGB;
+    texture.width = width;
+    texture.height = height;
+    texture.levels.push_back({width, height, static_cast<const uint8_t *>(pixels), size_t(width) * height * 4});
+    uploadTexture(texture, image);
+}
+
+void WvkUploadBatch::uploadTexture(const TextureView &texture, Image &image) {
+    VkCommandBuffer commandBuffer = getCommandBuffer();
+
+    VkFormat format = texture.format;
+
+    // Devices without BC support get the blocks decoded to RGBA8
+    std::vector<std::vector<uint8_t>> decoded;
+    if (isBlockCompressed(format) && !device.getEnabledFeatures().textureCompressionBC) {
+        WVK_PROFILE_ZONE("decode compressed texture");
+
+        decoded.resize(texture.levels.size());
+        for (uint32_t level = 0; level < texture.levels.size(); level++) {
+            const TextureLevel &textureLevel = texture.levels[level];
+            if (!decodeTextureLevel(format, textureLevel.data, textureLevel.width, textureLevel.height, decoded[level])) {
+                logger::error("Texture has blocks the CPU decoder doesn't support");
+            }
+        }
+        format = isSrgb(format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    // Uncompressed textures missing their smaller levels get them by blitting each level from the one above
+    uint32_t copiedLevels = static_cast<uint32_t>(texture.levels.size());
+    uint32_t levelCount = copiedLevels;
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                              VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if (!isBlockCompressed(format) && device.supportsFormatFeatures(format, blitFeatures)) {
+        levelCount = mipLevelCount(texture.width, texture.height);
+    }
+    bool blitLevels = levelCount > copiedLevels;
+
+    // All levels share one staging buffer, at offsets aligned for any texel block size
+    std::vector<VkDeviceSize> offsets(copiedLevels);
+    VkDeviceSize stagingSize = 0;
+    for (uint32_t level = 0; level < copiedLevels; level++) {
+        offsets[level] = stagingSize;
+        stagingSize += (textureLevelSize(format, texture.levels[level].width, texture.levels[level].height) + 15) & ~15ull;
+    }
+    uint8_t *staging = static_cast<uint8_t *>(createStagingBuffer(stagingSize));
+    for (uint32_t level = 0; level < copiedLevels; level++) {
+        if (decoded.empty()) {
+            memcpy(staging + offsets[level], texture.levels[level].data, texture.levels[level].size);
+        } else {
+            memcpy(staging + offsets[level], decoded[level].data(), decoded[level].size());
+        }
+    }
+    decoded.clear();
+
+    image.device = device.getDevice();
+    image.memoryTracker = &device.getMemoryTracker();
+    image.width = texture.width;
+    image.height = texture.height;
+    image.format = format;
+    image.mipLevels = levelCount;
+
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (blitLevels) usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    device.createImage(texture.width, texture.height,
+                       format, VK_IMAGE_TILING_OPTIMAL,
+                       VK_SAMPLE_COUNT_1_BIT,
+                       usage,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       image.image, image.imageMemory, 1, levelCount);
+    image.imageView = device.createImageView(image.image, format, VK_IMAGE_ASPECT_COLOR_BIT,
+                                             VK_IMAGE_VIEW_TYPE_2D, 0, 1, levelCount);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    // Rows are tightly packed, block compressed levels smaller than a block still copy their texel extent
+    std::vector<VkBufferImageCopy> copies(copiedLevels);
+    for (uint32_t level = 0; level < copiedLevels; level++) {
+        VkBufferImageCopy &bufferCopy = copies[level];
+        bufferCopy.bufferOffset = offsets[level];
+        bufferCopy.bufferRowLength = 0;
+        bufferCopy.bufferImageHeight = 0;
+        bufferCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        bufferCopy.imageSubresource.mipLevel = level;
+        bufferCopy.imageSubresource.baseArrayLayer = 0;
+        bufferCopy.imageSubresource.layerCount = 1;
+        bufferCopy.imageOffset = {0, 0, 0};
+        bufferCopy.imageExtent = {texture.levels[level].width, texture.levels[level].height, 1};
+    }
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffers.back().buffer, image.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copiedLevels, copies.data());
+
+    barrier.subresourceRange.levelCount = 1;
+    for (uint32_t level = copiedLevels; level < levelCount; level++) {
+        // The level above has been written, read it from now on
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkImageBlit blit{};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+        blit.srcOffsets[1] = {static_cast<int32_t>(std::max(texture.width >> (level - 1), 1u)),
+                              static_cast<int32_t>(std::max(texture.height >> (level - 1), 1u)), 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        blit.dstOffsets[1] = {static_cast<int32_t>(std::max(texture.width >> level, 1u)),
+                              static_cast<int32_t>(std::max(texture.height >> level, 1u)), 1};
+        vkCmdBlitImage(commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+    }
+
+    // Sampled by the fragment shaders of later frames. Levels blitted from are in transfer source layout.
+    std::vector<VkImageMemoryBarrier> readBarriers;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        bool blitSource = blitLevels && level + 1 >= copiedLevels && level + 1 < levelCount;
+        barrier.subresourceRange.baseMipLevel = level;
+        barrier.oldLayout = blitSource ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = blitSource ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        readBarriers.push_back(barrier);
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, static_cast<uint32_t>(readBarriers.size()), readBarriers.data());
+}
+
+void WvkUploadBatch::submit() {
+    WVK_PROFILE_ZONE("submit uploads");
+
+    if (submitted || commandBuffer == VK_NULL_HANDLE) return;
+    VkDevice dev = device.getDevice();
+
+    for (Buffer &buffer : stagingBuffers) {
+        vkUnmapMemory(dev, buffer.memory);
+    }
+
+    // One barrier covers every buffer copy, they're read as vertices and indices by later frames
+    if (uploadedBuffers) {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                             1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    checkVulkanError(vkEndCommandBuffer(commandBuffer), "failed to end upload command buffer");
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    checkVulkanError(vkCreateFence(dev, &fenceInfo, nullptr, &fence), "failed to create upload fence");
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    VkResult result = vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, fence);
+    checkVulkanError(result, "failed to submit uploads");
+    submitted = true;
+}
+
+bool WvkUploadBatch::finished() {
+    if (!submitted) return commandBuffer == VK_NULL_HANDLE;
+    return vkGetFenceStatus(device.getDevice(), fence) == VK_SUCCESS;
+}
+
+void WvkUploadBatch::wait() {
+    if (!submitted) return;
+
+    WVK_PROFILE_ZONE("wait for uploads");
+    vkWaitForFences(device.getDevice(), 1, &fence, VK_TRUE, UINT64_MAX);
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "wvk_device.h"
+#include "wvk_buffer.h"
+#include "wvk_image.h"
+#include "texture/texture_data.h"
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+namespace wvk {
+
+/*
+ * Copies from host memory into new device local buffers and images. All copies of a batch are recorded into one
+ * command buffer and submitted with a fence, instead of waiting for the queue to go idle after every copy. The
+ * staging buffers are released once the fence has signaled. Batches are recorded and submitted on the main thread,
+ * which owns the device's command pool and queue.
+ */
+class WvkUploadBatch {
+  public:
+    WvkUploadBatch(WvkDevice &device);
+    // Waits for a submitted batch to finish
+    ~WvkUploadBatch();
+
+    WvkUploadBatch(const WvkUploadBatch &) = delete;
+    WvkUploadBatch &operator=(const WvkUploadBatch &) = delete;
+
+    // Creates buffer in device local memory and records copying size bytes of data into it
+    void uploadBuffer(const void *data, VkDeviceSize size, VkBufferUsageFlags usage, Buffer &buffer);
+    // Same as above for data the caller writes into the returned staging memory, which is valid until submit()
+    void *stageBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Buffer &buffer);
+    // Creates a sampled sRGB RGBA image and records copying the pixels into it, and generating its mip chain
+    void uploadImage(const void *pixels, uint32_t width, uint32_t height, Image &image);
+    // Creates a sampled image with every level of texture. Uncompressed textures without a full mip chain get the
+    // missing levels blitted on the device, block compressed ones are decoded on the CPU if the device doesn't
+    // support their format.
+    void uploadTexture(const TextureView &texture, Image &image);
+
+    bool empty() { return commandBuffer == VK_NULL_HANDLE; }
+    // Bytes staged so far
+    VkDeviceSize getSize() { return stagedSize; }
+
+    // The uploaded buffers and images can be used by command buffers submitted after this. Their contents are only
+    // guaranteed to be there for other queues, or the host, once finished() returns true.
+    void submit();
+    bool finished();
+    void wait();
+
+  private:
+    VkCommandBuffer getCommandBuffer();
+    void *createStagingBuffer(VkDeviceSize size);
+
+    WvkDevice &device;
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    bool submitted = false;
+    bool uploadedBuffers = false;
+
+    std::vector<Buffer> stagingBuffers;
+    VkDeviceSize stagedSize = 0;
+};
+
+}
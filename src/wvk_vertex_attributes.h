@@ -2,68 +2,127 @@
 
 #include "glm.h"
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
 #include <vector>
 #include <array>
+#include <cstdint>
+#include <cstring>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 namespace wvk {
 
+// Unpacked vertex produced by the loaders, packed into a PackedVertex before it is uploaded
 struct MeshVertex {
     glm::vec3 position;
     glm::vec3 normal;
     glm::vec2 tex_coord;
     uint8_t texture_index;
 
+    bool operator==(const MeshVertex& other) const {
+        return position == other.position && tex_coord == other.tex_coord && normal == other.normal && texture_index == other.texture_index;
+    }
+};
+
+// Vertex as read by the mesh pipelines. The position is dequantized with the mesh's Quantization, and the texture
+// index is a per draw material id.
+struct PackedVertex {
+    uint16_t position[4]; // unsigned normalized, w is unused
+    int16_t normal[2];    // octahedral encoded, signed normalized
+    uint16_t texCoord[2]; // half floats
+
     static VkVertexInputBindingDescription getBindingDescription() {
         VkVertexInputBindingDescription bindingDescription{};
 
         bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(MeshVertex);
+        bindingDescription.stride = sizeof(PackedVertex);
         bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
         return bindingDescription;
     }
 
     static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
-        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{4};
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{3};
 
         /* Vertex position */
         attributeDescriptions[0].location = 0;
         attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(MeshVertex, position);
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(PackedVertex, position);
 
         /* Vertex normal */
         attributeDescriptions[1].location = 1;
         attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(MeshVertex, normal);
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+        attributeDescriptions[1].offset = offsetof(PackedVertex, normal);
 
         /* Texture coordinate */
         attributeDescriptions[2].location = 2;
         attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(MeshVertex, tex_coord);
+        attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(PackedVertex, texCoord);
 
-        /* Texture id */
-        attributeDescriptions[3].location = 3;
-        attributeDescriptions[3].binding = 0;
-        attributeDescriptions[3].format = VK_FORMAT_R8_UINT;
-        attributeDescriptions[3].offset = offsetof(MeshVertex, texture_index);
+        return attributeDescriptions;
+    }
+};
+
+// Position stream stored alongside the PackedVertex stream, depth only passes bind just this
+struct PositionVertex {
+    uint16_t position[4]; // same quantized position as the PackedVertex
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(PositionVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{1};
+
+        /* Vertex position */
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(PositionVertex, position);
 
         return attributeDescriptions;
     }
+};
 
-    bool operator==(const MeshVertex& other) const {
-        return position == other.position && tex_coord == other.tex_coord && normal == other.normal && texture_index == other.texture_index;
+// Per-instance data, read from vertex buffer binding 1
+struct InstanceData {
+    glm::mat4 transform;
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(InstanceData);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return bindingDescription;
+    }
+
+    // The transform takes one location per column, starting after the vertex attributes
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(uint32_t firstLocation) {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{4};
+
+        for (uint32_t i = 0; i < 4; i++) {
+            attributeDescriptions[i].location = firstLocation + i;
+            attributeDescriptions[i].binding = 1;
+            attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[i].offset = offsetof(InstanceData, transform) + i * sizeof(glm::vec4);
+        }
+
+        return attributeDescriptions;
     }
 };
 
+// Unpacked skinned vertex produced by the glTF loader, packed into a PackedRiggedVertex before it is uploaded
 struct RiggedMeshVertex {
     glm::vec3 position;
     glm::vec3 normal;
@@ -74,70 +133,142 @@ struct RiggedMeshVertex {
     uint8_t joint2;
     float weight2;
 
+    bool operator==(const RiggedMeshVertex& other) const {
+        return position == other.position && tex_coord == other.tex_coord && normal == other.normal && texture_index == other.texture_index
+            && joint1 == other.joint1 && joint2 == other.joint2 && weight1 == other.weight1 && weight2 == other.weight2;
+    }
+};
+
+// PackedVertex with the skinning data of two joints
+struct PackedRiggedVertex {
+    uint16_t position[4];
+    int16_t normal[2];
+    uint16_t texCoord[2];
+    uint8_t joints[2];
+    uint8_t padding[2];
+    uint16_t weights[2]; // unsigned normalized
+
     static VkVertexInputBindingDescription getBindingDescription() {
         VkVertexInputBindingDescription bindingDescription{};
 
         bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(RiggedMeshVertex);
+        bindingDescription.stride = sizeof(PackedRiggedVertex);
         bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
         return bindingDescription;
     }
 
     static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
-        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{8};
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{5};
 
         /* Vertex position */
         attributeDescriptions[0].location = 0;
         attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(RiggedMeshVertex, position);
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(PackedRiggedVertex, position);
 
         /* Vertex normal */
         attributeDescriptions[1].location = 1;
         attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(RiggedMeshVertex, normal);
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+        attributeDescriptions[1].offset = offsetof(PackedRiggedVertex, normal);
 
         /* Texture coordinate */
         attributeDescriptions[2].location = 2;
         attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(RiggedMeshVertex, tex_coord);
+        attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(PackedRiggedVertex, texCoord);
 
-        /* Texture id */
+        /* Joint ids */
         attributeDescriptions[3].location = 3;
         attributeDescriptions[3].binding = 0;
-        attributeDescriptions[3].format = VK_FORMAT_R8_UINT;
-        attributeDescriptions[3].offset = offsetof(RiggedMeshVertex, texture_index);
+        attributeDescriptions[3].format = VK_FORMAT_R8G8_UINT;
+        attributeDescriptions[3].offset = offsetof(PackedRiggedVertex, joints);
 
+        /* Joint weights */
         attributeDescriptions[4].location = 4;
         attributeDescriptions[4].binding = 0;
-        attributeDescriptions[4].format = VK_FORMAT_R8_UINT;
-        attributeDescriptions[4].offset = offsetof(RiggedMeshVertex, joint1);
+        attributeDescriptions[4].format = VK_FORMAT_R16G16_UNORM;
+        attributeDescriptions[4].offset = offsetof(PackedRiggedVertex, weights);
+
+        return attributeDescriptions;
+    }
+};
 
-        attributeDescriptions[5].location = 5;
-        attributeDescriptions[5].binding = 0;
-        attributeDescriptions[5].format = VK_FORMAT_R8_UINT;
-        attributeDescriptions[5].offset = offsetof(RiggedMeshVertex, joint2);
+// The attributes of a PackedRiggedVertex that depth only passes need, the position and the skinning data
+struct RiggedPositionVertex {
+    uint16_t position[4];
+    uint8_t joints[2];
+    uint8_t padding[2];
+    uint16_t weights[2];
 
-        attributeDescriptions[6].location = 6;
-        attributeDescriptions[6].binding = 0;
-        attributeDescriptions[6].format = VK_FORMAT_R32_SFLOAT;
-        attributeDescriptions[6].offset = offsetof(RiggedMeshVertex, weight1);
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
 
-        attributeDescriptions[7].location = 7;
-        attributeDescriptions[7].binding = 0;
-        attributeDescriptions[7].format = VK_FORMAT_R32_SFLOAT;
-        attributeDescriptions[7].offset = offsetof(RiggedMeshVertex, weight2);
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(RiggedPositionVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{3};
+
+        /* Vertex position */
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(RiggedPositionVertex, position);
+
+        /* Joint ids */
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].format = VK_FORMAT_R8G8_UINT;
+        attributeDescriptions[1].offset = offsetof(RiggedPositionVertex, joints);
+
+        /* Joint weights */
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].format = VK_FORMAT_R16G16_UNORM;
+        attributeDescriptions[2].offset = offsetof(RiggedPositionVertex, weights);
 
         return attributeDescriptions;
     }
+};
 
-    bool operator==(const RiggedMeshVertex& other) const {
-        return position == other.position && tex_coord == other.tex_coord && normal == other.normal && texture_index == other.texture_index
-            && joint1 == other.joint1 && joint2 == other.joint2 && weight1 == other.weight1 && weight2 == other.weight2;
+// The joint indices are padded to keep the weights aligned, shadow and depth passes read these strides
+static_assert(sizeof(PositionVertex) == 8 && sizeof(RiggedPositionVertex) == 16, "position stream strides");
+
+// Hash over every attribute of a vertex, fed one 32 bit word at a time. 0 and -0 compare equal, so they hash alike.
+class VertexHash {
+  public:
+    VertexHash &add(uint32_t value) {
+        hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 32;
+        return *this;
+    }
+
+    VertexHash &add(float value) {
+        if (value == 0.f) value = 0.f;
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return add(bits);
     }
+
+    VertexHash &add(glm::vec2 value) { return add(value.x).add(value.y); }
+    VertexHash &add(glm::vec3 value) { return add(value.x).add(value.y).add(value.z); }
+
+    size_t get() const {
+        uint64_t result = hash;
+        result ^= result >> 33;
+        result *= 0xff51afd7ed558ccdull;
+        result ^= result >> 33;
+        return static_cast<size_t>(result);
+    }
+
+  private:
+    uint64_t hash = 0xcbf29ce484222325ull;
 };
 
 }
@@ -147,13 +278,16 @@ namespace std {
 
 template<> struct hash<wvk::MeshVertex> {
     size_t operator()(wvk::MeshVertex const& vertex) const {
-        return hash<glm::vec3>()(vertex.position) ^ (hash<glm::vec3>()(vertex.normal) << 1);
+        return wvk::VertexHash{}.add(vertex.position).add(vertex.normal).add(vertex.tex_coord)
+                                .add(uint32_t{vertex.texture_index}).get();
     }
 };
 
 template<> struct hash<wvk::RiggedMeshVertex> {
-    size_t operator()(wvk::MeshVertex const& vertex) const {
-        return hash<glm::vec3>()(vertex.position) ^ (hash<glm::vec3>()(vertex.normal) << 1);
+    size_t operator()(wvk::RiggedMeshVertex const& vertex) const {
+        return wvk::VertexHash{}.add(vertex.position).add(vertex.normal).add(vertex.tex_coord)
+                                .add(uint32_t{vertex.texture_index} | uint32_t{vertex.joint1} << 8 | uint32_t{vertex.joint2} << 16)
+                                .add(vertex.weight1).add(vertex.weight2).get();
     }
 };
 